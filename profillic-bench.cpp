@@ -0,0 +1,521 @@
+/**
+ * \file profillic-bench.cpp
+ * \brief
+ * Timed drivers for the profillic-hmmer hot paths, on random profiles
+ * \details
+<pre>
+Usage: profillic-bench [-options]
+
+Options:
+  -h            : show brief help on version and usage
+  -o <f>        : direct the results to file <f>, not stdout
+  -s <n>        : set random number seed to <n>  [42]
+  -N <n>        : number of random models per alphabet and length  [16]
+  --Mmin <n>    : smallest model length  [50]
+  --Mmax <n>    : largest model length (lengths double from --Mmin)  [800]
+  --tmax <n>    : largest number of threads (counts double from 1)  [4]
+  --dna         : only DNA models (default: DNA, then amino)
+  --amino       : only amino acid models
+  --drivers <s> : comma-separated list of drivers to run  [all]
+  --emit <f>    : don't time anything; save the random profiles to <f>
+</pre>
+
+The drivers are:
+
+  modelmaker      profillic_p7_Profillicmodelmaker(), from a profile
+                  and its consensus MSA, as profillic-hmmbuild does
+  profile_to_hmm  profillic_profile_to_hmm()
+  hmm_to_profile  profillic_hmm_to_profile()
+  maxlength       profillic_p7_Builder_MaxLength()
+  calibrate       E-value calibration, split across the threads
+                  as with profillic-hmmbuild --Ecpu
+  unify           profillic_hmm_UnifyTransitions(), as
+                  profillic-hmmunifytransitions does
+  copy            profillic_hmm_CopyTransitions(), as
+                  profillic-hmmcopytransitions does
+
+For each alphabet, each model length M (from --Mmin, doubling up to
+--Mmax), each driver and each thread count (1, 2, 4, ... up to
+--tmax), the -N models are run through the driver once and one
+tab-delimited line is written:
+
+  driver alphabet M threads n wall_s cpu_s wall_per_model_s
+
+Apart from calibrate, the threads share out the models among
+themselves. The first two lines of output are comments ("#"), the
+second naming the columns; the format won't change without updating
+the version on the first. Without HMMER_THREADS, there is just the
+one thread count.
+
+With --emit, the random profiles are instead written to <f> as text,
+separated by lines containing only "//", as profillic-hmmtoprofile
+writes them. With --dna or --amino, that file can be given to
+profillic-hmmbuild as it is.
+ */
+extern "C" {
+#include "p7_config.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+  /// \note TAH 8/12 Workaround for C++ keyword "new" in esl_msa.h
+#define new _new
+#include "esl_msa.h"
+#undef new
+#include "esl_random.h"
+#include "esl_stopwatch.h"
+#include "esl_vectorops.h"
+}
+
+#ifdef HMMER_THREADS
+extern "C" {
+#include "esl_threads.h"
+}
+#endif /*HMMER_THREADS*/
+
+extern "C" {
+#define new _new
+#include "hmmer.h"
+#undef new
+}
+
+/* /////////////// For profillic-hmmer ////////////////////////////////// */
+#include "profillic-hmmer.hpp"
+#include "profillic-p7_builder.hpp"
+#include "profillic-transitions.hpp"
+#include "profillic-profile_sample.hpp"
+
+#include <iostream>
+#include <fstream>
+
+/// Bump this when the columns of the output change.
+#define PROFILLIC_BENCH_FORMAT_VERSION 1
+
+enum profillic_bench_driver_e {
+  PROFILLIC_BENCH_MODELMAKER     = 0,
+  PROFILLIC_BENCH_PROFILE_TO_HMM = 1,
+  PROFILLIC_BENCH_HMM_TO_PROFILE = 2,
+  PROFILLIC_BENCH_MAXLENGTH      = 3,
+  PROFILLIC_BENCH_CALIBRATE      = 4,
+  PROFILLIC_BENCH_UNIFY          = 5,
+  PROFILLIC_BENCH_COPY           = 6
+};
+#define PROFILLIC_BENCH_NDRIVERS 7
+
+static const char *bench_driver_names[PROFILLIC_BENCH_NDRIVERS] = {
+  "modelmaker", "profile_to_hmm", "hmm_to_profile", "maxlength", "calibrate", "unify", "copy"
+};
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range     toggles   reqs   incomp  help   docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "show brief help on version and usage",                         0 },
+  { "-o",        eslARG_OUTFILE, NULL, NULL, NULL,      NULL,  NULL, "--emit", "direct the results to file <f>, not stdout",              0 },
+  { "-s",        eslARG_INT,     "42", NULL, "n>=0",    NULL,  NULL, NULL, "set random number seed to <n>",                                0 },
+  { "-N",        eslARG_INT,     "16", NULL, "n>0",     NULL,  NULL, NULL, "number of random models per alphabet and length",              0 },
+  { "--Mmin",    eslARG_INT,     "50", NULL, "n>1",     NULL,  NULL, NULL, "smallest model length",                                        0 },
+  { "--Mmax",    eslARG_INT,    "800", NULL, "n>1",     NULL,  NULL, NULL, "largest model length (lengths double from --Mmin)",            0 },
+  { "--tmax",    eslARG_INT,      "4", NULL, "n>0",     NULL,  NULL, NULL, "largest number of threads (counts double from 1)",             0 },
+  { "--dna",     eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, "--amino", "only DNA models (default: DNA, then amino)",              0 },
+  { "--amino",   eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, "--dna",   "only amino acid models",                                  0 },
+  { "--drivers", eslARG_STRING, "all", NULL, NULL,      NULL,  NULL, NULL, "comma-separated list of drivers to run",                       0 },
+  { "--emit",    eslARG_OUTFILE, NULL, NULL, NULL,      NULL,  NULL, NULL, "don't time anything; save the random profiles to <f>",        0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+static char usage[]  = "[-options]";
+static char banner[] = "time the profillic-hmmer hot paths on random profiles";
+
+/**
+ * BENCH_SET
+ *
+ * The <n> random models of one alphabet and length <M> that each
+ * driver is run on.  <hmm> and <profile> are only read by the
+ * drivers; what they write to (<scratch>, <outprofile>, <msa>) is
+ * per-model, so the threads can share the models out.
+ */
+template <typename ProfileType>
+struct BENCH_SET {
+  int           n;
+  int           M;
+  ProfileType  *profile;    /**< n random profiles                           */
+  ProfileType  *outprofile; /**< targets for hmm_to_profile                  */
+  P7_HMM      **hmm;        /**< the HMMs the profiles were converted from   */
+  P7_HMM      **scratch;    /**< copies of <hmm>, reset before each run      */
+  ESL_MSA     **msa;        /**< consensus MSAs of the profiles              */
+  P7_BUILDER   *bld;
+  P7_BG        *bg;
+};
+
+template <typename ProfileType>
+struct BENCH_WORKER {
+  BENCH_SET<ProfileType> *set;
+  int                     driver;
+  int                     first;   /**< this worker does models first, first+stride, ... */
+  int                     stride;
+  int                     status;
+};
+
+/**
+ * consensus_msa
+ *
+ * Make the one-sequence consensus MSA of <hmm> that
+ * profillic_p7_Profillicmodelmaker() builds from, as
+ * profillic_esl_msafile_profile_Read() would have made it.
+ */
+static int
+consensus_msa(const ESL_ALPHABET *abc, const P7_HMM *hmm, ESL_MSA **ret_msa)
+{
+  ESL_MSA *msa = NULL;
+  int      k;
+  int      status;
+
+  if ((msa = esl_msa_CreateDigital(abc, 1, hmm->M)) == NULL) { status = eslEMEM; goto ERROR; }
+  if ((status = esl_strdup("Galosh Profile Consensus", -1, &(msa->sqname[0]))) != eslOK) goto ERROR;
+  if ((status = esl_strdup("Galosh Profile",           -1, &(msa->name)))      != eslOK) goto ERROR;
+  msa->ax[0][0] = eslDSQ_SENTINEL;
+  for (k = 1; k <= hmm->M; k++)
+    msa->ax[0][k] = esl_vec_FArgMax(hmm->mat[k], abc->K);
+  msa->ax[0][hmm->M+1] = eslDSQ_SENTINEL;
+  if ((status = esl_msa_SetDefaultWeights(msa)) != eslOK) goto ERROR;
+
+  *ret_msa = msa;
+  return eslOK;
+
+ ERROR:
+  if (msa != NULL) esl_msa_Destroy(msa);
+  *ret_msa = NULL;
+  return status;
+}
+
+template <typename ProfileType>
+static void
+destroy_set(BENCH_SET<ProfileType> *set)
+{
+  int i;
+
+  for (i = 0; i < set->n; i++) {
+    if (set->hmm     != NULL && set->hmm[i]     != NULL) p7_hmm_Destroy(set->hmm[i]);
+    if (set->scratch != NULL && set->scratch[i] != NULL) p7_hmm_Destroy(set->scratch[i]);
+    if (set->msa     != NULL && set->msa[i]     != NULL) esl_msa_Destroy(set->msa[i]);
+  }
+  if (set->hmm     != NULL) free(set->hmm);
+  if (set->scratch != NULL) free(set->scratch);
+  if (set->msa     != NULL) free(set->msa);
+  delete [] set->profile;
+  delete [] set->outprofile;
+  set->hmm = set->scratch = NULL;
+  set->msa = NULL;
+  set->profile = set->outprofile = NULL;
+  set->n = 0;
+}
+
+/**
+ * create_set
+ *
+ * Sample <n> random models of length <M> into <set>.
+ */
+template <typename ProfileType>
+static int
+create_set(ESL_RANDOMNESS *r, const ESL_ALPHABET *abc, P7_BUILDER *bld, P7_BG *bg, int M, int n, BENCH_SET<ProfileType> *set)
+{
+  int i;
+  int status;
+
+  set->n          = 0;
+  set->M          = M;
+  set->profile    = new ProfileType[n];
+  set->outprofile = new ProfileType[n];
+  set->hmm        = NULL;
+  set->scratch    = NULL;
+  set->msa        = NULL;
+  set->bld        = bld;
+  set->bg         = bg;
+
+  ESL_ALLOC_CPP(P7_HMM *,  set->hmm,     sizeof(P7_HMM *)  * n);
+  ESL_ALLOC_CPP(P7_HMM *,  set->scratch, sizeof(P7_HMM *)  * n);
+  ESL_ALLOC_CPP(ESL_MSA *, set->msa,     sizeof(ESL_MSA *) * n);
+  for (i = 0; i < n; i++) set->hmm[i] = set->scratch[i] = NULL;
+  for (i = 0; i < n; i++) set->msa[i] = NULL;
+  set->n = n;
+
+  for (i = 0; i < n; i++) {
+    if ((status = profillic_profile_Sample(r, M, abc, set->profile[i], &(set->hmm[i]))) != eslOK) goto ERROR;
+    if ((set->scratch[i] = p7_hmm_Clone(set->hmm[i]))                              == NULL)  { status = eslEMEM; goto ERROR; }
+    if ((status = consensus_msa(abc, set->hmm[i], &(set->msa[i])))                 != eslOK) goto ERROR;
+  }
+  return eslOK;
+
+ ERROR:
+  destroy_set(set);
+  return status;
+}
+
+/**
+ * run_model
+ *
+ * Run model <i> of <set> through <driver> (anything but calibrate).
+ */
+template <typename ProfileType>
+static int
+run_model(BENCH_SET<ProfileType> *set, int driver, int i)
+{
+  P7_HMM *hmm = NULL;
+  int     status = eslOK;
+
+  switch (driver) {
+  case PROFILLIC_BENCH_MODELMAKER:
+    status = profillic_p7_Profillicmodelmaker(set->bld, set->msa[i], set->profile[i], &hmm, NULL);
+    if (hmm != NULL) p7_hmm_Destroy(hmm);
+    break;
+  case PROFILLIC_BENCH_PROFILE_TO_HMM:
+    if ((status = p7_hmm_Zero(set->scratch[i])) != eslOK) break;
+    status = profillic_profile_to_hmm(set->profile[i], set->scratch[i]);
+    break;
+  case PROFILLIC_BENCH_HMM_TO_PROFILE:
+    status = profillic_hmm_to_profile(set->hmm[i], set->outprofile[i]);
+    break;
+  case PROFILLIC_BENCH_MAXLENGTH:
+    status = profillic_p7_Builder_MaxLength(set->scratch[i], set->bld->w_beta);
+    if (status == eslERANGE) status = eslOK; /* hit the length bound; still a valid timing */
+    break;
+  case PROFILLIC_BENCH_UNIFY:
+    profillic_hmm_UnifyTransitions(set->scratch[i]);
+    break;
+  case PROFILLIC_BENCH_COPY:
+    profillic_hmm_CopyTransitions(set->scratch[i], set->hmm[(i+1) % set->n]);
+    break;
+  default:
+    status = eslEINVAL;
+    break;
+  }
+  return status;
+}
+
+#ifdef HMMER_THREADS
+template <typename ProfileType>
+static void *
+bench_thread(void *arg)
+{
+  ESL_THREADS               *obj = (ESL_THREADS *) arg;
+  BENCH_WORKER<ProfileType> *info;
+  int                        workeridx;
+  int                        i;
+
+  esl_threads_Started(obj, &workeridx);
+  info = (BENCH_WORKER<ProfileType> *) esl_threads_GetData(obj, workeridx);
+
+  for (i = info->first; i < info->set->n && info->status == eslOK; i += info->stride)
+    info->status = run_model(info->set, info->driver, i);
+
+  esl_threads_Finished(obj, workeridx);
+  pthread_exit(NULL);
+  return NULL;
+}
+#endif /*HMMER_THREADS*/
+
+/**
+ * run_driver
+ *
+ * Run every model of <set> through <driver>, using <nthreads> threads.
+ */
+template <typename ProfileType>
+static int
+run_driver(BENCH_SET<ProfileType> *set, int driver, int nthreads)
+{
+  int i;
+  int status;
+
+  if (driver == PROFILLIC_BENCH_CALIBRATE) {
+    for (i = 0; i < set->n; i++)
+      if ((status = calibrate(set->bld, set->scratch[i], set->bg, NULL, NULL, nthreads)) != eslOK) return status;
+    return eslOK;
+  }
+
+#ifdef HMMER_THREADS
+  if (nthreads > 1) {
+    ESL_THREADS               *obj  = NULL;
+    BENCH_WORKER<ProfileType> *info = new BENCH_WORKER<ProfileType>[nthreads];
+
+    if ((obj = esl_threads_Create(&bench_thread<ProfileType>)) == NULL) { delete [] info; return eslEMEM; }
+    for (i = 0; i < nthreads; i++) {
+      info[i].set    = set;
+      info[i].driver = driver;
+      info[i].first  = i;
+      info[i].stride = nthreads;
+      info[i].status = eslOK;
+      esl_threads_AddThread(obj, &info[i]);
+    }
+    esl_threads_WaitForStart(obj);
+    esl_threads_WaitForFinish(obj);
+    esl_threads_Destroy(obj);
+
+    status = eslOK;
+    for (i = 0; i < nthreads; i++)
+      if (info[i].status != eslOK) status = info[i].status;
+    delete [] info;
+    return status;
+  }
+#endif /*HMMER_THREADS*/
+
+  for (i = 0; i < set->n; i++)
+    if ((status = run_model(set, driver, i)) != eslOK) return status;
+  return eslOK;
+}
+
+/**
+ * bench_alphabet
+ *
+ * Time the drivers flagged in <do_driver> on random <ProfileType>
+ * models over <abc>, writing one line per (M, driver, threads) to
+ * <ofp>.  With <emitfp> non-NULL, write the random profiles there
+ * instead.
+ */
+template <typename ProfileType>
+static void
+bench_alphabet(ESL_GETOPTS *go, ESL_RANDOMNESS *r, const ESL_ALPHABET *abc, const int *do_driver, FILE *ofp, std::ofstream *emitfp, int *nemitted)
+{
+  BENCH_SET<ProfileType>  set;
+  P7_BUILDER             *bld      = NULL;
+  P7_BG                  *bg       = NULL;
+  ESL_STOPWATCH          *w        = esl_stopwatch_Create();
+  const char             *alphabet = (abc->type == eslDNA ? "dna" : "amino");
+  int                     N        = esl_opt_GetInteger(go, "-N");
+  int                     Mmax     = esl_opt_GetInteger(go, "--Mmax");
+  int                     tmax     = 1;
+  int                     M, driver, nthreads, i;
+  int                     status;
+
+#ifdef HMMER_THREADS
+  tmax = esl_opt_GetInteger(go, "--tmax");
+#endif
+
+  if ((bld = profillic_p7_builder_Create(NULL, abc)) == NULL) esl_fatal("profillic_p7_builder_Create failed");
+  bld->w_len  = -1;
+  bld->w_beta = p7_DEFAULT_WINDOW_BETA;
+  /* Reseed before each calibration, as profillic-hmmbuild does by default. */
+  esl_randomness_Init(bld->r, esl_opt_GetInteger(go, "-s"));
+  bld->do_reseeding = TRUE;
+  if ((bg = p7_bg_Create(abc)) == NULL) esl_fatal("p7_bg_Create failed");
+
+  for (M = esl_opt_GetInteger(go, "--Mmin"); M <= Mmax; M *= 2)
+    {
+      if ((status = create_set(r, abc, bld, bg, M, N, &set)) != eslOK) esl_fatal("failed to sample %d %s profiles of length %d", N, alphabet, M);
+
+      if (emitfp != NULL) {
+        for (i = 0; i < set.n; i++) {
+          if ((*nemitted)++ > 0) (*emitfp) << "//" << std::endl;
+          (*emitfp) << set.profile[i];
+        }
+        destroy_set(&set);
+        continue;
+      }
+
+      for (driver = 0; driver < PROFILLIC_BENCH_NDRIVERS; driver++)
+        {
+          if (! do_driver[driver]) continue;
+          for (nthreads = 1; nthreads <= tmax; nthreads *= 2)
+            {
+              for (i = 0; i < set.n; i++) p7_hmm_CopyParameters(set.hmm[i], set.scratch[i]);
+
+              esl_stopwatch_Start(w);
+              status = run_driver(&set, driver, nthreads);
+              esl_stopwatch_Stop(w);
+              if (status != eslOK) esl_fatal("driver %s failed (code %d) on %s models of length %d", bench_driver_names[driver], status, alphabet, M);
+
+              fprintf(ofp, "%s\t%s\t%d\t%d\t%d\t%.6f\t%.6f\t%.6f\n",
+                      bench_driver_names[driver], alphabet, M, nthreads, set.n,
+                      w->elapsed, w->user + w->sys, w->elapsed / set.n);
+              fflush(ofp);
+            }
+        }
+      destroy_set(&set);
+    }
+
+  p7_bg_Destroy(bg);
+  profillic_p7_builder_Destroy(bld);
+  esl_stopwatch_Destroy(w);
+}
+
+/**
+ * parse_drivers
+ *
+ * Set <do_driver> from the comma-separated <list> of driver names
+ * (or "all").
+ */
+static int
+parse_drivers(const char *list, int *do_driver, char *errbuf)
+{
+  char *s    = NULL;
+  char *name;
+  int   d;
+  int   status;
+
+  for (d = 0; d < PROFILLIC_BENCH_NDRIVERS; d++) do_driver[d] = (strcmp(list, "all") == 0);
+  if (strcmp(list, "all") == 0) return eslOK;
+
+  if ((status = esl_strdup(list, -1, &s)) != eslOK) goto ERROR;
+  for (name = strtok(s, ","); name != NULL; name = strtok(NULL, ",")) {
+    for (d = 0; d < PROFILLIC_BENCH_NDRIVERS; d++)
+      if (strcmp(name, bench_driver_names[d]) == 0) break;
+    if (d == PROFILLIC_BENCH_NDRIVERS) ESL_XFAIL(eslEINVAL, errbuf, "no such driver %s", name);
+    do_driver[d] = TRUE;
+  }
+  free(s);
+  return eslOK;
+
+ ERROR:
+  if (s != NULL) free(s);
+  return status;
+}
+
+/**
+ * \fn int main(int argc,char **argv)
+ * main driver
+ *
+ */
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go       = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r        = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc      = NULL;
+  FILE           *ofp      = stdout;
+  std::ofstream  *emitfp   = NULL;
+  int             nemitted = 0;
+  int             do_driver[PROFILLIC_BENCH_NDRIVERS];
+  char            errbuf[eslERRBUFSIZE];
+
+  if (parse_drivers(esl_opt_GetString(go, "--drivers"), do_driver, errbuf) != eslOK) p7_Fail("Bad --drivers: %s\n", errbuf);
+
+  if (esl_opt_IsOn(go, "--emit")) {
+    emitfp = new std::ofstream(esl_opt_GetString(go, "--emit"));
+    if (! emitfp->good()) p7_Fail("Failed to open profile file %s for writing\n", esl_opt_GetString(go, "--emit"));
+  } else {
+    if (esl_opt_IsOn(go, "-o") && (ofp = fopen(esl_opt_GetString(go, "-o"), "w")) == NULL) p7_Fail("Failed to open output file %s for writing\n", esl_opt_GetString(go, "-o"));
+    fprintf(ofp, "# profillic-bench format %d; seed %d\n", PROFILLIC_BENCH_FORMAT_VERSION, esl_opt_GetInteger(go, "-s"));
+    fprintf(ofp, "# driver\talphabet\tM\tthreads\tn\twall_s\tcpu_s\twall_per_model_s\n");
+  }
+
+  if (! esl_opt_GetBoolean(go, "--amino")) {
+    abc = esl_alphabet_Create(eslDNA);
+    bench_alphabet<galosh::ProfileTreeRoot<seqan::Dna, floatrealspace> >(go, r, abc, do_driver, ofp, emitfp, &nemitted);
+    esl_alphabet_Destroy(abc);
+  }
+  if (! esl_opt_GetBoolean(go, "--dna")) {
+    abc = esl_alphabet_Create(eslAMINO);
+    bench_alphabet<galosh::ProfileTreeRoot<seqan::AminoAcid20, floatrealspace> >(go, r, abc, do_driver, ofp, emitfp, &nemitted);
+    esl_alphabet_Destroy(abc);
+  }
+
+  if (emitfp != NULL) { emitfp->close(); delete emitfp; }
+  if (ofp != stdout) fclose(ofp);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return 0;
+}
@@ -0,0 +1,360 @@
+/**
+ * \file profillic-build_cache.hpp
+ * \brief
+ * Content hashes of galosh profiles, and an on-disk cache of the
+ * models built from them.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Hashing profiles and build configurations.
+ *     2. The on-disk build cache.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * esl_msa_Checksum() of a profile's consensus-only MSA can't tell two
+ * profiles with the same consensus apart, so it can't say whether a
+ * model built earlier would be built again.  The key used here is a
+ * 64-bit FNV-1a hash (see profillic-hash.hpp) of everything the build
+ * depends on: every parameter of the profile (as
+ * profillic_binary_Encode() packs them) and the probability type it
+ * was read as (--profile-precision), the consensus MSA's sequence
+ * count and annotation lines, and the build configuration
+ * (strategies, effective-number and relative entropy targets, the
+ * prior's mixture Dirichlets, the null model, the calibration sizes
+ * and the RNG seed).
+ *
+ * Cached models are kept one per file, <dir>/<key>.hmm, in HMMER's
+ * binary save format, so they read back bit-for-bit as they were
+ * built.  Stores write a temporary file in <dir> and rename() it into
+ * place, so concurrent builders (threads or processes) sharing a
+ * directory never see a partial model.
+ */
+#ifndef __GALOSH_PROFILLICBUILDCACHE_HPP__
+#define __GALOSH_PROFILLICBUILDCACHE_HPP__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_dirichlet.h"
+#define new _new
+#include "esl_msa.h"
+#undef new
+#include "esl_random.h"
+
+#include "base/p7_bg.h"
+#include "base/p7_hmm.h"
+#include "base/p7_hmmfile.h"
+
+#include "build/p7_builder.h"
+}
+
+#include "profillic-hmmer.hpp"
+#include "profillic-hash.hpp"
+#include "profillic-profile_binary.hpp"
+
+/*****************************************************************
+ *# 1. Hashing profiles and build configurations.
+ *****************************************************************/
+
+/* Bump this whenever the builder changes what it makes of the same
+ * inputs, so that models cached by older versions are not reused.
+ */
+#define PROFILLIC_BUILD_CACHE_VERSION 1
+
+/* Fold mixture Dirichlet <d> (which may be <NULL>) into <h>. */
+static uint64_t
+profillic_hash_Mixdchlet(uint64_t h, const ESL_MIXDCHLET *d)
+{
+  int q;
+
+  if (d == NULL) return profillic_hash_Int(h, -1);
+  h = profillic_hash_Int(h, d->N);
+  h = profillic_hash_Int(h, d->K);
+  h = profillic_hash_Bytes(h, d->pq, sizeof(double) * d->N);
+  for (q = 0; q < d->N; q++) h = profillic_hash_Bytes(h, d->alpha[q], sizeof(double) * d->K);
+  return h;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hash_Profile()
+ *
+ * Purpose:   Return the FNV-1a hash of all of <profile>'s parameters,
+ *            its dimensions (length and alphabet size) and its
+ *            probability type.  The type matters even though the
+ *            parameters are hashed as floats: the builder works from
+ *            the profile's own values, so the same file read as float
+ *            and as double need not build the same model.
+ * </pre>
+ */
+template <typename ProfileType>
+static uint64_t
+profillic_hash_Profile(ProfileType const & profile)
+{
+  typedef typename galosh::profile_traits<ProfileType>::ProbabilityType ProbabilityType;
+  PROFILLIC_BINARY_RECORD rec;
+  std::vector<float>      v;
+  uint64_t                h = PROFILLIC_FNV64_OFFSET;
+
+  profillic_binary_Encode(profile, &rec, v);
+  h = profillic_hash_Bytes(h, &(rec.M),       sizeof(rec.M));
+  h = profillic_hash_Bytes(h, &(rec.K),       sizeof(rec.K));
+  h = profillic_hash_Bytes(h, &(rec.nfloats), sizeof(rec.nfloats));
+  h = profillic_hash_Int  (h, (int) ProfillicPrecision<ProbabilityType>::code);
+  h = profillic_hash_Bytes(h, &( v[ 0 ] ),   sizeof(float) * rec.nfloats);
+  return h;
+}
+
+/* Alignment profiles have no binary form to hash, and aren't cached
+ * (ProfillicProfileKind<>::cacheable); this just lets
+ * profillic_build_cache_Key() instantiate for them. */
+template <typename ResidueType, typename ProbabilityType, typename ScoreType, typename MatrixValueType>
+static uint64_t
+profillic_hash_Profile(galosh::AlignmentProfileAccessor<ResidueType, ProbabilityType, ScoreType, MatrixValueType> const & profile)
+{
+  return PROFILLIC_FNV64_OFFSET;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_build_cache_Key()
+ *
+ * Purpose:   Return the key under which the model that
+ *            profillic_p7_Builder() makes of <profile> (read as the
+ *            consensus-only <msa>, whose esl_msa_Checksum() is
+ *            <msa_checksum>) with builder <bld>, null model <bg>,
+ *            <use_priors> and <calibrate_ncpu>, is cached.
+ *
+ *            The model's name, accession, description, creation time
+ *            and cutoffs are not part of the key: they are taken from
+ *            <msa> afresh on a cache hit.
+ * </pre>
+ */
+template <typename ProfileType>
+static uint64_t
+profillic_build_cache_Key(const P7_BUILDER *bld, const P7_BG *bg, const ESL_MSA *msa, uint32_t msa_checksum,
+                          ProfileType const & profile, int use_priors, int calibrate_ncpu)
+{
+  uint64_t h = profillic_hash_Profile(profile);
+
+  h = profillic_hash_Int   (h, PROFILLIC_BUILD_CACHE_VERSION);
+
+  /* The consensus MSA: what modelmaker and annotation take from it. */
+  h = profillic_hash_Int   (h, msa->nseq);
+  h = profillic_hash_Int   (h, (int) msa->alen);
+  h = profillic_hash_Bytes (h, &msa_checksum, sizeof(uint32_t));
+  h = profillic_hash_String(h, msa->rf);
+  h = profillic_hash_String(h, msa->mm);
+  h = profillic_hash_String(h, msa->ss_cons);
+  h = profillic_hash_String(h, msa->sa_cons);
+
+  /* The build configuration. */
+  h = profillic_hash_Int   (h, bld->abc->type);
+  h = profillic_hash_Int   (h, bld->arch_strategy);
+  h = profillic_hash_Int   (h, bld->wgt_strategy);
+  h = profillic_hash_Int   (h, bld->effn_strategy);
+  h = profillic_hash_Double(h, bld->symfrac);
+  h = profillic_hash_Double(h, bld->fragthresh);
+  h = profillic_hash_Double(h, bld->wid);
+  h = profillic_hash_Double(h, bld->esigma);
+  h = profillic_hash_Double(h, bld->eid);
+  h = profillic_hash_Double(h, bld->eset);
+  h = profillic_hash_Double(h, bld->re_target);
+  h = profillic_hash_Int   (h, bld->max_insert_len);
+  h = profillic_hash_Double(h, bld->w_beta);
+  h = profillic_hash_Int   (h, bld->w_len);
+  h = profillic_hash_Int   (h, bld->EmL);
+  h = profillic_hash_Int   (h, bld->EmN);
+  h = profillic_hash_Int   (h, bld->EvL);
+  h = profillic_hash_Int   (h, bld->EvN);
+  h = profillic_hash_Int   (h, bld->EfL);
+  h = profillic_hash_Int   (h, bld->EfN);
+  h = profillic_hash_Double(h, bld->Eft);
+  h = profillic_hash_Int   (h, use_priors);
+  h = profillic_hash_Int   (h, (int) (bld->prior != NULL));
+  if (bld->prior != NULL) {
+    h = profillic_hash_Mixdchlet(h, bld->prior->tm);
+    h = profillic_hash_Mixdchlet(h, bld->prior->ti);
+    h = profillic_hash_Mixdchlet(h, bld->prior->td);
+    h = profillic_hash_Mixdchlet(h, bld->prior->em);
+    h = profillic_hash_Mixdchlet(h, bld->prior->ei);
+  }
+  h = profillic_hash_Bytes (h, bg->f, sizeof(float) * bg->abc->K);
+
+  /* Calibration: the seed, and how the simulations are split up. */
+  h = profillic_hash_Int   (h, (int) esl_randomness_GetSeed(bld->r));
+  h = profillic_hash_Int   (h, (calibrate_ncpu > 1 ? calibrate_ncpu : 0));
+  return h;
+}
+
+/*---------------------- end, hashing --------------------*/
+
+/*****************************************************************
+ *# 2. The on-disk build cache.
+ *****************************************************************/
+
+typedef struct {
+  char *dir;                    /* directory holding the cached models */
+} PROFILLIC_BUILD_CACHE;
+
+/**
+ * <pre>
+ * Function:  profillic_build_cache_Open()
+ *
+ * Purpose:   Open (creating it, if need be) the build cache in
+ *            directory <dir>, and return it in <*ret_cache>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslFAIL> if <dir> can't be created or isn't a
+ *            directory, with a message in <errbuf>.
+ *
+ * Throws:    <eslEMEM> on allocation error.
+ * </pre>
+ */
+static int
+profillic_build_cache_Open(const char *dir, PROFILLIC_BUILD_CACHE **ret_cache, char *errbuf)
+{
+  PROFILLIC_BUILD_CACHE *cache = NULL;
+  struct stat            st;
+  int                    status;
+
+  if (mkdir(dir, 0777) != 0 && errno != EEXIST) ESL_XFAIL(eslFAIL, errbuf, "Failed to create build cache directory %s", dir);
+  if (stat(dir, &st) != 0 || ! S_ISDIR(st.st_mode)) ESL_XFAIL(eslFAIL, errbuf, "Build cache %s is not a directory", dir);
+
+  ESL_ALLOC_CPP(PROFILLIC_BUILD_CACHE, cache, sizeof(PROFILLIC_BUILD_CACHE));
+  cache->dir = NULL;
+  if ((status = esl_strdup(dir, -1, &(cache->dir))) != eslOK) goto ERROR;
+
+  *ret_cache = cache;
+  return eslOK;
+
+ ERROR:
+  if (cache != NULL) { if (cache->dir != NULL) free(cache->dir); free(cache); }
+  *ret_cache = NULL;
+  return status;
+}
+
+/* The file that the model under <key> is cached in; caller frees it. */
+static int
+profillic_build_cache_Path(const PROFILLIC_BUILD_CACHE *cache, uint64_t key, char **ret_path)
+{
+  return esl_sprintf(ret_path, "%s/%08x%08x.hmm", cache->dir, (unsigned int) (key >> 32), (unsigned int) (key & 0xffffffffU));
+}
+
+/**
+ * <pre>
+ * Function:  profillic_build_cache_Fetch()
+ *
+ * Purpose:   Read the model cached under <key>, in alphabet <abc>,
+ *            into <*ret_hmm>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslENOTFOUND> if nothing is cached under <key>.
+ *            Any other status if the cached file can't be read, with
+ *            a message in <errbuf>.
+ * </pre>
+ */
+static int
+profillic_build_cache_Fetch(const PROFILLIC_BUILD_CACHE *cache, uint64_t key, const ESL_ALPHABET *abc, P7_HMM **ret_hmm, char *errbuf)
+{
+  char         *path    = NULL;
+  P7_HMMFILE   *hfp     = NULL;
+  ESL_ALPHABET *hmm_abc = (ESL_ALPHABET *) abc;
+  P7_HMM       *hmm     = NULL;
+  int           status;
+
+  *ret_hmm = NULL;
+  if ((status = profillic_build_cache_Path(cache, key, &path)) != eslOK) goto ERROR;
+  if (access(path, R_OK) != 0) { status = eslENOTFOUND; goto ERROR; }
+
+  if ((status = p7_hmmfile_OpenE(path, NULL, &hfp, errbuf)) != eslOK) goto ERROR;
+  if ((status = p7_hmmfile_Read(hfp, &hmm_abc, &hmm))       != eslOK) ESL_XFAIL(status, errbuf, "Failed to read cached model %s", path);
+
+  p7_hmmfile_Close(hfp);
+  free(path);
+  *ret_hmm = hmm;
+  return eslOK;
+
+ ERROR:
+  if (hfp  != NULL) p7_hmmfile_Close(hfp);
+  if (hmm  != NULL) p7_hmm_Destroy(hmm);
+  if (path != NULL) free(path);
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_build_cache_Store()
+ *
+ * Purpose:   Cache <hmm> under <key>, replacing anything cached there.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslFAIL> if the model can't be written, with a message
+ *            in <errbuf>.
+ *
+ * Throws:    <eslEMEM> on allocation error.
+ * </pre>
+ */
+static int
+profillic_build_cache_Store(const PROFILLIC_BUILD_CACHE *cache, uint64_t key, P7_HMM *hmm, char *errbuf)
+{
+  char *path    = NULL;
+  char *tmppath = NULL;
+  FILE *fp      = NULL;
+  int   fd      = -1;
+  int   status;
+
+  if ((status = profillic_build_cache_Path(cache, key, &path))    != eslOK) goto ERROR;
+  if ((status = esl_sprintf(&tmppath, "%s.XXXXXX", path))         != eslOK) goto ERROR;
+  if ((fd = mkstemp(tmppath)) < 0)                                 ESL_XFAIL(eslFAIL, errbuf, "Failed to create a temporary file in build cache %s", cache->dir);
+  if ((fp = fdopen(fd, "wb")) == NULL)                              ESL_XFAIL(eslFAIL, errbuf, "Failed to open temporary file %s", tmppath);
+  fd = -1;
+
+  if ((status = p7_hmmfile_WriteBinary(fp, -1, hmm)) != eslOK)      ESL_XFAIL(eslFAIL, errbuf, "Failed to write cached model %s", tmppath);
+  status = fclose(fp);
+  fp     = NULL;
+  if (status != 0)                                                  ESL_XFAIL(eslFAIL, errbuf, "Failed to write cached model %s", tmppath);
+  if (rename(tmppath, path) != 0)                                   ESL_XFAIL(eslFAIL, errbuf, "Failed to move cached model into place as %s", path);
+
+  free(tmppath);
+  free(path);
+  return eslOK;
+
+ ERROR:
+  if (fp      != NULL) fclose(fp);
+  if (fd      >= 0)    close(fd);
+  if (tmppath != NULL) { remove(tmppath); free(tmppath); }
+  if (path    != NULL) free(path);
+  return status;
+}
+
+/* Free a build cache opened by profillic_build_cache_Open(); the cached models stay on disk. */
+static void
+profillic_build_cache_Close(PROFILLIC_BUILD_CACHE *cache)
+{
+  if (cache == NULL) return;
+  if (cache->dir != NULL) free(cache->dir);
+  free(cache);
+}
+
+/*---------------------- end, build cache --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICBUILDCACHE_HPP__
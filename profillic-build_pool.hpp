@@ -0,0 +1,373 @@
+/**
+ * \file profillic-build_pool.hpp
+ * \brief
+ * Per-worker pools of the objects that building each model would
+ * otherwise allocate and free afresh.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. The pool.
+ *     2. Pooled models.
+ *     3. Pooled sequences and scratch space.
+ *     4. Copyright and license.
+ * </pre>
+ *
+ * Building thousands of small families from several threads at once
+ * spends a surprising share of its time in malloc() and free(), with
+ * the threads contending for the allocator.  Each worker therefore
+ * keeps a pool: the <ESL_SQ> that --single builds fetch their sequence
+ * into, the scratch space of the window-length engine
+ * (profillic-maxlength.hpp), and a few spare <P7_HMM>s, whose bodies
+ * are reused in place for later models that fit in them.
+ *
+ * Models are given back to the pool of the worker that built them by
+ * whoever is done with them (in profillic-hmmbuild, the output
+ * writer), so the spares are guarded by a mutex; the sequence and the
+ * scratch space are only ever used by their own worker.
+ *
+ * A pool reuses the body of any model it is given back, including
+ * ones made by HMMER's own constructors, but only models built from
+ * galosh profiles (profillic_p7_Profillicmodelmaker()) are taken from
+ * it: HMMER's model makers allocate theirs internally.
+ */
+#ifndef __GALOSH_PROFILLICBUILDPOOL_HPP__
+#define __GALOSH_PROFILLICBUILDPOOL_HPP__
+
+#include <stdlib.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+#define new _new
+#include "esl_msa.h"
+#undef new
+#include "esl_sq.h"
+
+#include "base/p7_hmm.h"
+}
+
+#ifdef HMMER_THREADS
+#include <pthread.h>
+#endif
+
+#include "profillic-hmmer.hpp"
+
+/*****************************************************************
+ *# 1. The pool.
+ *****************************************************************/
+
+/* Spare models a worker keeps, by default. */
+#define PROFILLIC_POOL_NHMM 8
+
+/* A model's body, and the length it was allocated for. */
+typedef struct {
+  P7_HMM *hmm;
+  int     Mcap;
+} PROFILLIC_POOLED_HMM;
+
+typedef struct {
+  const ESL_ALPHABET   *abc;
+  PROFILLIC_POOLED_HMM *spare;    /* models given back, ready for reuse          */
+  int                   nspare;
+  int                   maxspare; /* 0: models aren't pooled                     */
+  PROFILLIC_POOLED_HMM *lent;     /* reused models out on loan with Mcap > M     */
+  int                   nlent;
+  int                   nlentalloc;
+  ESL_SQ               *sq;       /* --single builds' sequence; made when needed */
+  double               *scratch;
+  int                   nscratch; /* doubles allocated in <scratch>              */
+#ifdef HMMER_THREADS
+  pthread_mutex_t       mutex;    /* for <spare> and <lent>                      */
+#endif
+} PROFILLIC_BUILD_POOL;
+
+/**
+ * <pre>
+ * Function:  profillic_build_pool_Create()
+ *
+ * Purpose:   Create a pool for a worker that builds models in alphabet
+ *            <abc>, keeping up to <maxspare> spare models (0 for none,
+ *            when the worker doesn't build from galosh profiles).
+ *
+ * Throws:    <NULL> on allocation or mutex initialization failure.
+ * </pre>
+ */
+static PROFILLIC_BUILD_POOL *
+profillic_build_pool_Create(const ESL_ALPHABET *abc, int maxspare)
+{
+  PROFILLIC_BUILD_POOL *pool = NULL;
+  int                   status;
+
+  ESL_ALLOC_CPP(PROFILLIC_BUILD_POOL, pool, sizeof(PROFILLIC_BUILD_POOL));
+  pool->abc        = abc;
+  pool->spare      = NULL;
+  pool->nspare     = 0;
+  pool->maxspare   = maxspare;
+  pool->lent       = NULL;
+  pool->nlent      = 0;
+  pool->nlentalloc = 0;
+  pool->sq         = NULL;
+  pool->scratch    = NULL;
+  pool->nscratch   = 0;
+  if (maxspare > 0) ESL_ALLOC_CPP(PROFILLIC_POOLED_HMM, pool->spare, sizeof(PROFILLIC_POOLED_HMM) * maxspare);
+#ifdef HMMER_THREADS
+  if (pthread_mutex_init(&pool->mutex, NULL) != 0) goto ERROR;
+#endif
+  return pool;
+
+ ERROR:
+  if (pool != NULL) { if (pool->spare != NULL) free(pool->spare); free(pool); }
+  return NULL;
+}
+
+/* Free <pool> and its spares; models still out on loan are the borrowers' to destroy. */
+static void
+profillic_build_pool_Destroy(PROFILLIC_BUILD_POOL *pool)
+{
+  int i;
+
+  if (pool == NULL) return;
+  for (i = 0; i < pool->nspare; i++) p7_hmm_Destroy(pool->spare[i].hmm);
+  if (pool->spare   != NULL) free(pool->spare);
+  if (pool->lent    != NULL) free(pool->lent);
+  if (pool->sq      != NULL) esl_sq_Destroy(pool->sq);
+  if (pool->scratch != NULL) free(pool->scratch);
+#ifdef HMMER_THREADS
+  pthread_mutex_destroy(&pool->mutex);
+#endif
+  free(pool);
+}
+
+/*---------------------- end, the pool --------------------*/
+
+/*****************************************************************
+ *# 2. Pooled models.
+ *****************************************************************/
+
+static void
+profillic_build_pool_Lock(PROFILLIC_BUILD_POOL *pool)
+{
+#ifdef HMMER_THREADS
+  if (pthread_mutex_lock(&pool->mutex) != 0) esl_fatal("mutex lock failed");
+#endif
+}
+
+static void
+profillic_build_pool_Unlock(PROFILLIC_BUILD_POOL *pool)
+{
+#ifdef HMMER_THREADS
+  if (pthread_mutex_unlock(&pool->mutex) != 0) esl_fatal("mutex unlock failed");
+#endif
+}
+
+/**
+ * <pre>
+ * Function:  profillic_build_pool_ResetHmm()
+ *
+ * Purpose:   Make <hmm>, whose body was allocated for at least <M>
+ *            nodes, into the model of <M> nodes that
+ *            <p7_hmm_Create(M, abc)> would have returned: its optional
+ *            annotation is freed, its fields are unset, and its
+ *            probabilities are zeroed, with the same conventions on
+ *            the unused distributions.
+ *
+ *            Relies on p7_hmm_CreateBody() allocating each of <t>,
+ *            <mat> and <ins> as one block, with row <k> at the same
+ *            place whatever the model's length.
+ * </pre>
+ */
+static void
+profillic_build_pool_ResetHmm(P7_HMM *hmm, int M)
+{
+  int z;
+
+  if (hmm->name      != NULL) { free(hmm->name);      hmm->name      = NULL; }
+  if (hmm->acc       != NULL) { free(hmm->acc);       hmm->acc       = NULL; }
+  if (hmm->desc      != NULL) { free(hmm->desc);      hmm->desc      = NULL; }
+  if (hmm->rf        != NULL) { free(hmm->rf);        hmm->rf        = NULL; }
+  if (hmm->mm        != NULL) { free(hmm->mm);        hmm->mm        = NULL; }
+  if (hmm->consensus != NULL) { free(hmm->consensus); hmm->consensus = NULL; }
+  if (hmm->cs        != NULL) { free(hmm->cs);        hmm->cs        = NULL; }
+  if (hmm->ca        != NULL) { free(hmm->ca);        hmm->ca        = NULL; }
+  if (hmm->comlog    != NULL) { free(hmm->comlog);    hmm->comlog    = NULL; }
+  if (hmm->ctime     != NULL) { free(hmm->ctime);     hmm->ctime     = NULL; }
+  if (hmm->map       != NULL) { free(hmm->map);       hmm->map       = NULL; }
+
+  hmm->M          = M;
+  hmm->nseq       = -1;
+  hmm->eff_nseq   = -1.0;
+  hmm->max_length = -1;
+  hmm->checksum   = 0;
+  hmm->offset     = 0;
+  hmm->flags      = 0;
+  for (z = 0; z < p7_NCUTOFFS; z++) hmm->cutoff[z]  = p7_CUTOFF_UNSET;
+  for (z = 0; z < p7_NEVPARAM; z++) hmm->evparam[z] = p7_EVPARAM_UNSET;
+  for (z = 0; z < p7_MAXABET;  z++) hmm->compo[z]   = p7_COMPO_UNSET;
+
+  p7_hmm_Zero(hmm);
+  hmm->mat[0][0]    = 1.0;
+  hmm->t[0][p7H_DM] = 1.0;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_build_pool_CreateHmm()
+ *
+ * Purpose:   Return a new model of <M> nodes in alphabet <abc>, as
+ *            <p7_hmm_Create()> does, but reusing a spare from <pool>
+ *            when one fits: the smallest spare allocated for between
+ *            <M> and 2*<M> nodes (a bigger one would hold on to memory
+ *            it doesn't need).  <pool> may be <NULL>.
+ *
+ *            Give the model back with <profillic_build_pool_DestroyHmm()>,
+ *            to any thread.
+ *
+ * Throws:    <NULL> on allocation failure.
+ * </pre>
+ */
+static P7_HMM *
+profillic_build_pool_CreateHmm(PROFILLIC_BUILD_POOL *pool, int M, const ESL_ALPHABET *abc)
+{
+  PROFILLIC_POOLED_HMM e;
+  int                  best = -1;
+  int                  i;
+  int                  status;
+
+  if (pool == NULL || pool->maxspare == 0 || abc != pool->abc) return p7_hmm_Create(M, abc);
+
+  profillic_build_pool_Lock(pool);
+  for (i = 0; i < pool->nspare; i++)
+    if (pool->spare[i].Mcap >= M && pool->spare[i].Mcap <= 2 * M && (best < 0 || pool->spare[i].Mcap < pool->spare[best].Mcap)) best = i;
+  if (best < 0) { profillic_build_pool_Unlock(pool); return p7_hmm_Create(M, abc); }
+
+  e = pool->spare[best];
+  pool->spare[best] = pool->spare[--(pool->nspare)];
+
+  /* Remember what a shortened model's body can really hold, for when it comes back */
+  if (e.Mcap > M)
+    {
+      if (pool->nlent == pool->nlentalloc)
+        {
+          ESL_REALLOC_CPP(PROFILLIC_POOLED_HMM, pool->lent, sizeof(PROFILLIC_POOLED_HMM) * (pool->nlentalloc + 8));
+          pool->nlentalloc += 8;
+        }
+      pool->lent[pool->nlent++] = e;
+    }
+  profillic_build_pool_Unlock(pool);
+
+  profillic_build_pool_ResetHmm(e.hmm, M);
+  return e.hmm;
+
+ ERROR:
+  profillic_build_pool_Unlock(pool);
+  profillic_build_pool_ResetHmm(e.hmm, M); /* it can still be handed out; it just won't be known as shortened */
+  return e.hmm;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_build_pool_DestroyHmm()
+ *
+ * Purpose:   Give <hmm> back to <pool>, for reuse, or destroy it if the
+ *            pool is full (or <NULL>, or not pooling models).  <hmm>
+ *            need not have come from the pool.
+ * </pre>
+ */
+static void
+profillic_build_pool_DestroyHmm(PROFILLIC_BUILD_POOL *pool, P7_HMM *hmm)
+{
+  int Mcap;
+  int i;
+
+  if (hmm == NULL) return;
+  if (pool == NULL || pool->maxspare == 0 || hmm->abc != pool->abc) { p7_hmm_Destroy(hmm); return; }
+
+  profillic_build_pool_Lock(pool);
+  Mcap = hmm->M;
+  for (i = pool->nlent - 1; i >= 0; i--)
+    if (pool->lent[i].hmm == hmm) { Mcap = pool->lent[i].Mcap; pool->lent[i] = pool->lent[--(pool->nlent)]; break; }
+
+  if (pool->nspare < pool->maxspare)
+    {
+      pool->spare[pool->nspare].hmm  = hmm;
+      pool->spare[pool->nspare].Mcap = Mcap;
+      pool->nspare++;
+      hmm = NULL;
+    }
+  profillic_build_pool_Unlock(pool);
+
+  if (hmm != NULL) p7_hmm_Destroy(hmm);
+}
+
+/*---------------------- end, pooled models --------------------*/
+
+/*****************************************************************
+ *# 3. Pooled sequences and scratch space.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_build_pool_GetSq()
+ *
+ * Purpose:   Fetch sequence <idx> of digital <msa> into <pool>'s own
+ *            sequence, reused from one call to the next, and return it
+ *            in <*ret_sq>; it stays <pool>'s, valid until the next
+ *            call.
+ *
+ * Returns:   <eslOK> on success; otherwise <esl_sq_GetFromMSA()>'s
+ *            failure status.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+static int
+profillic_build_pool_GetSq(PROFILLIC_BUILD_POOL *pool, const ESL_MSA *msa, int idx, ESL_SQ **ret_sq)
+{
+  int status;
+
+  *ret_sq = NULL;
+  if (pool->sq == NULL && (pool->sq = esl_sq_CreateDigital(msa->abc)) == NULL) return eslEMEM;
+  esl_sq_Reuse(pool->sq);
+  if ((status = esl_sq_GetFromMSA(msa, idx, pool->sq)) != eslOK) return status;
+  *ret_sq = pool->sq;
+  return eslOK;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_build_pool_Scratch()
+ *
+ * Purpose:   Return <pool>'s scratch space, grown to at least <n>
+ *            doubles if need be; it stays <pool>'s.  <pool> may be
+ *            <NULL>, and then so is the result.
+ *
+ * Throws:    <NULL> on allocation failure.
+ * </pre>
+ */
+static double *
+profillic_build_pool_Scratch(PROFILLIC_BUILD_POOL *pool, int n)
+{
+  int status;
+
+  if (pool == NULL) return NULL;
+  if (pool->nscratch < n)
+    {
+      ESL_REALLOC_CPP(double, pool->scratch, sizeof(double) * n);
+      pool->nscratch = n;
+    }
+  return pool->scratch;
+
+ ERROR:
+  return NULL;
+}
+
+/*---------------------- end, sequences and scratch --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICBUILDPOOL_HPP__
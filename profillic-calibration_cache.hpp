@@ -0,0 +1,303 @@
+/**
+ * \file profillic-calibration_cache.hpp
+ * \brief
+ * A persistent cache of E-value calibrations, for recalibrating
+ * libraries of mostly unchanged models.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Calibration cache keys.
+ *     2. Opening, looking up, adding to and closing the cache.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * A calibration depends only on the model's parameters, the sizes of
+ * the simulations and the RNG seed (when the RNG is reseeded for each
+ * model, as it is unless the seed is 0).  The cache maps a hash of
+ * those (profillic_calibration_cache_Key()) to the <evparam> values
+ * that p7_Calibrate() came up with.
+ *
+ * The cache is a text file, one calibration per line:
+ *
+ * <pre>
+ *   # profillic calibration cache
+ *   &lt;key, 16 hex digits&gt; &lt;evparam[0]&gt; ... &lt;evparam[p7_NEVPARAM-1]&gt;
+ * </pre>
+ *
+ * It is read whole when opened, and new calibrations are appended to
+ * it as they are added; a key that appears more than once takes its
+ * last values.  The table read at opening is not changed afterwards,
+ * so lookups may be made from any number of threads at once, while
+ * additions (which only write to the file) are made from one.
+ */
+#ifndef __GALOSH_PROFILLICCALIBRATIONCACHE_HPP__
+#define __GALOSH_PROFILLICCALIBRATIONCACHE_HPP__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_fileparser.h"
+#include "esl_keyhash.h"
+#include "esl_vectorops.h"
+
+#include "base/p7_hmm.h"
+#include "build/p7_builder.h"
+}
+
+#include "profillic-hmmer.hpp"
+#include "profillic-hash.hpp"
+
+/*****************************************************************
+ *# 1. Calibration cache keys.
+ *****************************************************************/
+
+/* Bump this whenever calibration changes what it makes of the same
+ * inputs, so that calibrations cached by older versions are not reused.
+ */
+#define PROFILLIC_CALIBRATION_CACHE_VERSION 1
+#define PROFILLIC_CALIBRATION_CACHE_KEYLEN  16
+
+/**
+ * <pre>
+ * Function:  profillic_calibration_cache_Key()
+ *
+ * Purpose:   Return the key under which the calibration of <hmm> by
+ *            p7_Calibrate() with configuration <cfg_b> (or, if
+ *            <cfg_b> is <NULL>, p7_Calibrate()'s defaults), starting
+ *            from RNG seed <seed>, is cached.
+ * </pre>
+ */
+static uint64_t
+profillic_calibration_cache_Key(const P7_HMM *hmm, const P7_BUILDER *cfg_b, uint32_t seed)
+{
+  uint64_t h = profillic_hash_Hmm(PROFILLIC_FNV64_OFFSET, hmm);
+
+  h = profillic_hash_Int   (h, PROFILLIC_CALIBRATION_CACHE_VERSION);
+  h = profillic_hash_Int   (h, (cfg_b != NULL ? cfg_b->EmL : 200));
+  h = profillic_hash_Int   (h, (cfg_b != NULL ? cfg_b->EmN : 200));
+  h = profillic_hash_Int   (h, (cfg_b != NULL ? cfg_b->EvL : 200));
+  h = profillic_hash_Int   (h, (cfg_b != NULL ? cfg_b->EvN : 200));
+  h = profillic_hash_Int   (h, (cfg_b != NULL ? cfg_b->EfL : 100));
+  h = profillic_hash_Int   (h, (cfg_b != NULL ? cfg_b->EfN : 200));
+  h = profillic_hash_Double(h, (cfg_b != NULL ? cfg_b->Eft : 0.04));
+  h = profillic_hash_Bytes (h, &seed, sizeof(uint32_t));
+  return h;
+}
+
+/* Write <key> as PROFILLIC_CALIBRATION_CACHE_KEYLEN hex digits (and a '\0') to <s>. */
+static void
+profillic_calibration_cache_FormatKey(uint64_t key, char *s)
+{
+  snprintf(s, PROFILLIC_CALIBRATION_CACHE_KEYLEN + 1, "%08x%08x", (unsigned int) (key >> 32), (unsigned int) (key & 0xffffffffU));
+}
+
+/*---------------------- end, cache keys --------------------*/
+
+/*****************************************************************
+ *# 2. Opening, looking up, adding to and closing the cache.
+ *****************************************************************/
+
+typedef struct {
+  char        *path;
+  FILE        *fp;        /* <path>, open for appending new calibrations        */
+  ESL_KEYHASH *kh;        /* the keys read from <path> at opening               */
+  float       *evparam;   /* p7_NEVPARAM values for each key, in <kh>'s order   */
+  int          nalloc;    /* number of keys <evparam> has room for              */
+  int          nhit;      /* tallies kept by the caller, for its summary: models */
+  int          nmiss;     /*   whose calibration was found, and wasn't          */
+} PROFILLIC_CALIBRATION_CACHE;
+
+/* Read the calibrations in the existing cache file <cache->path> into <cache>. */
+static int
+profillic_calibration_cache_Load(PROFILLIC_CALIBRATION_CACHE *cache, char *errbuf)
+{
+  ESL_FILEPARSER *efp = NULL;
+  char           *tok;
+  int             toklen;
+  char            key[PROFILLIC_CALIBRATION_CACHE_KEYLEN + 1];
+  int             idx;
+  int             z;
+  int             status;
+
+  if (esl_fileparser_Open(cache->path, NULL, &efp) != eslOK) ESL_XFAIL(eslFAIL, errbuf, "Failed to open calibration cache %s", cache->path);
+  esl_fileparser_SetCommentChar(efp, '#');
+
+  while ((status = esl_fileparser_NextLine(efp)) == eslOK)
+    {
+      if (esl_fileparser_GetTokenOnLine(efp, &tok, &toklen) != eslOK || toklen != PROFILLIC_CALIBRATION_CACHE_KEYLEN)
+        ESL_XFAIL(eslEFORMAT, errbuf, "Bad key at line %d of calibration cache %s", efp->linenumber, cache->path);
+      memcpy(key, tok, PROFILLIC_CALIBRATION_CACHE_KEYLEN);
+      key[PROFILLIC_CALIBRATION_CACHE_KEYLEN] = '\0';
+
+      status = esl_keyhash_Store(cache->kh, key, PROFILLIC_CALIBRATION_CACHE_KEYLEN, &idx);
+      if (status != eslOK && status != eslEDUP) goto ERROR; /* a repeated key takes its last values */
+      if (idx >= cache->nalloc) {
+        cache->nalloc *= 2;
+        ESL_REALLOC_CPP(float, cache->evparam, sizeof(float) * p7_NEVPARAM * cache->nalloc);
+      }
+
+      for (z = 0; z < p7_NEVPARAM; z++) {
+        if (esl_fileparser_GetTokenOnLine(efp, &tok, &toklen) != eslOK)
+          ESL_XFAIL(eslEFORMAT, errbuf, "Too few values at line %d of calibration cache %s", efp->linenumber, cache->path);
+        cache->evparam[idx * p7_NEVPARAM + z] = (float) atof(tok);
+      }
+    }
+  if (status != eslEOF) ESL_XFAIL(status, errbuf, "Failed to read calibration cache %s", cache->path);
+
+  esl_fileparser_Close(efp);
+  return eslOK;
+
+ ERROR:
+  if (efp != NULL) esl_fileparser_Close(efp);
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_calibration_cache_Open()
+ *
+ * Purpose:   Open the calibration cache file <path>, reading the
+ *            calibrations in it if it exists and creating it if it
+ *            doesn't, and return it in <*ret_cache>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslFAIL> if <path> can't be read or written, or
+ *            <eslEFORMAT> if it isn't a calibration cache, with a
+ *            message in <errbuf>.
+ *
+ * Throws:    <eslEMEM> on allocation error.
+ * </pre>
+ */
+static int
+profillic_calibration_cache_Open(const char *path, PROFILLIC_CALIBRATION_CACHE **ret_cache, char *errbuf)
+{
+  PROFILLIC_CALIBRATION_CACHE *cache = NULL;
+  int                          exists;
+  int                          status;
+
+  ESL_ALLOC_CPP(PROFILLIC_CALIBRATION_CACHE, cache, sizeof(PROFILLIC_CALIBRATION_CACHE));
+  cache->path    = NULL;
+  cache->fp      = NULL;
+  cache->kh      = NULL;
+  cache->evparam = NULL;
+  cache->nalloc  = 256;
+  cache->nhit    = 0;
+  cache->nmiss   = 0;
+
+  if ((status = esl_strdup(path, -1, &(cache->path))) != eslOK) goto ERROR;
+  if ((cache->kh = esl_keyhash_Create())              == NULL)  { status = eslEMEM; goto ERROR; }
+  ESL_ALLOC_CPP(float, cache->evparam, sizeof(float) * p7_NEVPARAM * cache->nalloc);
+
+  exists = (access(path, F_OK) == 0);
+  if (exists && (status = profillic_calibration_cache_Load(cache, errbuf)) != eslOK) goto ERROR;
+
+  if ((cache->fp = fopen(path, "a")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open calibration cache %s for writing", path);
+  if (! exists && fprintf(cache->fp, "# profillic calibration cache\n") < 0) ESL_XFAIL(eslFAIL, errbuf, "Failed to write calibration cache %s", path);
+
+  *ret_cache = cache;
+  return eslOK;
+
+ ERROR:
+  if (cache != NULL) {
+    if (cache->fp      != NULL) fclose(cache->fp);
+    if (cache->kh      != NULL) esl_keyhash_Destroy(cache->kh);
+    if (cache->evparam != NULL) free(cache->evparam);
+    if (cache->path    != NULL) free(cache->path);
+    free(cache);
+  }
+  *ret_cache = NULL;
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_calibration_cache_Lookup()
+ *
+ * Purpose:   If a calibration is cached under <key>, copy its
+ *            <p7_NEVPARAM> values into <evparam>.  Only the
+ *            calibrations read at opening are found.
+ *
+ * Returns:   <eslOK> if found; <eslENOTFOUND> if not, and <evparam>
+ *            is untouched.
+ * </pre>
+ */
+static int
+profillic_calibration_cache_Lookup(const PROFILLIC_CALIBRATION_CACHE *cache, uint64_t key, float *evparam)
+{
+  char keystr[PROFILLIC_CALIBRATION_CACHE_KEYLEN + 1];
+  int  idx;
+
+  profillic_calibration_cache_FormatKey(key, keystr);
+  if (esl_keyhash_Lookup(cache->kh, keystr, PROFILLIC_CALIBRATION_CACHE_KEYLEN, &idx) != eslOK) return eslENOTFOUND;
+  esl_vec_FCopy(cache->evparam + idx * p7_NEVPARAM, p7_NEVPARAM, evparam);
+  return eslOK;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_calibration_cache_Add()
+ *
+ * Purpose:   Append calibration <evparam> (of length <p7_NEVPARAM>)
+ *            under <key> to the cache file, for later runs.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslFAIL> on a write error, with a message in <errbuf>.
+ * </pre>
+ */
+static int
+profillic_calibration_cache_Add(PROFILLIC_CALIBRATION_CACHE *cache, uint64_t key, const float *evparam, char *errbuf)
+{
+  char keystr[PROFILLIC_CALIBRATION_CACHE_KEYLEN + 1];
+  int  z;
+
+  profillic_calibration_cache_FormatKey(key, keystr);
+  if (fputs(keystr, cache->fp) < 0) ESL_FAIL(eslFAIL, errbuf, "Failed to write calibration cache %s", cache->path);
+  for (z = 0; z < p7_NEVPARAM; z++)
+    if (fprintf(cache->fp, " %.9g", evparam[z]) < 0) ESL_FAIL(eslFAIL, errbuf, "Failed to write calibration cache %s", cache->path);
+  if (fputc('\n', cache->fp) == EOF)                 ESL_FAIL(eslFAIL, errbuf, "Failed to write calibration cache %s", cache->path);
+  return eslOK;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_calibration_cache_Close()
+ *
+ * Purpose:   Close and free <cache>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslFAIL> if the cache file couldn't be finished, with a
+ *            message in <errbuf>.
+ * </pre>
+ */
+static int
+profillic_calibration_cache_Close(PROFILLIC_CALIBRATION_CACHE *cache, char *errbuf)
+{
+  int status = eslOK;
+
+  if (cache == NULL) return eslOK;
+  if (cache->fp != NULL && fclose(cache->fp) != 0) {
+    status = eslFAIL;
+    if (errbuf != NULL) snprintf(errbuf, eslERRBUFSIZE, "Failed to finish writing calibration cache %s", cache->path);
+  }
+  esl_keyhash_Destroy(cache->kh);
+  free(cache->evparam);
+  free(cache->path);
+  free(cache);
+  return status;
+}
+
+/*---------------------- end, the cache --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICCALIBRATIONCACHE_HPP__
@@ -0,0 +1,290 @@
+/**
+ * \file profillic-compress.hpp
+ * \brief
+ * Reading and writing gzip- and zstd-compressed profile, alignment and
+ * HMM files as streams.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Recognizing compressed files.
+ *     2. Compressed input.
+ *     3. Compressed output.
+ *     4. Copyright and license.
+ * </pre>
+ *
+ * A file whose name ends in ``.gz'' or ``.zst'' is taken to be gzip-
+ * or zstd-compressed.  Such inputs are read through a pipe from
+ * <gzip -dc> or <zstd -dc>, and such outputs are written through a
+ * pipe to <gzip -c> or <zstd -q -c>, so nothing is ever decompressed
+ * to (or compressed from) scratch disk.  The (de)compressor is a
+ * separate process, so compression proceeds in the background, on
+ * another CPU, while the tool computes; and closing an output waits
+ * for it to finish.
+ *
+ * Easel's <esl_buffer_Open()> already reads ``.gz'' files this way;
+ * profillic_buffer_Open() adds ``.zst'', and so covers galosh profiles
+ * and alignments.  p7_hmmfile_OpenE() takes a file name, so
+ * profillic_hmmfile_OpenE() hands it the decompressor's pipe as
+ * </dev/fd/N>; HMMER reads HMM files strictly sequentially, peeking
+ * at (not rewinding past) the format's magic number.
+ *
+ * Compressed outputs can't seek, so binary profile files and
+ * --press databases (which are also memory-mapped or indexed by file
+ * offset) can't be compressed; callers refuse those.
+ */
+#ifndef __GALOSH_PROFILLICCOMPRESS_HPP__
+#define __GALOSH_PROFILLICCOMPRESS_HPP__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_buffer.h"
+#define new _new
+#include "hmmer.h"
+#undef new
+}
+
+#include "profillic-hmmer.hpp"
+
+/*****************************************************************
+ *# 1. Recognizing compressed files.
+ *****************************************************************/
+
+#define PROFILLIC_COMPRESS_NONE 0
+#define PROFILLIC_COMPRESS_GZIP 1
+#define PROFILLIC_COMPRESS_ZSTD 2
+
+/* The compression of file <path>, by its suffix: PROFILLIC_COMPRESS_NONE, _GZIP (".gz") or _ZSTD (".zst"). */
+static int
+profillic_compress_Type(const char *path)
+{
+  size_t n = (path == NULL ? 0 : strlen(path));
+
+  if (n > 3 && strcmp(path + n - 3, ".gz")  == 0) return PROFILLIC_COMPRESS_GZIP;
+  if (n > 4 && strcmp(path + n - 4, ".zst") == 0) return PROFILLIC_COMPRESS_ZSTD;
+  return PROFILLIC_COMPRESS_NONE;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_compress_Command()
+ *
+ * Purpose:   Create in <*ret_cmd> the shell command <cmdfmt> (which has
+ *            one "%s") with <path> substituted, single-quoted for the
+ *            shell, so that any file name is safe to pass.
+ *
+ * Returns:   <eslOK> on success; caller frees <*ret_cmd>.
+ *
+ * Throws:    <eslEMEM> on allocation failure; <*ret_cmd> is <NULL>.
+ * </pre>
+ */
+static int
+profillic_compress_Command(const char *cmdfmt, const char *path, char **ret_cmd)
+{
+  char       *quoted = NULL;
+  const char *s;
+  char       *q;
+  int         status;
+
+  /* at worst every character is a ' that becomes '\'' */
+  ESL_ALLOC_CPP(char, quoted, sizeof(char) * (4 * strlen(path) + 3));
+  q = quoted;
+  *q++ = '\'';
+  for (s = path; *s != '\0'; s++)
+    {
+      if (*s == '\'') { memcpy(q, "'\\''", 4); q += 4; }
+      else            *q++ = *s;
+    }
+  *q++ = '\'';
+  *q   = '\0';
+
+  status = esl_sprintf(ret_cmd, cmdfmt, quoted);
+  free(quoted);
+  return status;
+
+ ERROR:
+  *ret_cmd = NULL;
+  return status;
+}
+
+/*---------------------- end, recognizing compressed files --------------------*/
+
+/*****************************************************************
+ *# 2. Compressed input.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_buffer_Open()
+ *
+ * Purpose:   As <esl_buffer_Open()>, which reads ``-'' from <stdin>
+ *            and a ``.gz'' file through <gzip -dc>; and also read a
+ *            ``.zst'' file through <zstd -dc>.
+ *
+ * Returns:   as <esl_buffer_Open()>: <eslOK> on success;
+ *            <eslENOTFOUND> if <filename> isn't found; <eslFAIL> if
+ *            the decompressor fails (<*ret_bf> then holds an error
+ *            message, in <(*ret_bf)->errmsg>).
+ *
+ * Throws:    as <esl_buffer_Open()>.
+ * </pre>
+ */
+static int
+profillic_buffer_Open(const char *filename, const char *env, ESL_BUFFER **ret_bf)
+{
+  if (profillic_compress_Type(filename) == PROFILLIC_COMPRESS_ZSTD)
+    return esl_buffer_OpenPipe(filename, env, "zstd -dc %s 2>/dev/null", ret_bf);
+  return esl_buffer_Open(filename, env, ret_bf);
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmmfile_OpenE()
+ *
+ * Purpose:   As <p7_hmmfile_OpenE(filename, NULL, ret_hfp, errbuf)>,
+ *            but if <filename> ends in ``.gz'' or ``.zst'', read it
+ *            through a pipe from <gzip -dc> or <zstd -dc>, returned in
+ *            <*ret_pipe> (else <*ret_pipe> is <NULL>).  Close with
+ *            profillic_hmmfile_Close().
+ *
+ * Returns:   as <p7_hmmfile_OpenE()>, with a message in <errbuf> on
+ *            normal errors: <eslOK> on success; <eslENOTFOUND> if
+ *            <filename> doesn't exist, or the decompressor can't be
+ *            started; <eslEFORMAT> if it isn't an HMM file (or the
+ *            decompressor failed on it).
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+static int
+profillic_hmmfile_OpenE(const char *filename, P7_HMMFILE **ret_hfp, FILE **ret_pipe, char *errbuf)
+{
+  FILE *zfp  = NULL;
+  char *cmd  = NULL;
+  char  devpath[32];
+  int   status;
+
+  *ret_pipe = NULL;
+  if (profillic_compress_Type(filename) == PROFILLIC_COMPRESS_NONE)
+    return p7_hmmfile_OpenE((char *) filename, NULL, ret_hfp, errbuf);
+
+  *ret_hfp = NULL;
+  if (! esl_FileExists(filename)) ESL_XFAIL(eslENOTFOUND, errbuf, "HMM file %s not found", filename);
+  if (profillic_compress_Type(filename) == PROFILLIC_COMPRESS_GZIP) status = profillic_compress_Command("gzip -dc %s 2>/dev/null", filename, &cmd);
+  else                                                               status = profillic_compress_Command("zstd -dc %s 2>/dev/null", filename, &cmd);
+  if (status != eslOK) goto ERROR;
+  if ((zfp = popen(cmd, "r")) == NULL) ESL_XFAIL(eslENOTFOUND, errbuf, "Failed to start the decompressor for HMM file %s", filename);
+
+  snprintf(devpath, 32, "/dev/fd/%d", fileno(zfp));
+  if ((status = p7_hmmfile_OpenE(devpath, NULL, ret_hfp, errbuf)) != eslOK) goto ERROR;
+
+  free(cmd);
+  *ret_pipe = zfp;
+  return eslOK;
+
+ ERROR:
+  if (zfp  != NULL) pclose(zfp);
+  if (cmd  != NULL) free(cmd);
+  *ret_hfp = NULL;
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmmfile_Close()
+ *
+ * Purpose:   Close <hfp>, and the decompression pipe <zfp> it was
+ *            read from (if not <NULL>), from profillic_hmmfile_OpenE().
+ *
+ * Returns:   <eslOK> on success; <eslFAIL> if the decompressor
+ *            failed, as it does on a truncated or corrupt file.  (A
+ *            decompressor killed by SIGPIPE just had more to give
+ *            than the caller read.)
+ * </pre>
+ */
+static int
+profillic_hmmfile_Close(P7_HMMFILE *hfp, FILE *zfp)
+{
+  int wstatus;
+
+  if (hfp != NULL) p7_hmmfile_Close(hfp);
+  if (zfp == NULL) return eslOK;
+  if ((wstatus = pclose(zfp)) == -1)                                 return eslFAIL;
+  if (WIFEXITED(wstatus)   && WEXITSTATUS(wstatus) != 0)             return eslFAIL;
+  if (WIFSIGNALED(wstatus) && WTERMSIG(wstatus)    != SIGPIPE)       return eslFAIL;
+  return eslOK;
+}
+
+/*---------------------- end, compressed input --------------------*/
+
+/*****************************************************************
+ *# 3. Compressed output.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_ofile_Open()
+ *
+ * Purpose:   As <fopen(path, "w")>, but if <path> ends in ``.gz'' or
+ *            ``.zst'', write it through a pipe to <gzip -c> or
+ *            <zstd -q -c>.  Close with profillic_ofile_Close().
+ *
+ *            <path> is first opened (and truncated) directly, so a
+ *            file that can't be written fails here, not when the
+ *            compressor starts.
+ *
+ * Returns:   the open stream; or <NULL> if <path> can't be opened for
+ *            writing, or the compressor can't be started.
+ * </pre>
+ */
+static FILE *
+profillic_ofile_Open(const char *path)
+{
+  FILE *fp  = NULL;
+  char *cmd = NULL;
+  int   type = profillic_compress_Type(path);
+
+  if ((fp = fopen(path, "w")) == NULL) return NULL;
+  if (type == PROFILLIC_COMPRESS_NONE) return fp;
+  fclose(fp);
+
+  if (type == PROFILLIC_COMPRESS_GZIP) { if (profillic_compress_Command("gzip -c > %s",    path, &cmd) != eslOK) return NULL; }
+  else                                 { if (profillic_compress_Command("zstd -q -c > %s", path, &cmd) != eslOK) return NULL; }
+  fp = popen(cmd, "w");
+  free(cmd);
+  return fp;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_ofile_Close()
+ *
+ * Purpose:   Close <fp>, opened on <path> by profillic_ofile_Open(),
+ *            waiting for its compressor (if any) to finish.
+ *
+ * Returns:   0 on success; <EOF> if the remaining output couldn't be
+ *            written, or the compressor failed (as <fclose()>).
+ * </pre>
+ */
+static int
+profillic_ofile_Close(FILE *fp, const char *path)
+{
+  if (profillic_compress_Type(path) == PROFILLIC_COMPRESS_NONE) return fclose(fp);
+  return (pclose(fp) == 0 ? 0 : EOF);
+}
+
+/*---------------------- end, compressed output --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICCOMPRESS_HPP__
@@ -0,0 +1,103 @@
+/**
+ * \file profillic-consensus_msa.hpp
+ * \brief
+ * Consensus-only MSAs, standing in for the alignment behind a galosh
+ * alignment profile.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Creating and querying consensus-only MSAs.
+ *     2. Copyright and license.
+ * </pre>
+ *
+ * An alignment profile is read as an MSA with one row (its consensus),
+ * but it was trained on <orig_nseq> sequences, and the model built from
+ * it should say so in <hmm->nseq> and <eff_nseq>.  Rather than setting
+ * <msa->nseq> to <orig_nseq> (and allocating, or pretending to have,
+ * that many rows), the MSA has the one row, whose weight is
+ * <orig_nseq>: it stands for that many sequences.  Memory is O(profile
+ * length), and the MSA is an honest one-sequence MSA to everything
+ * that walks its rows.
+ */
+#ifndef __GALOSH_PROFILLICCONSENSUSMSA_HPP__
+#define __GALOSH_PROFILLICCONSENSUSMSA_HPP__
+
+extern "C" {
+#include "easel.h"
+#include "esl_alphabet.h"
+#define new _new
+#include "esl_msa.h"
+#undef new
+}
+
+/*****************************************************************
+ *# 1. Creating and querying consensus-only MSAs.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_esl_msa_CreateConsensus()
+ *
+ * Purpose:   Create a growable MSA with exactly one (empty) row, digital
+ *            if <abc> is non-<NULL>, standing for <orig_nseq>
+ *            sequences (1 if <orig_nseq> < 1).  The caller fills in
+ *            row 0 (name, sequence, <alen>) and destroys it with
+ *            <esl_msa_Destroy()> as usual.
+ *
+ * Returns:   <eslOK> on success, and <*ret_msa> is the new MSA.
+ *
+ * Throws:    <eslEMEM> on allocation error, and <*ret_msa> is <NULL>.
+ * </pre>
+ */
+static int
+profillic_esl_msa_CreateConsensus(const ESL_ALPHABET *abc, int orig_nseq, ESL_MSA **ret_msa)
+{
+  ESL_MSA *msa = NULL;
+  int      status;
+
+#ifdef eslAUGMENT_ALPHABET
+  if (abc != NULL) msa = esl_msa_CreateDigital(abc, 1, -1);
+  else
+#endif
+                   msa = esl_msa_Create(1, -1);
+  if (msa == NULL) { status = eslEMEM; goto ERROR; }
+
+  msa->nseq    = 1;
+  msa->wgt[0]  = (double) ESL_MAX(orig_nseq, 1);
+  msa->flags  |= eslMSA_HASWGTS;
+
+  *ret_msa = msa;
+  return eslOK;
+
+ ERROR:
+  if (msa != NULL) esl_msa_Destroy(msa);
+  *ret_msa = NULL;
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_esl_msa_Nseq()
+ *
+ * Purpose:   Return the number of sequences <msa> stands for: for a
+ *            one-row MSA with a weight of one or more (as made by
+ *            profillic_esl_msa_CreateConsensus()), that weight; for
+ *            any other MSA, <msa->nseq>.
+ * </pre>
+ */
+static int
+profillic_esl_msa_Nseq(const ESL_MSA *msa)
+{
+  if (msa->nseq == 1 && (msa->flags & eslMSA_HASWGTS) && msa->wgt[0] >= 1.0) return (int) msa->wgt[0];
+  return msa->nseq;
+}
+
+/*---------------------- end, consensus-only MSAs --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICCONSENSUSMSA_HPP__
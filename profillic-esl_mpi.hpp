@@ -0,0 +1,177 @@
+/**
+ * \file profillic-esl_mpi.hpp
+ * \brief
+ * MPI communication of galosh profiles (for profillic-hmmbuild --mpi)
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Communicating galosh profiles.
+ *     2. Copyright and license.
+ * </pre>
+ *
+ * A galosh profile travels as its own text serialization (exactly what
+ * operator<<() writes to a profile file), packed as an <int> length
+ * followed by that many <MPI_CHAR>s.  The master sends it right after
+ * the consensus <ESL_MSA> it goes with, on the same tag, so MPI's
+ * non-overtaking guarantee keeps the pair together.
+ */
+#ifndef __GALOSH_PROFILLICESLMPI_HPP__
+#define __GALOSH_PROFILLICESLMPI_HPP__
+
+#ifdef HAVE_MPI
+
+#include <string>
+#include <sstream>
+
+extern "C" {
+#include "mpi.h"
+#include "easel.h"
+}
+
+#include "profillic-hmmer.hpp"
+
+/*****************************************************************
+ *# 1. Communicating galosh profiles.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_profile_MPISend()
+ * Synopsis:  Send a galosh profile as an MPI message.
+ *
+ * Purpose:   Sends galosh profile <*profile_ptr> to processor number
+ *            <dest> (in communicator <comm>), with MPI tag <tag>.
+ *            This is the profile that goes with the <ESL_MSA> most
+ *            recently sent to <dest> by <esl_msa_MPISend()>.
+ *
+ *            In order to minimize alloc/free cycles, the caller
+ *            passes the same working buffer <*buf> of size <*nalloc>
+ *            that it uses for <esl_msa_MPISend()>; it is reallocated
+ *            here if needed.
+ *
+ * Returns:   <eslOK> on success; <*buf> may have been reallocated and
+ *            <*nalloc> may have been increased.
+ *
+ * Throws:    <eslESYS> if an MPI call fails; <eslEMEM> if a realloc()
+ *            fails. In either case, <*buf> and <*nalloc> remain valid
+ *            and useful memory (though the contents of <*buf> are
+ *            undefined).
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_profile_MPISend(ProfileType const * profile_ptr, int dest, int tag, MPI_Comm comm, char **buf, int *nalloc)
+{
+  std::ostringstream profile_stream;
+  std::string        profile_string;
+  int                len;
+  int                n = 0;
+  int                sz, pos;
+  int                status;
+
+  profile_stream << *profile_ptr;
+  profile_string = profile_stream.str();
+  len            = (int) profile_string.length();
+
+  /* Figure out size; reallocate buf if needed */
+  if (MPI_Pack_size(1,   MPI_INT,  comm, &sz) != 0) ESL_XEXCEPTION(eslESYS, "pack size failed");  n += sz;
+  if (MPI_Pack_size(len, MPI_CHAR, comm, &sz) != 0) ESL_XEXCEPTION(eslESYS, "pack size failed");  n += sz;
+  if (*nalloc < n) {
+    ESL_REALLOC_CPP(char, *buf, sizeof(char) * n);
+    *nalloc = n;
+  }
+
+  /* Pack the length, then the text */
+  pos = 0;
+  if (MPI_Pack(&len, 1, MPI_INT, *buf, n, &pos, comm)                                        != 0) ESL_XEXCEPTION(eslESYS, "pack failed");
+  if (MPI_Pack(const_cast<char *>(profile_string.c_str()), len, MPI_CHAR, *buf, n, &pos, comm) != 0) ESL_XEXCEPTION(eslESYS, "pack failed");
+
+  /* Send the packed profile to the destination. */
+  if (MPI_Send(*buf, n, MPI_PACKED, dest, tag, comm) != 0) ESL_XEXCEPTION(eslESYS, "mpi send failed");
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_profile_MPIRecv()
+ * Synopsis:  Receive a galosh profile as an MPI message.
+ *
+ * Purpose:   Receive a galosh profile from <source> (where <source>
+ *            is usually 0, the master process), with tag <tag>, and
+ *            parse it into the caller's <*profile_ptr>.
+ *
+ *            Caller provides a working buffer <*buf> of size
+ *            <*nalloc> characters, as for <esl_msa_MPIRecv()>. These
+ *            are passed by reference, so that <*buf> can be
+ *            reallocated and <*nalloc> increased if necessary.
+ *
+ * Returns:   <eslOK> on success. <*profile_ptr> holds the profile;
+ *            <*buf> may have been reallocated and <*nalloc> increased.
+ *
+ * Throws:    <eslEMEM> on allocation error; <eslESYS> on MPI call
+ *            failure. <*profile_ptr> is unspecified.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_profile_MPIRecv(int source, int tag, MPI_Comm comm, char **buf, int *nalloc, ProfileType * profile_ptr)
+{
+  std::string  profile_string;
+  int          n;
+  int          len;
+  int          pos;
+  MPI_Status   mpistatus;
+  int          status;
+
+  if (MPI_Probe(source, tag, comm, &mpistatus)  != 0) ESL_XEXCEPTION(eslESYS, "mpi probe failed");
+  if (MPI_Get_count(&mpistatus, MPI_PACKED, &n) != 0) ESL_XEXCEPTION(eslESYS, "mpi get count failed");
+  if (*nalloc < n) {
+    ESL_REALLOC_CPP(char, *buf, sizeof(char) * n);
+    *nalloc = n;
+  }
+  if (MPI_Recv(*buf, n, MPI_PACKED, source, tag, comm, &mpistatus) != 0) ESL_XEXCEPTION(eslESYS, "mpi recv failed");
+
+  pos = 0;
+  if (MPI_Unpack(*buf, n, &pos, &len, 1, MPI_INT, comm) != 0) ESL_XEXCEPTION(eslESYS, "mpi unpack failed");
+  profile_string.resize(len);
+  if (len > 0 && MPI_Unpack(*buf, n, &pos, &(profile_string[0]), len, MPI_CHAR, comm) != 0) ESL_XEXCEPTION(eslESYS, "mpi unpack failed");
+
+  profile_ptr->fromString( profile_string );
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* Alignment profiles aren't sent to MPI workers
+ * (ProfillicAlignmentProfiles::shippable, in profillic-profile_kind.hpp);
+ * these just let the MPI master and workers of
+ * profillic-hmmbuild_driver.hpp instantiate for them. */
+template <typename ResidueType, typename ProbabilityType, typename ScoreType, typename MatrixValueType>
+int
+profillic_profile_MPISend(galosh::AlignmentProfileAccessor<ResidueType, ProbabilityType, ScoreType, MatrixValueType> const * profile_ptr, int dest, int tag, MPI_Comm comm, char **buf, int *nalloc)
+{
+  ESL_EXCEPTION(eslEUNIMPLEMENTED, "galosh alignment profiles can't be sent to MPI workers");
+}
+
+template <typename ResidueType, typename ProbabilityType, typename ScoreType, typename MatrixValueType>
+int
+profillic_profile_MPIRecv(int source, int tag, MPI_Comm comm, char **buf, int *nalloc, galosh::AlignmentProfileAccessor<ResidueType, ProbabilityType, ScoreType, MatrixValueType> * profile_ptr)
+{
+  ESL_EXCEPTION(eslEUNIMPLEMENTED, "galosh alignment profiles can't be received from the MPI master");
+}
+
+/*---------------------- end, communicating galosh profiles -------*/
+
+#endif /*HAVE_MPI*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICESLMPI_HPP__
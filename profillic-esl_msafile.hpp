@@ -47,6 +47,9 @@ extern "C" {
 #include "esl_msa.h"
 }
 #undef new
+#include "profillic-consensus_msa.hpp"
+#include "profillic-profile_kind.hpp"
+#include "profillic-compress.hpp"
 #define eslMSAFILE_PROFILLIC       98103  /* A galosh profile (from profillic)   */
 #define PRId64 "d"
 
@@ -62,6 +65,10 @@ template <typename ProfileType>
 static int
 profillic_esl_msafile_profile_Read(ESLX_MSAFILE *afp, ESL_MSA **ret_msa, ProfileType * profile_ptr );
 
+template <typename ProfileType>
+static int
+profillic_esl_msa_CreateFromProfile(const ESL_ALPHABET *abc, ProfileType const & profile, ESL_MSA **ret_msa, char *errbuf);
+
 /* /////////////// End profillic-hmmer ////////////////////////////////// */
 
 
@@ -82,10 +89,11 @@ static int profillic_msafile_OpenBuffer(ESL_ALPHABET **byp_abc, ESL_BUFFER *bf,
  *
  *            <msafile> is usually the name of a file. Alignments may
  *            also be read from standard input, or from
- *            gzip-compressed files.  If <msafile> is ``-'', alignment
- *            input is taken from the standard input stream. If
- *            <msafile> ends in ``.gz'', alignment input is read
- *            through a pipe from <gzip -dc>.
+ *            gzip- or zstd-compressed files.  If <msafile> is ``-'',
+ *            alignment input is taken from the standard input
+ *            stream. If <msafile> ends in ``.gz'' (or ``.zst''),
+ *            alignment input is read through a pipe from <gzip -dc>
+ *            (or <zstd -dc>).
  *            
  *            <byp_abc>, <env>, <format>, and <fmtd> support a variety
  *            of optional/advanced operations, as described
@@ -163,7 +171,8 @@ static int profillic_msafile_OpenBuffer(ESL_ALPHABET **byp_abc, ESL_BUFFER *bf,
  *                        If <*byp_abc> is a digital alphabet, use it.
  *            msafile   - name of alignment input to open;
  *                        if "-", read standard input;
- *                        if "*.gz", read through a <gzip -dc> pipe.
+ *                        if "*.gz", read through a <gzip -dc> pipe;
+ *                        if "*.zst", read through a <zstd -dc> pipe.
  *            env       - <NULL>, or the name of an environment variable
  *                        containing colon-delimited list of directories
  *                        in which to search for <msafile> (e.g. "PFAMDB").
@@ -178,9 +187,9 @@ static int profillic_msafile_OpenBuffer(ESL_ALPHABET **byp_abc, ESL_BUFFER *bf,
  * Returns:   <eslOK> on success, and <*ret_afp> is the newly opened msa file.
  *
  *            <eslENOTFOUND> if <msafile> doesn't exist or can't be
- *            opened for reading; or (in the case of a <.gz> file) if
- *            a <gzip> executable doesn't exist in user's <PATH> or
- *            can't be executed. <afp->errmsg> is something like 
+ *            opened for reading; or (in the case of a <.gz> or <.zst>
+ *            file) if a <gzip> or <zstd> executable doesn't exist in
+ *            user's <PATH> or can't be executed. <afp->errmsg> is something like 
  *            "couldn't open %s for reading", with <%s> being the 
  *            name of the msafile.
  *
@@ -194,8 +203,8 @@ static int profillic_msafile_OpenBuffer(ESL_ALPHABET **byp_abc, ESL_BUFFER *bf,
  *            mode w/ alphabet autodetection) but the alphabet could
  *            not be reliably guessed.
  *            
- *            <eslFAIL> in the case of a <.gz> file and the <gzip -dc>
- *            command fails on it.
+ *            <eslFAIL> in the case of a <.gz> or <.zst> file and the
+ *            <gzip -dc> or <zstd -dc> command fails on it.
  *            
  *            On any of these normal errors, <*ret_afp> is returned in
  *            an error state, containing a user-directed error message
@@ -220,7 +229,7 @@ profillic_eslx_msafile_Open(ESL_ALPHABET **byp_abc, const char *msafile, const c
 
   if ( (status = profillic_msafile_Create(&afp)) != eslOK) goto ERROR;
 
-  if ((status = esl_buffer_Open(msafile, env, &(afp->bf))) != eslOK)
+  if ((status = profillic_buffer_Open(msafile, env, &(afp->bf))) != eslOK)
     ESL_XFAIL(status, afp->errmsg, "%s", afp->bf->errmsg); /* ENOTFOUND; FAIL are normal here */
 
   if ( (status = profillic_msafile_OpenBuffer(byp_abc, afp->bf, format, fmtd, afp)) != eslOK) goto ERROR;
@@ -438,13 +447,34 @@ profillic_eslx_msafile_Read(ESLX_MSAFILE *afp, ESL_MSA **ret_msa, ProfileType *
  *
  * Synopsis:  Read a profillic/galosh profile.
  *
- * Purpose: Parse the Profile HMM from an open galosh profile format
- *            file (from profillic) <afp>, leaving the profile in
+ * Purpose: Parse the next Profile HMM from an open galosh profile format
+ *            file (from profillic, or an alignment profile from
+ *            profuse) <afp>, leaving the profile in
  *            <ret_profile>. Also create a new
  *            MSA, and return it by reference through 
  *            <*ret_msa>. Caller is responsible for freeing
  *            this <ESL_MSA>.
  *
+ *            Profiles are read one record at a time from <afp->bf>,
+ *            so <afp> may be a pipe or the standard input. A file
+ *            may hold several profiles, each one terminated by a
+ *            line containing only <//> (as in Stockholm and HMMER
+ *            save files); the terminator after the last (or only)
+ *            profile is optional. Blank lines between records are
+ *            skipped.
+ *
+ *            A binary profile file (see profillic-profile_binary.hpp)
+ *            is recognized by its leading tag, and its profiles are
+ *            then taken straight from the buffer without a text parse.
+ *
+ *            What differs between a ProfileTreeRoot and an
+ *            AlignmentProfileAccessor <ProfileType> (how it's read,
+ *            where its consensus starts, and whether the consensus
+ *            row is weighted by the profile's original number of
+ *            sequences) is ProfillicProfileKind<ProfileType>'s; see
+ *            profillic-profile_kind.hpp. An alignment profile is read
+ *            whole, from <afp->bf->filename>.
+ *
  * Args:      <afp>     - open <ESL_MSAFILE> to read from
  *            <ret_msa> - RETURN: newly parsed, created <ESL_MSA>
  *
@@ -473,68 +503,88 @@ template <typename ProfileType>
 static int
 profillic_esl_msafile_profile_Read(ESLX_MSAFILE *afp, ESL_MSA **ret_msa, ProfileType * profile_ptr )
 {
-  /// \note Right now this isn't actually using the open file pointer; for convenience I just use the profile.fromFile( <filename> ) method.
-  /// \todo Use convenience fns in esl_buffer.h; see eg hmmer-3.1/easel/esl_msafile_stockholm.c for examples...
+  ESL_MSA *msa = NULL;
+  int      status;
+
+  ESL_DASSERT1((afp->format == eslMSAFILE_PROFILLIC));
+
+  if (profile_ptr == NULL)  { ESL_EXCEPTION(eslEINCONCEIVABLE, "profile_ptr is NULL in profillic_esl_msafile_profile_Read(..)!"); }
+  afp->errmsg[0] = '\0';
+
+  if ((status = ProfillicProfileKind<ProfileType>::Read(afp, profile_ptr))           != eslOK) goto ERROR;
+  if ((status = profillic_esl_msa_CreateFromProfile(afp->abc, *profile_ptr, &msa, afp->errmsg)) != eslOK) goto ERROR;
+
+  if (ret_msa != NULL) *ret_msa = msa; else esl_msa_Destroy(msa);
+  return eslOK;
+
+ ERROR:
+  if (msa != NULL)      esl_msa_Destroy(msa);
+  if (ret_msa != NULL) *ret_msa = NULL;
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_esl_msa_CreateFromProfile()
+ *
+ * Synopsis:  Make the consensus-only MSA for a galosh profile.
+ *
+ * Purpose:   Create in <*ret_msa> the one-row MSA that
+ *            profillic_p7_Builder() builds <profile>'s model from: its
+ *            consensus (the most likely residue at every match
+ *            position), named as a read profile is, digital if <abc>
+ *            is non-<NULL>. For profillic_esl_msafile_profile_Read(),
+ *            and for callers that have the profile in memory already
+ *            (profillic-lib.hpp).
+ *
+ *            Where the consensus starts, and whether its row is
+ *            weighted by the profile's original number of sequences,
+ *            are ProfillicProfileKind<ProfileType>'s.
+ *
+ * Returns:   <eslOK> on success; caller destroys <*ret_msa>.
+ *
+ *            <eslEFORMAT> if the consensus isn't valid in <abc>, with
+ *            a message in <errbuf>; <*ret_msa> is <NULL>.
+ *
+ * Throws:    <eslEMEM> on allocation error; <*ret_msa> is <NULL>.
+ * </pre>
+ */
+template <typename ProfileType>
+static int
+profillic_esl_msa_CreateFromProfile(const ESL_ALPHABET *abc, ProfileType const & profile, ESL_MSA **ret_msa, char *errbuf)
+{
+  typedef ProfillicProfileKind<ProfileType> Kind;
+
   ESL_MSA                 *msa      = NULL;
-  string profile_string;
-  char *buf;
-  long len;
   int                      seqidx;
   int                      status;
   char       errmsg2[eslERRBUFSIZE];
 
-  ESL_DASSERT1((afp->format == eslMSAFILE_PROFILLIC));
-
-  const char * const seqname = "Galosh Profile Consensus";
-  const char * const msaname = "Galosh Profile";
+  const char * const seqname = ( Kind::position_offset ? "Galosh Alignment Profile Consensus" : "Galosh Profile Consensus" );
+  const char * const msaname = ( Kind::position_offset ? "Galosh Alignment Profile"           : "Galosh Profile" );
   uint32_t profile_length;
-  galosh::Sequence<typename ProfileType::ProfileResidueType> consensus_sequence;
+  galosh::Sequence<typename Kind::ResidueType> consensus_sequence;
   stringstream tmp_consensus_output_stream;
 
   uint32_t pos_i;
 
-  if (profile_ptr == NULL)  { ESL_EXCEPTION(eslEINCONCEIVABLE, "profile_ptr is NULL in profillic_esl_msafile_profile_Read(..)!"); }
-  //if (feof(afp->bf->fp))  { status = eslEOF; goto ERROR; }
-  afp->errmsg[0] = '\0';
-
-  // Read in the galosh profile (from profillic)
-  //fseek( afp->bf->fp, 0, SEEK_END ); // go to the end
-  //len = afp->bf->ftell( afp->bf->fp ); // get the position at the end (length)
-  //fseek( afp->bf->fp, 0, SEEK_SET ); // go to the beginning again.
-
-  //ESL_ALLOC_CPP( char, buf, sizeof( char ) * len ); //malloc buffer
-  //fread( buf, len, 1, afp->bf->fp ); //read into buffer
-
-  //profile_string = buf;
-  //profile_ptr->fromString( profile_string );
-  profile_ptr->fromFile( afp->bf->filename );
-  //if (buf)      free(buf);
-  // \todo WHY WON'T THIS WORK?  See HACKs in profillic-hmmbuild.cpp to work around it.
-  //fseek( afp->bf->fp, 0, SEEK_END ); // go to the end (to signal there's no more profiles in the file, the next time we come to this function)
-
-  // Calculate the consensus sequence.
-  profile_length = profile_ptr->length();
+  // Calculate the consensus sequence: the "most likely" character at
+  // every position.  An alignment profile's position 0 is its Begin
+  // state, which has no residue of its own.
+  profile_length = profile.length() - Kind::position_offset;
   consensus_sequence.reinitialize( profile_length );
   for( pos_i = 0; pos_i < profile_length; pos_i++ ) {
     consensus_sequence[ pos_i ] =
-      ( *profile_ptr )[ pos_i ][ galosh::Emission::Match ].maximumValueType();
+      profile[ pos_i + Kind::position_offset ][ galosh::Emission::Match ].maximumValueType();
   }
   tmp_consensus_output_stream << consensus_sequence;
 
-  /* Allocate a growable MSA, and auxiliary parse data coupled to the MSA allocation */
-#ifdef eslAUGMENT_ALPHABET
-  if (afp->abc   &&  (msa = esl_msa_CreateDigital(afp->abc, 16, -1)) == NULL) { status = eslEMEM; goto ERROR; }
-#endif
-  if (! afp->abc &&  (msa = esl_msa_Create(                 16, -1)) == NULL) { status = eslEMEM; goto ERROR; }
-
-
-  // Set first-and-only seq to the consensus.  This should set sqlen[0] to the profile's length and set ax to have length 1 and ax[0] to be the sequence itself.  Also msa->sqname[0] to the "name" of that consensus sequence.
-
-  /* if nec, make room for the new seq */
-  if (msa->nseq >= msa->sqalloc && (status = esl_msa_Expand(msa)) != eslOK) return status; 
-  seqidx = msa->nseq; // 0
-  msa->nseq++; // = 1
-  status = esl_strdup(seqname, -1, &(msa->sqname[seqidx]));
+  /* A one-row MSA for the consensus, standing (if the kind of profile
+   * says how many there were) for the profile's original sequences.
+   */
+  if ((status = profillic_esl_msa_CreateConsensus(abc, Kind::orig_nseq(profile), &msa)) != eslOK) goto ERROR;
+  seqidx = 0;
+  if ((status = esl_strdup(seqname, -1, &(msa->sqname[seqidx]))) != eslOK) goto ERROR;
   // NOTE: Could add description of this "sequence" here, using esl_msa_SetSeqDescription(msa, seqidx, desc).
 #ifdef eslAUGMENT_ALPHABET
   if (msa->flags & eslMSA_DIGITAL)
@@ -542,22 +592,22 @@ profillic_esl_msafile_profile_Read(ESLX_MSAFILE *afp, ESL_MSA **ret_msa, Profile
       // NOTE (profillic): There was a bug in this; it had said .."esl_abc_dsqcat(msa->abc, " where it should have said .."esl_abc_dsqcat(msa->abc->inmap, "
       if((status = esl_abc_dsqcat(msa->abc->inmap, &(msa->ax[seqidx]), &(msa->sqlen[seqidx]), tmp_consensus_output_stream.str().c_str(), profile_length)) != eslOK) {
         /* invalid char(s), get informative error message */
-        if (esl_abc_ValidateSeq(msa->abc, tmp_consensus_output_stream.str().c_str(), profile_length, afp->errmsg) != eslOK) 
-          ESL_XFAIL(eslEFORMAT, errmsg2, "%s (line %d): %s", msa->sqname[0], afp->linenumber, afp->errmsg);
+        if (esl_abc_ValidateSeq(msa->abc, tmp_consensus_output_stream.str().c_str(), profile_length, errmsg2) != eslOK) 
+          ESL_XFAIL(eslEFORMAT, errbuf, "%s: %s", seqname, errmsg2);
+        goto ERROR;
       }
     }
 #endif
   if (! (msa->flags & eslMSA_DIGITAL))
     {
-      status = esl_strcat(&(msa->aseq[seqidx]), 0, tmp_consensus_output_stream.str().c_str(), profile_length);
+      if ((status = esl_strcat(&(msa->aseq[seqidx]), 0, tmp_consensus_output_stream.str().c_str(), profile_length)) != eslOK) goto ERROR;
       msa->sqlen[seqidx] = profile_length;
     } 
   msa->alen = profile_length;
 
   /// \todo OR read in a fasta file of sequences too.
   /// \todo (Optional?) Set msa->name to the name of the profile (file?)
-  esl_strdup(msaname, -1, &(msa->name));
-  /// \todo make sure eslMSA_HASWGTS is FALSE .. OR set it to TRUE and set msa->wgt[idx] to 1.0.
+  if ((status = esl_strdup(msaname, -1, &(msa->name))) != eslOK) goto ERROR;
   /// \note Could have secondary structure (per sequence) too. msa->ss[0]. msa->sslen[0] should be the same as msa->sqlen[0].
   /// \todo Investigate what msa->sa and msa->pp are for.
 
@@ -567,14 +617,18 @@ profillic_esl_msafile_profile_Read(ESLX_MSAFILE *afp, ESL_MSA **ret_msa, Profile
    */
   //if (verify_parse(msa, afp->errmsg) != eslOK) { status = eslEFORMAT; goto ERROR; } 
 
-  if (( status = esl_msa_SetDefaultWeights(msa)) != eslOK) goto ERROR;
+  /* A weighted consensus keeps msa->wgt[0] = orig_nseq (see
+   * profillic-consensus_msa.hpp); otherwise the one row has the default
+   * weight, and no eslMSA_HASWGTS.
+   */
+  if (! Kind::weighted && ( status = esl_msa_SetDefaultWeights(msa)) != eslOK) goto ERROR;
 
-  if (ret_msa != NULL) *ret_msa = msa; else esl_msa_Destroy(msa);
+  *ret_msa = msa;
   return eslOK;
 
  ERROR:
-  if (msa != NULL)      esl_msa_Destroy(msa);
-  if (ret_msa != NULL) *ret_msa = NULL;
+  if (msa != NULL) esl_msa_Destroy(msa);
+  *ret_msa = NULL;
   return status;
 }
 
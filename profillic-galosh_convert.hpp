@@ -0,0 +1,579 @@
+/**
+ * \file profillic-galosh_convert.hpp
+ * \brief
+ * Conversion between galosh profiles and HMMER3 P7_HMMs.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Residue maps.
+ *     2. Probability types.
+ *     3. Galosh profile to P7_HMM.
+ *     4. P7_HMM to galosh profile.
+ *     5. Copyright and license.
+ * </pre>
+ *
+ * These are the one place that knows how the two models line up; they
+ * are used by profillic-hmmbuild and profillic-alignment-hmmbuild (by
+ * way of profillic_p7_Profillicmodelmaker(), which picks one through
+ * ProfillicProfileKind<>; see profillic-profile_kind.hpp) and by
+ * profillic-hmmtoprofile.  An alignment profile (as in
+ * profillic_alignment_profile_to_hmm()) has per-position parameters
+ * throughout, and no shared block.
+ *
+ * A galosh ProfileTreeRoot has position-specific match emissions only;
+ * its insertion emissions and its transitions are shared by every
+ * internal position, and the last position takes the post-align ones
+ * instead.  So each conversion does the match emissions in one pass,
+ * converts the shared insertion / transition block once, and treats
+ * the last position on its own, leaving no per-residue symbol lookups
+ * and no last-position test inside the loop over positions.
+ *
+ * The profile's probability type is a template parameter too (the
+ * tools' --profile-precision): each value goes into HMMER's float
+ * arrays through ProfillicProbability<ProbabilityType>, which for the
+ * plain realspace types is just a cast.
+ */
+#ifndef __GALOSH_PROFILLICGALOSHCONVERT_HPP__
+#define __GALOSH_PROFILLICGALOSHCONVERT_HPP__
+
+#include <assert.h>
+#include <string.h>
+#include <strings.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "base/p7_hmm.h"
+}
+
+#include "profillic-hmmer.hpp"
+#include <seqan/basic.h>
+
+/*****************************************************************
+ *# 1. Residue maps.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Class:     ProfillicResidueMap<ResidueType>
+ * Synopsis:  Galosh residue index to HMMER digital code.
+ *
+ * Purpose:   Maps each residue index <res_i> of galosh/seqan
+ *            <ResidueType> (Dna: 4, AminoAcid20: 20) to its digital
+ *            code in HMMER alphabet <abc>, so that conversions look a
+ *            residue up with <map[ res_i ]> rather than calling
+ *            <esl_abc_DigitizeSymbol()> at every position.  The table
+ *            is sized at compile time; it's filled once, on
+ *            construction.
+ * </pre>
+ */
+template <typename ResidueType>
+class ProfillicResidueMap
+{
+public:
+  enum { SIZE = seqan::ValueSize<ResidueType>::VALUE };
+
+  ProfillicResidueMap ( ESL_ALPHABET const * abc )
+  {
+    for( uint32_t res_i = 0; res_i < SIZE; res_i++ ) {
+      m_dsq[ res_i ] =
+        esl_abc_DigitizeSymbol( abc, static_cast<char>( ResidueType( res_i ) ) );
+    }
+  }
+
+  ESL_DSQ
+  operator[] ( uint32_t const res_i ) const
+  {
+    return m_dsq[ res_i ];
+  }
+
+private:
+  ESL_DSQ m_dsq[ SIZE ];
+}; // End class ProfillicResidueMap
+
+/*---------------------- end, residue maps ----------------------*/
+
+/*****************************************************************
+ *# 2. Probability types.
+ *****************************************************************/
+
+/* The galosh probability types a profile can be read as (--profile-precision). */
+enum profillic_precision_e {
+  PROFILLIC_PRECISION_UNKNOWN  = 0,
+  PROFILLIC_PRECISION_FLOAT    = 1,  /* floatrealspace, the default */
+  PROFILLIC_PRECISION_DOUBLE   = 2,  /* doublerealspace             */
+  PROFILLIC_PRECISION_LOGSPACE = 3,  /* logspace                    */
+  PROFILLIC_PRECISION_BFLOAT   = 4   /* bfloat                      */
+};
+
+/**
+ * <pre>
+ * Function:  profillic_precision_Encode()
+ *
+ * Purpose:   Return the <PROFILLIC_PRECISION_*> code for the name
+ *            <s> ("float", "double", "logspace" or "bfloat", in any
+ *            case), or <PROFILLIC_PRECISION_UNKNOWN>.
+ * </pre>
+ */
+static int
+profillic_precision_Encode ( char const * s )
+{
+  if( strcasecmp( s, "float" )    == 0 ) return PROFILLIC_PRECISION_FLOAT;
+  if( strcasecmp( s, "double" )   == 0 ) return PROFILLIC_PRECISION_DOUBLE;
+  if( strcasecmp( s, "logspace" ) == 0 ) return PROFILLIC_PRECISION_LOGSPACE;
+  if( strcasecmp( s, "bfloat" )   == 0 ) return PROFILLIC_PRECISION_BFLOAT;
+  return PROFILLIC_PRECISION_UNKNOWN;
+}
+
+/* ProfillicPrecision<ProbabilityType>::code is the PROFILLIC_PRECISION_*
+ * code of galosh probability type <ProbabilityType>. */
+template <typename ProbabilityType>
+struct ProfillicPrecision { enum { code = PROFILLIC_PRECISION_UNKNOWN }; };
+template <> struct ProfillicPrecision<floatrealspace>  { enum { code = PROFILLIC_PRECISION_FLOAT    }; };
+template <> struct ProfillicPrecision<doublerealspace> { enum { code = PROFILLIC_PRECISION_DOUBLE   }; };
+template <> struct ProfillicPrecision<logspace>        { enum { code = PROFILLIC_PRECISION_LOGSPACE }; };
+template <> struct ProfillicPrecision<bfloat>          { enum { code = PROFILLIC_PRECISION_BFLOAT   }; };
+
+/**
+ * <pre>
+ * Class:     ProfillicProbability<ProbabilityType>
+ * Synopsis:  Galosh probability to HMMER float.
+ *
+ * Purpose:   <toFloat( p )> converts one probability <p> of galosh
+ *            type <ProbabilityType>, and <scatter( dist, map, row )>
+ *            converts a whole distribution <dist> over residues into
+ *            HMMER row <row>, in digital order by way of residue map
+ *            <map>.
+ *
+ *            The general case goes through <toDouble()>: the log-space
+ *            types (<logspace>, <bfloat>) have to be taken out of log
+ *            space one value at a time whichever way it's done.  The
+ *            realspace types (<floatrealspace>, <doublerealspace>) are
+ *            specialized to a plain cast, so that the float default
+ *            makes no round trip through double.
+ * </pre>
+ */
+template <typename ProbabilityType>
+struct ProfillicProbability
+{
+  static float
+  toFloat ( ProbabilityType const & p )
+  {
+    return static_cast<float>( toDouble( p ) );
+  }
+
+  template <typename DistributionType, typename MapType>
+  static void
+  scatter ( DistributionType const & dist, MapType const & map, float * row )
+  {
+    for( uint32_t res_i = 0; res_i < MapType::SIZE; res_i++ ) {
+      row[ map[ res_i ] ] = toFloat( dist[ res_i ] );
+    }
+  }
+}; // End struct ProfillicProbability
+
+template <>
+struct ProfillicProbability<floatrealspace>
+{
+  static float
+  toFloat ( floatrealspace const & p )
+  {
+    return static_cast<float>( p );
+  }
+
+  template <typename DistributionType, typename MapType>
+  static void
+  scatter ( DistributionType const & dist, MapType const & map, float * row )
+  {
+    for( uint32_t res_i = 0; res_i < MapType::SIZE; res_i++ ) {
+      row[ map[ res_i ] ] = static_cast<float>( dist[ res_i ] );
+    }
+  }
+}; // End struct ProfillicProbability<floatrealspace>
+
+template <>
+struct ProfillicProbability<doublerealspace>
+{
+  static float
+  toFloat ( doublerealspace const & p )
+  {
+    return static_cast<float>( p );
+  }
+
+  template <typename DistributionType, typename MapType>
+  static void
+  scatter ( DistributionType const & dist, MapType const & map, float * row )
+  {
+    for( uint32_t res_i = 0; res_i < MapType::SIZE; res_i++ ) {
+      row[ map[ res_i ] ] = static_cast<float>( dist[ res_i ] );
+    }
+  }
+}; // End struct ProfillicProbability<doublerealspace>
+
+/*---------------------- end, probability types ----------------------*/
+
+/*****************************************************************
+ *# 3. Galosh profile to P7_HMM.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_profile_to_hmm()
+ * Synopsis:  Copy a galosh profile's parameters into a P7_HMM.
+ *
+ * Purpose:   Fill in the emissions and transitions of <hmm>, which the
+ *            caller has created with <M = profile.length()> and zeroed
+ *            (<p7_hmm_Create()>, <p7_hmm_Zero()>), from galosh profile
+ *            <profile>.  Entries that the galosh model has no
+ *            counterpart for are left as they are (zero).
+ *
+ *            Note that HMMER3 has a slightly different model, starting
+ *            in Begin rather than in preAlign, and with 3 legal
+ *            transitions out of Begin (one of these is to PreAlign).
+ *            The galosh profile model begins in preAlign and
+ *            transitions to Begin, and from there to either Match or
+ *            Delete.  One implication is that galosh profiles enforce
+ *            t[ 0 ][ p7H_MI ] to be the same as t[ 0 ][ p7H_II ], but
+ *            HMMER3 does not.  Another way to say this is that H3 uses
+ *            affine pre-aligns, and prohibits pre-align -to- delete
+ *            transitions, whereas galosh / profillic uses non-affine
+ *            pre-aligns and allows pre-align->delete.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEINVAL> if <hmm> isn't the length of <profile>.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_profile_to_hmm ( ProfileType const & profile, P7_HMM * hmm )
+{
+  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
+  typedef typename galosh::profile_traits<ProfileType>::ProbabilityType ProbabilityType;
+  typedef ProfillicProbability<ProbabilityType> Convert;
+
+  ProfillicResidueMap<ResidueType> const map( hmm->abc );
+  uint32_t const M = static_cast<uint32_t>( hmm->M );
+  uint32_t pos_i; ///< Position in profile.  Corresponds to one less than match state pos in HMM.
+  uint32_t res_i;
+  int      k;
+
+  if( M != profile.length() ) ESL_EXCEPTION( eslEINVAL, "hmm and profile lengths differ" );
+
+  // ALWAYS TRUE, so need not be set:
+  //hmm->t[ 0 ][ p7H_DM ] = 1.0;
+  //hmm->t[ 0 ][ p7H_DD ] = 0.0;
+
+  // fromPreAlign
+  hmm->t[ 0 ][ p7H_MI ] =
+    Convert::toFloat(
+      profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toPreAlign ]
+    );
+  hmm->t[ 0 ][ p7H_II ] =  hmm->t[ 0 ][ p7H_MI ];
+  hmm->t[ 0 ][ p7H_IM ] = ( 1 - hmm->t[ 0 ][ p7H_MI ] );
+  Convert::scatter( profile[ galosh::Emission::PreAlignInsertion ], map, hmm->ins[ 0 ] );
+
+  // fromBegin
+  hmm->t[ 0 ][ p7H_MM ] =
+    Convert::toFloat(
+      ( 1 - hmm->t[ 0 ][ p7H_MI ] ) *
+      profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ]
+    );
+  hmm->t[ 0 ][ p7H_MD ] =
+    Convert::toFloat(
+      ( 1 - hmm->t[ 0 ][ p7H_MI ] ) *
+      profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toDeletion ]
+    );
+
+  // ALWAYS TRUE, so need not be set:
+  // Convention sets first elem to 1, rest to 0.
+  hmm->mat[ 0 ][ 0 ] = 1.0;
+  for( res_i = 1; res_i < hmm->abc->K; res_i++ ) {
+    hmm->mat[ 0 ][ res_i ] = 0.0;
+  }
+
+  // Match emissions, the only position-specific parameters.
+  for( pos_i = 0; pos_i < M; pos_i++ ) {
+    Convert::scatter( profile[ pos_i ][ galosh::Emission::Match ], map, hmm->mat[ pos_i + 1 ] );
+  }
+
+  // Internal positions (1..M-1) all share one insertion emission
+  // distribution and one set of transitions: convert them into node 1,
+  // then copy that node's rows to the rest.
+  if( M > 1 ) {
+    Convert::scatter( profile[ galosh::Emission::Insertion ], map, hmm->ins[ 1 ] );
+    hmm->t[ 1 ][ p7H_MM ] =
+      Convert::toFloat( profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toMatch ] );
+    hmm->t[ 1 ][ p7H_MI ] =
+      Convert::toFloat( profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toInsertion ] );
+    hmm->t[ 1 ][ p7H_MD ] =
+      Convert::toFloat( profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toDeletion ] );
+    hmm->t[ 1 ][ p7H_IM ] =
+      Convert::toFloat( profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toMatch ] );
+    hmm->t[ 1 ][ p7H_II ] =
+      Convert::toFloat( profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toInsertion ] );
+    hmm->t[ 1 ][ p7H_DM ] =
+      Convert::toFloat( profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toMatch ] );
+    hmm->t[ 1 ][ p7H_DD ] =
+      Convert::toFloat( profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toDeletion ] );
+
+    for( k = 2; k < hmm->M; k++ ) {
+      memcpy( hmm->ins[ k ], hmm->ins[ 1 ], sizeof( float ) * hmm->abc->K );
+      memcpy( hmm->t[ k ],   hmm->t[ 1 ],   sizeof( float ) * p7H_NTRANSITIONS );
+    }
+  } // End if there are internal positions
+
+  // The last position uses the post-align insertions.
+  Convert::scatter( profile[ galosh::Emission::PostAlignInsertion ], map, hmm->ins[ M ] );
+  for( res_i = 0; res_i < map.SIZE; res_i++ ) {
+    assert( hmm->ins[ M ][ map[ res_i ] ] == hmm->ins[ 0 ][ map[ res_i ] ] );
+  }
+  hmm->t[ M ][ p7H_IM ] =
+    Convert::toFloat( profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ] );
+  hmm->t[ M ][ p7H_II ] =
+    Convert::toFloat( profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toPostAlign ] );
+  hmm->t[ M ][ p7H_MM ] = hmm->t[ M ][ p7H_IM ];
+  hmm->t[ M ][ p7H_MI ] = hmm->t[ M ][ p7H_II ];
+
+  // ALWAYS TRUE, so need not be set:
+  //hmm->t[ M ][ p7H_DM ] = 1;
+  //hmm->t[ M ][ p7H_MD ] = 0;
+  //hmm->t[ M ][ p7H_DD ] = 0;
+
+  return eslOK;
+} // profillic_profile_to_hmm (..)
+
+/**
+ * <pre>
+ * Function:  profillic_alignment_profile_to_hmm()
+ * Synopsis:  Copy a galosh alignment profile's parameters into a P7_HMM.
+ *
+ * Purpose:   As profillic_profile_to_hmm(), for the per-position
+ *            AlignmentProfileAccessor <profile> that
+ *            profillic-alignment-hmmbuild reads, into <hmm> of
+ *            <M = profile.length()>, created and zeroed by the caller.
+ *
+ *            Unlike a ProfileTreeRoot, an alignment profile's
+ *            position 0 is the Begin state (its pre-align, begin and
+ *            position-0 insertion parameters go to node 0), and every
+ *            position has its own insertion emissions and transitions;
+ *            so there is no shared block to copy, and profile position
+ *            <pos_i> is node <pos_i> rather than <pos_i + 1>.  The last
+ *            position takes the post-align transitions.  Node <M>'s
+ *            emissions are left as they are (zero).
+ *
+ *            <ProbabilityType> is the profile's probability type (the
+ *            caller names it, as AlignmentProfileAccessor doesn't), so
+ *            that each emission row goes in whole through
+ *            ProfillicProbability<>::scatter(), as in
+ *            profillic_profile_to_hmm().
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEINVAL> if <hmm> isn't the length of <profile>.
+ * </pre>
+ */
+template <typename ProbabilityType, typename ProfileType>
+int
+profillic_alignment_profile_to_hmm ( ProfileType const & profile, P7_HMM * hmm )
+{
+  typedef typename ProfileType::APAResidueType ResidueType;
+  typedef ProfillicProbability<ProbabilityType> Convert;
+
+  ProfillicResidueMap<ResidueType> const map( hmm->abc );
+  uint32_t pos_i; ///< Position in profile.  Corresponds to the match state pos in HMM.
+  uint32_t res_i;
+
+  if( static_cast<uint32_t>( hmm->M ) != profile.length() ) ESL_EXCEPTION( eslEINVAL, "hmm and profile lengths differ" );
+
+  // ALWAYS TRUE, so need not be set:
+  //hmm->t[ 0 ][ p7H_DM ] = 1.0;
+  //hmm->t[ 0 ][ p7H_DD ] = 0.0;
+
+  // fromPreAlign
+  /// TAH 5/12 special cases for 0th element
+  ///  Profile N->N is HMM I->I
+  hmm->t[ 0 ][ p7H_II ] =
+    Convert::toFloat( profile[ 0 ][ galosh::profile_PreAlign_distribution_tag() ][ galosh::TransitionFromPreAlign::toPreAlign ] );
+  /// Profile N->B is HMM I->M
+  hmm->t[ 0 ][ p7H_IM ] =
+    Convert::toFloat( profile[ 0 ][ galosh::profile_PreAlign_distribution_tag() ][ galosh::TransitionFromPreAlign::toBegin ] );
+  /// Profile B->I is HMM M->I
+  hmm->t[ 0 ][ p7H_MI ] =
+    Convert::toFloat( profile[ 0 ][ galosh::profile_Match_distribution_tag() ][ galosh::TransitionFromMatch::toInsertion ] );
+  /// Profile B->M is HMM M->M
+  hmm->t[ 0 ][ p7H_MM ] =
+    Convert::toFloat( profile[ 0 ][ galosh::profile_Match_distribution_tag() ][ galosh::TransitionFromMatch::toMatch ] );
+  /// Profile B->D is HMM M->D
+  hmm->t[ 0 ][ p7H_MD ] =
+    Convert::toFloat( profile[ 0 ][ galosh::profile_Match_distribution_tag() ][ galosh::TransitionFromMatch::toDeletion ] );
+
+  /// TAH 3/12 Assuming 0th residue insertion emission is equivalent to PreAlignInsertion
+  Convert::scatter( profile[ 0 ][ galosh::profile_Insertion_emission_distribution_tag() ], map, hmm->ins[ 0 ] );
+
+  // ALWAYS TRUE, so need not be set:
+  // Convention sets first elem to 1, rest to 0.
+  hmm->mat[ 0 ][ 0 ] = 1.0;
+  for( res_i = 1; res_i < hmm->abc->K; res_i++ ) {
+    hmm->mat[ 0 ][ res_i ] = 0.0;
+  }
+
+  /// \note Paul's note: in the case of alignment profiles, the
+  /// per-position insertion distributions should be used, but we really
+  /// should account for how informed each is (some positions never
+  /// have insertions).
+  /// \todo Think about a good solution to the pre-align emission distributions
+  for( pos_i = 1; pos_i < profile.length(); pos_i++ ) {
+    Convert::scatter( profile[ pos_i ][ galosh::profile_Match_emission_distribution_tag() ],     map, hmm->mat[ pos_i ] );
+    Convert::scatter( profile[ pos_i ][ galosh::profile_Insertion_emission_distribution_tag() ], map, hmm->ins[ pos_i ] );
+  } // End foreach pos_i
+
+  // Internal positions' transitions (the last is peeled off below).
+  for( pos_i = 1; pos_i + 1 < profile.length(); pos_i++ ) {
+    hmm->t[ pos_i ][ p7H_MM ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_Match_distribution_tag() ][ galosh::TransitionFromMatch::toMatch ] );
+    hmm->t[ pos_i ][ p7H_MI ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_Match_distribution_tag() ][ galosh::TransitionFromMatch::toInsertion ] );
+    hmm->t[ pos_i ][ p7H_MD ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_Match_distribution_tag() ][ galosh::TransitionFromMatch::toDeletion ] );
+    hmm->t[ pos_i ][ p7H_IM ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_Insertion_distribution_tag() ][ galosh::TransitionFromInsertion::toMatch ] );
+    hmm->t[ pos_i ][ p7H_II ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_Insertion_distribution_tag() ][ galosh::TransitionFromInsertion::toInsertion ] );
+    hmm->t[ pos_i ][ p7H_DM ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_Deletion_distribution_tag() ][ galosh::TransitionFromDeletion::toMatch ] );
+    hmm->t[ pos_i ][ p7H_DD ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_Deletion_distribution_tag() ][ galosh::TransitionFromDeletion::toDeletion ] );
+  } // End foreach internal pos_i
+
+  /// TAH 3/12 Last position special cases: use post-align transitions
+  if( profile.length() > 1 ) {
+    pos_i = profile.length() - 1;
+    hmm->t[ pos_i ][ p7H_IM ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_PostAlign_distribution_tag() ][ galosh::TransitionFromPostAlign::toTerminal ] );
+    hmm->t[ pos_i ][ p7H_II ] =
+      Convert::toFloat( profile[ pos_i ][ galosh::profile_PostAlign_distribution_tag() ][ galosh::TransitionFromPostAlign::toPostAlign ] );
+    hmm->t[ pos_i ][ p7H_MM ] = hmm->t[ pos_i ][ p7H_IM ];
+    hmm->t[ pos_i ][ p7H_MI ] = hmm->t[ pos_i ][ p7H_II ];
+
+    // ALWAYS TRUE, so need not be set:
+    //hmm->t[ pos_i + 1 ][ p7H_DM ] = 1;
+    //hmm->t[ pos_i + 1 ][ p7H_MD ] = 0;
+    //hmm->t[ pos_i + 1 ][ p7H_DD ] = 0;
+  } // End if there is a last position to peel
+
+  return eslOK;
+} // profillic_alignment_profile_to_hmm (..)
+
+/*---------------- end, galosh profile to P7_HMM -----------------*/
+
+/*****************************************************************
+ *# 4. P7_HMM to galosh profile.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_to_profile()
+ * Synopsis:  Convert a P7_HMM into a galosh profile.
+ *
+ * Purpose:   Reinitialize galosh profile <profile> to the length of
+ *            <hmm> and set its parameters from <hmm>.  The galosh
+ *            model's shared insertion emissions and transitions are the
+ *            averages of <hmm>'s over its internal positions (see the
+ *            notes in profillic_profile_to_hmm() on how the two models
+ *            differ).
+ *
+ *            The profile is normalized with 0 as the minimum value
+ *            we'll allow.  Note that in profillic and profuse, it's
+ *            generally 1E-5, so when the profile is read in by those
+ *            programs, it might be slightly altered.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslENORESULT> if <hmm> has no match states.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_hmm_to_profile ( P7_HMM const * hmm, ProfileType & profile )
+{
+  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
+
+  ProfillicResidueMap<ResidueType> const map( hmm->abc );
+  double   ins_sum[ p7_MAXABET ];      /* insertion emissions, summed over internal positions; digital order */
+  double   t_sum[ p7H_NTRANSITIONS ];  /* transitions, summed over internal positions */
+  uint32_t pos_i; ///< Position in profile.  Corresponds to one less than match state pos in HMM.
+  uint32_t res_i;
+  int      k, x;
+
+  /* How many match states in the HMM? */
+  if( hmm->M == 0 ) return eslENORESULT;
+  uint32_t const M = static_cast<uint32_t>( hmm->M );
+  profile.reinitialize( M );
+
+  profile.zero();
+
+  // fromPreAlign
+  profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toPreAlign ] =
+    hmm->t[ 0 ][ p7H_II ];
+  profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toBegin ] =
+    hmm->t[ 0 ][ p7H_IM ];
+  for( res_i = 0; res_i < map.SIZE; res_i++ ) {
+    profile[ galosh::Emission::PreAlignInsertion ][ res_i ] =
+      hmm->ins[ 0 ][ map[ res_i ] ];
+  }
+
+  // fromBegin
+  profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ] =
+    ( hmm->t[ 0 ][ p7H_MM ] / ( 1.0 - hmm->t[ 0 ][ p7H_MI ] ) );
+  profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toDeletion ] =
+    ( 1.0 - profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ] );
+
+  // Match emissions, the only position-specific parameters.
+  for( pos_i = 0; pos_i < M; pos_i++ ) {
+    for( res_i = 0; res_i < map.SIZE; res_i++ ) {
+      profile[ pos_i ][ galosh::Emission::Match ][ res_i ] =
+        hmm->mat[ pos_i + 1 ][ map[ res_i ] ];
+    }
+  }
+
+  // Internal positions (1..M-1): sum the HMM's rows, then set the
+  // profile's shared parameters once (normalize() below averages them).
+  for( x = 0; x < hmm->abc->K;      x++ ) ins_sum[ x ] = 0.;
+  for( x = 0; x < p7H_NTRANSITIONS; x++ ) t_sum[ x ]   = 0.;
+  for( k = 1; k < hmm->M; k++ ) {
+    for( x = 0; x < hmm->abc->K;      x++ ) ins_sum[ x ] += hmm->ins[ k ][ x ];
+    for( x = 0; x < p7H_NTRANSITIONS; x++ ) t_sum[ x ]   += hmm->t[ k ][ x ];
+  }
+  for( res_i = 0; res_i < map.SIZE; res_i++ ) {
+    profile[ galosh::Emission::Insertion ][ res_i ] = ins_sum[ map[ res_i ] ];
+  }
+  profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toMatch ]               = t_sum[ p7H_MM ];
+  profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toInsertion ]           = t_sum[ p7H_MI ];
+  profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toDeletion ]            = t_sum[ p7H_MD ];
+  profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toMatch ]       = t_sum[ p7H_IM ];
+  profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toInsertion ]   = t_sum[ p7H_II ];
+  profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toMatch ]         = t_sum[ p7H_DM ];
+  profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toDeletion ]      = t_sum[ p7H_DD ];
+
+  // The last position uses the post-align insertions.
+  for( res_i = 0; res_i < map.SIZE; res_i++ ) {
+    profile[ galosh::Emission::PostAlignInsertion ][ res_i ] =
+      hmm->ins[ M ][ map[ res_i ] ];
+  }
+  profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ] =
+    hmm->t[ M ][ p7H_IM ];
+  profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toPostAlign ] =
+    ( 1.0 - profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ] );
+
+  profile.normalize( 0 );
+  return eslOK;
+} // profillic_hmm_to_profile (..)
+
+/*---------------- end, P7_HMM to galosh profile -----------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICGALOSHCONVERT_HPP__
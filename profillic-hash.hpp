@@ -0,0 +1,103 @@
+/**
+ * \file profillic-hash.hpp
+ * \brief
+ * Fast 64-bit content hashes, for keying caches of built and
+ * calibrated models.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. FNV-1a hashing.
+ *     2. Hashing HMM parameters.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * The hashes are FNV-1a over the bytes of the values hashed, so they
+ * are only comparable between hosts with the same byte order and
+ * floating point format; the caches keyed by them are meant to be
+ * reused on the machine (or cluster) that made them.
+ */
+#ifndef __GALOSH_PROFILLICHASH_HPP__
+#define __GALOSH_PROFILLICHASH_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+
+#include "base/p7_hmm.h"
+}
+
+/*****************************************************************
+ *# 1. FNV-1a hashing.
+ *****************************************************************/
+
+#define PROFILLIC_FNV64_OFFSET  ((uint64_t) 0xcbf29ce484222325ULL)
+#define PROFILLIC_FNV64_PRIME   ((uint64_t) 0x00000100000001b3ULL)
+
+/* Fold the <n> bytes at <p> into FNV-1a hash <h>. */
+static uint64_t
+profillic_hash_Bytes(uint64_t h, const void *p, size_t n)
+{
+  const unsigned char *b = (const unsigned char *) p;
+  size_t               i;
+
+  for (i = 0; i < n; i++) { h ^= (uint64_t) b[i]; h *= PROFILLIC_FNV64_PRIME; }
+  return h;
+}
+
+static uint64_t profillic_hash_Int   (uint64_t h, int x)    { return profillic_hash_Bytes(h, &x, sizeof(int));    }
+static uint64_t profillic_hash_Double(uint64_t h, double x) { return profillic_hash_Bytes(h, &x, sizeof(double)); }
+
+/* Fold string <s> (which may be <NULL>, and hashes differently from "") into <h>. */
+static uint64_t
+profillic_hash_String(uint64_t h, const char *s)
+{
+  if (s == NULL) return profillic_hash_Int(h, -1);
+  return profillic_hash_Bytes(profillic_hash_Int(h, (int) strlen(s)), s, strlen(s));
+}
+
+/*---------------------- end, FNV-1a hashing --------------------*/
+
+/*****************************************************************
+ *# 2. Hashing HMM parameters.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_hash_Hmm()
+ *
+ * Purpose:   Fold <hmm>'s probability parameters (transitions, match
+ *            and insert emissions, nodes 0..M), its length and its
+ *            alphabet into <h>.  Names, annotation and statistics are
+ *            not included, so a renamed or recalibrated model hashes
+ *            the same.
+ *
+ *            Relies on p7_hmm_CreateBody() allocating each of <t>,
+ *            <mat> and <ins> as one block.
+ * </pre>
+ */
+static uint64_t
+profillic_hash_Hmm(uint64_t h, const P7_HMM *hmm)
+{
+  h = profillic_hash_Int  (h, hmm->M);
+  h = profillic_hash_Int  (h, hmm->abc->type);
+  h = profillic_hash_Int  (h, hmm->abc->K);
+  h = profillic_hash_Bytes(h, hmm->t[0],   sizeof(float) * (hmm->M + 1) * p7H_NTRANSITIONS);
+  h = profillic_hash_Bytes(h, hmm->mat[0], sizeof(float) * (hmm->M + 1) * hmm->abc->K);
+  h = profillic_hash_Bytes(h, hmm->ins[0], sizeof(float) * (hmm->M + 1) * hmm->abc->K);
+  return h;
+}
+
+/*---------------------- end, hashing HMMs --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICHASH_HPP__
@@ -0,0 +1,2734 @@
+/**
+ * \file profillic-hmmbuild_driver.hpp
+ * \brief
+ * The driver shared by profillic-hmmbuild and profillic-alignment-hmmbuild
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. The driver: options, serial, threaded, MPI and --server builds.
+ *     2. Copyright and license.
+ * </pre>
+ *
+ * Everything of the two programs but their main(): the option table,
+ * the serial loop, the thread master and workers with their ordered
+ * writer, the MPI master and workers, and --server, all templated on
+ * the profile type.  Each program's main() is
+ * profillic_hmmbuild_main<Family>(), for its family of galosh profile
+ * types (ProfillicTreeProfiles or ProfillicAlignmentProfiles; see
+ * profillic-profile_kind.hpp); what differs between the profile types
+ * themselves is in ProfillicProfileKind<>.
+ *
+ * An including program defines main(), and nothing else, from this
+ * header; see profillic-hmmbuild.cpp for the options.
+ */
+#ifndef __GALOSH_PROFILLICHMMBUILDDRIVER_HPP__
+#define __GALOSH_PROFILLICHMMBUILDDRIVER_HPP__
+
+/*****************************************************************
+ *# 1. The driver: options, serial, threaded, MPI and --server builds.
+ *****************************************************************/
+extern "C" {
+#include "p7_config.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern "C" {
+#ifdef HAVE_MPI
+#include "mpi.h"
+#endif
+}
+
+extern "C" {
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+#include "esl_mpi.h"
+  /// \note TAH 8/12 Workaround for C++ keyword "new" in esl_msa.h
+#define new _new
+#include "esl_msa.h"
+#undef new
+#include "esl_msafile.h"
+#include "esl_msaweight.h"
+#include "esl_msacluster.h"
+#include "esl_ssi.h"
+#include "esl_stopwatch.h"
+#include "esl_vectorops.h"
+}
+
+#ifdef HMMER_THREADS
+extern "C" {
+#include "esl_threads.h"
+#include "esl_workqueue.h"
+}
+#endif /*HMMER_THREADS*/
+
+extern "C" {
+#include "hmmer.h"
+}
+
+/* /////////////// For profillic-hmmer ////////////////////////////////// */
+#include "profillic-hmmer.hpp"
+#include "profillic-p7_builder.hpp"
+//#include "profillic-esl_msa.hpp"
+#include "profillic-esl_msafile.hpp"
+#include "profillic-esl_mpi.hpp"
+#include "profillic-schedule.hpp"
+#include "profillic-msafile_readers.hpp"
+#include "profillic-modelstats.hpp"
+#include "profillic-compress.hpp"
+
+// Updated notices:
+#define PROFILLIC_HMMER_VERSION "1.0a"
+#define PROFILLIC_HMMER_DATE "July 2011"
+#define PROFILLIC_HMMER_COPYRIGHT "Copyright (C) 2011 Paul T. Edlefsen, Fred Hutchinson Cancer Research Center."
+#define PROFILLIC_HMMER_URL "http://galosh.org/"
+
+/// Modified from hmmer.c p7_banner(..):
+/* Version info - set once for whole package in configure.ac
+ */
+/*****************************************************************
+ * 1. Miscellaneous functions for H3
+ *****************************************************************/
+
+/** 
+ * <pre>
+ * Function:  p7_banner()
+ * Synopsis:  print standard HMMER application output header
+ * Incept:    SRE, Wed May 23 10:45:53 2007 [Janelia]
+ *
+ * Purpose:   Print the standard HMMER command line application banner
+ *            to <fp>, constructing it from <progname> (the name of the
+ *            program) and a short one-line description <banner>.
+ *            For example, 
+ *            <p7_banner(stdout, "hmmsim", "collect profile HMM score distributions");>
+ *            might result in:
+ *            
+ *            \begin{cchunk}
+ *            # hmmsim :: collect profile HMM score distributions
+ *            # HMMER 3.0 (May 2007)
+ *            # Copyright (C) 2004-2007 HHMI Janelia Farm Research Campus
+ *            # Freely licensed under the Janelia Software License.
+ *            # - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *            \end{cchunk}
+ *              
+ *            <progname> would typically be an application's
+ *            <argv[0]>, rather than a fixed string. This allows the
+ *            program to be renamed, or called under different names
+ *            via symlinks. Any path in the <progname> is discarded;
+ *            for instance, if <progname> is "/usr/local/bin/hmmsim",
+ *            "hmmsim" is used as the program name.
+ *            
+ * Note:    
+ *    Needs to pick up preprocessor #define's from p7_config.h,
+ *    as set by ./configure:
+ *            
+ *    symbol          example
+ *    ------          ----------------
+ *    HMMER_VERSION   "3.0"
+ *    HMMER_DATE      "May 2007"
+ *    HMMER_COPYRIGHT "Copyright (C) 2004-2007 HHMI Janelia Farm Research Campus"
+ *    HMMER_LICENSE   "Freely licensed under the Janelia Software License."
+ *
+ * Returns:   (void)
+ * </pre>
+ */
+void
+profillic_p7_banner(FILE *fp, char *progname, char *banner)
+{
+  char *appname = NULL;
+
+  if (esl_FileTail(progname, FALSE, &appname) != eslOK) appname = progname;
+
+  fprintf(fp, "# %s :: %s\n", appname, banner);
+  fprintf(fp, "# profillic-hmmer %s (%s); %s\n", PROFILLIC_HMMER_VERSION, PROFILLIC_HMMER_DATE, PROFILLIC_HMMER_URL);
+  fprintf(fp, "# %s\n", PROFILLIC_HMMER_COPYRIGHT);
+  fprintf(fp, "# HMMER %s (%s); %s\n", HMMER_VERSION, HMMER_DATE, HMMER_URL);
+  fprintf(fp, "# %s\n", HMMER_COPYRIGHT);
+  fprintf(fp, "# %s\n", HMMER_LICENSE);
+  fprintf(fp, "# - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -\n");
+
+  if (appname != NULL) free(appname);
+  return;
+}
+/* /////////////// End profillic-hmmer ////////////////////////////////// */
+
+#ifdef HMMER_THREADS
+struct output_writer_s;
+
+/* Admission control for --max-memory.  <inflight> counts the
+ * (estimated) bytes of each alignment and its model from when the
+ * reader hands it out until the writer has written it.  The reader
+ * waits while handing out another would go over <max>, unless nothing
+ * is being built: then only the writer could free anything, and it may
+ * be waiting for this very alignment.
+ */
+typedef struct {
+  size_t           max;      /* budget, in bytes                          */
+  size_t           inflight; /* bytes handed out and not yet written       */
+  size_t           peak;     /* most <inflight> has been                   */
+  int              nbusy;    /* alignments handed out and not yet built    */
+  pthread_mutex_t  mutex;
+  pthread_cond_t   freed;    /* <inflight> or <nbusy> went down            */
+} MEMORY_BUDGET;
+#endif /*HMMER_THREADS*/
+
+typedef struct {
+#ifdef HMMER_THREADS
+  ESL_WORK_QUEUE   *queue;
+  struct output_writer_s *writer; /* where finished models go to be written, in order */
+  MEMORY_BUDGET    *budget;       /* --max-memory, or NULL */
+#endif /*HMMER_THREADS*/
+  P7_BG	           *bg;
+  P7_BUILDER       *bld;
+  int                     use_priors;
+  int                     do_stats;    /* FALSE with --nostats                      */
+  int                     calibrate_ncpu;
+  int                     weight_ncpu;
+  int                     do_timings;  /* TRUE with --timings                       */
+  PROFILLIC_BUILD_TIMINGS total;       /* this worker's stage times, over its models */
+  int                     nbuilt;      /* number of models in <total>                */
+  int                     do_press;    /* TRUE with --press: keep each model's optimized profile */
+  int                     do_postmsa;  /* TRUE with -O: make each model's postmsa    */
+  const PROFILLIC_BUILD_CACHE *cache;  /* --cache, or NULL */
+  PROFILLIC_BUILD_POOL   *pool;        /* this worker's reusable models, sequence and scratch space */
+} WORKER_INFO;
+
+#ifdef HMMER_THREADS
+typedef struct {
+  int         nali;
+  int         processed;
+  FILE       *spill;        /* -O: its postmsa, spilled to a temporary file by postmsa_Spill(); else NULL */
+  ESL_MSA    *msa;
+  P7_HMM     *hmm;
+  double      entropy;
+  int         force_single; /* FALSE by default,  TRUE if esl_opt_IsUsed(go, "--single") ;  only matters for single sequences */
+  void       *profile;      /* this item's own galosh profile (a ProfileType *) when reading --profillic-* input; else NULL */
+  int         workeridx;    /* which worker built it (for --timings) */
+  PROFILLIC_BUILD_TIMINGS timings;
+  P7_OPROFILE *om;          /* optimized profile, for --press; else NULL */
+  size_t      bytes;        /* its estimated size, charged to the --max-memory budget */
+  PROFILLIC_BUILD_POOL *pool; /* the pool of the worker that built it, to give its model back to */
+} WORK_ITEM;
+
+/* A finished model waiting in the writer's reorder ring */
+typedef struct {
+  int         nali;         /* 0 if the slot is empty */
+  FILE       *spill;
+  ESL_MSA    *msa;
+  P7_HMM     *hmm;
+  double      entropy;
+  int         workeridx;
+  PROFILLIC_BUILD_TIMINGS timings;
+  P7_OPROFILE *om;
+  size_t      bytes;
+  PROFILLIC_BUILD_POOL *pool;
+} PENDING_ITEM;
+
+/* The writer thread and its reorder ring: model <nali> waits in
+ * ring[nali % nring] until all models before it have been written.
+ * Workers block in output_writer_Put() while their model is <nring>
+ * or more ahead of <next>, which bounds the memory held by finished
+ * models; the worker with model <next> never blocks, so the writer
+ * always makes progress.
+ */
+typedef struct output_writer_s {
+  const struct cfg_s *cfg;
+  PENDING_ITEM    *ring;
+  int              nring;
+  int              next;    /* nali of the next model to write           */
+  int              nlast;   /* number of models, once known; -1 until then */
+  pthread_mutex_t  mutex;
+  pthread_cond_t   ready;   /* a slot was filled, or <nlast> was set      */
+  pthread_cond_t   space;   /* <next> moved on                            */
+  pthread_t        thread;
+} OUTPUT_WRITER;
+#endif /*HMMER_THREADS*/
+
+#ifdef HAVE_MPI
+/* With --sched, a model received by the MPI master, waiting for the ones before it to be written */
+typedef struct mpi_pending_s {
+  int         nali;
+  ESL_MSA    *msa;
+  P7_HMM     *hmm;
+  FILE       *spill;        /* -O: its postmsa, spilled by postmsa_Spill(); else NULL */
+  struct mpi_pending_s *next;
+} MPI_PENDING;
+#endif /*HAVE_MPI*/
+
+#define ALPHOPTS "--amino,--dna,--rna"                         /* Exclusive options for alphabet choice */
+#define CONOPTS "--fast,--hand,--profillic-amino,--profillic-dna"                      /* Exclusive options for model construction                    */
+#define EFFOPTS "--eent,--eclust,--eset,--enone"               /* Exclusive options for effective sequence number calculation */
+#define WGTOPTS "--wgsc,--wblosum,--wpb,--wnone,--wgiven"      /* Exclusive options for relative weighting                    */
+
+/* The option table of profillic_hmmbuild_main<Family>(): the two
+ * programs take the same options, but for the help on the
+ * --profillic-* inputs, and --nseq, which only alignment profiles
+ * have (for tree profiles its NULL name ends the table a row early). */
+template <class Family>
+struct ProfillicHmmbuildOptions
+{
+  static ESL_OPTIONS options[];
+};
+
+template <class Family>
+ESL_OPTIONS ProfillicHmmbuildOptions<Family>::options[] = {
+  /* name           type      default  env  range     toggles      reqs   incomp  help   docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,      NULL,      NULL,    NULL, "show brief help on version and usage",                  1 },
+  { "-n",        eslARG_STRING,  NULL, NULL, NULL,      NULL,      NULL,    NULL, "name the HMM <s>",                                      1 },
+  { "-o",        eslARG_OUTFILE,FALSE, NULL, NULL,      NULL,      NULL,    NULL, "direct summary output to file <f>, not stdout",         1 },
+  { "-O",        eslARG_OUTFILE,FALSE, NULL, NULL,      NULL,      NULL,    NULL, "resave annotated, possibly modified MSA to file <f>",   1 },
+/* Selecting the alphabet rather than autoguessing it */
+  { "--amino",   eslARG_NONE,   FALSE, NULL, NULL,   ALPHOPTS,    NULL,     NULL, "input alignment is protein sequence data",              2 },
+  { "--dna",     eslARG_NONE,   FALSE, NULL, NULL,   ALPHOPTS,    NULL,     NULL, "input alignment is DNA sequence data",                  2 },
+  { "--rna",     eslARG_NONE,   FALSE, NULL, NULL,   ALPHOPTS,    NULL,     NULL, "input alignment is RNA sequence data",                  2 },
+/* Alternate model construction strategies */
+  { "--fast",    eslARG_NONE,"default",NULL, NULL,    CONOPTS,    NULL,     NULL, "assign cols w/ >= symfrac residues as consensus",       3 },
+  { "--hand",    eslARG_NONE,   FALSE, NULL, NULL,    CONOPTS,    NULL,     NULL, "manual construction (requires reference annotation)",   3 },
+  { "--profillic-amino",    eslARG_NONE, FALSE,NULL, NULL,    CONOPTS,    NULL,     NULL, (char *)(Family::alignment ? "input msa is an AA galosh alignment profile (from profuse)" : "input msa is actually an AA galosh profile (from profillic)"), 3 },
+  { "--profillic-dna",    eslARG_NONE, FALSE,NULL, NULL,    CONOPTS,    NULL,     NULL, (char *)(Family::alignment ? "input msa is a DNA galosh alignment profile (from profuse)" : "input msa is actually a DNA galosh profile (from profillic)"), 3 },
+  { "--symfrac", eslARG_REAL,   "0.5", NULL, "0<=x<=1", NULL,   "--fast",   NULL, "sets sym fraction controlling --fast construction",     3 },
+  { "--fragthresh",eslARG_REAL, "0.5", NULL, "0<=x<=1", NULL,     NULL,     NULL, "if L <= x*alen, tag sequence as a fragment",            3 },
+/* Alternate relative sequence weighting strategies */
+  /* --wme not implemented in HMMER3 yet */
+  { "--wpb",     eslARG_NONE,"default",NULL, NULL,    WGTOPTS,    NULL,      NULL, "Henikoff position-based weights",                      4 },
+  { "--wgsc",    eslARG_NONE,   NULL,  NULL, NULL,    WGTOPTS,    NULL,      NULL, "Gerstein/Sonnhammer/Chothia tree weights",             4 },
+  { "--wblosum", eslARG_NONE,   NULL,  NULL, NULL,    WGTOPTS,    NULL,      NULL, "Henikoff simple filter weights",                       4 },
+  { "--wnone",   eslARG_NONE,   NULL,  NULL, NULL,    WGTOPTS,    NULL,      NULL, "don't do any relative weighting; set all to 1",        4 },
+  { "--wgiven",  eslARG_NONE,   NULL,  NULL, NULL,    WGTOPTS,    NULL,      NULL, "use weights as given in MSA file",                     4 },
+  { "--wid",     eslARG_REAL, "0.62",  NULL,"0<=x<=1",   NULL,"--wblosum",   NULL, "for --wblosum: set identity cutoff",                   4 },
+#ifdef HMMER_THREADS 
+  { "--Wcpu",    eslARG_INT,      "0", NULL,"n>=0",      NULL,    NULL,      NULL, "split each alignment's weighting and clustering across <n> threads", 4 },
+#endif
+/* Alternative effective sequence weighting strategies */
+  { "--eent",    eslARG_NONE,"default",NULL, NULL,    EFFOPTS,    NULL,      NULL, "adjust eff seq # to achieve relative entropy target",  5 },
+  { "--eclust",  eslARG_NONE,  FALSE,  NULL, NULL,    EFFOPTS,    NULL,      NULL, "eff seq # is # of single linkage clusters",            5 },
+  { "--enone",   eslARG_NONE,  FALSE,  NULL, NULL,    EFFOPTS,    NULL,      NULL, "no effective seq # weighting: just use nseq",          5 },
+  { "--eset",    eslARG_REAL,   NULL,  NULL, NULL,    EFFOPTS,    NULL,      NULL, "set eff seq # for all models to <x>",                  5 },
+  { "--ere",     eslARG_REAL,   NULL,  NULL,"x>0",       NULL, "--eent",     NULL, "for --eent: set minimum rel entropy/position to <x>",  5 },
+  { "--esigma",  eslARG_REAL, "45.0",  NULL,"x>0",       NULL, "--eent",     NULL, "for --eent: set sigma param to <x>",                   5 },
+  { "--eid",     eslARG_REAL, "0.62",  NULL,"0<=x<=1",   NULL,"--eclust",    NULL, "for --eclust: set fractional identity cutoff to <x>",  5 },
+/* Alternative prior strategies */
+  { "--pnone",   eslARG_NONE,  FALSE,  NULL, NULL,       NULL,  NULL,"--plaplace", "don't use any prior; parameters are frequencies",      9 },
+  { "--plaplace",eslARG_NONE,  FALSE,  NULL, NULL,       NULL,  NULL,   "--pnone", "use a Laplace +1 prior",                               9 },
+/* Single sequence methods */
+  { "--single",  eslARG_NONE,   FALSE, NULL,   NULL,   NULL,  NULL,            "",   "use substitution score matrix for single-sequence protein inputs",     10 },
+  { "--popen",    eslARG_REAL,   "0.02", NULL,"0<=x<0.5",NULL, NULL,           "",   "gap open probability (with --single)",                         10 },
+  { "--pextend",  eslARG_REAL,    "0.4", NULL, "0<=x<1", NULL, NULL,           "",   "gap extend probability (with --single)",                       10 },
+  { "--mx",     eslARG_STRING, "BLOSUM62", NULL, NULL,   NULL, NULL,   "--mxfile",   "substitution score matrix (built-in matrices, with --single)", 10 },
+  { "--mxfile", eslARG_INFILE,     NULL, NULL,   NULL,   NULL, NULL,       "--mx",   "read substitution score matrix from file <f> (with --single)", 10 },
+
+  /* Control of E-value calibration */
+  { "--EmL",     eslARG_INT,    "200", NULL,"n>0",       NULL,    NULL,      NULL, "length of sequences for MSV Gumbel mu fit",            6 },   
+  { "--EmN",     eslARG_INT,    "200", NULL,"n>0",       NULL,    NULL,      NULL, "number of sequences for MSV Gumbel mu fit",            6 },   
+  { "--EvL",     eslARG_INT,    "200", NULL,"n>0",       NULL,    NULL,      NULL, "length of sequences for Viterbi Gumbel mu fit",        6 },   
+  { "--EvN",     eslARG_INT,    "200", NULL,"n>0",       NULL,    NULL,      NULL, "number of sequences for Viterbi Gumbel mu fit",        6 },   
+  { "--EfL",     eslARG_INT,    "100", NULL,"n>0",       NULL,    NULL,      NULL, "length of sequences for Forward exp tail tau fit",     6 },   
+  { "--EfN",     eslARG_INT,    "200", NULL,"n>0",       NULL,    NULL,      NULL, "number of sequences for Forward exp tail tau fit",     6 },   
+  { "--Eft",     eslARG_REAL,  "0.04", NULL,"0<x<1",     NULL,    NULL,      NULL, "tail mass for Forward exponential tail tau fit",       6 },   
+#ifdef HMMER_THREADS 
+  { "--Ecpu",    eslARG_INT,      "0", NULL,"n>=0",      NULL,    NULL,      NULL, "split each model's calibration across <n> threads",    6 },
+#endif
+
+/* Other options */
+#ifdef HMMER_THREADS 
+  { "--cpu",     eslARG_INT,    NULL,"HMMER_NCPU","n>=0",NULL,     NULL,  NULL,  "number of parallel CPU workers for multithreads",       8 },
+  { "--readers", eslARG_INT,      "0", NULL, "n>=0",    NULL,      NULL,  "--profillic-amino,--profillic-dna", "parse Stockholm input with <n> threads", 8 },
+  { "--max-memory", eslARG_INT,  NULL, NULL, "n>0",     NULL,      NULL,  NULL,  "with --cpu, hold about <n> MB of alignments and models in flight, at most", 8 },
+#endif
+#ifdef HAVE_MPI
+  { "--mpi",     eslARG_NONE,   FALSE, NULL, NULL,      NULL,      NULL,  NULL,  "run as an MPI parallel program",                        8 },
+#endif
+  { "--stall",   eslARG_NONE,       FALSE, NULL, NULL,    NULL,     NULL,    NULL, "arrest after start: for attaching debugger to process", 8 },
+  { "--informat", eslARG_STRING,     NULL, NULL, NULL,    NULL,     NULL,    NULL, "assert input alifile is in format <s> (no autodetect)", 8 },
+  { "--seed",     eslARG_INT,        "42", NULL, "n>=0",  NULL,     NULL,    NULL, "set RNG seed to <n> (if 0: one-time arbitrary seed)",   8 },
+  { "--w_beta",   eslARG_REAL,       NULL, NULL, NULL,    NULL,     NULL,    NULL, "tail mass at which window length is determined",        8 },
+  { "--w_length", eslARG_INT,        NULL, NULL, NULL,    NULL,     NULL,    NULL, "window length ",                                        8 },
+  { "--maxinsertlen",  eslARG_INT,   NULL, NULL, "n>=5",  NULL,     NULL,    NULL, "pretend all inserts are length <= <n>",   8 },
+  { "--noprior", eslARG_NONE,  FALSE, NULL, NULL,       NULL,      NULL,    NULL, "do not apply any priors",                                8 },
+  { "--timings", eslARG_OUTFILE, NULL, NULL, NULL,       NULL,      NULL,    NULL, "save per-stage build times (TSV) to file <f>",           8 },
+  { "--nostats", eslARG_NONE,   FALSE, NULL, NULL,       NULL,      NULL,    NULL, "don't compute each model's mean relative entropy (re/pos)", 8 },
+  { "--press",   eslARG_NONE,   FALSE, NULL, NULL,       NULL,      NULL,    NULL, "also write <hmmfile_out>.h3{m,i,f,p}, as hmmpress would", 8 },
+  { "--server",  eslARG_NONE,   FALSE, NULL, NULL,       NULL,      NULL,    NULL, "build server: read \"<hmmfile_out> <msafile>\" jobs from stdin, one per line", 8 },
+  { "--cache",   eslARG_STRING,  NULL, NULL, NULL,       NULL,      NULL,    NULL, "reuse models built before from unchanged profiles, cached in dir <d>", 8 },
+  { "--sched",   eslARG_INT,      "0", NULL, "n>=0",     NULL,      NULL,    NULL, "with --cpu/--mpi, dispatch the costliest of the next <n> alignments first", 8 },
+  { "--profile-precision", eslARG_STRING, "float", NULL, NULL, NULL,  NULL,    NULL, "read --profillic-* profiles as probability type <s>: float, double, logspace or bfloat", 8 },
+/* Alignment profiles only: this row must stay last */
+  { (char *)(Family::alignment ? "--nseq" : NULL), eslARG_INT, "0", NULL, "n>=0", NULL, NULL, NULL, "override n of seqs from msa/alignment profile", 3 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+
+/** 
+ * struct cfg_s : "Global" application configuration shared by all threads/processes
+ * 
+ * This structure is passed to routines within main.c, as a means of semi-encapsulation
+ * of shared data amongst different parallel processes (threads or MPI processes).
+ */
+struct cfg_s {
+  FILE         *ofp;		/* output file (default is stdout) */
+
+  char         *alifile;	/* name of the alignment file we're building HMMs from  */
+  int           fmt;		/* format code for alifile */
+  int           precision;      /* probability type galosh profiles are read as: PROFILLIC_PRECISION_* (--profile-precision) */
+  int           nseq;           /* n of sequences alignment profiles were trained on, if not 0 (--nseq) */
+  ESLX_MSAFILE *afp;            /* open alifile  */
+  ESL_ALPHABET *abc;		/* digital alphabet */
+
+  char         *hmmName;        /* hmm file name supplied from -n          */
+  char         *hmmfile;        /* file to write HMM to                    */
+  FILE         *hmmfp;          /* HMM output file handle                  */
+
+  char         *postmsafile;	/* optional file to resave annotated, modified MSAs to  */
+  FILE         *postmsafp;	/* open <postmsafile>, or NULL */
+
+  int           nali;		/* which # alignment this is in file (only valid in serial mode)   */
+  int           nnamed;		/* number of alignments that had their own names */
+
+  int           do_mpi;		/* TRUE if we're doing MPI parallelization */
+  int           nproc;		/* how many MPI processes, total */
+  int           my_rank;	/* who am I, in 0..nproc-1 */
+  int           do_stall;	/* TRUE to stall the program until gdb attaches */
+
+  int           use_priors; /* TRUE except when esl_opt_GetBoolean(go, "--noprior") */
+  int           do_stats;   /* FALSE with --nostats: no re/pos column */
+  int           calibrate_ncpu; /* threads for each model's E-value calibration; 0 means serial */
+  int           weight_ncpu;    /* threads for each alignment's weighting and clustering; 0 means serial */
+
+  char         *timingsfile;    /* optional file to save per-stage build times to (--timings) */
+  FILE         *timingsfp;      /* open <timingsfile>, or NULL */
+
+  int           do_press;       /* TRUE to also write the pressed database (--press) */
+  int           do_server;      /* TRUE to take <hmmfile>/<alifile> jobs from stdin (--server) */
+  FILE         *mfp;            /* open <hmmfile>.h3m (binary HMMs), or NULL */
+  FILE         *ffp;            /* open <hmmfile>.h3f (MSV filter parts of optimized profiles), or NULL */
+  FILE         *pfp;            /* open <hmmfile>.h3p (the rest of the optimized profiles), or NULL */
+  ESL_NEWSSI   *nssi;           /* SSI index of <mfp>, saved to <hmmfile>.h3i by press_close() */
+  uint16_t      fh;             /* <mfp>'s handle in <nssi> */
+
+  PROFILLIC_BUILD_CACHE *cache; /* models built before, by profile content and options (--cache), or NULL */
+
+  PROFILLIC_SCHED *sched;       /* alignments read ahead, to dispatch costliest first (--sched), or NULL */
+  int           sched_eof;      /* TRUE once <sched> has read the last alignment */
+  double        sched_symfrac;  /* --symfrac, for estimating model lengths */
+  double        sched_calib_residues; /* total length of the sequences simulated to calibrate each model */
+
+#ifdef HMMER_THREADS
+  PROFILLIC_READERS *readers;   /* threads parsing <alifile> from its record offsets (--readers), or NULL */
+  MEMORY_BUDGET *budget;        /* bytes of alignments and models in flight (--max-memory), or NULL */
+#endif
+};
+
+
+static char usage[]  = "[-options] <hmmfile_out> <msafile>";
+static char banner[] = "profile HMM construction from multiple sequence alignments and galosh profiles";
+
+template <class Family>
+static int  profillic_usual_master(const ESL_GETOPTS *go, struct cfg_s *cfg);
+template <class Family>
+static void run_input(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus);
+template <class Family, typename ProbabilityType>
+static void run_input_as(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus);
+template <class Family>
+static void profillic_server_loop(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus);
+static int  server_job_open (struct cfg_s *cfg, char *hmmfile, char *alifile, char *errbuf);
+static int  server_job_close(struct cfg_s *cfg, char *errbuf);
+template <class ProfileType>
+static void  profillic_serial_loop  (WORKER_INFO *info, struct cfg_s *cfg, const ESL_GETOPTS *go);
+#ifdef HMMER_THREADS
+template <class ProfileType>
+static void profillic_thread_master(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus);
+template <class ProfileType>
+static void thread_loop(ESL_THREADS *obj, ESL_WORK_QUEUE *queue, struct cfg_s *cfg, const ESL_GETOPTS *go);
+template <class ProfileType>
+static void pipeline_thread(void *arg);
+
+static int   output_writer_Create(const struct cfg_s *cfg, int nring, OUTPUT_WRITER **ret_w);
+static void  output_writer_Put   (OUTPUT_WRITER *w, WORK_ITEM *item);
+static void  output_writer_Finish(OUTPUT_WRITER *w, int nlast);
+static void *output_writer_thread(void *arg);
+
+static int    memory_budget_Create (size_t max, MEMORY_BUDGET **ret_b);
+static void   memory_budget_Admit  (MEMORY_BUDGET *b, size_t bytes);
+static void   memory_budget_Built  (MEMORY_BUDGET *b);
+static void   memory_budget_Release(MEMORY_BUDGET *b, size_t bytes);
+static void   memory_budget_Destroy(MEMORY_BUDGET *b);
+static size_t item_bytes(const struct cfg_s *cfg, const ESL_MSA *msa);
+#endif /*HMMER_THREADS*/
+
+#ifdef HAVE_MPI
+template <class ProfileType>
+static void  mpi_master    (const ESL_GETOPTS *go, struct cfg_s *cfg);
+template <class ProfileType>
+static void  mpi_worker    (const ESL_GETOPTS *go, struct cfg_s *cfg);
+template <class Family, typename ProbabilityType>
+static void  mpi_run_as    (const ESL_GETOPTS *go, struct cfg_s *cfg);
+static void  mpi_init_open_failure(ESLX_MSAFILE *afp, int status);
+static void  mpi_init_other_failure(char *format, ...);
+#endif
+
+static int profillic_output_header(const ESL_GETOPTS *go, const struct cfg_s *cfg);
+static int output_result(const struct cfg_s *cfg, char *errbuf, int msaidx, ESL_MSA *msa, P7_HMM *hmm, ESL_MSA *postmsa, FILE *spill, double entropy,
+                         int workeridx, const PROFILLIC_BUILD_TIMINGS *timings, P7_OPROFILE *om);
+static int postmsa_Spill  (ESL_MSA *postmsa, FILE **ret_spill);
+static int postmsa_Unspill(FILE *spill, FILE *ofp);
+static int press_open (struct cfg_s *cfg, char *errbuf);
+static int press_close(struct cfg_s *cfg, char *errbuf);
+static int output_timings(FILE *fp, const char *idx, const char *name, const char *worker, const PROFILLIC_BUILD_TIMINGS *timings);
+static int set_msa_name (      struct cfg_s *cfg, char *errbuf, ESL_MSA *msa);
+static int sched_open   (const ESL_GETOPTS *go, struct cfg_s *cfg);
+static int readers_open (const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf);
+static void readers_close(struct cfg_s *cfg);
+template <class ProfileType>
+static int read_input   (struct cfg_s *cfg, ESL_MSA **ret_msa, ProfileType *profile);
+template <class ProfileType>
+static void sched_close (struct cfg_s *cfg);
+template <class ProfileType>
+static int next_input   (struct cfg_s *cfg, int do_name, char *errbuf, int *ret_rstatus, ESL_MSA **ret_msa, void **io_profile, int *ret_nali);
+
+
+template <class Family>
+static int
+process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_hmmfile, char **ret_alifile)
+{
+  ESL_GETOPTS *go = esl_getopts_Create(ProfillicHmmbuildOptions<Family>::options);
+  int          status;
+
+  if (esl_opt_ProcessEnvironment(go)         != eslOK) { if (printf("Failed to process environment:\n%s\n", go->errbuf) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if (esl_opt_ProcessCmdline(go, argc, argv) != eslOK) { if (printf("Failed to parse command line:\n%s\n",  go->errbuf) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if (esl_opt_VerifyConfig(go)               != eslOK) { if (printf("Failed to parse command line:\n%s\n",  go->errbuf) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+
+  /* help format: */
+  if (esl_opt_GetBoolean(go, "-h") == TRUE) 
+    {
+      profillic_p7_banner(stdout, argv[0], banner);
+      esl_usage(stdout, argv[0], usage);
+
+      if (puts("\nBasic options:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 1, 2, 80);
+
+      if (puts("\nOptions for selecting alphabet rather than guessing it:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 2, 2, 80);
+
+      if (puts("\nAlternative model construction strategies:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 3, 2, 80);
+
+      if (puts("\nAlternative relative sequence weighting strategies:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 4, 2, 80);
+
+      if (puts("\nAlternative effective sequence weighting strategies:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 5, 2, 80);
+
+      if (puts("\nAlternative prior strategies:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 9, 2, 80);
+
+      if (puts("\nHandling single sequence inputs:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 10, 2, 80);
+
+
+      if (puts("\nControl of E-value calibration:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 6, 2, 80);
+
+      if (puts("\nOther options:") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 8, 2, 80);
+      exit(0);
+    }
+
+  /* A build server takes its files from the jobs it reads, and builds
+   * for one alphabet, so the workers can be set up once, before any
+   * input is seen.
+   */
+  if (esl_opt_GetBoolean(go, "--server"))
+    {
+      if (esl_opt_ArgNumber(go) != 0) { if (puts("With --server, give no <hmmfile_out> or <msafile>: they come from the jobs read from stdin.") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+      if (! esl_opt_GetBoolean(go, "--amino") && ! esl_opt_GetBoolean(go, "--dna") && ! esl_opt_GetBoolean(go, "--rna") && ! esl_opt_IsOn(go, "--profillic-amino") && ! esl_opt_IsOn(go, "--profillic-dna"))
+	{ if (puts("--server needs the alphabet: use --amino, --dna, --rna, --profillic-amino or --profillic-dna.") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+#ifdef HAVE_MPI
+      if (esl_opt_IsOn(go, "--mpi")) { if (puts("Options --server and --mpi are incompatible.") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+#endif
+      *ret_hmmfile = NULL;
+      *ret_alifile = NULL;
+      *ret_go      = go;
+      return eslOK;
+    }
+
+  if (esl_opt_ArgNumber(go)                  != 2)    { if (puts("Incorrect number of command line arguments.")          < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if ((*ret_hmmfile = esl_opt_GetArg(go, 1)) == NULL) { if (puts("Failed to get <hmmfile_out> argument on command line") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if ((*ret_alifile = esl_opt_GetArg(go, 2)) == NULL) { if (puts("Failed to get <msafile> argument on command line")     < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+
+  if (strcmp(*ret_hmmfile, "-") == 0) 
+    { if (puts("Can't write <hmmfile_out> to stdout: don't use '-'")         < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if (strcmp(*ret_alifile, "-") == 0 && ! esl_opt_IsOn(go, "--informat") && ! esl_opt_IsOn(go, "--profillic-amino") && ! esl_opt_IsOn(go, "--profillic-dna"))
+    { if (puts("Must specify --informat to read <alifile> from stdin ('-')") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+
+#ifdef HAVE_MPI
+  if (esl_opt_IsOn(go, "--mpi") && esl_opt_IsOn(go, "--cpu")) 
+    {
+      int mpisetby = esl_opt_GetSetter(go, "--mpi");
+      int cpusetby = esl_opt_GetSetter(go, "--cpu");
+
+      if (mpisetby == cpusetby) {
+	if (puts("Options --cpu and --mpi are incompatible. The MPI implementation is not multithreaded.") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+	goto FAILURE;
+      }
+    }
+#endif
+
+  *ret_go = go;
+  return eslOK;
+  
+ FAILURE:  /* all errors handled here are user errors, so be polite.  */
+  esl_usage(stdout, argv[0], usage);
+  puts("\nwhere basic options are:");
+  esl_opt_DisplayHelp(stdout, go, 1, 2, 80);
+  printf("\nTo see more help on other available options, do:\n  %s -h\n\n", argv[0]);
+  esl_getopts_Destroy(go);
+  exit(1);  
+
+ ERROR:
+  if (go) esl_getopts_Destroy(go);
+  exit(status);
+}
+
+/**
+ * profillic_output_header
+ *
+ * display input data summary and program parameters
+ */
+static int
+profillic_output_header(const ESL_GETOPTS *go, const struct cfg_s *cfg)
+{
+  if (cfg->my_rank > 0)  return eslOK;
+
+  profillic_p7_banner(cfg->ofp, go->argv[0], banner);
+
+  if (cfg->do_server) {
+    if (fprintf(cfg->ofp, "# build server:                     jobs read from stdin\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  } else {
+    if( esl_opt_IsUsed(go, "--profillic-amino") || esl_opt_IsUsed(go, "--profillic-dna") ) {
+      if (fprintf(cfg->ofp, "# input galosh profile file:        %s\n", cfg->alifile) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    } else {
+      if (fprintf(cfg->ofp, "# input alignment file:             %s\n", cfg->alifile) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    }
+    if (fprintf(cfg->ofp, "# output HMM file:                  %s\n", cfg->hmmfile) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  }
+
+  if (esl_opt_IsUsed(go, "-n")           && fprintf(cfg->ofp, "# name (the single) HMM:            %s\n",        esl_opt_GetString(go, "-n"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-o")           && fprintf(cfg->ofp, "# output directed to file:          %s\n",        esl_opt_GetString(go, "-o"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-O")           && fprintf(cfg->ofp, "# processed alignment resaved to:   %s\n",        esl_opt_GetString(go, "-O"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--amino")      && fprintf(cfg->ofp, "# input alignment is asserted as:   protein\n")                                        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--dna")        && fprintf(cfg->ofp, "# input alignment is asserted as:   DNA\n")                                            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--rna")        && fprintf(cfg->ofp, "# input alignment is asserted as:   RNA\n")                                            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--fast")       && fprintf(cfg->ofp, "# model architecture construction:  fast/heuristic\n")                                 < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--hand")       && fprintf(cfg->ofp, "# model architecture construction:  hand-specified by RF annotation\n")                < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--profillic-amino")       && fprintf(cfg->ofp, "# model architecture construction:  use input amino profile\n")                < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--profillic-dna")       && fprintf(cfg->ofp, "# model architecture construction:  use input dna profile\n")                < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (cfg->nseq > 0                      && fprintf(cfg->ofp, "# n of sequences in profile:        %d\n",        cfg->nseq)                           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--symfrac")    && fprintf(cfg->ofp, "# sym fraction for model structure: %.3f\n",      esl_opt_GetReal(go, "--symfrac"))    < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--fragthresh") && fprintf(cfg->ofp, "# seq called frag if L <= x*alen:   %.3f\n",      esl_opt_GetReal(go, "--fragthresh")) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--wpb")        && fprintf(cfg->ofp, "# relative weighting scheme:        Henikoff PB\n")                                    < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--wgsc")       && fprintf(cfg->ofp, "# relative weighting scheme:        G/S/C\n")                                          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--wblosum")    && fprintf(cfg->ofp, "# relative weighting scheme:        BLOSUM filter\n")                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--wnone")      && fprintf(cfg->ofp, "# relative weighting scheme:        none\n")                                           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--wid")        && fprintf(cfg->ofp, "# frac id cutoff for BLOSUM wgts:   %f\n",        esl_opt_GetReal(go, "--wid"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--Wcpu")       && fprintf(cfg->ofp, "# threads per alignment weighting:  %d\n",        esl_opt_GetInteger(go, "--Wcpu"))    < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#endif
+  if (esl_opt_IsUsed(go, "--eent")       && fprintf(cfg->ofp, "# effective seq number scheme:      entropy weighting\n")                              < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--eclust")     && fprintf(cfg->ofp, "# effective seq number scheme:      single linkage clusters\n")                        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--enone")      && fprintf(cfg->ofp, "# effective seq number scheme:      none\n")                                           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--eset")       && fprintf(cfg->ofp, "# effective seq number:             set to %f\n", esl_opt_GetReal(go, "--eset"))       < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--ere")        && fprintf(cfg->ofp, "# minimum rel entropy target:       %f bits\n",   esl_opt_GetReal(go, "--ere"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--esigma")     && fprintf(cfg->ofp, "# entropy target sigma parameter:   %f bits\n",   esl_opt_GetReal(go, "--esigma"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--eid")        && fprintf(cfg->ofp, "# frac id cutoff for --eclust:      %f\n",        esl_opt_GetReal(go, "--eid"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--pnone")      && fprintf(cfg->ofp, "# prior scheme:                     none\n")                                           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--plaplace")   && fprintf(cfg->ofp, "# prior scheme:                     Laplace +1\n")                                     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--EmL")        && fprintf(cfg->ofp, "# seq length for MSV Gumbel mu fit: %d\n",        esl_opt_GetInteger(go, "--EmL"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--EmN")        && fprintf(cfg->ofp, "# seq number for MSV Gumbel mu fit: %d\n",        esl_opt_GetInteger(go, "--EmN"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--EvL")        && fprintf(cfg->ofp, "# seq length for Vit Gumbel mu fit: %d\n",        esl_opt_GetInteger(go, "--EvL"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--EvN")        && fprintf(cfg->ofp, "# seq number for Vit Gumbel mu fit: %d\n",        esl_opt_GetInteger(go, "--EvN"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--EfL")        && fprintf(cfg->ofp, "# seq length for Fwd exp tau fit:   %d\n",        esl_opt_GetInteger(go, "--EfL"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--EfN")        && fprintf(cfg->ofp, "# seq number for Fwd exp tau fit:   %d\n",        esl_opt_GetInteger(go, "--EfN"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--Eft")        && fprintf(cfg->ofp, "# tail mass for Fwd exp tau fit:    %f\n",        esl_opt_GetReal(go, "--Eft"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--Ecpu")       && fprintf(cfg->ofp, "# threads per model calibration:    %d\n",        esl_opt_GetInteger(go, "--Ecpu"))    < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#endif
+  if (esl_opt_IsUsed(go, "--popen")      && fprintf(cfg->ofp, "# gap open probability:            %f\n",         esl_opt_GetReal   (go, "--popen"))   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--pextend")    && fprintf(cfg->ofp, "# gap extend probability:          %f\n",         esl_opt_GetReal   (go, "--pextend")) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--mx")         && fprintf(cfg->ofp, "# subst score matrix (built-in):   %s\n",         esl_opt_GetString (go, "--mx"))      < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--mxfile")     && fprintf(cfg->ofp, "# subst score matrix (file):       %s\n",         esl_opt_GetString (go, "--mxfile"))  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--maxinsertlen")  && fprintf(cfg->ofp, "# max insert length:                %d\n",         esl_opt_GetInteger (go, "--maxinsertlen"))  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--cpu")        && fprintf(cfg->ofp, "# number of worker threads:         %d\n",        esl_opt_GetInteger(go, "--cpu"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");  
+  if (esl_opt_IsUsed(go, "--max-memory") && fprintf(cfg->ofp, "# max in-flight memory:             %d MB\n",     esl_opt_GetInteger(go, "--max-memory")) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--readers")    && fprintf(cfg->ofp, "# alignment parser threads:         %d\n",        esl_opt_GetInteger(go, "--readers")) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#endif
+#ifdef HAVE_MPI
+  if (esl_opt_IsUsed(go, "--mpi")        && fprintf(cfg->ofp, "# parallelization mode:             MPI\n")                                            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#endif
+  if (esl_opt_IsUsed(go, "--seed"))  {
+    if (esl_opt_GetInteger(go, "--seed") == 0  && fprintf(cfg->ofp,"# random number seed:               one-time arbitrary\n")                        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    else if                              (  fprintf(cfg->ofp,"# random number seed set to:        %d\n",         esl_opt_GetInteger(go, "--seed"))    < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  }
+  if (esl_opt_IsUsed(go, "--w_beta")     && fprintf(cfg->ofp, "# window length beta value:         %g bits\n",   esl_opt_GetReal(go, "--w_beta"))     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--w_length")   && fprintf(cfg->ofp, "# window length :                   %d\n",        esl_opt_GetInteger(go, "--w_length"))< 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--timings")    && fprintf(cfg->ofp, "# build stage times saved to:       %s\n",        esl_opt_GetString(go, "--timings"))  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--nostats")    && fprintf(cfg->ofp, "# model stats:                      not computed\n")                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--press")      && fprintf(cfg->ofp, "# pressed database saved to:        %s.h3{m,i,f,p}\n", (cfg->do_server ? "<hmmfile_out>" : cfg->hmmfile)) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--cache")      && fprintf(cfg->ofp, "# build cache directory:            %s\n",        esl_opt_GetString(go, "--cache"))    < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--sched")      && fprintf(cfg->ofp, "# costliest-first dispatch window:  %d alignments\n", esl_opt_GetInteger(go, "--sched"))  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--profile-precision") && fprintf(cfg->ofp, "# profile probability type:         %s\n",           esl_opt_GetString(go, "--profile-precision")) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+
+  if (fprintf(cfg->ofp, "# - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -\n\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  return eslOK;
+}
+
+/**
+ * profillic_hmmbuild_main()
+ *
+ * The main() of a program building models from galosh profiles of
+ * <Family> (ProfillicTreeProfiles for profillic-hmmbuild,
+ * ProfillicAlignmentProfiles for profillic-alignment-hmmbuild; see
+ * profillic-profile_kind.hpp), or from MSAs.
+ */
+template <class Family>
+static int
+profillic_hmmbuild_main(int argc, char **argv)
+{
+  ESL_GETOPTS     *go = NULL;	/* command line processing                 */
+  ESL_STOPWATCH   *w  = esl_stopwatch_Create();
+  struct cfg_s     cfg;
+
+  p7_Init();
+
+  cfg.alifile     = NULL;
+  cfg.hmmfile     = NULL;
+
+  /* Parse the command line
+   */
+  process_commandline<Family>(argc, argv, &go, &cfg.hmmfile, &cfg.alifile);    
+
+  /** 
+   * Initialize what we can in the config structure (without knowing the alphabet yet).
+   * Fields controlled by masters are set up in usual_master() or mpi_master()
+   * Fields used by workers are set up in mpi_worker()
+   */
+  cfg.ofp         = NULL;	           
+  cfg.fmt         = eslMSAFILE_UNKNOWN;    /* autodetect alignment format by default. */ 
+  cfg.afp         = NULL;	           
+  cfg.abc         = NULL;	           
+  cfg.hmmfp       = NULL;	           
+  cfg.postmsafile = esl_opt_GetString(go, "-O"); /* NULL by default */
+  cfg.postmsafp   = NULL;                  
+  cfg.timingsfile = esl_opt_GetString(go, "--timings"); /* NULL by default */
+  cfg.timingsfp   = NULL;
+  cfg.do_press    = esl_opt_GetBoolean(go, "--press");
+  cfg.do_server   = esl_opt_GetBoolean(go, "--server");
+  cfg.mfp         = NULL;
+  cfg.ffp         = NULL;
+  cfg.pfp         = NULL;
+  cfg.nssi        = NULL;
+  cfg.fh          = 0;
+  cfg.cache       = NULL;
+  cfg.sched       = NULL;
+  cfg.sched_eof   = FALSE;
+  cfg.sched_symfrac        = 0.0;
+  cfg.sched_calib_residues = 0.0;
+#ifdef HMMER_THREADS
+  cfg.readers     = NULL;
+  cfg.budget      = NULL;
+#endif
+
+  cfg.nali       = 0;		           /* this counter is incremented in masters */
+  cfg.nnamed     = 0;		           /* 0 or 1 if a single MSA; == nali if multiple MSAs */
+  cfg.do_mpi     = FALSE;	           /* this gets reset below, if we init MPI */
+  cfg.nproc      = 0;		           /* this gets reset below, if we init MPI */
+  cfg.my_rank    = 0;		           /* this gets reset below, if we init MPI */
+  cfg.do_stall   = esl_opt_GetBoolean(go, "--stall");
+  cfg.hmmName    = esl_opt_GetString(go, "-n"); /* NULL by default */
+  cfg.nseq       = Family::alignment ? esl_opt_GetInteger(go, "--nseq") : 0; /* 0 by default */
+
+  cfg.use_priors = !esl_opt_GetBoolean(go, "--noprior");
+  cfg.do_stats   = !esl_opt_GetBoolean(go, "--nostats");
+#ifdef HMMER_THREADS
+  cfg.calibrate_ncpu = esl_opt_GetInteger(go, "--Ecpu");
+  cfg.weight_ncpu    = esl_opt_GetInteger(go, "--Wcpu");
+#else
+  cfg.calibrate_ncpu = 0;
+  cfg.weight_ncpu    = 0;
+#endif
+
+  if( esl_opt_IsUsed(go, "--profillic-amino")||esl_opt_IsUsed(go, "--profillic-dna") ) {
+    cfg.fmt = eslMSAFILE_PROFILLIC;
+  } else if (esl_opt_IsOn(go, "--informat")) {
+    cfg.fmt = eslx_msafile_EncodeFormat(esl_opt_GetString(go, "--informat"));
+
+    if (cfg.fmt == eslMSAFILE_UNKNOWN) p7_Fail("%s is not a recognized input sequence file format\n", esl_opt_GetString(go, "--informat"));
+  }
+  cfg.precision = profillic_precision_Encode(esl_opt_GetString(go, "--profile-precision"));
+  if (cfg.precision == PROFILLIC_PRECISION_UNKNOWN) p7_Fail("%s is not a recognized profile probability type (float, double, logspace or bfloat)\n", esl_opt_GetString(go, "--profile-precision"));
+  if (cfg.fmt == eslMSAFILE_PROFILLIC && ! Family::any_precision && cfg.precision != PROFILLIC_PRECISION_FLOAT) p7_Fail("galosh alignment profiles can only be read as float, not --profile-precision %s\n", esl_opt_GetString(go, "--profile-precision"));
+
+  /* This is our stall point, if we need to wait until we get a
+   * debugger attached to this process for debugging (especially
+   * useful for MPI):
+   */
+  while (cfg.do_stall); 
+
+  /* Start timing. */
+  esl_stopwatch_Start(w);
+
+  /* Figure out who we are, and send control there: 
+   * we might be an MPI master, an MPI worker, or a serial program.
+   */
+#ifdef HAVE_MPI
+  if (esl_opt_GetBoolean(go, "--mpi")) 
+    {
+      if (cfg.fmt == eslMSAFILE_PROFILLIC && ! Family::shippable) p7_Fail("galosh alignment profiles can't be sent to MPI workers; use --cpu instead of --mpi\n");
+
+      cfg.do_mpi     = TRUE;
+      MPI_Init(&argc, &argv);
+      MPI_Comm_rank(MPI_COMM_WORLD, &(cfg.my_rank));
+      MPI_Comm_size(MPI_COMM_WORLD, &(cfg.nproc));
+
+      /* galosh profiles are shipped to the workers alongside their consensus MSAs */
+      switch (cfg.fmt == eslMSAFILE_PROFILLIC ? cfg.precision : PROFILLIC_PRECISION_FLOAT) {
+      case PROFILLIC_PRECISION_DOUBLE:   mpi_run_as<Family, doublerealspace>(go, &cfg); break;
+      case PROFILLIC_PRECISION_LOGSPACE: mpi_run_as<Family, logspace>       (go, &cfg); break;
+      case PROFILLIC_PRECISION_BFLOAT:   mpi_run_as<Family, bfloat>         (go, &cfg); break;
+      default:                           mpi_run_as<Family, floatrealspace> (go, &cfg); break;
+      }
+
+      esl_stopwatch_Stop(w);
+      esl_stopwatch_MPIReduce(w, 0, MPI_COMM_WORLD);
+      MPI_Finalize();
+    }
+  else
+#endif /*HAVE_MPI*/
+    {
+      profillic_usual_master<Family>(go, &cfg);
+      esl_stopwatch_Stop(w);
+    }
+
+  if (cfg.my_rank == 0) {
+    fputc('\n', cfg.ofp);
+    esl_stopwatch_Display(cfg.ofp, w, "# CPU time: ");
+#ifdef HMMER_THREADS
+    if (cfg.budget != NULL) fprintf(cfg.ofp, "# Peak in-flight memory: %.1f MB (of %.1f MB allowed)\n", (double) cfg.budget->peak / 1048576.0, (double) cfg.budget->max / 1048576.0);
+#endif
+  }
+
+  /* Clean up the shared cfg. 
+   */
+  if (cfg.my_rank == 0) {
+    if (esl_opt_IsOn(go, "-o")) { fclose(cfg.ofp); }
+    if (cfg.afp)   eslx_msafile_Close(cfg.afp);
+    if (cfg.abc)   esl_alphabet_Destroy(cfg.abc);
+    if (cfg.hmmfp) profillic_ofile_Close(cfg.hmmfp, cfg.hmmfile);
+    if (cfg.postmsafp) profillic_ofile_Close(cfg.postmsafp, cfg.postmsafile);
+    if (cfg.timingsfp) fclose(cfg.timingsfp);
+#ifdef HMMER_THREADS
+    memory_budget_Destroy(cfg.budget);
+#endif
+  }
+  esl_getopts_Destroy(go);
+  esl_stopwatch_Destroy(w);
+  return 0;
+}
+
+
+/** 
+ * usual_master()
+ *
+ * The usual version of hmmbuild, serial or threaded
+ * For each MSA, build an HMM and save it.
+ * 
+ * A master can only return if it's successful. 
+ * All errors are handled immediately and fatally with p7_Fail() or equiv.
+ */
+template <class Family>
+static int
+profillic_usual_master(const ESL_GETOPTS *go, struct cfg_s *cfg)
+{
+  int              ncpus    = 0;
+  int              infocnt  = 0;
+  WORKER_INFO     *info     = NULL;
+  P7_BUILDER      *bld      = NULL;  /* the workers' shared builder configuration */
+  P7_BG           *bg       = NULL;
+  int              i;
+  int              status;
+  char             errmsg[eslERRBUFSIZE];
+
+  /**
+   * <pre> 
+   * Open files, set alphabet.
+   *   cfg->afp       - open alignment file for input
+   *   cfg->abc       - alphabet expected or guessed in ali file
+   *   cfg->hmmfp     - open HMM file for output
+   *   cfg->postmsafp - optional open MSA resave file, or NULL
+   *   cfp->ofp       - optional open output file, or stdout
+   * The mpi_master's version of this is in init_master_cfg(), with
+   * different error handling (necessitated by our MPI design).
+   * </pre>
+   */
+  if      (esl_opt_GetBoolean(go, "--amino")||esl_opt_IsUsed(go, "--profillic-amino"))   cfg->abc = esl_alphabet_Create(eslAMINO);
+  else if (esl_opt_GetBoolean(go, "--dna")||esl_opt_IsUsed(go, "--profillic-dna"))     cfg->abc = esl_alphabet_Create(eslDNA);
+  else if (esl_opt_GetBoolean(go, "--rna"))     cfg->abc = esl_alphabet_Create(eslRNA);
+  else                                          cfg->abc = NULL;
+
+  /* (a --server opens each job's files in server_job_open()) */
+  if (! cfg->do_server)
+    {
+      status = profillic_eslx_msafile_Open(&(cfg->abc), cfg->alifile, NULL, cfg->fmt, NULL, &(cfg->afp));
+      if (status != eslOK) eslx_msafile_OpenFailure(cfg->afp, status);
+
+      cfg->hmmfp = profillic_ofile_Open(cfg->hmmfile);
+      if (cfg->hmmfp == NULL) p7_Fail("Failed to open HMM file %s for writing", cfg->hmmfile);
+    }
+
+  /* a --server replies to its jobs on stdout, so its summary goes elsewhere */
+  if (esl_opt_IsUsed(go, "-o")) 
+    {
+      cfg->ofp = fopen(esl_opt_GetString(go, "-o"), "w");
+      if (cfg->ofp == NULL) p7_Fail("Failed to open -o output file %s\n", esl_opt_GetString(go, "-o"));
+    } 
+  else cfg->ofp = (cfg->do_server ? stderr : stdout);
+
+  if (cfg->postmsafile) 
+    {
+      cfg->postmsafp = profillic_ofile_Open(cfg->postmsafile);
+      if (cfg->postmsafp == NULL) p7_Fail("Failed to MSA resave file %s for writing", cfg->postmsafile);
+    } 
+  else cfg->postmsafp = NULL;
+
+  if (cfg->timingsfile) 
+    {
+      cfg->timingsfp = fopen(cfg->timingsfile, "w");
+      if (cfg->timingsfp == NULL) p7_Fail("Failed to open --timings file %s for writing", cfg->timingsfile);
+    } 
+
+  if (cfg->do_press && ! cfg->do_server && profillic_compress_Type(cfg->hmmfile) != PROFILLIC_COMPRESS_NONE) p7_Fail("--press can't be used with a compressed HMM file (%s)\n", cfg->hmmfile);
+  if (cfg->do_press && ! cfg->do_server && press_open(cfg, errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+
+  if (esl_opt_IsOn(go, "--cache") && profillic_build_cache_Open(esl_opt_GetString(go, "--cache"), &(cfg->cache), errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+
+  /* Looks like the i/o is set up successfully...
+   * Initial output to the user
+   */
+  profillic_output_header(go, cfg);                                  /* cheery output header                                */
+  output_result(cfg, NULL, 0, NULL, NULL, NULL, NULL, 0.0, 0, NULL, NULL); /* tabular results header (with no args, special-case) */
+
+#ifdef HMMER_THREADS
+  /* initialize thread data */
+  if (esl_opt_IsOn(go, "--cpu")) ncpus = esl_opt_GetInteger(go, "--cpu");
+  else                                   esl_threads_CPUCount(&ncpus);
+#endif
+
+  /* Serially, models are written as they're built, so --sched would reorder the output itself */
+  if (ncpus == 0 && esl_opt_GetInteger(go, "--sched") > 0) p7_Fail("--sched needs worker threads (--cpu > 0) or --mpi\n");
+
+  infocnt = (ncpus == 0) ? 1 : ncpus;
+  ESL_ALLOC_CPP( WORKER_INFO, info, sizeof(*info) * infocnt);
+
+  /* The builder's configuration -- the prior, the --single score
+   * system, the options -- never changes while building, so it is set
+   * up once, and each worker gets a clone that shares it but has its
+   * own RNG and errbuf.  (Each worker keeps its own null model, which
+   * calibration resets the length of.)
+   */
+  bld = p7_builder_Create(go, cfg->abc);
+  if (bld == NULL)  p7_Fail("p7_builder_Create failed");
+
+  //do this here instead of in p7_builder_Create(), because it's an hmmbuild-specific option
+  if ( esl_opt_IsOn(go, "--maxinsertlen") )
+    bld->max_insert_len    = esl_opt_GetInteger(go, "--maxinsertlen");
+
+  /* Default matrix is stored in the --mx option, so it's always IsOn().
+   * Check --mxfile first; then go to the --mx option and the default.
+   */
+  if ( cfg->abc != NULL && cfg->abc->type == eslAMINO && esl_opt_IsUsed(go, "--single")) {
+    bg = p7_bg_Create(cfg->abc);
+    if (esl_opt_IsOn(go, "--mxfile")) status = p7_builder_SetScoreSystem (bld, esl_opt_GetString(go, "--mxfile"), NULL, esl_opt_GetReal(go, "--popen"), esl_opt_GetReal(go, "--pextend"), bg);
+    else                              status = p7_builder_LoadScoreSystem(bld, esl_opt_GetString(go, "--mx"),           esl_opt_GetReal(go, "--popen"), esl_opt_GetReal(go, "--pextend"), bg);
+    if (status != eslOK) p7_Fail("Failed to set single query seq score system:\n%s\n", bld->errbuf);
+    p7_bg_Destroy(bg);
+  }
+
+  /* special arguments for hmmbuild */
+  bld->w_len      = (go != NULL && esl_opt_IsOn (go, "--w_length")) ?  esl_opt_GetInteger(go, "--w_length"): -1;
+  bld->w_beta     = (go != NULL && esl_opt_IsOn (go, "--w_beta"))   ?  esl_opt_GetReal   (go, "--w_beta")    : p7_DEFAULT_WINDOW_BETA;
+  if ( bld->w_beta < 0 || bld->w_beta > 1  ) esl_fatal("Invalid window-length beta value\n");
+
+  for (i = 0; i < infocnt; ++i)
+    {
+      info[i].bg   = p7_bg_Create(cfg->abc);
+      info[i].bld  = profillic_p7_builder_CreateClone(bld);
+      info[i].pool = profillic_build_pool_Create(cfg->abc, (cfg->fmt == eslMSAFILE_PROFILLIC ? PROFILLIC_POOL_NHMM : 0));
+
+      if (info[i].bg == NULL || info[i].bld == NULL || info[i].pool == NULL)  p7_Fail("Failed to create worker %d's builder", i);
+
+#ifdef HMMER_THREADS
+      info[i].queue  = NULL; /* set in profillic_thread_master() */
+      info[i].writer = NULL; /*  ditto */
+      info[i].budget = NULL; /*  ditto */
+#endif
+      info[i].use_priors = cfg->use_priors;
+      info[i].do_stats   = cfg->do_stats;
+      info[i].calibrate_ncpu = cfg->calibrate_ncpu;
+      info[i].weight_ncpu    = cfg->weight_ncpu;
+      info[i].do_timings     = (cfg->timingsfp != NULL);
+      info[i].nbuilt         = 0;
+      info[i].do_press       = cfg->do_press;
+      info[i].do_postmsa     = (cfg->postmsafile != NULL);
+      info[i].cache          = cfg->cache;
+      profillic_timings_Start(&(info[i].total));
+    }
+
+  if( cfg->fmt == eslMSAFILE_PROFILLIC && ( cfg->abc == NULL || ( cfg->abc->type != eslDNA && cfg->abc->type != eslAMINO ) ) ) {
+    ESL_EXCEPTION(eslEUNIMPLEMENTED, "Sorry, at present the profillic-hmmbuild software can only handle amino and dna.");
+  }
+
+  if (cfg->do_server)
+    profillic_server_loop<Family>(go, cfg, info, ncpus);
+  else
+    {
+      run_input<Family>(go, cfg, info, ncpus);
+      if (cfg->do_press && press_close(cfg, errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+    }
+  profillic_build_cache_Close(cfg->cache);
+  cfg->cache = NULL;
+
+  /* Per-worker totals of the stage times, then the grand total */
+  if (cfg->timingsfp != NULL) {
+    PROFILLIC_BUILD_TIMINGS all;
+    char                    worker[32];
+    char                    nbuilt[32];
+    int                     nall = 0;
+
+    /* (the name column of a total holds its number of models) */
+    profillic_timings_Start(&all);
+    for (i = 0; i < infocnt; ++i)
+      {
+        snprintf(worker, sizeof(worker), "%d", i);
+        snprintf(nbuilt, sizeof(nbuilt), "%d", info[i].nbuilt);
+        if (output_timings(cfg->timingsfp, "total", nbuilt, worker, &(info[i].total)) != eslOK) p7_Fail("Failed to write --timings file %s", cfg->timingsfile);
+        profillic_timings_Add(&all, &(info[i].total));
+        nall += info[i].nbuilt;
+      }
+    snprintf(nbuilt, sizeof(nbuilt), "%d", nall);
+    if (output_timings(cfg->timingsfp, "total", nbuilt, "all", &all) != eslOK) p7_Fail("Failed to write --timings file %s", cfg->timingsfile);
+  }
+
+  for (i = 0; i < infocnt; ++i)
+    {
+      p7_bg_Destroy(info[i].bg);
+      profillic_p7_builder_DestroyClone(info[i].bld);
+      profillic_build_pool_Destroy(info[i].pool);
+    }
+  profillic_p7_builder_Destroy(bld);
+
+  free(info);
+  return eslOK;
+
+ ERROR:
+  return eslFAIL;
+}
+
+/**
+ * run_input
+ *
+ * Build models for every alignment (or galosh profile) in the open
+ * <cfg->afp>, writing them to <cfg->hmmfp>, with <ncpus> worker
+ * threads (or serially, if <ncpus> is 0) over the initialized <info>.
+ *
+ * Each worker thread builds from the galosh profile carried by its
+ * own work item, so profile inputs are threaded just like MSAs.  The
+ * profile type, <Family>'s, only matters for --profillic-* input,
+ * which is read as the --profile-precision probability type; other
+ * formats use the Dna, floatrealspace instantiation with NULL profiles.
+ */
+template <class Family>
+static void
+run_input(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus)
+{
+  if( cfg->fmt != eslMSAFILE_PROFILLIC ) { run_input_as<Family, floatrealspace>(go, cfg, info, ncpus); return; }
+
+  switch (cfg->precision) {
+  case PROFILLIC_PRECISION_DOUBLE:   run_input_as<Family, doublerealspace>(go, cfg, info, ncpus); break;
+  case PROFILLIC_PRECISION_LOGSPACE: run_input_as<Family, logspace>       (go, cfg, info, ncpus); break;
+  case PROFILLIC_PRECISION_BFLOAT:   run_input_as<Family, bfloat>         (go, cfg, info, ncpus); break;
+  default:                           run_input_as<Family, floatrealspace> (go, cfg, info, ncpus); break;
+  }
+}
+
+/* run_input() for profiles of probability type <ProbabilityType>. */
+template <class Family, typename ProbabilityType>
+static void
+run_input_as(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus)
+{
+  typedef typename Family::template Of<seqan::AminoAcid20, ProbabilityType>::Type AminoProfileType;
+  typedef typename Family::template Of<seqan::Dna,         ProbabilityType>::Type DnaProfileType;
+
+#ifdef HMMER_THREADS
+  if (ncpus > 0) {
+
+    if( cfg->fmt == eslMSAFILE_PROFILLIC && cfg->abc->type == eslAMINO ) {
+      profillic_thread_master<AminoProfileType>(go, cfg, info, ncpus);
+    } else {
+      profillic_thread_master<DnaProfileType>(go, cfg, info, ncpus);
+    }
+  } else
+#endif
+  if( cfg->fmt == eslMSAFILE_PROFILLIC && cfg->abc->type == eslAMINO ) {
+    profillic_serial_loop<AminoProfileType>(info, cfg, go);
+  } else {
+    profillic_serial_loop<DnaProfileType>(info, cfg, go);
+  }
+}
+
+/**
+ * profillic_server_loop
+ *
+ * --server: read jobs from stdin, one per line, "<hmmfile_out>
+ * <msafile>" (blank lines and lines starting with '#' are skipped),
+ * and run each one as profillic-hmmbuild <hmmfile_out> <msafile> would
+ * with the same options, reusing the workers in <info>: their priors,
+ * score systems and builders, and the --cache, are set up only once.
+ *
+ * After each job, one tab-delimited line is written to stdout and
+ * flushed:
+ *   ok     <job#> <hmmfile_out> <number of models built>
+ *   error  <job#> <hmmfile_out> <message>
+ * A job whose files can't be opened or written is reported and
+ * skipped.  Errors while building are fatal, as they are for a single
+ * run.
+ */
+template <class Family>
+static void
+profillic_server_loop(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus)
+{
+  char  *line   = NULL;
+  int    nline  = 0;
+  char  *s;
+  char  *hmmfile;
+  char  *alifile;
+  char  *extra;
+  char   errmsg[eslERRBUFSIZE];
+  int    njob   = 0;
+  int    status;
+
+  while ((status = esl_fgets(&line, &nline, stdin)) == eslOK)
+    {
+      s = line;
+      if (esl_strtok(&s, " \t\r\n", &hmmfile) != eslOK || hmmfile[0] == '#') continue;
+      njob++;
+
+      if (esl_strtok(&s, " \t\r\n", &alifile) != eslOK || esl_strtok(&s, " \t\r\n", &extra) == eslOK)
+	strcpy(errmsg, "expected a job of two fields, <hmmfile_out> <msafile>");
+      else if (strcmp(hmmfile, "-") == 0 || strcmp(alifile, "-") == 0)
+	strcpy(errmsg, "a --server job can't read or write '-': stdin carries the jobs, and stdout the replies");
+      else if (server_job_open(cfg, hmmfile, alifile, errmsg) == eslOK)
+	{
+	  run_input<Family>(go, cfg, info, ncpus);
+	  if (server_job_close(cfg, errmsg) == eslOK)
+	    {
+	      if (printf("ok\t%d\t%s\t%d\n", njob, hmmfile, cfg->nali) < 0 || fflush(stdout) != 0) p7_Fail("Failed to write --server reply");
+	      continue;
+	    }
+	}
+      if (printf("error\t%d\t%s\t%s\n", njob, hmmfile, errmsg) < 0 || fflush(stdout) != 0) p7_Fail("Failed to write --server reply");
+    }
+  if (status != eslEOF) p7_Fail("Failed to read --server jobs from stdin");
+  free(line);
+}
+
+/**
+ * server_job_open
+ *
+ * Open a --server job's files: <alifile> as <cfg->afp>, <hmmfile> as
+ * <cfg->hmmfp>, and with --press its pressed database; and start its
+ * alignment count afresh.  <hmmfile> and <alifile> must outlive the
+ * job.
+ *
+ * Returns eslOK; or, with a message in <errbuf>, a failure status, and
+ * nothing is left open.
+ */
+static int
+server_job_open(struct cfg_s *cfg, char *hmmfile, char *alifile, char *errbuf)
+{
+  int status;
+
+  cfg->hmmfile = hmmfile;
+  cfg->alifile = alifile;
+  cfg->nali    = 0;
+  cfg->nnamed  = 0;
+
+  status = profillic_eslx_msafile_Open(&(cfg->abc), alifile, NULL, cfg->fmt, NULL, &(cfg->afp));
+  if      (status == eslENOTFOUND) ESL_XFAIL(status, errbuf, "Alignment file %s doesn't exist or is not readable", alifile);
+  else if (status == eslENOFORMAT) ESL_XFAIL(status, errbuf, "Couldn't determine format of alignment file %s", alifile);
+  else if (status != eslOK)        ESL_XFAIL(status, errbuf, "Failed to open alignment file %s: %s", alifile, (cfg->afp != NULL ? cfg->afp->errmsg : ""));
+
+  if (cfg->do_press && profillic_compress_Type(hmmfile) != PROFILLIC_COMPRESS_NONE) ESL_XFAIL(eslEINVAL, errbuf, "--press can't be used with a compressed HMM file (%s)", hmmfile);
+  if ((cfg->hmmfp = profillic_ofile_Open(hmmfile)) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open HMM file %s for writing", hmmfile);
+  if (cfg->do_press && (status = press_open(cfg, errbuf)) != eslOK) goto ERROR;
+  return eslOK;
+
+ ERROR:
+  if (cfg->afp   != NULL) { eslx_msafile_Close(cfg->afp); cfg->afp   = NULL; }
+  if (cfg->hmmfp != NULL) { profillic_ofile_Close(cfg->hmmfp, hmmfile); cfg->hmmfp = NULL; }
+  if (cfg->mfp   != NULL) { fclose(cfg->mfp);           cfg->mfp   = NULL; }
+  if (cfg->ffp   != NULL) { fclose(cfg->ffp);           cfg->ffp   = NULL; }
+  if (cfg->pfp   != NULL) { fclose(cfg->pfp);           cfg->pfp   = NULL; }
+  if (cfg->nssi  != NULL) { esl_newssi_Close(cfg->nssi); cfg->nssi = NULL; }
+  cfg->hmmfile = NULL;
+  cfg->alifile = NULL;
+  return status;
+}
+
+/**
+ * server_job_close
+ *
+ * Finish a --server job: close its files, writing out the pressed
+ * database's index with --press.
+ *
+ * Returns eslOK; or eslEWRITE (or press_close()'s failure), with a
+ * message in <errbuf>.  Either way, the job's files are closed.
+ */
+static int
+server_job_close(struct cfg_s *cfg, char *errbuf)
+{
+  int status = eslOK;
+
+  if (cfg->do_press) status = press_close(cfg, errbuf);
+  if (profillic_ofile_Close(cfg->hmmfp, cfg->hmmfile) != 0 && status == eslOK) { status = eslEWRITE; snprintf(errbuf, eslERRBUFSIZE, "Failed to write HMM file %s", cfg->hmmfile); }
+  cfg->hmmfp = NULL;
+  eslx_msafile_Close(cfg->afp);
+  cfg->afp     = NULL;
+  cfg->hmmfile = NULL;
+  cfg->alifile = NULL;
+  return status;
+}
+
+#ifdef HAVE_MPI
+/**
+ * mpi_run_as()
+ * Be the MPI master or a worker, as our rank says, for <Family>'s
+ * galosh profiles of probability type <ProbabilityType>
+ * (--profile-precision).
+ */
+template <class Family, typename ProbabilityType>
+static void
+mpi_run_as(const ESL_GETOPTS *go, struct cfg_s *cfg)
+{
+  typedef typename Family::template Of<seqan::AminoAcid20, ProbabilityType>::Type AminoProfileType;
+  typedef typename Family::template Of<seqan::Dna,         ProbabilityType>::Type DnaProfileType;
+
+  if( esl_opt_IsUsed(go, "--profillic-amino") ) {
+    if (cfg->my_rank > 0)  mpi_worker<AminoProfileType>(go, cfg);
+    else                   mpi_master<AminoProfileType>(go, cfg);
+  } else {
+    if (cfg->my_rank > 0)  mpi_worker<DnaProfileType>(go, cfg);
+    else                   mpi_master<DnaProfileType>(go, cfg);
+  }
+}
+
+/** 
+ * mpi_master()
+ * The MPI version of hmmbuild.
+ *
+ * Follows standard pattern for a master/worker load-balanced MPI program (J1/78-79).
+ * 
+ * A master can only return if it's successful. 
+ * Errors in an MPI master come in two classes: recoverable and nonrecoverable.
+ * 
+ * Recoverable errors include all worker-side errors, and any
+ * master-side error that do not affect MPI communication. Error
+ * messages from recoverable messages are delayed until we've cleanly
+ * shut down the workers.
+ * 
+ * Unrecoverable errors are master-side errors that may affect MPI
+ * communication, meaning we cannot count on being able to reach the
+ * workers and shut them down. Unrecoverable errors result in immediate
+ * p7_Fail()'s, which will cause MPI to shut down the worker processes
+ * uncleanly.
+ *
+ * For --profillic-* input, each galosh profile is sent (see
+ * profillic_profile_MPISend()) right after the consensus MSA it was
+ * read with; <ProfileType> is its type. For other input <ProfileType>
+ * is unused.
+ *
+ * Results are written as they come back, except with --sched, where
+ * alignments are sent out costliest first, and each result is held in
+ * <pending> until those before it have been written, so that the
+ * output stays in input order.
+ */
+template <class ProfileType>
+static void
+mpi_master(const ESL_GETOPTS *go, struct cfg_s *cfg)
+{
+  int         have_work     = TRUE;	/* TRUE while alignments remain  */
+  int         nproc_working = 0;	        /* number of worker processes working, up to nproc-1 */
+  int         wi;          	        /* rank of next worker to get an alignment to work on */
+  char       *buf           = NULL;	/* input/output buffer, for packed MPI messages */
+  int         bn            = 0;
+  ESL_MSA    *msa           = NULL;
+  P7_HMM     *hmm           = NULL;
+  P7_BG      *bg            = NULL;
+  ESL_MSA   **msalist       = NULL;
+  ESL_MSA    *postmsa       = NULL;
+  int        *msaidx        = NULL;
+  char        errmsg[eslERRBUFSIZE];
+  int         n;
+  int         pos;
+  double      entropy;
+  int         status;
+  int         xstatus       = eslOK;	/* changes from OK on recoverable error */
+  int         rstatus       = eslOK;	/* status specifically from msa read */
+  int         nali          = 0;	/* number of the alignment just read, 1.. */
+  MPI_Status  mpistatus; 
+  void       *profile       = NULL;	/* the galosh profile just read (a ProfileType *), for --profillic-* input */
+  MPI_PENDING *pending      = NULL;	/* with --sched: models received but not yet written, in input order */
+  MPI_PENDING *p;
+  MPI_PENDING **pp;
+  int         nwritten      = 0;	/* with --sched: models written so far */
+
+  /**
+   * <pre>
+   * Open files, set alphabet.
+   *   cfg->abc       - alphabet expected or guessed in ali file
+   *   cfg->afp       - open alignment file for input
+   *   cfg->hmmfp     - open HMM file for output
+   *   cfp->ofp       - optional open output file, or stdout
+   *   cfg->postmsafp - optional open MSA resave file, or NULL
+   * Error handling requires first broadcasting a non-OK status to workers
+   * to get them to shut down cleanly.
+   * </pre>
+   */
+  if      (esl_opt_GetBoolean(go, "--amino")||esl_opt_IsUsed(go, "--profillic-amino"))   cfg->abc = esl_alphabet_Create(eslAMINO);
+  else if (esl_opt_GetBoolean(go, "--dna")||esl_opt_IsUsed(go, "--profillic-dna"))     cfg->abc = esl_alphabet_Create(eslDNA);
+  else if (esl_opt_GetBoolean(go, "--rna"))     cfg->abc = esl_alphabet_Create(eslRNA);
+  else                                          cfg->abc = NULL;
+
+  status = profillic_eslx_msafile_Open(&(cfg->abc), cfg->alifile, NULL, cfg->fmt, NULL, &(cfg->afp));
+  if (status != eslOK) mpi_init_open_failure(cfg->afp, status);
+
+  cfg->hmmfp = profillic_ofile_Open(cfg->hmmfile);
+  if (cfg->hmmfp == NULL) mpi_init_other_failure("Failed to open HMM file %s for writing", cfg->hmmfile); 
+  
+  if (esl_opt_IsUsed(go, "-o")) 
+    {
+      cfg->ofp = fopen(esl_opt_GetString(go, "-o"), "w");
+      if (cfg->ofp == NULL) mpi_init_other_failure("Failed to open -o output file %s\n", esl_opt_GetString(go, "-o"));
+    }
+  else cfg->ofp = stdout;
+
+  if (cfg->postmsafile) 
+    {
+      cfg->postmsafp = profillic_ofile_Open(cfg->postmsafile);
+      if (cfg->postmsafp == NULL) mpi_init_other_failure("Failed to MSA resave file %s for writing", cfg->postmsafile);
+    }
+  else cfg->postmsafp = NULL;
+
+  /* per-stage build times are taken on the workers; they aren't sent back */
+  if (cfg->timingsfile) mpi_init_other_failure("--timings is not supported with --mpi");
+  if (cfg->do_press)    mpi_init_other_failure("--press is not supported with --mpi");
+  if (esl_opt_IsOn(go, "--cache")) mpi_init_other_failure("--cache is not supported with --mpi");
+#ifdef HMMER_THREADS
+  if (esl_opt_IsOn(go, "--max-memory")) mpi_init_other_failure("--max-memory is not supported with --mpi");
+#endif
+  if (sched_open(go, cfg) != eslOK) mpi_init_other_failure("allocation failed");
+#ifdef HMMER_THREADS
+  if (readers_open(go, cfg, errmsg) != eslOK) mpi_init_other_failure("%s", errmsg);
+#endif
+
+  /* Other initialization in the master
+   */
+  bn = 4096; 
+  if ((buf     = static_cast<char *>    (malloc(sizeof(char) * bn)))              == NULL) mpi_init_other_failure("allocation failed"); 
+  if ((msalist = static_cast<ESL_MSA **>(malloc(sizeof(ESL_MSA *) * cfg->nproc))) == NULL) mpi_init_other_failure("allocation failed"); 
+  if ((msaidx  = static_cast<int *>     (malloc(sizeof(int)       * cfg->nproc))) == NULL) mpi_init_other_failure("allocation failed"); 
+  if ((bg      = p7_bg_Create(cfg->abc))                                          == NULL) mpi_init_other_failure("allocation failed"); 
+  if (cfg->fmt == eslMSAFILE_PROFILLIC) profile = ProfillicProfileKind<ProfileType>::Create(cfg->nseq);
+
+  for (wi = 0; wi < cfg->nproc; wi++) { msalist[wi] = NULL; msaidx[wi] = 0; } 
+
+  /* Looks like the master is initialized successfully...
+   * Tell the workers we're fine; send initial output to the user
+   */
+  xstatus = eslOK;
+  MPI_Bcast(&xstatus, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  profillic_output_header(go, cfg);                        /* cheery output header                                */
+  output_result(cfg, NULL, 0, NULL, NULL, NULL, NULL, 0.0, 0, NULL, NULL); /* tabular results header (with no args, special-case) */  
+  ESL_DPRINTF1(("MPI master is initialized\n"));  
+
+  /* Worker initialization:
+   * Because we've already successfully initialized the master before we start
+   * initializing the workers, we don't expect worker initialization to fail;
+   * so we just receive a quick OK/error code reply from each worker to be sure,
+   * and don't worry about an informative message. 
+   */
+  MPI_Bcast(&(cfg->abc->type), 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&xstatus, &status, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+  if (status != eslOK) { MPI_Finalize(); p7_Fail("One or more MPI worker processes failed to initialize."); }
+  ESL_DPRINTF1(("%d workers are initialized\n", cfg->nproc-1));
+
+
+  /** 
+   * Main loop: combining load workers, send/receive, clear workers loops;
+   * also, catch error states and die later, after clean shutdown of workers.
+   * 
+   * When a recoverable error occurs, have_work = FALSE, xstatus !=
+   * eslOK, and errmsg is set to an informative message. No more
+   * errmsg's can be received after the first one. We wait for all the
+   * workers to clear their work units, then send them shutdown signals,
+   * then finally print our errmsg and exit.
+   * 
+   * Unrecoverable errors just crash us out with p7_Fail().
+   */
+  wi = 1;
+  while (have_work || nproc_working)
+    {
+      if (have_work) 
+	{
+	  /* galosh profiles all arrive with the same placeholder name; number them */
+	  status = next_input<ProfileType>(cfg, (cfg->afp->format == eslMSAFILE_PROFILLIC), errmsg, &rstatus, &msa, &profile, &nali);
+	  if      (status == eslOK)   {                                          ESL_DPRINTF1(("MPI master read MSA %s\n", msa->name == NULL? "" : msa->name));  } 
+	  else if (status == eslEOF)  {  have_work  = FALSE;                     ESL_DPRINTF1(("MPI master has run out of MSAs (having read %d)\n", cfg->nali)); }
+	  else if (rstatus != eslOK)  {  have_work  = FALSE;  xstatus = rstatus; ESL_DPRINTF1(("MPI master msa read has failed... start to shut down\n")); }
+	  else                        {  have_work  = FALSE;  xstatus = status; }
+	}
+
+      if ((have_work && nproc_working == cfg->nproc-1) || (!have_work && nproc_working > 0))
+	{
+	  if (MPI_Probe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &mpistatus) != 0) { MPI_Finalize(); p7_Fail("mpi probe failed"); }
+	  if (MPI_Get_count(&mpistatus, MPI_PACKED, &n)                != 0) { MPI_Finalize(); p7_Fail("mpi get count failed"); }
+	  wi = mpistatus.MPI_SOURCE;
+	  ESL_DPRINTF1(("MPI master sees a result of %d bytes from worker %d\n", n, wi));
+
+	  if (n > bn) {
+	    if ((buf = static_cast<char *>(realloc(buf, sizeof(char) * n))) == NULL) p7_Fail("reallocation failed");
+	    bn = n; 
+	  }
+	  if (MPI_Recv(buf, bn, MPI_PACKED, wi, 0, MPI_COMM_WORLD, &mpistatus) != 0) { MPI_Finalize(); p7_Fail("mpi recv failed"); }
+	  ESL_DPRINTF1(("MPI master has received the buffer\n"));
+
+	  /** If we're in a recoverable error state, we're only clearing worker results;
+           * just receive them, don't unpack them or print them.
+           * But if our xstatus is OK, go ahead and process the result buffer.
+	   */
+	  if (xstatus == eslOK)	
+	    {
+	      pos = 0;
+	      if (MPI_Unpack(buf, bn, &pos, &xstatus, 1, MPI_INT, MPI_COMM_WORLD)     != 0) { MPI_Finalize();  p7_Fail("mpi unpack failed");}
+	      if (xstatus == eslOK) /* worker reported success. Get the HMM. */
+		{
+		  ESL_DPRINTF1(("MPI master sees that the result buffer contains an HMM\n"));
+		  if (p7_hmm_MPIUnpack(buf, bn, &pos, MPI_COMM_WORLD, &(cfg->abc), &hmm) != eslOK) {  MPI_Finalize(); p7_Fail("HMM unpack failed"); }
+		  ESL_DPRINTF1(("MPI master has unpacked the HMM\n"));
+
+		  if (cfg->postmsafile != NULL) {
+		    if (esl_msa_MPIUnpack(cfg->abc, buf, bn, &pos, MPI_COMM_WORLD, &postmsa) != eslOK) { MPI_Finalize(); p7_Fail("postmsa unpack failed");}
+		  } 
+
+		  if (cfg->sched == NULL)
+		    {
+		      entropy = (cfg->do_stats ? profillic_hmm_MatchStats(hmm, bg, NULL) : 0.0);
+		      if ((status = output_result(cfg, errmsg, msaidx[wi], msalist[wi], hmm, postmsa, NULL, entropy, 0, NULL, NULL)) != eslOK) xstatus = status;
+
+		      esl_msa_Destroy(postmsa); postmsa = NULL;
+		      p7_hmm_Destroy(hmm);      hmm     = NULL;
+		    }
+		  else
+		    {
+		      /* --sched dispatches out of order: hold the model until those before it are written */
+		      if ((p = static_cast<MPI_PENDING *>(malloc(sizeof(MPI_PENDING)))) == NULL) { MPI_Finalize(); p7_Fail("allocation failed"); }
+		      p->nali    = msaidx[wi];
+		      p->msa     = msalist[wi];
+		      p->hmm     = hmm;
+		      p->spill   = NULL;
+		      if (postmsa != NULL && postmsa_Spill(postmsa, &(p->spill)) != eslOK) { MPI_Finalize(); p7_Fail("Failed to spill resaved MSA to a temporary file"); }
+		      for (pp = &pending; *pp != NULL && (*pp)->nali < p->nali; pp = &((*pp)->next)) ;
+		      p->next = *pp;
+		      *pp     = p;
+		      msalist[wi] = NULL;
+		      hmm         = NULL;
+		      postmsa     = NULL;
+
+		      while (xstatus == eslOK && pending != NULL && pending->nali == nwritten + 1)
+			{
+			  p       = pending;
+			  pending = p->next;
+			  entropy = (cfg->do_stats ? profillic_hmm_MatchStats(p->hmm, bg, NULL) : 0.0);
+			  if ((status = output_result(cfg, errmsg, p->nali, p->msa, p->hmm, NULL, p->spill, entropy, 0, NULL, NULL)) != eslOK) xstatus = status;
+			  nwritten++;
+
+			  if (p->spill != NULL) fclose(p->spill);
+			  p7_hmm_Destroy(p->hmm);
+			  esl_msa_Destroy(p->msa);
+			  free(p);
+			}
+		    }
+		}
+	      else	/* worker reported an error. Get the errmsg. */
+		{
+		  if (MPI_Unpack(buf, bn, &pos, errmsg, eslERRBUFSIZE, MPI_CHAR, MPI_COMM_WORLD) != 0) { MPI_Finalize(); p7_Fail("mpi unpack of errmsg failed"); }
+		  ESL_DPRINTF1(("MPI master sees that the result buffer contains an error message\n"));
+		}
+	    }
+	  esl_msa_Destroy(msalist[wi]);
+	  msalist[wi] = NULL;
+	  msaidx[wi]  = 0;
+	  nproc_working--;
+	}
+
+      if (have_work)
+	{   
+	  ESL_DPRINTF1(("MPI master is sending MSA %s to worker %d\n", msa->name == NULL ? "":msa->name, wi));
+	  if (esl_msa_MPISend(msa, wi, 0, MPI_COMM_WORLD, &buf, &bn) != eslOK) p7_Fail("MPI msa send failed");
+	  if (profile != NULL && profillic_profile_MPISend(static_cast<ProfileType *>(profile), wi, 0, MPI_COMM_WORLD, &buf, &bn) != eslOK) p7_Fail("MPI profile send failed");
+	  msalist[wi] = msa;
+	  msaidx[wi]  = nali; /* 1..N for N alignments in the MSA database */
+	  msa = NULL;
+	  wi++;
+	  nproc_working++;
+	}
+    }
+  
+  /** On success or recoverable errors:
+   * Shut down workers cleanly. 
+   */
+  ESL_DPRINTF1(("MPI master is done. Shutting down all the workers cleanly\n"));
+  for (wi = 1; wi < cfg->nproc; wi++) 
+    if (esl_msa_MPISend(NULL, wi, 0, MPI_COMM_WORLD, &buf, &bn) != eslOK) p7_Fail("MPI msa send failed");
+
+  while ((p = pending) != NULL)	/* only left after an error */
+    {
+      pending = p->next;
+      if (p->spill != NULL) fclose(p->spill);
+      p7_hmm_Destroy(p->hmm);
+      esl_msa_Destroy(p->msa);
+      free(p);
+    }
+
+  free(buf);
+  free(msaidx);
+  free(msalist);
+  p7_bg_Destroy(bg);
+  if (profile != NULL) delete static_cast<ProfileType *>(profile);
+  sched_close<ProfileType>(cfg);
+#ifdef HMMER_THREADS
+  readers_close(cfg);
+#endif
+
+  if      (rstatus != eslOK && rstatus != eslEOF) { MPI_Finalize(); eslx_msafile_ReadFailure(cfg->afp, rstatus); }
+  else if (xstatus != eslOK) { MPI_Finalize(); p7_Fail(errmsg); }
+  else                        return;
+}
+/**
+ * mpi_init_open_failure
+ *
+ */
+static void
+mpi_init_open_failure(ESLX_MSAFILE *afp, int status)
+{
+  MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Finalize();
+  eslx_msafile_OpenFailure(afp, status);
+}
+
+/**
+ * mpi_init_other_failure
+ *
+ */
+static void
+mpi_init_other_failure(char *format, ...)
+{
+  va_list argp;
+  int status = eslFAIL;
+
+  MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Finalize();
+  if (fprintf(stderr, "\nError: ") < 0) exit(eslEWRITE);
+
+  va_start(argp, format);
+  if (vfprintf(stderr, format, argp) < 0) exit(eslEWRITE);
+  va_end(argp);
+
+  if (fprintf(stderr, "\n") < 0) exit(eslEWRITE);
+  fflush(stderr);
+  exit(1);
+}
+
+/**
+ * mpi_worker
+ *
+ */
+template <class ProfileType>
+static void
+mpi_worker(const ESL_GETOPTS *go, struct cfg_s *cfg)
+{
+  int           xstatus = eslOK;
+  int           status;
+  int           type;
+  P7_BUILDER   *bld         = NULL;
+  ESL_MSA      *msa         = NULL;
+  ESL_MSA      *postmsa     = NULL;
+  ESL_MSA     **postmsa_ptr = (cfg->postmsafile != NULL) ? &postmsa : NULL;
+  P7_HMM       *hmm         = NULL;
+  P7_BG        *bg          = NULL;
+  char         *wbuf        = NULL;	/* packed send/recv buffer  */
+  void         *tmp;			/* for reallocation of wbuf */
+  int           wn          = 0;	/* allocation size for wbuf */
+  int           sz, n;		        /* size of a packed message */
+  int           pos;
+  char          errmsg[eslERRBUFSIZE];
+  ESL_SQ     *sq          = NULL;
+  PROFILLIC_BUILD_POOL *pool = NULL;
+  ProfileType  *profile_ptr = NULL;	/* for --profillic-* input: the profile that came with this MSA */
+
+  /* After master initialization: master broadcasts its status.
+   */
+  MPI_Bcast(&xstatus, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (xstatus != eslOK) return; /* master saw an error code; workers do an immediate normal shutdown. */
+  ESL_DPRINTF2(("worker %d: sees that master has initialized\n", cfg->my_rank));
+  
+  /** Master now broadcasts worker initialization information (alphabet type) 
+   * Workers returns their status post-initialization.
+   * Initial allocation of wbuf must be large enough to guarantee that
+   * we can pack an error result into it, because after initialization,
+   * errors will be returned as packed (code, errmsg) messages.
+   */
+  MPI_Bcast(&type, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (xstatus == eslOK) { if ((cfg->abc = esl_alphabet_Create(type))      == NULL)    xstatus = eslEMEM; }
+  if (xstatus == eslOK) { wn = 4096;  if ((wbuf = static_cast<char *>(malloc(wn * sizeof(char)))) == NULL) xstatus = eslEMEM; }
+  if (xstatus == eslOK) { if ((bld = p7_builder_Create(go, cfg->abc))     == NULL)    xstatus = eslEMEM; }
+
+  //special arguments for hmmbuild
+  bld->w_len      = (go != NULL && esl_opt_IsOn (go, "--w_length")) ?  esl_opt_GetInteger(go, "--w_length"): -1;
+  bld->w_beta     = (go != NULL && esl_opt_IsOn (go, "--w_beta"))   ?  esl_opt_GetReal   (go, "--w_beta")    : p7_DEFAULT_WINDOW_BETA;
+  if ( bld->w_beta < 0 || bld->w_beta > 1  ) goto ERROR;
+
+
+  MPI_Reduce(&xstatus, &status, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD); /* everyone sends xstatus back to master */
+  if (xstatus != eslOK) {
+    if (wbuf != NULL) free(wbuf);
+    if (bld  != NULL) p7_builder_Destroy(bld);
+    return; /* shutdown; we passed the error back for the master to deal with. */
+  }
+
+  bg = p7_bg_Create(cfg->abc);
+  if (cfg->fmt == eslMSAFILE_PROFILLIC) profile_ptr = ProfillicProfileKind<ProfileType>::Create(cfg->nseq);
+  if ((pool = profillic_build_pool_Create(cfg->abc, (profile_ptr != NULL ? PROFILLIC_POOL_NHMM : 0))) == NULL) { status = eslEMEM; strcpy(errmsg, "memory allocation failed"); goto ERROR; }
+
+  ESL_DPRINTF2(("worker %d: initialized\n", cfg->my_rank));
+
+                      /* source = 0 (master); tag = 0 */
+  while (esl_msa_MPIRecv(0, 0, MPI_COMM_WORLD, cfg->abc, &wbuf, &wn, &msa) == eslOK) 
+    {
+      /* Build the HMM */
+      ESL_DPRINTF2(("worker %d: has received MSA %s (%d columns, %d seqs)\n", cfg->my_rank, msa->name, msa->alen, msa->nseq));
+      if (profile_ptr != NULL && (status = profillic_profile_MPIRecv(0, 0, MPI_COMM_WORLD, &wbuf, &wn, profile_ptr)) != eslOK) { strcpy(errmsg, "galosh profile receive failed"); goto ERROR; }
+
+      if ( profillic_esl_msa_Nseq(msa) > 1 || cfg->abc->type != eslAMINO || !esl_opt_IsUsed(go, "--single")) {
+        if ((status = profillic_p7_Builder(bld, msa, profile_ptr, bg, &hmm, NULL, NULL, NULL, postmsa_ptr, cfg->use_priors, cfg->calibrate_ncpu, cfg->weight_ncpu, NULL, NULL, pool)) != eslOK) { strcpy(errmsg, bld->errbuf); goto ERROR; }
+      } else {
+        //for protein, single sequence, use blosum matrix:
+        if ((status = profillic_build_pool_GetSq(pool, msa, 0, &sq)) != eslOK) { strcpy(errmsg, bld->errbuf); goto ERROR; }
+        if ((status = p7_SingleBuilder(bld, sq, bg, &hmm, NULL, NULL, NULL)) != eslOK) { strcpy(errmsg, bld->errbuf); goto ERROR; }
+        sq = NULL;
+        hmm->eff_nseq = 1;
+      }
+
+      ESL_DPRINTF2(("worker %d: has produced an HMM %s\n", cfg->my_rank, hmm->name));
+
+      /* Calculate upper bound on size of sending status, HMM, and optional postmsa; make sure wbuf can hold it. */
+      n = 0;
+      if (MPI_Pack_size(1,    MPI_INT, MPI_COMM_WORLD, &sz) != 0)     goto ERROR;   n += sz;
+      if (p7_hmm_MPIPackSize( hmm,     MPI_COMM_WORLD, &sz) != eslOK) goto ERROR;   n += sz;
+      if (esl_msa_MPIPackSize(postmsa, MPI_COMM_WORLD, &sz) != eslOK) goto ERROR;   n += sz;
+      if (n > wn) { ESL_RALLOC_CPP(char, wbuf, tmp, sizeof(char) * n); wn = n; }
+      ESL_DPRINTF2(("worker %d: has calculated that HMM will pack into %d bytes\n", cfg->my_rank, n));
+
+      /* Send status, HMM, and optional postmsa back to the master */
+      pos = 0;
+      if (MPI_Pack       (&status, 1, MPI_INT, wbuf, wn, &pos, MPI_COMM_WORLD) != 0)     goto ERROR;
+      if (p7_hmm_MPIPack (hmm,                 wbuf, wn, &pos, MPI_COMM_WORLD) != eslOK) goto ERROR;
+      if (esl_msa_MPIPack(postmsa,             wbuf, wn, &pos, MPI_COMM_WORLD) != eslOK) goto ERROR;
+      MPI_Send(wbuf, pos, MPI_PACKED, 0, 0, MPI_COMM_WORLD);
+      ESL_DPRINTF2(("worker %d: has sent HMM to master in message of %d bytes\n", cfg->my_rank, pos));
+
+      esl_msa_Destroy(msa);     msa     = NULL;
+      esl_msa_Destroy(postmsa); postmsa = NULL;
+      profillic_build_pool_DestroyHmm(pool, hmm); hmm = NULL;
+    }
+
+  if (wbuf != NULL) free(wbuf);
+  if (profile_ptr != NULL) delete profile_ptr;
+  profillic_build_pool_Destroy(pool);
+  profillic_p7_builder_Destroy(bld);
+  p7_bg_Destroy(bg);
+  return;
+
+ ERROR:
+  ESL_DPRINTF2(("worker %d: fails, is sending an error message, as follows:\n%s\n", cfg->my_rank, errmsg));
+  pos = 0;
+  MPI_Pack(&status, 1,                MPI_INT,  wbuf, wn, &pos, MPI_COMM_WORLD);
+  MPI_Pack(errmsg,  eslERRBUFSIZE,    MPI_CHAR, wbuf, wn, &pos, MPI_COMM_WORLD);
+  MPI_Send(wbuf, pos, MPI_PACKED, 0, 0, MPI_COMM_WORLD);
+  if (wbuf != NULL) free(wbuf);
+  if (msa  != NULL) esl_msa_Destroy(msa);
+  if (hmm  != NULL) profillic_build_pool_DestroyHmm(pool, hmm);
+  if (bld  != NULL) profillic_p7_builder_Destroy(bld);
+  if (profile_ptr != NULL) delete profile_ptr;
+  profillic_build_pool_Destroy(pool);
+  return;
+}
+#endif /*HAVE_MPI*/
+
+/**
+ * profillic_serial_loop
+ *
+ * Build from each alignment in turn, in the calling thread.  Input is
+ * read through next_input(), so that --readers can parse ahead while
+ * models are built.  (--sched, which only orders work among workers,
+ * is refused without them; see profillic_usual_master().)
+ */
+template <class ProfileType>
+static void
+profillic_serial_loop(WORKER_INFO *info, struct cfg_s *cfg, const ESL_GETOPTS *go)
+{
+  ESL_MSA    *msa         = NULL;
+  ESL_SQ     *sq          = NULL;
+  ESL_MSA    *postmsa     = NULL;
+  ESL_MSA   **postmsa_ptr = (cfg->postmsafile != NULL) ? &postmsa : NULL;
+  P7_HMM     *hmm         = NULL;
+  P7_OPROFILE  *om        = NULL;
+  P7_OPROFILE **om_ptr    = info->do_press ? &om : NULL;
+  void       *profile     = NULL;
+  int         nali;
+  char        errmsg[eslERRBUFSIZE];
+  int         status;
+  int         rstatus;
+
+  double      entropy;
+  PROFILLIC_BUILD_TIMINGS  timings;
+  PROFILLIC_BUILD_TIMINGS *timings_ptr = info->do_timings ? &timings : NULL;
+
+  if (readers_open(go, cfg, errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+  if (cfg->fmt == eslMSAFILE_PROFILLIC) profile = ProfillicProfileKind<ProfileType>::Create(cfg->nseq);
+
+  cfg->nali = 0;
+  while ((status = next_input<ProfileType>(cfg, TRUE, errmsg, &rstatus, &msa, &profile, &nali)) != eslEOF)
+    {
+      if (rstatus != eslOK && rstatus != eslEOF) eslx_msafile_ReadFailure(cfg->afp, rstatus);
+      if (status  != eslOK)                      p7_Fail("%s\n", errmsg); /* cfg->nnamed gets incremented in next_input() */
+
+      /*         bg   new-HMM trarr gm   om  */
+      if ( profillic_esl_msa_Nseq(msa) > 1 || (cfg->abc != NULL && cfg->abc->type != eslAMINO) || !esl_opt_IsUsed(go, "--single")) {
+        if ((status = profillic_p7_Builder(info->bld, msa, static_cast<ProfileType *>(profile), info->bg, &hmm, NULL, NULL, om_ptr, postmsa_ptr, info->use_priors, info->calibrate_ncpu, info->weight_ncpu, timings_ptr, info->cache, info->pool)) != eslOK) p7_Fail("build failed: %s", info->bld->errbuf);
+      } else {
+        //for protein, single sequence, use blosum matrix:
+        if (timings_ptr != NULL) profillic_timings_Start(timings_ptr);
+        if ((status = profillic_build_pool_GetSq(info->pool, msa, 0, &sq)) != eslOK) p7_Fail("build failed: %s", info->bld->errbuf);
+        if ((status = p7_SingleBuilder(info->bld, sq, info->bg, &hmm, NULL, NULL, om_ptr)) != eslOK) p7_Fail("build failed: %s", info->bld->errbuf);
+        sq = NULL;
+        hmm->eff_nseq = 1;
+        profillic_timings_Mark(timings_ptr, PROFILLIC_STAGE_MODEL);
+      }
+      if (timings_ptr != NULL) { profillic_timings_Add(&(info->total), timings_ptr); info->nbuilt++; }
+      entropy = (info->do_stats ? profillic_hmm_MatchStats(hmm, info->bg, NULL) : 0.0);
+      if ((status = output_result(cfg, errmsg, nali, msa, hmm, postmsa, NULL, entropy, 0, timings_ptr, om)) != eslOK) p7_Fail(errmsg);
+
+      if (om != NULL) p7_oprofile_Destroy(om);
+      om = NULL;
+      profillic_build_pool_DestroyHmm(info->pool, hmm);
+      esl_msa_Destroy(msa);
+      esl_msa_Destroy(postmsa);
+      postmsa = NULL;
+    }
+
+  readers_close(cfg);
+  if (profile != NULL) delete static_cast<ProfileType *>(profile);
+}
+
+#ifdef HMMER_THREADS
+/**
+ * profillic_thread_master
+ *
+ * Threaded half of profillic_usual_master(): start <ncpus> workers
+ * over the already-initialized <info> array, give each work item its
+ * own <ProfileType> (when reading --profillic-* input) so that the
+ * reader can parse the next profile while workers build from earlier
+ * ones, and run thread_loop() until the input is exhausted.
+ *
+ * Workers hand finished models to an OUTPUT_WRITER thread, which
+ * writes them in input order, so that reading, building and writing
+ * all overlap.  With --sched, the reader hands out alignments
+ * costliest first (see next_input()); the writer still sees to the
+ * order of the output.
+ */
+template <class ProfileType>
+static void
+profillic_thread_master(const ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, int ncpus)
+{
+  WORK_ITEM       *item     = NULL;
+  ESL_THREADS     *threadObj= NULL;
+  ESL_WORK_QUEUE  *queue    = NULL;
+  OUTPUT_WRITER   *writer   = NULL;
+  int              nring;
+  int              i;
+  int              status;
+  char             errmsg[eslERRBUFSIZE];
+
+  /* With --sched, a model can be finished up to 2*<n> models ahead
+   * of the oldest one not yet dispatched (see profillic-schedule.hpp);
+   * the ring must hold that many, or workers could all block waiting
+   * for one still sitting in the window.
+   */
+  if (sched_open(go, cfg) != eslOK) esl_fatal("Failed to create the --sched window");
+  if (readers_open(go, cfg, errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+  if (esl_opt_IsOn(go, "--max-memory") && cfg->budget == NULL && memory_budget_Create((size_t) esl_opt_GetInteger(go, "--max-memory") * 1048576, &(cfg->budget)) != eslOK) esl_fatal("Failed to create the --max-memory budget");
+  nring = ncpus * 4 + (cfg->sched != NULL ? 2 * cfg->sched->size : 0);
+
+  threadObj = esl_threads_Create(&pipeline_thread<ProfileType>);
+  queue     = esl_workqueue_Create(ncpus * 2);
+  if (output_writer_Create(cfg, nring, &writer) != eslOK) esl_fatal("Failed to start the output writer");
+
+  for (i = 0; i < ncpus; ++i)
+    {
+      info[i].queue  = queue;
+      info[i].writer = writer;
+      info[i].budget = cfg->budget;
+      esl_threads_AddThread(threadObj, &info[i]);
+    }
+
+  for (i = 0; i < ncpus * 2; ++i)
+    {
+      ESL_ALLOC_CPP( WORK_ITEM, item, sizeof(*item));
+
+      item->nali      = 0;
+      item->processed = FALSE;
+      item->spill     = NULL;
+      item->msa       = NULL;
+      item->hmm       = NULL;
+      item->entropy   = 0.0;
+      item->profile   = ( cfg->fmt == eslMSAFILE_PROFILLIC ) ? ProfillicProfileKind<ProfileType>::Create(cfg->nseq) : NULL;
+      item->workeridx = 0;
+      profillic_timings_Start(&(item->timings));
+      item->om        = NULL;
+      item->bytes     = 0;
+      item->pool      = NULL;
+
+      status = esl_workqueue_Init(queue, item);
+      if (status != eslOK) esl_fatal("Failed to add block to work queue");
+    }
+
+  thread_loop<ProfileType>(threadObj, queue, cfg, go);
+  output_writer_Finish(writer, cfg->nali);
+  sched_close<ProfileType>(cfg);
+  readers_close(cfg);
+
+  esl_workqueue_Reset(queue);
+  while (esl_workqueue_Remove(queue, (void **) &item) == eslOK)
+    {
+      if (item->profile != NULL) delete static_cast<ProfileType *>(item->profile);
+      free(item);
+    }
+  esl_workqueue_Destroy(queue);
+  esl_threads_Destroy(threadObj);
+  return;
+
+ ERROR:
+  p7_Fail("profillic_thread_master failed: memory allocation problem");
+}
+
+template <class ProfileType>
+static void
+thread_loop(ESL_THREADS *obj, ESL_WORK_QUEUE *queue, struct cfg_s *cfg, const ESL_GETOPTS *go)
+{
+  int          status    = eslOK;
+  int          sstatus   = eslOK;
+  int          rstatus   = eslOK;
+  int          processed = 0;
+  WORK_ITEM   *item;
+  void        *newItem;
+
+  char        errmsg[eslERRBUFSIZE];
+
+  esl_workqueue_Reset(queue);
+  esl_threads_WaitForStart(obj);
+
+  status = esl_workqueue_ReaderUpdate(queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+      
+  /* Main loop: */
+  item = (WORK_ITEM *) newItem;
+  while (sstatus == eslOK) {
+    sstatus = next_input<ProfileType>(cfg, TRUE, errmsg, &rstatus, &item->msa, &item->profile, &item->nali);
+    if      (sstatus == eslOK) ;
+    else if (sstatus == eslEOF && processed < cfg->nali) sstatus = eslOK;
+    else if (rstatus != eslOK && rstatus != eslEOF)      eslx_msafile_ReadFailure(cfg->afp, rstatus);
+    else if (sstatus != eslEOF)                          p7_Fail("%s\n", errmsg);
+	  
+    if (sstatus == eslOK && item->msa != NULL && cfg->budget != NULL) {
+      item->bytes = item_bytes(cfg, item->msa);
+      memory_budget_Admit(cfg->budget, item->bytes);
+    }
+
+    if (sstatus == eslOK) {
+      item->force_single = esl_opt_IsUsed(go, "--single");
+      status = esl_workqueue_ReaderUpdate(queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue reader failed");
+
+      /* Count any results; the worker has already passed the model
+       * on to the writer, which keeps the input output order the same.
+       */
+      item = (WORK_ITEM *) newItem;
+      if (item->processed == TRUE) {
+	++processed;
+
+	item->nali      = 0;
+	item->processed = FALSE;
+	item->hmm       = NULL;
+	item->msa       = NULL;
+	item->spill     = NULL;
+	item->om        = NULL;
+	item->entropy   = 0.0;
+	item->bytes     = 0;
+	item->pool      = NULL;
+      }
+    }
+  }
+
+  status = esl_workqueue_ReaderUpdate(queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+
+  if (sstatus == eslEOF)
+    {
+      /* wait for all the threads to complete */
+      esl_threads_WaitForFinish(obj);
+      esl_workqueue_Complete(queue);  
+    }
+  return;
+}
+
+template <class ProfileType>
+static void 
+pipeline_thread(void *arg)
+{
+  int           workeridx;
+  int           status;
+
+  WORK_ITEM    *item;
+  void         *newItem;
+
+  WORKER_INFO  *info;
+  ESL_THREADS  *obj;
+  ESL_SQ       *sq        = NULL;  /* (the pool's own) */
+  ESL_MSA      *postmsa   = NULL;
+
+  obj = (ESL_THREADS *) arg;
+  esl_threads_Started(obj, &workeridx);
+
+  info = (WORKER_INFO *) esl_threads_GetData(obj, workeridx);
+
+  status = esl_workqueue_WorkerUpdate(info->queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  /* loop until all blocks have been processed */
+  item = (WORK_ITEM *) newItem;
+  while (item->msa != NULL)
+    {
+
+      if ( profillic_esl_msa_Nseq(item->msa) > 1 || info->bg->abc->type != eslAMINO || !item->force_single) {
+        status = profillic_p7_Builder(info->bld, item->msa, static_cast<ProfileType *>(item->profile), info->bg, &item->hmm, NULL, NULL, (info->do_press ? &item->om : NULL), (info->do_postmsa ? &postmsa : NULL), info->use_priors, info->calibrate_ncpu, info->weight_ncpu, &(item->timings), info->cache, info->pool);
+        if (status != eslOK) p7_Fail("build failed: %s", info->bld->errbuf);
+        /* it may wait for earlier models to be written: on disk, not in memory */
+        if (postmsa != NULL && postmsa_Spill(postmsa, &item->spill) != eslOK) p7_Fail("Failed to spill resaved MSA to a temporary file");
+        postmsa = NULL;
+      } else {
+        //for protein, single sequence, use blosum matrix:
+        profillic_timings_Start(&(item->timings));
+        status = profillic_build_pool_GetSq(info->pool, item->msa, 0, &sq);
+        if (status != eslOK) p7_Fail("build failed: %s", info->bld->errbuf);
+
+        status = p7_SingleBuilder(info->bld, sq, info->bg, &item->hmm, NULL, NULL, (info->do_press ? &item->om : NULL));
+        if (status != eslOK) p7_Fail("build failed: %s", info->bld->errbuf);
+
+        sq = NULL;
+        item->hmm->eff_nseq = 1;
+        profillic_timings_Mark(&(item->timings), PROFILLIC_STAGE_MODEL);
+      }
+      item->workeridx = workeridx;
+      item->pool      = info->pool;
+      if (info->do_timings) { profillic_timings_Add(&(info->total), &(item->timings)); info->nbuilt++; }
+
+      item->entropy   = (info->do_stats ? profillic_hmm_MatchStats(item->hmm, info->bg, NULL) : 0.0);
+      item->processed = TRUE;
+      if (info->budget != NULL) memory_budget_Built(info->budget);
+      output_writer_Put(info->writer, item);
+
+      status = esl_workqueue_WorkerUpdate(info->queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue worker failed");
+
+      item = (WORK_ITEM *) newItem;
+    }
+
+  status = esl_workqueue_WorkerUpdate(info->queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+
+/**
+ * output_writer_Create
+ *
+ * Start the thread that writes finished models through
+ * output_result(), in input order, with a reorder ring of <nring>
+ * slots.
+ */
+static int
+output_writer_Create(const struct cfg_s *cfg, int nring, OUTPUT_WRITER **ret_w)
+{
+  OUTPUT_WRITER *w = NULL;
+  int            i;
+  int            status;
+
+  ESL_ALLOC_CPP( OUTPUT_WRITER, w, sizeof(OUTPUT_WRITER));
+  w->ring  = NULL;
+  ESL_ALLOC_CPP( PENDING_ITEM, w->ring, sizeof(PENDING_ITEM) * nring);
+  for (i = 0; i < nring; i++) w->ring[i].nali = 0;
+  w->cfg   = cfg;
+  w->nring = nring;
+  w->next  = 1;
+  w->nlast = -1;
+
+  if (pthread_mutex_init(&w->mutex, NULL) != 0) ESL_XEXCEPTION(eslESYS, "mutex init failed");
+  if (pthread_cond_init (&w->ready, NULL) != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+  if (pthread_cond_init (&w->space, NULL) != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+  if (pthread_create(&w->thread, NULL, output_writer_thread, w) != 0) ESL_XEXCEPTION(eslESYS, "writer thread creation failed");
+
+  *ret_w = w;
+  return eslOK;
+
+ ERROR:
+  if (w != NULL) { if (w->ring != NULL) free(w->ring); free(w); }
+  *ret_w = NULL;
+  return status;
+}
+
+/**
+ * output_writer_Put
+ *
+ * Called by a worker: move <item>'s finished model into the writer's
+ * ring, first waiting for its slot to come within reach of the
+ * writer.  <item> is left without its hmm, msa, spill and om, which
+ * the writer destroys once they are written (giving the hmm back to
+ * <item>'s worker's pool).
+ */
+static void
+output_writer_Put(OUTPUT_WRITER *w, WORK_ITEM *item)
+{
+  PENDING_ITEM *slot;
+
+  if (pthread_mutex_lock(&w->mutex) != 0) esl_fatal("mutex lock failed");
+  while (item->nali >= w->next + w->nring)
+    if (pthread_cond_wait(&w->space, &w->mutex) != 0) esl_fatal("cond wait failed");
+
+  slot = &(w->ring[item->nali % w->nring]);
+  slot->nali      = item->nali;
+  slot->hmm       = item->hmm;
+  slot->msa       = item->msa;
+  slot->spill     = item->spill;
+  slot->entropy   = item->entropy;
+  slot->workeridx = item->workeridx;
+  slot->timings   = item->timings;
+  slot->om        = item->om;
+  slot->bytes     = item->bytes;
+  slot->pool      = item->pool;
+
+  if (pthread_cond_signal(&w->ready) != 0) esl_fatal("cond signal failed");
+  if (pthread_mutex_unlock(&w->mutex) != 0) esl_fatal("mutex unlock failed");
+
+  item->hmm     = NULL;
+  item->msa     = NULL;
+  item->spill   = NULL;
+  item->om      = NULL;
+}
+
+/**
+ * output_writer_thread
+ *
+ * Write models 1, 2, ... as they arrive in the ring, until all
+ * <nlast> of them are written.  The lock is not held while writing.
+ */
+static void *
+output_writer_thread(void *arg)
+{
+  OUTPUT_WRITER *w = (OUTPUT_WRITER *) arg;
+  PENDING_ITEM  *slot;
+  PENDING_ITEM   result;
+  char           errmsg[eslERRBUFSIZE];
+
+  if (pthread_mutex_lock(&w->mutex) != 0) esl_fatal("mutex lock failed");
+  for (;;)
+    {
+      slot = &(w->ring[w->next % w->nring]);
+      while (slot->nali != w->next && (w->nlast < 0 || w->next <= w->nlast))
+        if (pthread_cond_wait(&w->ready, &w->mutex) != 0) esl_fatal("cond wait failed");
+      if (slot->nali != w->next) break; /* all <nlast> written */
+
+      result     = *slot;
+      slot->nali = 0;
+      w->next++;
+      if (pthread_cond_broadcast(&w->space) != 0) esl_fatal("cond broadcast failed");
+      if (pthread_mutex_unlock(&w->mutex)   != 0) esl_fatal("mutex unlock failed");
+
+      if (output_result(w->cfg, errmsg, result.nali, result.msa, result.hmm, NULL, result.spill, result.entropy, result.workeridx, &(result.timings), result.om) != eslOK) p7_Fail(errmsg);
+      if (result.om != NULL) p7_oprofile_Destroy(result.om);
+      profillic_build_pool_DestroyHmm(result.pool, result.hmm); /* back to the worker that built it */
+      esl_msa_Destroy(result.msa);
+      if (result.spill != NULL) fclose(result.spill);
+      if (w->cfg->budget != NULL) memory_budget_Release(w->cfg->budget, result.bytes);
+
+      if (pthread_mutex_lock(&w->mutex) != 0) esl_fatal("mutex lock failed");
+    }
+  if (pthread_mutex_unlock(&w->mutex) != 0) esl_fatal("mutex unlock failed");
+  return NULL;
+}
+
+/**
+ * output_writer_Finish
+ *
+ * Once all workers are done, tell the writer there are <nlast>
+ * models in all, wait for it to write the rest, and free it.
+ */
+static void
+output_writer_Finish(OUTPUT_WRITER *w, int nlast)
+{
+  if (pthread_mutex_lock(&w->mutex) != 0) esl_fatal("mutex lock failed");
+  w->nlast = nlast;
+  if (pthread_cond_signal(&w->ready) != 0) esl_fatal("cond signal failed");
+  if (pthread_mutex_unlock(&w->mutex) != 0) esl_fatal("mutex unlock failed");
+
+  if (pthread_join(w->thread, NULL) != 0) esl_fatal("writer thread join failed");
+
+  pthread_cond_destroy (&w->space);
+  pthread_cond_destroy (&w->ready);
+  pthread_mutex_destroy(&w->mutex);
+  free(w->ring);
+  free(w);
+}
+
+/**
+ * memory_budget_Create
+ *
+ * Create a --max-memory budget of <max> bytes.
+ */
+static int
+memory_budget_Create(size_t max, MEMORY_BUDGET **ret_b)
+{
+  MEMORY_BUDGET *b = NULL;
+  int            status;
+
+  ESL_ALLOC_CPP( MEMORY_BUDGET, b, sizeof(MEMORY_BUDGET));
+  b->max      = max;
+  b->inflight = 0;
+  b->peak     = 0;
+  b->nbusy    = 0;
+  if (pthread_mutex_init(&b->mutex, NULL) != 0) ESL_XEXCEPTION(eslESYS, "mutex init failed");
+  if (pthread_cond_init (&b->freed, NULL) != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+
+  *ret_b = b;
+  return eslOK;
+
+ ERROR:
+  if (b != NULL) free(b);
+  *ret_b = NULL;
+  return status;
+}
+
+/**
+ * memory_budget_Admit
+ *
+ * Called by the reader before handing out an alignment of (about)
+ * <bytes>, with its model: wait until it fits in the budget, or there
+ * is nothing else it could wait for, then charge it.
+ */
+static void
+memory_budget_Admit(MEMORY_BUDGET *b, size_t bytes)
+{
+  if (pthread_mutex_lock(&b->mutex) != 0) esl_fatal("mutex lock failed");
+  while (b->inflight > 0 && b->inflight + bytes > b->max && b->nbusy > 0)
+    if (pthread_cond_wait(&b->freed, &b->mutex) != 0) esl_fatal("cond wait failed");
+
+  b->inflight += bytes;
+  b->nbusy++;
+  if (b->inflight > b->peak) b->peak = b->inflight;
+  if (pthread_mutex_unlock(&b->mutex) != 0) esl_fatal("mutex unlock failed");
+}
+
+/**
+ * memory_budget_Built
+ *
+ * Called by a worker when it has built a model; its bytes stay
+ * charged until the writer is done with it.
+ */
+static void
+memory_budget_Built(MEMORY_BUDGET *b)
+{
+  if (pthread_mutex_lock(&b->mutex) != 0) esl_fatal("mutex lock failed");
+  b->nbusy--;
+  if (pthread_cond_signal(&b->freed) != 0) esl_fatal("cond signal failed");
+  if (pthread_mutex_unlock(&b->mutex) != 0) esl_fatal("mutex unlock failed");
+}
+
+/**
+ * memory_budget_Release
+ *
+ * Called by the writer once a model of <bytes> (charged by
+ * memory_budget_Admit()) has been written and freed.
+ */
+static void
+memory_budget_Release(MEMORY_BUDGET *b, size_t bytes)
+{
+  if (pthread_mutex_lock(&b->mutex) != 0) esl_fatal("mutex lock failed");
+  b->inflight -= bytes;
+  if (pthread_cond_signal(&b->freed) != 0) esl_fatal("cond signal failed");
+  if (pthread_mutex_unlock(&b->mutex) != 0) esl_fatal("mutex unlock failed");
+}
+
+/**
+ * memory_budget_Destroy
+ *
+ * Free <b> (which may be NULL).
+ */
+static void
+memory_budget_Destroy(MEMORY_BUDGET *b)
+{
+  if (b == NULL) return;
+  pthread_cond_destroy (&b->freed);
+  pthread_mutex_destroy(&b->mutex);
+  free(b);
+}
+
+/**
+ * item_bytes
+ *
+ * Estimate the memory held for <msa> while it is in flight: the
+ * alignment itself, its model (at most one node per column), and,
+ * with --press, the optimized profile.  The builder's own scratch
+ * space isn't counted: it belongs to the worker, and is there whether
+ * the worker is busy or not; nor is the -O resaved alignment, which
+ * waits its turn in a temporary file (postmsa_Spill()).
+ */
+static size_t
+item_bytes(const struct cfg_s *cfg, const ESL_MSA *msa)
+{
+  size_t alen     = (size_t) msa->alen;
+  size_t nseq     = (size_t) msa->nseq;
+  size_t K        = (size_t) (cfg->abc != NULL ? cfg->abc->Kp : 32);
+  size_t msabytes = nseq * (alen + 2 + sizeof(double) + 64) + 5 * (alen + 2);
+  size_t hmmbytes = (alen + 1) * (p7H_NTRANSITIONS + 2 * K) * sizeof(float) + 5 * (alen + 2);
+  size_t bytes    = msabytes + hmmbytes;
+
+  if (cfg->do_press)            bytes += 4 * hmmbytes; /* striped match, insert and filter scores, roughly */
+  return bytes;
+}
+#endif   /* HMMER_THREADS */
+
+/**
+ * postmsa_Spill
+ *
+ * For -O, when a model may have to wait for those before it to be
+ * written (--cpu, or --mpi with --sched): write its resaved alignment
+ * <postmsa>, in Stockholm format, to an anonymous temporary file in
+ * $TMPDIR (or /tmp), returned in <*ret_spill>, and destroy <postmsa>.
+ * A model waiting its turn then holds a file handle, not an alignment
+ * as deep as its input.  postmsa_Unspill() copies it out.
+ *
+ * Returns eslOK; or eslFAIL if the temporary file can't be created or
+ * written, and <*ret_spill> is NULL.  Either way <postmsa> is gone.
+ */
+static int
+postmsa_Spill(ESL_MSA *postmsa, FILE **ret_spill)
+{
+  const char *tmpdir = getenv("TMPDIR");
+  char       *path   = NULL;
+  FILE       *fp     = NULL;
+  int         fd     = -1;
+  int         status;
+
+  if (tmpdir == NULL || *tmpdir == '\0') tmpdir = "/tmp";
+  if ((status = esl_sprintf(&path, "%s/profillic-hmmbuild.XXXXXX", tmpdir)) != eslOK) goto ERROR;
+  if ((fd = mkstemp(path)) < 0)          { status = eslFAIL; goto ERROR; }
+  unlink(path);   /* gone when closed */
+  if ((fp = fdopen(fd, "w+")) == NULL)   { status = eslFAIL; goto ERROR; }
+  fd = -1;
+  if (eslx_msafile_Write(fp, postmsa, eslMSAFILE_STOCKHOLM) != eslOK || fflush(fp) != 0) { status = eslFAIL; goto ERROR; }
+
+  esl_msa_Destroy(postmsa);
+  free(path);
+  *ret_spill = fp;
+  return eslOK;
+
+ ERROR:
+  if (fp   != NULL) fclose(fp);
+  if (fd   >= 0)    close(fd);
+  if (path != NULL) free(path);
+  esl_msa_Destroy(postmsa);
+  *ret_spill = NULL;
+  return status;
+}
+
+/**
+ * postmsa_Unspill
+ *
+ * Copy a resaved alignment spilled by postmsa_Spill() to <ofp>, the
+ * -O file.  <spill> stays open; the caller closes it.
+ *
+ * Returns eslOK; or eslEWRITE on a read or write failure.
+ */
+static int
+postmsa_Unspill(FILE *spill, FILE *ofp)
+{
+  char   buf[BUFSIZ];
+  size_t n;
+
+  rewind(spill);
+  while ((n = fread(buf, 1, BUFSIZ, spill)) > 0)
+    if (fwrite(buf, 1, n, ofp) != n) return eslEWRITE;
+  if (ferror(spill)) return eslEWRITE;
+  return eslOK;
+}
+ 
+static int
+output_result(const struct cfg_s *cfg, char *errbuf, int msaidx, ESL_MSA *msa, P7_HMM *hmm, ESL_MSA *postmsa, FILE *spill, double entropy,
+              int workeridx, const PROFILLIC_BUILD_TIMINGS *timings, P7_OPROFILE *om)
+{
+  char  idx[32];
+  char  worker[32];
+  off_t moff;
+  int   k;
+  int   status;
+
+  /* Special case: output the tabular results header. 
+   * Arranged this way to keep the two fprintf()'s close together in the code,
+   * so we can keep the data and labels properly sync'ed.
+   */
+  if (msa == NULL)
+    {
+      if (fprintf(cfg->ofp, "#%4s %-20s %5s %5s %5s %5s %8s %6s %s\n", " idx", "name",                 "nseq",  "alen",  "mlen",  "W", "eff_nseq",  "re/pos",  "description")     < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+      if (fprintf(cfg->ofp, "#%4s %-20s %5s %5s %5s %5s %8s %6s %s\n", "----", "--------------------", "-----", "-----", "-----", "-----", "--------",  "------",  "-----------") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+      if (cfg->timingsfp != NULL) {
+        if (fprintf(cfg->timingsfp, "idx\tname\tworker") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+        for (k = 0; k < PROFILLIC_NSTAGES; k++)
+          if (fprintf(cfg->timingsfp, "\t%s_wall\t%s_cpu", profillic_build_stage_names[k], profillic_build_stage_names[k]) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+        if (fprintf(cfg->timingsfp, "\ttotal_wall\ttotal_cpu\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+      }
+      return eslOK;
+    }
+
+//  if ((status = p7_hmm_Validate(hmm, errbuf, 0.0001))       != eslOK) return status;
+  if ((status = p7_hmmfile_WriteASCII(cfg->hmmfp, -1, hmm)) != eslOK) ESL_FAIL(status, errbuf, "HMM save failed");
+
+  /* --press: the binary HMM, its optimized profile, and its SSI key, as hmmpress would write them */
+  if (cfg->mfp != NULL) {
+    if (om == NULL)                                               ESL_FAIL(eslEINCONCEIVABLE, errbuf, "no optimized profile to press for %s", hmm->name);
+    if ((moff = ftello(cfg->mfp)) == -1)                          ESL_FAIL(eslESYS,  errbuf, "Failed to ftello() the binary HMM file");
+    if ((status = p7_hmmfile_WriteBinary(cfg->mfp, -1, hmm)) != eslOK) ESL_FAIL(status, errbuf, "binary HMM save failed");
+    if ((status = p7_oprofile_Write(cfg->ffp, cfg->pfp, om)) != eslOK) ESL_FAIL(status, errbuf, "optimized profile save failed");
+    if ((status = esl_newssi_AddKey(cfg->nssi, hmm->name, cfg->fh, moff, 0, 0)) != eslOK) ESL_FAIL(status, errbuf, "Failed to add key %s to SSI index", hmm->name);
+    if (hmm->acc != NULL && (status = esl_newssi_AddAlias(cfg->nssi, hmm->acc, hmm->name)) != eslOK) ESL_FAIL(status, errbuf, "Failed to add secondary key %s to SSI index", hmm->acc);
+  }
+  
+	             /* #   name nseq alen M max_length eff_nseq re/pos description */
+  if (fprintf(cfg->ofp, "%-5d %-20s %5d %5" PRId64 " %5d %5d %8.2f ",
+	      msaidx,
+	      (msa->name != NULL) ? msa->name : "",
+	      profillic_esl_msa_Nseq(msa),
+	      msa->alen,
+	      hmm->M,
+	      hmm->max_length,
+	      hmm->eff_nseq) < 0)
+    ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+  if (cfg->do_stats) status = fprintf(cfg->ofp, "%6.3f %s\n", entropy, (msa->desc != NULL) ? msa->desc : "");
+  else               status = fprintf(cfg->ofp, "%6s %s\n",   "-",     (msa->desc != NULL) ? msa->desc : "");
+  if (status < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+  
+  if (cfg->postmsafp != NULL && postmsa != NULL) {
+    eslx_msafile_Write(cfg->postmsafp, postmsa, eslMSAFILE_STOCKHOLM);
+  }
+  if (cfg->postmsafp != NULL && spill != NULL && postmsa_Unspill(spill, cfg->postmsafp) != eslOK) ESL_FAIL(eslEWRITE, errbuf, "Failed to resave MSA %s to %s", (msa->name != NULL) ? msa->name : "", cfg->postmsafile);
+
+  if (cfg->timingsfp != NULL && timings != NULL) {
+    snprintf(idx,    sizeof(idx),    "%d", msaidx);
+    snprintf(worker, sizeof(worker), "%d", workeridx);
+    if (output_timings(cfg->timingsfp, idx, (msa->name != NULL) ? msa->name : "", worker, timings) != eslOK) ESL_EXCEPTION_SYS(eslEWRITE, "output_result: write failed");
+  }
+
+  return eslOK;
+}
+
+/**
+ * press_open
+ *
+ * For --press, open <hmmfile>.h3m, .h3f, .h3p and the SSI index
+ * (<hmmfile>.h3i) that output_result() adds each model to.
+ */
+static int
+press_open(struct cfg_s *cfg, char *errbuf)
+{
+  char *mfile   = NULL;
+  char *ffile   = NULL;
+  char *pfile   = NULL;
+  char *ssifile = NULL;
+  int   status;
+
+  if ((status = esl_sprintf(&mfile,   "%s.h3m", cfg->hmmfile)) != eslOK) ESL_XFAIL(status, errbuf, "allocation failed");
+  if ((status = esl_sprintf(&ffile,   "%s.h3f", cfg->hmmfile)) != eslOK) ESL_XFAIL(status, errbuf, "allocation failed");
+  if ((status = esl_sprintf(&pfile,   "%s.h3p", cfg->hmmfile)) != eslOK) ESL_XFAIL(status, errbuf, "allocation failed");
+  if ((status = esl_sprintf(&ssifile, "%s.h3i", cfg->hmmfile)) != eslOK) ESL_XFAIL(status, errbuf, "allocation failed");
+
+  if ((cfg->mfp = fopen(mfile, "wb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open binary HMM file %s for writing", mfile);
+  if ((cfg->ffp = fopen(ffile, "wb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open MSV filter file %s for writing", ffile);
+  if ((cfg->pfp = fopen(pfile, "wb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open optimized profile file %s for writing", pfile);
+
+  if ((status = esl_newssi_Open(ssifile, TRUE, &(cfg->nssi)))         != eslOK) ESL_XFAIL(status, errbuf, "Failed to open SSI index %s for writing", ssifile);
+  if ((status = esl_newssi_AddFile(cfg->nssi, mfile, 0, &(cfg->fh))) != eslOK) ESL_XFAIL(status, errbuf, "Failed to add %s to SSI index %s", mfile, ssifile);
+
+  free(mfile);
+  free(ffile);
+  free(pfile);
+  free(ssifile);
+  return eslOK;
+
+ ERROR:
+  if (mfile   != NULL) free(mfile);
+  if (ffile   != NULL) free(ffile);
+  if (pfile   != NULL) free(pfile);
+  if (ssifile != NULL) free(ssifile);
+  return status;
+}
+
+/**
+ * press_close
+ *
+ * For --press, save the SSI index and close the pressed files, once
+ * every model has gone through output_result().
+ */
+static int
+press_close(struct cfg_s *cfg, char *errbuf)
+{
+  int status;
+
+  if (cfg->nssi != NULL) {
+    if ((status = esl_newssi_Write(cfg->nssi)) != eslOK) ESL_FAIL(status, errbuf, "Failed to write SSI index for %s:\n%s", cfg->hmmfile, cfg->nssi->errbuf);
+    esl_newssi_Close(cfg->nssi);
+    cfg->nssi = NULL;
+  }
+  if (cfg->mfp != NULL) { status = fclose(cfg->mfp); cfg->mfp = NULL; if (status != 0) ESL_FAIL(eslEWRITE, errbuf, "Failed to write binary HMM file %s.h3m", cfg->hmmfile); }
+  if (cfg->ffp != NULL) { status = fclose(cfg->ffp); cfg->ffp = NULL; if (status != 0) ESL_FAIL(eslEWRITE, errbuf, "Failed to write MSV filter file %s.h3f", cfg->hmmfile); }
+  if (cfg->pfp != NULL) { status = fclose(cfg->pfp); cfg->pfp = NULL; if (status != 0) ESL_FAIL(eslEWRITE, errbuf, "Failed to write optimized profile file %s.h3p", cfg->hmmfile); }
+  return eslOK;
+}
+
+/**
+ * output_timings
+ *
+ * Write one row of the --timings TSV: the wall and CPU seconds of each
+ * build stage in <timings>, then their sums.
+ */
+static int
+output_timings(FILE *fp, const char *idx, const char *name, const char *worker, const PROFILLIC_BUILD_TIMINGS *timings)
+{
+  double wall = 0.;
+  double cpu  = 0.;
+  int    k;
+
+  if (fprintf(fp, "%s\t%s\t%s", idx, name, worker) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_timings: write failed");
+  for (k = 0; k < PROFILLIC_NSTAGES; k++) {
+    if (fprintf(fp, "\t%.6f\t%.6f", timings->wall[k], timings->cpu[k]) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_timings: write failed");
+    wall += timings->wall[k];
+    cpu  += timings->cpu[k];
+  }
+  if (fprintf(fp, "\t%.6f\t%.6f\n", wall, cpu) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "output_timings: write failed");
+  return eslOK;
+}
+
+
+
+/**
+ * <pre> 
+ * set_msa_name() 
+ *
+ * Make sure the alignment has a name; this name will
+ * then be transferred to the model.
+ * 
+ * We can only do this for a single alignment in a file. For multi-MSA
+ * files, each MSA is required to have a name already.
+ *
+ * Priority is:
+ *      1. Use -n <name> if set, overriding any name the alignment might already have. 
+ *      2. Use alignment's existing name, if non-NULL.
+ *      3. Make a name, from alignment file name without path and without filename extension 
+ *         (e.g. "/usr/foo/globins.slx" gets named "globins")
+ * If none of these succeeds, return <eslEINVAL>.
+ *         
+ * If a multiple MSA database (e.g. Stockholm/Pfam), and we encounter
+ * an MSA that doesn't already have a name, return <eslEINVAL> if nali > 1.
+ * (We don't know we're in a multiple MSA database until we're on the second
+ * alignment.)
+ * 
+ * If we're in MPI mode, we assume we're in a multiple MSA database,
+ * even on the first alignment.
+ *
+ * Galosh profiles carry no names of their own, so in a multi-profile
+ * file the second and later profiles are numbered: "Galosh Profile-2",
+ * "Galosh Profile-3", ...  The first keeps its name unsuffixed, in MPI
+ * mode too, so that the names don't depend on how the file is read.
+ * 
+ * Because we can't tell whether we've got more than one
+ * alignment 'til we're on the second one, these fatal errors
+ * only happen after the first HMM has already been built.
+ * Oh well.
+ * </pre>
+ */
+static int
+set_msa_name(struct cfg_s *cfg, char *errbuf, ESL_MSA *msa)
+{
+  char *name = NULL;
+  int   status;
+
+  assert(cfg != NULL && msa != NULL);
+  if (cfg->do_mpi == FALSE && cfg->nali == 1) /* first (only?) HMM in file: */
+    {
+      if  (cfg->hmmName != NULL)
+	{
+	  if ((status = esl_msa_SetName(msa, cfg->hmmName, -1)) != eslOK) return status;
+	}
+      else if (msa->name != NULL) 
+	{
+	  cfg->nnamed++;
+	}
+      else if (cfg->afp->bf->filename)
+	{
+	  if ((status = esl_FileTail(cfg->afp->bf->filename, TRUE, &name)) != eslOK) return status; /* TRUE=nosuffix */	  
+	  if ((status = esl_msa_SetName(msa, name, -1))                    != eslOK) return status;
+	  free(name);
+	}
+      else ESL_FAIL(eslEINVAL, errbuf, "Failed to set model name: msa has no name, no msa filename, and no -n");
+    }
+  else 
+    {
+      if (cfg->hmmName   != NULL) ESL_FAIL(eslEINVAL, errbuf, "Oops. Wait. You can't use -n with an alignment database.");
+      else if (cfg->afp->format == eslMSAFILE_PROFILLIC && msa->name != NULL && cfg->nali > 1)
+	{
+	  if ((status = esl_strdup(msa->name, -1, &name))                     != eslOK) return status;
+	  if ((status = esl_msa_FormatName(msa, "%s-%d", name, cfg->nali))    != eslOK) { free(name); return status; }
+	  free(name);
+	  cfg->nnamed++;
+	}
+      else if (msa->name != NULL) cfg->nnamed++;
+      else                        ESL_FAIL(eslEINVAL, errbuf, "Oops. Wait. I need name annotation on each alignment in a multi MSA file; failed on #%d", cfg->nali+1);
+
+      /* special kind of failure: the *first* alignment didn't have a name, and we used the filename to
+       * construct one; now that we see a second alignment, we realize this was a boo-boo*/
+      if (cfg->nnamed != cfg->nali)            ESL_FAIL(eslEINVAL, errbuf, "Oops. Wait. I need name annotation on each alignment in a multi MSA file; first MSA didn't have one");
+    }
+  return eslOK;
+}
+
+/**
+ * sched_open
+ *
+ * With --sched <n> (n > 0), create the window of <n> alignments that
+ * next_input() reads ahead into, and note what it needs to estimate
+ * their build costs.  Otherwise leave <cfg->sched> NULL.
+ *
+ * Returns eslOK, or eslEMEM on allocation failure.
+ */
+static int
+sched_open(const ESL_GETOPTS *go, struct cfg_s *cfg)
+{
+  if (esl_opt_GetInteger(go, "--sched") == 0) return eslOK;
+
+  if ((cfg->sched = profillic_sched_Create(esl_opt_GetInteger(go, "--sched"))) == NULL) return eslEMEM;
+  cfg->sched_eof            = FALSE;
+  cfg->sched_symfrac        = esl_opt_GetReal(go, "--symfrac");
+  cfg->sched_calib_residues = (double) esl_opt_GetInteger(go, "--EmL") * (double) esl_opt_GetInteger(go, "--EmN")
+                            + (double) esl_opt_GetInteger(go, "--EvL") * (double) esl_opt_GetInteger(go, "--EvN")
+                            + (double) esl_opt_GetInteger(go, "--EfL") * (double) esl_opt_GetInteger(go, "--EfN");
+  return eslOK;
+}
+
+/**
+ * sched_close
+ *
+ * Free the --sched window, if any, with its spare profiles (and any
+ * alignments still waiting in it, as after an error).
+ */
+template <class ProfileType>
+static void
+sched_close(struct cfg_s *cfg)
+{
+  PROFILLIC_SCHED_ENTRY e;
+  void                 *profile;
+
+  if (cfg->sched == NULL) return;
+  while (profillic_sched_Take(cfg->sched, &e) == eslOK)
+    {
+      esl_msa_Destroy(e.msa);
+      profillic_sched_PushSpare(cfg->sched, e.profile);
+    }
+  while ((profile = profillic_sched_PopSpare(cfg->sched)) != NULL)
+    delete static_cast<ProfileType *>(profile);
+  profillic_sched_Destroy(cfg->sched);
+  cfg->sched = NULL;
+}
+
+/**
+ * readers_open
+ *
+ * With --readers <n> (n > 0), start <n> threads parsing the alignment
+ * file from its record offsets (see profillic-msafile_readers.hpp),
+ * for read_input() to take alignments from.  Otherwise leave
+ * <cfg->readers> NULL.  Without thread support, this does nothing.
+ *
+ * Returns eslOK, or a failure status with a message in <errbuf>.
+ */
+static int
+readers_open(const ESL_GETOPTS *go, struct cfg_s *cfg, char *errbuf)
+{
+#ifdef HMMER_THREADS
+  if (esl_opt_GetInteger(go, "--readers") > 0)
+    return profillic_readers_Open(cfg->alifile, cfg->afp->format, cfg->abc, esl_opt_GetInteger(go, "--readers"), errbuf, &(cfg->readers));
+#endif
+  return eslOK;
+}
+
+/**
+ * readers_close
+ *
+ * Stop the --readers threads, if any.
+ */
+static void
+readers_close(struct cfg_s *cfg)
+{
+#ifdef HMMER_THREADS
+  profillic_readers_Close(cfg->readers);
+  cfg->readers = NULL;
+#endif
+}
+
+/**
+ * read_input
+ *
+ * Read the next alignment in the input (and, for --profillic-* input,
+ * its galosh profile into <profile>), from the --readers threads if
+ * they're running, else straight from <cfg->afp>.  Either way a parse
+ * failure leaves its message in <cfg->afp->errmsg>, for
+ * eslx_msafile_ReadFailure().
+ */
+template <class ProfileType>
+static int
+read_input(struct cfg_s *cfg, ESL_MSA **ret_msa, ProfileType *profile)
+{
+#ifdef HMMER_THREADS
+  if (cfg->readers != NULL) return profillic_readers_Read(cfg->readers, ret_msa, cfg->afp->errmsg);
+#endif
+  return profillic_eslx_msafile_Read(cfg->afp, ret_msa, profile);
+}
+
+/**
+ * next_input
+ *
+ * Get the next alignment to build from into <*ret_msa>, and its number
+ * in the input (1..) into <*ret_nali>.  For --profillic-* input, its
+ * galosh profile is in <*io_profile> (a ProfileType *), which the caller
+ * owns.  If <do_name>, the alignment is named by set_msa_name() as it
+ * is read.
+ *
+ * Without --sched, this just reads the next alignment into
+ * <*io_profile>.  With it, alignments are read ahead into
+ * <cfg->sched>, and the costliest one waiting is returned (within the
+ * window's bound on reordering; see profillic-schedule.hpp); the
+ * caller's <*io_profile> is swapped for the one read with it.
+ *
+ * Returns eslOK; eslEOF when no alignments remain; or, on failure,
+ * the failing status: <*ret_rstatus> is the status of the last read,
+ * so a read failure is reported there, and a naming failure leaves it
+ * eslOK with a message in <errbuf>.
+ */
+template <class ProfileType>
+static int
+next_input(struct cfg_s *cfg, int do_name, char *errbuf, int *ret_rstatus, ESL_MSA **ret_msa, void **io_profile, int *ret_nali)
+{
+  PROFILLIC_SCHED_ENTRY e;
+  ESL_MSA              *msa     = NULL;
+  void                 *profile = NULL;
+  int                   status;
+
+  *ret_msa     = NULL;
+  *ret_rstatus = eslOK;
+
+  if (cfg->sched == NULL)
+    {
+      if ((status = read_input(cfg, &msa, static_cast<ProfileType *>(*io_profile))) != eslOK) { *ret_rstatus = status; return status; }
+      cfg->nali++;
+      if (do_name && (status = set_msa_name(cfg, errbuf, msa)) != eslOK) goto ERROR; /* cfg->nnamed gets incremented in this call */
+      *ret_msa  = msa;
+      *ret_nali = cfg->nali;
+      return eslOK;
+    }
+
+  /* Top up the window; it is named in read order, because set_msa_name() counts on cfg->nali */
+  while (! cfg->sched_eof && ! profillic_sched_IsFull(cfg->sched))
+    {
+      if (cfg->fmt == eslMSAFILE_PROFILLIC && (profile = profillic_sched_PopSpare(cfg->sched)) == NULL) profile = ProfillicProfileKind<ProfileType>::Create(cfg->nseq);
+
+      status = read_input(cfg, &msa, static_cast<ProfileType *>(profile));
+      if (status == eslEOF)
+        {
+          cfg->sched_eof = TRUE;
+          profillic_sched_PushSpare(cfg->sched, profile);
+          profile = NULL;
+          break;
+        }
+      else if (status != eslOK) { *ret_rstatus = status; goto ERROR; }
+      cfg->nali++;
+      if (do_name && (status = set_msa_name(cfg, errbuf, msa)) != eslOK) goto ERROR;
+
+      profillic_sched_Add(cfg->sched, msa, profile, cfg->nali,
+                          profillic_sched_Cost(msa, (cfg->fmt == eslMSAFILE_PROFILLIC), cfg->sched_symfrac, cfg->sched_calib_residues));
+      msa     = NULL;
+      profile = NULL;
+    }
+
+  if (profillic_sched_Take(cfg->sched, &e) != eslOK) return eslEOF;
+  profillic_sched_PushSpare(cfg->sched, *io_profile);
+  *io_profile = e.profile;
+  *ret_msa    = e.msa;
+  *ret_nali   = e.nali;
+  return eslOK;
+
+ ERROR:
+  if (msa     != NULL) esl_msa_Destroy(msa);
+  if (profile != NULL) delete static_cast<ProfileType *>(profile);
+  return status;
+}
+
+/*---------------------- end, driver --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICHMMBUILDDRIVER_HPP__
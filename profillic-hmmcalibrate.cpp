@@ -14,8 +14,15 @@ Usage: profillic-hmmcalibrate [-options] <input hmmfile> <output hmmfile>
 
 Options:
   -h         : show brief help on version and usage
+  --cpu <n>  : number of parallel CPU workers for multithreads
   --seed <n> : set RNG seed to <n> (if 0: one-time arbitrary seed)  [42]  (n>=0)
+  --cache <f>: reuse the calibrations of unchanged models, cached in file <f>
+  --nostats  : don't compute the stats columns of each model's line (print "-")
  * </pre>
+ *
+ * An <input hmmfile> or <output hmmfile> ending in ".gz" or ".zst" is
+ * read or written gzip- or zstd-compressed, through a gzip or zstd
+ * process (see profillic-compress.hpp).
  */
 extern "C" {
 #include "p7_config.h"
@@ -35,9 +42,20 @@ extern "C" {
 #undef new
 }
 
+#ifdef HMMER_THREADS
+#include <unistd.h>
+extern "C" {
+#include "esl_threads.h"
+#include "esl_workqueue.h"
+}
+#endif /*HMMER_THREADS*/
+
 /* ////////////// For profillic-hmmer ///////////////////////////////// */
 #include "profillic-hmmer.hpp"
 //#include "profillic-p7_builder.hpp"
+#include "profillic-calibration_cache.hpp"
+#include "profillic-modelstats.hpp"
+#include "profillic-compress.hpp"
 
 // Updated notices:
 #define PROFILLIC_HMMER_VERSION "1.0a"
@@ -114,15 +132,62 @@ profillic_p7_banner(FILE *fp, char *progname, char *banner)
 }
 /* ////////////// End profillic-hmmer ////////////////////////////////// */
 
+typedef struct {
+#ifdef HMMER_THREADS
+  ESL_WORK_QUEUE   *queue;
+#endif /*HMMER_THREADS*/
+  P7_BG            *bg;            /* created from the first HMM's alphabet */
+  ESL_RANDOMNESS   *r;             /* this worker's own RNG for the calibration simulations */
+  int               do_reseeding;  /* TRUE to reseed before each model, making results reproducible */
+  const PROFILLIC_CALIBRATION_CACHE *cache; /* --cache, or NULL; only looked up by the workers */
+} WORKER_INFO;
+
+/* What calibrate_hmm() tells the writer about a model, for --cache. */
+typedef struct {
+  uint64_t    key;          /* the model's calibration cache key     */
+  int         cached;       /* TRUE if its calibration was restored  */
+} CALIBRATION_NOTE;
+
+#ifdef HMMER_THREADS
+typedef struct {
+  int         nhmm;
+  int         processed;
+  P7_HMM     *hmm;
+  CALIBRATION_NOTE note;
+} WORK_ITEM;
+
+typedef struct _pending_s {
+  int         nhmm;
+  P7_HMM     *hmm;
+  CALIBRATION_NOTE note;
+  struct _pending_s *next;
+} PENDING_ITEM;
+#endif /*HMMER_THREADS*/
+
 static ESL_OPTIONS options[] = {
   /* name           type      default  env  range     toggles   reqs   incomp  help   docgroup*/
   { "-h",        eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "show brief help on version and usage",            0 },
-  { "--seed",     eslARG_INT,   "42", NULL, "n>=0",     NULL,      NULL,    NULL, "set RNG seed to <n> (if 0: one-time arbitrary seed)",   8 },
+#ifdef HMMER_THREADS 
+  { "--cpu",     eslARG_INT,    NULL,"HMMER_NCPU","n>=0",NULL,     NULL,  NULL,  "number of parallel CPU workers for multithreads",       0 },
+#endif
+  { "--seed",     eslARG_INT,   "42", NULL, "n>=0",     NULL,      NULL,    NULL, "set RNG seed to <n> (if 0: one-time arbitrary seed)",   0 },
+  { "--cache",   eslARG_OUTFILE, NULL, NULL, NULL,      NULL,      NULL,    NULL, "reuse the calibrations of unchanged models, cached in file <f>", 0 },
+  { "--nostats", eslARG_NONE,    FALSE, NULL, NULL,      NULL,      NULL,    NULL, "don't compute the stats columns of each model's line", 0 },
   {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
 static char usage[]  = "[-options] <input hmmfile> <output hmmfile>";
 static char banner[] = "calibrate HMM search statistics";
+
+static void serial_loop    (WORKER_INFO *info, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, PROFILLIC_CALIBRATION_CACHE *cache);
+#ifdef HMMER_THREADS
+static void thread_loop    (ESL_THREADS *obj, ESL_WORK_QUEUE *queue, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, PROFILLIC_CALIBRATION_CACHE *cache);
+static void pipeline_thread(void *arg);
+#endif /*HMMER_THREADS*/
+
+static void read_failure   (int status, char *hmmfile);
+static int  calibrate_hmm  (WORKER_INFO *info, P7_HMM *hmm, CALIBRATION_NOTE *note);
+static int  output_result  (FILE *outhmmfp, P7_BG *bg, char *errbuf, int nhmm, P7_HMM *hmm, PROFILLIC_CALIBRATION_CACHE *cache, const CALIBRATION_NOTE *note);
 /**
  * int main(int argc, char **argv) 
  * main driver
@@ -136,26 +201,33 @@ main(int argc, char **argv)
   char            *hmmfile = NULL;
   char            *outhmmfile = NULL;
   P7_HMMFILE      *hfp     = NULL;
+  FILE            *hpipe   = NULL;      /* decompressor <hfp> reads from, or NULL */
   FILE         *outhmmfp;          /* HMM output file handle                  */
-  P7_HMM          *hmm     = NULL;
-  P7_BG           *bg      = NULL;
-  int              nhmm;	
-  double           x;
-  float            KL;
+  P7_BG           *bg      = NULL;      /* the writer's bg, for the stats line  */
+  PROFILLIC_CALIBRATION_CACHE *cache = NULL; /* --cache */
   int              status;
   char             errbuf[eslERRBUFSIZE];
 
   char        errmsg[eslERRBUFSIZE];
 
+  int              ncpus    = 0;
+  int              infocnt  = 0;
+  WORKER_INFO     *info     = NULL;
+#ifdef HMMER_THREADS
+  WORK_ITEM       *item     = NULL;
+  ESL_THREADS     *threadObj= NULL;
+  ESL_WORK_QUEUE  *queue    = NULL;
+#endif
+  int              i;
+
   /* Run-to-run variation due to random number generation                                          */
   int         seed;
-  ESL_RANDOMNESS      *r;	         /* RNG for E-value calibration simulations                */
-  int                  do_reseeding;	 /* TRUE to reseed, making results reproducible            */
 
   /* Process the command line options.
    */
   go = esl_getopts_Create(options);
-  if (esl_opt_ProcessCmdline(go, argc, argv) != eslOK || 
+  if (esl_opt_ProcessEnvironment(go)         != eslOK ||
+      esl_opt_ProcessCmdline(go, argc, argv) != eslOK || 
       esl_opt_VerifyConfig(go)               != eslOK)
     {
       printf("Failed to parse command line: %s\n", go->errbuf);
@@ -200,79 +272,414 @@ main(int argc, char **argv)
     if (esl_opt_GetInteger(go, "--seed") == 0) printf("# random number seed:               one-time arbitrary\n");
     else                                       printf("# random number seed set to:        %d\n", esl_opt_GetInteger(go, "--seed"));
   }
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--cpu"))             printf("# number of worker threads:         %d\n", esl_opt_GetInteger(go, "--cpu"));
+#endif
+  if (esl_opt_IsUsed(go, "--cache"))           printf("# calibration cache:                %s\n", esl_opt_GetString(go, "--cache"));
+  if (esl_opt_IsUsed(go, "--nostats"))         printf("# model stats:                      not computed\n");
   
   /* Initializations: open the input HMM file for reading
    */
-  status = p7_hmmfile_OpenE(hmmfile, NULL, &hfp, errbuf);
+  status = profillic_hmmfile_OpenE(hmmfile, &hfp, &hpipe, errbuf);
   if      (status == eslENOTFOUND) p7_Fail("File existence/permissions problem in trying to open HMM file %s.\n%s\n", hmmfile, errbuf);
   else if (status == eslEFORMAT)   p7_Fail("File format problem in trying to open HMM file %s.\n%s\n",                hmmfile, errbuf);
   else if (status != eslOK)        p7_Fail("Unexpected error %d in opening HMM file %s.\n%s\n",               status, hmmfile, errbuf);  
 
   /* Initializations: open the output HMM file for writing
    */
-  if ((outhmmfp = fopen(outhmmfile, "w")) == NULL) ESL_FAIL(status, errmsg, "Failed to open HMM file %s for writing", outhmmfile);
+  if ((outhmmfp = profillic_ofile_Open(outhmmfile)) == NULL) ESL_FAIL(status, errmsg, "Failed to open HMM file %s for writing", outhmmfile);
+
+  /* Initializations: read the calibration cache. Cached calibrations
+   * are only reproducible when each model starts from the same seed.
+   */
+  if (esl_opt_IsOn(go, "--cache")) {
+    if (esl_opt_GetInteger(go, "--seed") == 0) p7_Fail("--cache needs a fixed (nonzero) --seed\n");
+    if (profillic_calibration_cache_Open(esl_opt_GetString(go, "--cache"), &cache, errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+  }
+
+#ifdef HMMER_THREADS
+  /* initialize thread data */
+  if (esl_opt_IsOn(go, "--cpu")) ncpus = esl_opt_GetInteger(go, "--cpu");
+  else                                   esl_threads_CPUCount(&ncpus);
+
+  if (ncpus > 0)
+    {
+      threadObj = esl_threads_Create(&pipeline_thread);
+      queue = esl_workqueue_Create(ncpus * 2);
+    }
+#endif
 
   /* Normally we reinitialize the RNG to original seed before calibrating each model.
    * This eliminates run-to-run variation.
    * As a special case, seed==0 means choose an arbitrary seed and shut off the
    * reinitialization; this allows run-to-run variation.
+   *
+   * Every worker owns an RNG seeded the same way, and (when reseeding)
+   * starts each model from that seed, so the calibration of model <n>
+   * does not depend on which worker gets it or on what it did before:
+   * threaded results are identical to the serial ones.
    */
-  seed       = esl_opt_GetInteger(go, "--seed");
-  r            = esl_randomness_CreateFast(seed);
-  do_reseeding = (seed == 0) ? FALSE : TRUE;
+  seed    = esl_opt_GetInteger(go, "--seed");
+  infocnt = (ncpus == 0) ? 1 : ncpus;
+  ESL_ALLOC_CPP( WORKER_INFO, info, sizeof(*info) * infocnt);
+
+  for (i = 0; i < infocnt; ++i)
+    {
+      info[i].bg           = NULL;
+      info[i].r            = esl_randomness_CreateFast(seed);
+      info[i].do_reseeding = (seed == 0) ? FALSE : TRUE;
+      info[i].cache        = cache;
+#ifdef HMMER_THREADS
+      info[i].queue = queue;
+      if (ncpus > 0) esl_threads_AddThread(threadObj, &info[i]);
+#endif
+    }
+
+#ifdef HMMER_THREADS
+  for (i = 0; i < ncpus * 2; ++i)
+    {
+      ESL_ALLOC_CPP( WORK_ITEM, item, sizeof(*item));
+
+      item->nhmm      = 0;
+      item->processed = FALSE;
+      item->hmm       = NULL;
+
+      status = esl_workqueue_Init(queue, item);
+      if (status != eslOK) esl_fatal("Failed to add block to work queue");
+    }
+#endif
 
   /* Main body: read HMMs one at a time, print one line of stats
    */
   printf("#\n");
-  printf("# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "idx",  "name",                 "accession",    "nseq",     "eff_nseq", "M",      "relent", "info",   "p relE", "compKL");
-  printf("# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "----", "--------------------", "------------", "--------", "--------", "------", "------", "------", "------", "------");
+  profillic_hmm_PrintStatsHeader(stdout);
+
+#ifdef HMMER_THREADS
+  if (ncpus > 0)  thread_loop(threadObj, queue, hfp, hmmfile, &abc, &bg, ! esl_opt_GetBoolean(go, "--nostats"), outhmmfp, cache);
+  else            serial_loop(info, hfp, hmmfile, &abc, &bg, ! esl_opt_GetBoolean(go, "--nostats"), outhmmfp, cache);
+#else
+  serial_loop(info, hfp, hmmfile, &abc, &bg, ! esl_opt_GetBoolean(go, "--nostats"), outhmmfp, cache);
+#endif
+
+  if (cache != NULL) {
+    printf("#\n# calibration cache: %d hit%s, %d miss%s\n", cache->nhit, (cache->nhit == 1 ? "" : "s"), cache->nmiss, (cache->nmiss == 1 ? "" : "es"));
+    if (profillic_calibration_cache_Close(cache, errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+  }
+
+  for (i = 0; i < infocnt; ++i)
+    {
+      if (info[i].bg != NULL) p7_bg_Destroy(info[i].bg);
+      esl_randomness_Destroy(info[i].r);
+    }
+
+#ifdef HMMER_THREADS
+  if (ncpus > 0)
+    {
+      esl_workqueue_Reset(queue);
+      while (esl_workqueue_Remove(queue, (void **) &item) == eslOK)
+	{
+	  free(item);
+	}
+      esl_workqueue_Destroy(queue);
+      esl_threads_Destroy(threadObj);
+    }
+#endif
 
-  nhmm = 0;
-  while ((status = p7_hmmfile_Read(hfp, &abc, &hmm)) != eslEOF) 
+  free(info);
+  if (bg != NULL) p7_bg_Destroy(bg);
+  esl_alphabet_Destroy(abc);
+  if (profillic_hmmfile_Close(hfp, hpipe) != eslOK) p7_Fail("Failed to decompress HMM file %s\n", hmmfile);
+  if (outhmmfp != NULL && profillic_ofile_Close(outhmmfp, outhmmfile) != 0) p7_Fail("Failed to finish HMM file %s\n", outhmmfile);
+ esl_getopts_Destroy(go);
+  exit(0);
+
+ ERROR:
+  p7_Fail("profillic-hmmcalibrate failed: memory allocation problem");
+}
+
+/**
+ * serial_loop
+ *
+ * Read, calibrate and write each HMM in turn, with the one worker <info>.
+ */
+static void
+serial_loop(WORKER_INFO *info, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, PROFILLIC_CALIBRATION_CACHE *cache)
+{
+  P7_HMM     *hmm         = NULL;
+  int         nhmm        = 0;
+  CALIBRATION_NOTE note;
+  char        errmsg[eslERRBUFSIZE];
+  int         status;
+
+  while ((status = p7_hmmfile_Read(hfp, byp_abc, &hmm)) != eslEOF) 
     {
-      if      (status == eslEOD)       esl_fatal("read failed, HMM file %s may be truncated?", hmmfile);
-      else if (status == eslEFORMAT)   esl_fatal("bad file format in HMM file %s",             hmmfile);
-      else if (status == eslEINCOMPAT) esl_fatal("HMM file %s contains different alphabets",   hmmfile);
-      else if (status != eslOK)        esl_fatal("Unexpected error in reading HMMs from %s",   hmmfile);
+      if (status != eslOK) read_failure(status, hmmfile);
       nhmm++;
 
-      if (bg == NULL) bg = p7_bg_Create(abc);
+      if (do_stats && *byp_bg == NULL) *byp_bg = p7_bg_Create(*byp_abc);
+
+      if ((status = calibrate_hmm(info, hmm, &note))                                      != eslOK) esl_fatal("Unexpected error in calibrating the hmm");
+      if ((status = output_result(outhmmfp, *byp_bg, errmsg, nhmm, hmm, cache, &note))    != eslOK) p7_Fail("%s\n", errmsg);
+
+      p7_hmm_Destroy(hmm);
+    }
+}
+
+#ifdef HMMER_THREADS
+/**
+ * thread_loop
+ *
+ * The reader and ordered writer for the threaded version: read each HMM
+ * into a work item for the pipeline_thread()s, and write the calibrated
+ * models (and their stats lines) back out in the order they were read.
+ */
+static void
+thread_loop(ESL_THREADS *obj, ESL_WORK_QUEUE *queue, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, PROFILLIC_CALIBRATION_CACHE *cache)
+{
+  int          status    = eslOK;
+  int          sstatus   = eslOK;
+  int          nhmm      = 0;
+  int          processed = 0;
+  WORK_ITEM   *item;
+  void        *newItem;
+
+  int           next     = 1;
+  PENDING_ITEM *top      = NULL;
+  PENDING_ITEM *empty    = NULL;
+  PENDING_ITEM *tmp      = NULL;
+
+  char        errmsg[eslERRBUFSIZE];
+
+  esl_workqueue_Reset(queue);
+  esl_threads_WaitForStart(obj);
+
+  status = esl_workqueue_ReaderUpdate(queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+      
+  /* Main loop: */
+  item = (WORK_ITEM *) newItem;
+  while (sstatus == eslOK) {
+    sstatus = p7_hmmfile_Read(hfp, byp_abc, &item->hmm);
+    if (sstatus == eslOK) {
+      item->nhmm = ++nhmm;
+      if (do_stats && *byp_bg == NULL) *byp_bg = p7_bg_Create(*byp_abc);
+    }
+    else if (sstatus == eslEOF) {
+      item->hmm = NULL;	/* an empty item tells the workers there's nothing left */
+      if (processed < nhmm) sstatus = eslOK;
+    }
+    else read_failure(sstatus, hmmfile);
+	  
+    if (sstatus == eslOK) {
+      status = esl_workqueue_ReaderUpdate(queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue reader failed");
+
+      /* process any results */
+      item = (WORK_ITEM *) newItem;
+      if (item->processed == TRUE) {
+	++processed;
+
+	/* keep the output order the same as the input order */
+	if (item->nhmm == next) {
+	  if (output_result(outhmmfp, *byp_bg, errmsg, item->nhmm, item->hmm, cache, &(item->note)) != eslOK) p7_Fail("%s\n", errmsg);
+	  p7_hmm_Destroy(item->hmm);
+	  ++next;
 
-      /// \todo Add use of profillic-p7_builder and command-line args to control calibration.
-      if ((status = p7_Calibrate(hmm, NULL, &r, &bg, NULL, NULL)) != eslOK) esl_fatal("Unexpected error in calibrating the hmm");
+	  /* output any pending hmms as long as the order
+	   * remains the same as read in.
+	   */
+	  while (top != NULL && top->nhmm == next) {
+	    if (output_result(outhmmfp, *byp_bg, errmsg, top->nhmm, top->hmm, cache, &(top->note)) != eslOK) p7_Fail("%s\n", errmsg);
+	    p7_hmm_Destroy(top->hmm);
 
-      if( do_reseeding ) {
-        // For next time, reset the RNG to what it was this time..
-        esl_randomness_Init(r, esl_randomness_GetSeed(r));
+	    tmp = top;
+	    top = tmp->next;
+
+	    tmp->next = empty;
+	    empty     = tmp;
+	    
+	    ++next;
+	  }
+	} else {
+	  /* queue up the hmm until its predecessors have been written */
+	  if (empty != NULL) {
+	    tmp   = empty;
+	    empty = tmp->next;
+	  } else {
+	    ESL_ALLOC_CPP( PENDING_ITEM, tmp, sizeof(PENDING_ITEM));
+	  }
+
+	  tmp->nhmm     = item->nhmm;
+	  tmp->hmm      = item->hmm;
+	  tmp->note     = item->note;
+
+	  /* add the hmm to the pending list */
+	  if (top == NULL || tmp->nhmm < top->nhmm) {
+	    tmp->next = top;
+	    top       = tmp;
+	  } else {
+	    PENDING_ITEM *ptr = top;
+	    while (ptr->next != NULL && tmp->nhmm > ptr->next->nhmm) {
+	      ptr = ptr->next;
+	    }
+	    tmp->next = ptr->next;
+	    ptr->next = tmp;
+	  }
+	}
+
+	item->nhmm      = 0;
+	item->processed = FALSE;
+	item->hmm       = NULL;
       }
+    }
+  }
 
-      if ((status = p7_hmm_Validate(hmm, errmsg, 0.0001))       != eslOK) return status;
-      if ((status = p7_hmmfile_WriteASCII(outhmmfp, -1, hmm)) != eslOK) ESL_FAIL(status, errmsg, "HMM save failed");
-  
-      p7_MeanPositionRelativeEntropy(hmm, bg, &x); 
-      p7_hmm_CompositionKLDist(hmm, bg, &KL, NULL);
-
-      printf("%-6d %-20s %-12s %8d %8.2f %6d %6.2f %6.2f %6.2f %6.2f\n",
-	     nhmm,
-	     hmm->name,
-	     hmm->acc == NULL ? "-" : hmm->acc,
-	     hmm->nseq,
-	     hmm->eff_nseq,
-	     hmm->M,
-	     p7_MeanMatchRelativeEntropy(hmm, bg),
-	     p7_MeanMatchInfo(hmm, bg),
-	     x,
-	     KL);
-
-	     /*	     p7_MeanForwardScore(hmm, bg)); */
+  if (top != NULL) esl_fatal("Top is not empty\n");
 
-      p7_hmm_Destroy(hmm);
+  while (empty != NULL) {
+    tmp   = empty;
+    empty = tmp->next;
+    free(tmp);
+  }
+
+  status = esl_workqueue_ReaderUpdate(queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+
+  if (sstatus == eslEOF)
+    {
+      /* wait for all the threads to complete */
+      esl_threads_WaitForFinish(obj);
+      esl_workqueue_Complete(queue);  
     }
+  return;
 
-  p7_bg_Destroy(bg);
-  esl_alphabet_Destroy(abc);
-  p7_hmmfile_Close(hfp);
-  if (outhmmfp != NULL) fclose(outhmmfp);
- esl_getopts_Destroy(go);
-  exit(0);
+ ERROR:
+  p7_Fail("thread_loop failed: memory allocation problem");
+}
+
+/**
+ * pipeline_thread
+ *
+ * A calibration worker: calibrate each work item's HMM with this
+ * worker's own RNG and bg.
+ */
+static void 
+pipeline_thread(void *arg)
+{
+  int           workeridx;
+  int           status;
+
+  WORK_ITEM    *item;
+  void         *newItem;
+
+  WORKER_INFO  *info;
+  ESL_THREADS  *obj;
+
+  obj = (ESL_THREADS *) arg;
+  esl_threads_Started(obj, &workeridx);
+
+  info = (WORKER_INFO *) esl_threads_GetData(obj, workeridx);
+
+  status = esl_workqueue_WorkerUpdate(info->queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  /* loop until all blocks have been processed */
+  item = (WORK_ITEM *) newItem;
+  while (item->hmm != NULL)
+    {
+      if (calibrate_hmm(info, item->hmm, &(item->note)) != eslOK) esl_fatal("Unexpected error in calibrating the hmm");
+      item->processed = TRUE;
+
+      status = esl_workqueue_WorkerUpdate(info->queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue worker failed");
+
+      item = (WORK_ITEM *) newItem;
+    }
+
+  status = esl_workqueue_WorkerUpdate(info->queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+#endif   /* HMMER_THREADS */
+
+/**
+ * read_failure
+ *
+ * Report a non-OK, non-EOF status from p7_hmmfile_Read() and exit.
+ */
+static void
+read_failure(int status, char *hmmfile)
+{
+  if      (status == eslEOD)       esl_fatal("read failed, HMM file %s may be truncated?", hmmfile);
+  else if (status == eslEFORMAT)   esl_fatal("bad file format in HMM file %s",             hmmfile);
+  else if (status == eslEINCOMPAT) esl_fatal("HMM file %s contains different alphabets",   hmmfile);
+  else                             esl_fatal("Unexpected error in reading HMMs from %s",   hmmfile);
+}
+
+/**
+ * calibrate_hmm
+ *
+ * Calibrate one <hmm> with worker <info>'s RNG and bg (the bg is
+ * created here, from the HMM's alphabet, the first time it is needed).
+ * With --cache, a calibration found in the cache is restored instead;
+ * <note> says which happened, and under what key.
+ */
+static int
+calibrate_hmm(WORKER_INFO *info, P7_HMM *hmm, CALIBRATION_NOTE *note)
+{
+  int status;
+
+  note->key    = 0;
+  note->cached = FALSE;
+  if (info->cache != NULL) {
+    note->key = profillic_calibration_cache_Key(hmm, NULL, esl_randomness_GetSeed(info->r));
+    if (profillic_calibration_cache_Lookup(info->cache, note->key, hmm->evparam) == eslOK) {
+      hmm->flags  |= p7H_STATS;
+      note->cached = TRUE;
+      return eslOK;
+    }
+  }
+
+  if (info->bg == NULL) info->bg = p7_bg_Create(hmm->abc);
+
+  /// \todo Add use of profillic-p7_builder and command-line args to control calibration.
+  if ((status = p7_Calibrate(hmm, NULL, &(info->r), &(info->bg), NULL, NULL)) != eslOK) return status;
+
+  if( info->do_reseeding ) {
+    // For next time, reset the RNG to what it was this time..
+    esl_randomness_Init(info->r, esl_randomness_GetSeed(info->r));
+  }
+  return eslOK;
+}
+
+/**
+ * output_result
+ *
+ * Validate and save one calibrated <hmm> to <outhmmfp>, and print its
+ * line of stats (number <nhmm>; against <bg>, none if <bg> is NULL)
+ * to stdout.  With a <cache>, tally the
+ * hit or miss that <note> records, adding a new calibration to it.
+ */
+static int
+output_result(FILE *outhmmfp, P7_BG *bg, char *errbuf, int nhmm, P7_HMM *hmm, PROFILLIC_CALIBRATION_CACHE *cache, const CALIBRATION_NOTE *note)
+{
+  PROFILLIC_HMM_STATS stats;
+  int              status;
+
+  if ((status = p7_hmm_Validate(hmm, errbuf, 0.0001))       != eslOK) return status;
+  if ((status = p7_hmmfile_WriteASCII(outhmmfp, -1, hmm)) != eslOK) ESL_FAIL(status, errbuf, "HMM save failed");
+
+  if (cache != NULL) {
+    if (note->cached) cache->nhit++;
+    else {
+      cache->nmiss++;
+      if ((status = profillic_calibration_cache_Add(cache, note->key, hmm->evparam, errbuf)) != eslOK) return status;
+    }
+  }
+  
+  if ((status = profillic_hmm_Stats(hmm, bg, &stats)) != eslOK) ESL_FAIL(status, errbuf, "Failed to compute the stats of HMM %s", hmm->name);
+  profillic_hmm_PrintStats(stdout, nhmm, hmm, &stats);
+  return eslOK;
 }
@@ -14,8 +14,22 @@
 Usage: profillic-hmmcopytransitions [-options] <input hmmfile for emissions> <input hmmfile for transitions> <output hmmfile>
 
 Options:
-  -h : show brief help on version and usage
+  -h        : show brief help on version and usage
+  --byname  : pair each emissions HMM with the transitions HMM of the same name
+  --nostats : don't compute the stats columns of each model's line (print "-")
+  --cpu <n> : number of parallel CPU workers for multithreads
  * </pre>
+ *
+ * Every HMM in <input hmmfile for emissions> gets the transitions of its
+ * partner in <input hmmfile for transitions>: the HMM at the same
+ * position in that file, or (with --byname) the one with the same name.
+ * The hybrids are written to <output hmmfile> in the order read.  With
+ * --cpu (or HMMER_NCPU) they are made, validated and formatted by a pool
+ * of worker threads.
+ *
+ * Any of the HMM files ending in ".gz" or ".zst" is read or written
+ * gzip- or zstd-compressed, through a gzip or zstd process (see
+ * profillic-compress.hpp).
  */
 extern "C" {
 #include "p7_config.h"
@@ -31,13 +45,25 @@ extern "C" {
 #include "esl_getopts.h"
 #include "esl_vectorops.h"
   /// \note TAH 8/12 Workaround to avoid use of C++ keyword "new" in esl_msa.h
+#include "esl_keyhash.h"
 #define new _new
 #include "hmmer.h"
 #undef new
 }
 
+#ifdef HMMER_THREADS
+#include <unistd.h>
+extern "C" {
+#include "esl_threads.h"
+#include "esl_workqueue.h"
+}
+#endif /*HMMER_THREADS*/
+
 /* ////////////// For profillic-hmmer ////////////////////////////////// */
 #include "profillic-hmmer.hpp"
+#include "profillic-transitions.hpp"
+#include "profillic-modelstats.hpp"
+#include "profillic-compress.hpp"
 //#include "profillic-p7_builder.hpp"
 
 // Updated notices:
@@ -115,14 +141,72 @@ profillic_p7_banner(FILE *fp, char *progname, char *banner)
 }
 /* ////////////// End profillic-hmmer ////////////////////////////////// */
 
+/* The transitions HMMs, summarized and indexed by name, for --byname. */
+typedef struct {
+  ESL_KEYHASH           *kh;     /* HMM names; key i is trans[i] */
+  PROFILLIC_TRANSITIONS *trans;
+} TRANSITIONS_LIBRARY;
+
+/* One hybrid HMM, ready to be written: the model as ASCII text, and
+ * its stats line's numbers.  Workers fill these in; the writer writes
+ * them in input order.
+ */
+typedef struct {
+  char                *text;    /* the HMM in ASCII save format (malloc'ed by open_memstream()) */
+  size_t               n;       /* length of <text>                                             */
+  PROFILLIC_HMM_STATS  stats;   /* its stats line (not set with --nostats)                      */
+} HYBRID_HMM;
+
+#ifdef HMMER_THREADS
+typedef struct {
+  ESL_WORK_QUEUE   *queue;
+} WORKER_INFO;
+
+typedef struct {
+  int                          nhmm;
+  int                          processed;
+  P7_HMM                      *hmm;
+  P7_HMM                      *transhmm;   /* its partner, when pairing by position; else NULL  */
+  const PROFILLIC_TRANSITIONS *trans;      /* its partner's summary, with --byname; else NULL   */
+  P7_BG                       *bg;         /* the run's one bg (read-only for workers); NULL with --nostats */
+  HYBRID_HMM                   result;
+} WORK_ITEM;
+
+typedef struct _pending_s {
+  int                nhmm;
+  P7_HMM            *hmm;
+  HYBRID_HMM         result;
+  struct _pending_s *next;
+} PENDING_ITEM;
+#endif /*HMMER_THREADS*/
+
 static ESL_OPTIONS options[] = {
   /* name           type      default  env  range     toggles   reqs   incomp  help   docgroup*/
   { "-h",        eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "show brief help on version and usage",            0 },
+  { "--byname",  eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "pair each emissions HMM with the transitions HMM of the same name", 0 },
+  { "--nostats", eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "don't compute the stats columns of each model's line", 0 },
+#ifdef HMMER_THREADS 
+  { "--cpu",     eslARG_INT,    NULL,"HMMER_NCPU","n>=0",NULL,     NULL,  NULL,  "number of parallel CPU workers for multithreads",       0 },
+#endif
   {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
 static char usage[]  = "[-options] <input hmmfile for emissions> <input hmmfile for transitions> <output hmmfile>";
 static char banner[] = "create a hybrid of two HMMs with emissions from one, averaged transitions from the other";
+
+static void serial_loop    (P7_HMMFILE *hfp, char *hmmfile, P7_HMMFILE *transhfp, char *transhmmfile, TRANSITIONS_LIBRARY *lib, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, char *outhmmfile);
+#ifdef HMMER_THREADS
+static void thread_loop    (ESL_THREADS *obj, ESL_WORK_QUEUE *queue, P7_HMMFILE *hfp, char *hmmfile, P7_HMMFILE *transhfp, char *transhmmfile, TRANSITIONS_LIBRARY *lib, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, char *outhmmfile);
+static void pipeline_thread(void *arg);
+#endif /*HMMER_THREADS*/
+
+static void read_failure   (int status, char *hmmfile);
+static int  load_library   (P7_HMMFILE *transhfp, char *transhmmfile, ESL_ALPHABET **byp_abc, TRANSITIONS_LIBRARY *lib);
+static void find_partner   (P7_HMM *hmm, P7_HMMFILE *transhfp, char *transhmmfile, TRANSITIONS_LIBRARY *lib, ESL_ALPHABET **byp_abc,
+                            P7_HMM **ret_transhmm, const PROFILLIC_TRANSITIONS **ret_trans);
+static int  copy_hmm       (P7_HMM *hmm, P7_HMM *transhmm, const PROFILLIC_TRANSITIONS *trans, P7_BG *bg, char *errbuf, HYBRID_HMM *result);
+static int  output_result  (FILE *outhmmfp, char *outhmmfile, char *errbuf, int nhmm, P7_HMM *hmm, HYBRID_HMM *result);
+
 /**
  * int main(int argc, char **argv)
  * main driver
@@ -131,31 +215,36 @@ int
 main(int argc, char **argv)
 {
   ESL_GETOPTS     *go	   = NULL;      /* command line processing                   */
-  ESL_ALPHABET    *abc     = NULL;
+  ESL_ALPHABET    *abc     = NULL;      /* one alphabet, shared by all HMMs read     */
   char            *hmmfile = NULL;
   char            *transhmmfile = NULL;
   char            *outhmmfile = NULL;
   P7_HMMFILE      *hfp     = NULL;
   P7_HMMFILE      *transhfp     = NULL;
+  FILE            *hpipe   = NULL;      /* decompressor <hfp> reads from, or NULL      */
+  FILE            *transhpipe   = NULL; /* decompressor <transhfp> reads from, or NULL */
   FILE         *outhmmfp;          /* HMM output file handle                  */
-  P7_HMM          *hmm     = NULL;
-  P7_HMM          *transhmm     = NULL;
-  P7_BG           *bg      = NULL;
-  int              nhmm;	
-  double           x;
-  float            KL;
+  P7_BG           *bg      = NULL;      /* one bg, for the stats lines               */
+  int              do_stats;            /* FALSE with --nostats                      */
+  TRANSITIONS_LIBRARY  lib;             /* --byname: the summarized transitions HMMs */
+  TRANSITIONS_LIBRARY *lib_ptr = NULL;
   int              status;
   char             errbuf[eslERRBUFSIZE];
 
-  float average_internal_transitions[ p7H_NTRANSITIONS ];
-  int k;
-
-  char        errmsg[eslERRBUFSIZE];
+  int              ncpus    = 0;
+#ifdef HMMER_THREADS
+  WORKER_INFO     *info     = NULL;
+  WORK_ITEM       *item     = NULL;
+  ESL_THREADS     *threadObj= NULL;
+  ESL_WORK_QUEUE  *queue    = NULL;
+  int              i;
+#endif
 
   /* Process the command line options.
    */
   go = esl_getopts_Create(options);
-  if (esl_opt_ProcessCmdline(go, argc, argv) != eslOK || 
+  if (esl_opt_ProcessEnvironment(go)         != eslOK ||
+      esl_opt_ProcessCmdline(go, argc, argv) != eslOK || 
       esl_opt_VerifyConfig(go)               != eslOK)
     {
       printf("Failed to parse command line: %s\n", go->errbuf);
@@ -204,99 +293,471 @@ main(int argc, char **argv)
     }
 
   profillic_p7_banner(stdout, argv[0], banner);
+  if (esl_opt_IsUsed(go, "--byname"))          printf("# HMMs are paired:                  by name\n");
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--cpu"))             printf("# number of worker threads:         %d\n", esl_opt_GetInteger(go, "--cpu"));
+#endif
+  if (esl_opt_IsUsed(go, "--nostats"))         printf("# model stats:                      not computed\n");
+  do_stats = ! esl_opt_GetBoolean(go, "--nostats");
   
   /* Initializations: open the input HMM file (for emissions) for reading
    */
-  status = p7_hmmfile_OpenE(hmmfile, NULL, &hfp, errbuf);
+  status = profillic_hmmfile_OpenE(hmmfile, &hfp, &hpipe, errbuf);
   if      (status == eslENOTFOUND) p7_Fail("File existence/permissions problem in trying to open emissions HMM file %s.\n%s\n", hmmfile, errbuf);
   else if (status == eslEFORMAT)   p7_Fail("File format problem in trying to open emissions HMM file %s.\n%s\n",                hmmfile, errbuf);
   else if (status != eslOK)        p7_Fail("Unexpected error %d in opening emissions HMM file %s.\n%s\n",               status, hmmfile, errbuf);  
 
   /* Initializations: open the input HMM file (for transitions) for reading
    */
-  status = p7_hmmfile_Open(transhmmfile, NULL, &transhfp);
-  if      (status == eslENOTFOUND) p7_Fail("File existence/permissions problem in trying to open transitions HMM file %s.\n%s\n", hmmfile, errbuf);
-  else if (status == eslEFORMAT)   p7_Fail("File format problem in trying to open transitions HMM file %s.\n%s\n",                hmmfile, errbuf);
-  else if (status != eslOK)        p7_Fail("Unexpected error %d in opening transitions HMM file %s.\n%s\n",               status, hmmfile, errbuf);  
+  status = profillic_hmmfile_OpenE(transhmmfile, &transhfp, &transhpipe, errbuf);
+  if      (status == eslENOTFOUND) p7_Fail("File existence/permissions problem in trying to open transitions HMM file %s.\n%s\n", transhmmfile, errbuf);
+  else if (status == eslEFORMAT)   p7_Fail("File format problem in trying to open transitions HMM file %s.\n%s\n",                transhmmfile, errbuf);
+  else if (status != eslOK)        p7_Fail("Unexpected error %d in opening transitions HMM file %s.\n%s\n",               status, transhmmfile, errbuf);  
+
+  /* With --byname, the whole transitions file is read (and summarized) up front
+   */
+  if (esl_opt_GetBoolean(go, "--byname")) {
+    if (load_library(transhfp, transhmmfile, &abc, &lib) != eslOK) p7_Fail("Failed to index transitions HMM file %s\n", transhmmfile);
+    lib_ptr = &lib;
+  }
 
   /* Initializations: open the output HMM file for writing
    */
-  if ((outhmmfp = fopen(outhmmfile, "w")) == NULL) ESL_FAIL(status, errmsg, "Failed to open HMM file %s for writing", outhmmfile);
+  if ((outhmmfp = profillic_ofile_Open(outhmmfile)) == NULL) p7_Fail("Failed to open HMM file %s for writing\n", outhmmfile);
+
+#ifdef HMMER_THREADS
+  /* initialize thread data */
+  if (esl_opt_IsOn(go, "--cpu")) ncpus = esl_opt_GetInteger(go, "--cpu");
+  else                                   esl_threads_CPUCount(&ncpus);
+
+  if (ncpus > 0)
+    {
+      threadObj = esl_threads_Create(&pipeline_thread);
+      queue = esl_workqueue_Create(ncpus * 2);
+
+      ESL_ALLOC_CPP( WORKER_INFO, info, sizeof(*info) * ncpus);
+      for (i = 0; i < ncpus; ++i)
+	{
+	  info[i].queue = queue;
+	  esl_threads_AddThread(threadObj, &info[i]);
+	}
+
+      for (i = 0; i < ncpus * 2; ++i)
+	{
+	  ESL_ALLOC_CPP( WORK_ITEM, item, sizeof(*item));
+
+	  item->nhmm        = 0;
+	  item->processed   = FALSE;
+	  item->hmm         = NULL;
+	  item->transhmm    = NULL;
+	  item->trans       = NULL;
+	  item->bg          = NULL;
+	  item->result.text = NULL;
+
+	  status = esl_workqueue_Init(queue, item);
+	  if (status != eslOK) esl_fatal("Failed to add block to work queue");
+	}
+    }
+#endif
 
   /* Main body: read HMMs one at a time, print one line of stats
    */
   printf("#\n");
-  printf("# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "idx",  "name",                 "accession",    "nseq",     "eff_nseq", "M",      "relent", "info",   "p relE", "compKL");
-  printf("# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "----", "--------------------", "------------", "--------", "--------", "------", "------", "------", "------", "------");
+  profillic_hmm_PrintStatsHeader(stdout);
 
-  nhmm = 0;
-  if ((status = p7_hmmfile_Read(hfp, &abc, &hmm)) != eslEOF) 
+#ifdef HMMER_THREADS
+  if (ncpus > 0)  thread_loop(threadObj, queue, hfp, hmmfile, transhfp, transhmmfile, lib_ptr, &abc, &bg, do_stats, outhmmfp, outhmmfile);
+  else            serial_loop(hfp, hmmfile, transhfp, transhmmfile, lib_ptr, &abc, &bg, do_stats, outhmmfp, outhmmfile);
+#else
+  serial_loop(hfp, hmmfile, transhfp, transhmmfile, lib_ptr, &abc, &bg, do_stats, outhmmfp, outhmmfile);
+#endif
+
+#ifdef HMMER_THREADS
+  if (ncpus > 0)
     {
-      if      (status == eslEOD)       esl_fatal("read failed, HMM file %s may be truncated?", hmmfile);
-      else if (status == eslEFORMAT)   esl_fatal("bad file format in HMM file %s",             hmmfile);
-      else if (status == eslEINCOMPAT) esl_fatal("HMM file %s contains different alphabets",   hmmfile);
-      else if (status != eslOK)        esl_fatal("Unexpected error in reading HMMs from %s",   hmmfile);
+      esl_workqueue_Reset(queue);
+      while (esl_workqueue_Remove(queue, (void **) &item) == eslOK)
+	{
+	  free(item);
+	}
+      esl_workqueue_Destroy(queue);
+      esl_threads_Destroy(threadObj);
+      free(info);
+    }
+#endif
+
+  if (profillic_ofile_Close(outhmmfp, outhmmfile) != 0) p7_Fail("Failed to finish HMM file %s\n", outhmmfile);
+
+  if (lib_ptr != NULL) { esl_keyhash_Destroy(lib.kh); free(lib.trans); }
+  if (bg != NULL) p7_bg_Destroy(bg);
+  esl_alphabet_Destroy(abc);
+  if (profillic_hmmfile_Close(hfp, hpipe)           != eslOK) p7_Fail("Failed to decompress emissions HMM file %s\n",   hmmfile);
+  if (profillic_hmmfile_Close(transhfp, transhpipe) != eslOK) p7_Fail("Failed to decompress transitions HMM file %s\n", transhmmfile);
+  esl_getopts_Destroy(go);
+  exit(0);
+
+#ifdef HMMER_THREADS
+ ERROR:
+  p7_Fail("profillic-hmmcopytransitions failed: memory allocation problem");
+#endif
+}
+
+/**
+ * serial_loop
+ *
+ * Read each emissions HMM and its partner, make the hybrid, and write
+ * it.  The stats bg is only made if <do_stats>.
+ */
+static void
+serial_loop(P7_HMMFILE *hfp, char *hmmfile, P7_HMMFILE *transhfp, char *transhmmfile, TRANSITIONS_LIBRARY *lib, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, char *outhmmfile)
+{
+  P7_HMM                      *hmm      = NULL;
+  P7_HMM                      *transhmm = NULL;
+  const PROFILLIC_TRANSITIONS *trans    = NULL;
+  HYBRID_HMM                   result;
+  int                          nhmm     = 0;
+  char                         errmsg[eslERRBUFSIZE];
+  int                          status;
+
+  while ((status = p7_hmmfile_Read(hfp, byp_abc, &hmm)) != eslEOF) 
+    {
+      if (status != eslOK) read_failure(status, hmmfile);
       nhmm++;
 
-      status = p7_hmmfile_Read(transhfp, &abc, &transhmm);
+      if (do_stats && *byp_bg == NULL) *byp_bg = p7_bg_Create(*byp_abc);
 
-      if      (status == eslEOD)       esl_fatal("read failed, HMM file %s may be truncated?", transhmmfile);
-      else if (status == eslEFORMAT)   esl_fatal("bad file format in HMM file %s",             transhmmfile);
-      else if (status == eslEINCOMPAT) esl_fatal("HMM file %s contains different alphabets",   transhmmfile);
-      else if (status == eslEOF)       esl_fatal("read failed, no HMM in file %s may be truncated?", transhmmfile);
-      else if (status != eslOK)        esl_fatal("Unexpected error in reading HMMs from %s",   transhmmfile);
+      find_partner(hmm, transhfp, transhmmfile, lib, byp_abc, &transhmm, &trans);
+      if (copy_hmm(hmm, transhmm, trans, *byp_bg, errmsg, &result)             != eslOK) p7_Fail("%s\n", errmsg);
+      if (output_result(outhmmfp, outhmmfile, errmsg, nhmm, hmm, &result)      != eslOK) p7_Fail("%s\n", errmsg);
 
-      if (bg == NULL) bg = p7_bg_Create(abc);
+      free(result.text);
+      if (transhmm != NULL) p7_hmm_Destroy(transhmm);
+      p7_hmm_Destroy(hmm);
+    }
+}
 
-      // First get the average of the transitions from transhmm.
-      esl_vec_FSet(average_internal_transitions, p7H_NTRANSITIONS, 0.);
-      for( k = 1; k < transhmm->M; k++ ) {
-        esl_vec_FAdd(average_internal_transitions, transhmm->t[k], p7H_NTRANSITIONS);
-      }
-      // Match transitions
-      esl_vec_FNorm(average_internal_transitions, 3);
-      // Insert transitions
-      esl_vec_FNorm(average_internal_transitions + 3, 2);
-      // Delete transitions
-      esl_vec_FNorm(average_internal_transitions + 5, 2);
-
-      // Ok now set them in the other hmm.
-      for( k = 1; k < hmm->M; k++ ) {
-        esl_vec_FCopy( average_internal_transitions, p7H_NTRANSITIONS, hmm->t[k] );
+#ifdef HMMER_THREADS
+/**
+ * thread_loop
+ *
+ * The reader and ordered writer for the threaded version: read each
+ * emissions HMM (and find its partner) into a work item for the
+ * pipeline_thread()s, and write the hybrids (and their stats lines) out
+ * in the order they were read.
+ */
+static void
+thread_loop(ESL_THREADS *obj, ESL_WORK_QUEUE *queue, P7_HMMFILE *hfp, char *hmmfile, P7_HMMFILE *transhfp, char *transhmmfile, TRANSITIONS_LIBRARY *lib, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, int do_stats, FILE *outhmmfp, char *outhmmfile)
+{
+  int          status    = eslOK;
+  int          sstatus   = eslOK;
+  int          nhmm      = 0;
+  int          processed = 0;
+  WORK_ITEM   *item;
+  void        *newItem;
+
+  int           next     = 1;
+  PENDING_ITEM *top      = NULL;
+  PENDING_ITEM *empty    = NULL;
+  PENDING_ITEM *tmp      = NULL;
+
+  char        errmsg[eslERRBUFSIZE];
+
+  esl_workqueue_Reset(queue);
+  esl_threads_WaitForStart(obj);
+
+  status = esl_workqueue_ReaderUpdate(queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+      
+  /* Main loop: */
+  item = (WORK_ITEM *) newItem;
+  while (sstatus == eslOK) {
+    sstatus = p7_hmmfile_Read(hfp, byp_abc, &item->hmm);
+    if (sstatus == eslOK) {
+      item->nhmm = ++nhmm;
+      if (do_stats && *byp_bg == NULL) *byp_bg = p7_bg_Create(*byp_abc);
+      item->bg   = *byp_bg;
+      find_partner(item->hmm, transhfp, transhmmfile, lib, byp_abc, &item->transhmm, &item->trans);
+    }
+    else if (sstatus == eslEOF) {
+      item->hmm = NULL;	/* an empty item tells the workers there's nothing left */
+      if (processed < nhmm) sstatus = eslOK;
+    }
+    else read_failure(sstatus, hmmfile);
+	  
+    if (sstatus == eslOK) {
+      status = esl_workqueue_ReaderUpdate(queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue reader failed");
+
+      /* process any results */
+      item = (WORK_ITEM *) newItem;
+      if (item->processed == TRUE) {
+	++processed;
+
+	/* keep the output order the same as the input order */
+	if (item->nhmm == next) {
+	  if (output_result(outhmmfp, outhmmfile, errmsg, item->nhmm, item->hmm, &(item->result)) != eslOK) p7_Fail("%s\n", errmsg);
+	  free(item->result.text);
+	  p7_hmm_Destroy(item->hmm);
+	  ++next;
+
+	  /* output any pending HMMs as long as the order
+	   * remains the same as read in.
+	   */
+	  while (top != NULL && top->nhmm == next) {
+	    if (output_result(outhmmfp, outhmmfile, errmsg, top->nhmm, top->hmm, &(top->result)) != eslOK) p7_Fail("%s\n", errmsg);
+	    free(top->result.text);
+	    p7_hmm_Destroy(top->hmm);
+
+	    tmp = top;
+	    top = tmp->next;
+
+	    tmp->next = empty;
+	    empty     = tmp;
+	    
+	    ++next;
+	  }
+	} else {
+	  /* queue up the HMM until its predecessors have been written */
+	  if (empty != NULL) {
+	    tmp   = empty;
+	    empty = tmp->next;
+	  } else {
+	    ESL_ALLOC_CPP( PENDING_ITEM, tmp, sizeof(PENDING_ITEM));
+	  }
+
+	  tmp->nhmm   = item->nhmm;
+	  tmp->hmm    = item->hmm;
+	  tmp->result = item->result;
+
+	  /* add the HMM to the pending list */
+	  if (top == NULL || tmp->nhmm < top->nhmm) {
+	    tmp->next = top;
+	    top       = tmp;
+	  } else {
+	    PENDING_ITEM *ptr = top;
+	    while (ptr->next != NULL && tmp->nhmm > ptr->next->nhmm) {
+	      ptr = ptr->next;
+	    }
+	    tmp->next = ptr->next;
+	    ptr->next = tmp;
+	  }
+	}
+
+	item->nhmm        = 0;
+	item->processed   = FALSE;
+	item->hmm         = NULL;
+	item->transhmm    = NULL;
+	item->trans       = NULL;
+	item->result.text = NULL;
       }
+    }
+  }
 
-      // Also copy the transitions from the first and last positions (which are non-internal so don't get averaged).
-        esl_vec_FCopy( transhmm->t[0], p7H_NTRANSITIONS, hmm->t[0] );
-        esl_vec_FCopy( transhmm->t[ transhmm->M ], p7H_NTRANSITIONS, hmm->t[ hmm->M ] );
+  if (top != NULL) esl_fatal("Top is not empty\n");
 
-      if ((status = p7_hmm_Validate(hmm, errmsg, 0.0001))       != eslOK) return status;
-      if ((status = p7_hmmfile_WriteASCII(outhmmfp, -1, hmm)) != eslOK) ESL_FAIL(status, errmsg, "HMM save failed");
-  
-      p7_MeanPositionRelativeEntropy(hmm, bg, &x); 
-      p7_hmm_CompositionKLDist(hmm, bg, &KL, NULL);
-
-      printf("%-6d %-20s %-12s %8d %8.2f %6d %6.2f %6.2f %6.2f %6.2f\n",
-	     nhmm,
-	     hmm->name,
-	     hmm->acc == NULL ? "-" : hmm->acc,
-	     hmm->nseq,
-	     hmm->eff_nseq,
-	     hmm->M,
-	     p7_MeanMatchRelativeEntropy(hmm, bg),
-	     p7_MeanMatchInfo(hmm, bg),
-	     x,
-	     KL);
-
-	     /*	     p7_MeanForwardScore(hmm, bg)); */
+  while (empty != NULL) {
+    tmp   = empty;
+    empty = tmp->next;
+    free(tmp);
+  }
 
-      p7_hmm_Destroy(hmm);
+  status = esl_workqueue_ReaderUpdate(queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+
+  if (sstatus == eslEOF)
+    {
+      /* wait for all the threads to complete */
+      esl_threads_WaitForFinish(obj);
+      esl_workqueue_Complete(queue);  
     }
+  return;
 
-  p7_bg_Destroy(bg);
-  esl_alphabet_Destroy(abc);
-  p7_hmmfile_Close(hfp);
-  p7_hmmfile_Close(transhfp);
-  if (outhmmfp != NULL) fclose(outhmmfp);
- esl_getopts_Destroy(go);
-  exit(0);
+ ERROR:
+  p7_Fail("thread_loop failed: memory allocation problem");
+}
+
+/**
+ * pipeline_thread
+ *
+ * A hybrid-making worker: give each work item's HMM its partner's
+ * transitions, validate it, and format it for the writer.  The
+ * partner HMM, if any, is destroyed here.
+ */
+static void 
+pipeline_thread(void *arg)
+{
+  int           workeridx;
+  int           status;
+
+  WORK_ITEM    *item;
+  void         *newItem;
+
+  WORKER_INFO  *info;
+  ESL_THREADS  *obj;
+
+  char          errmsg[eslERRBUFSIZE];
+
+  obj = (ESL_THREADS *) arg;
+  esl_threads_Started(obj, &workeridx);
+
+  info = (WORKER_INFO *) esl_threads_GetData(obj, workeridx);
+
+  status = esl_workqueue_WorkerUpdate(info->queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  /* loop until all blocks have been processed */
+  item = (WORK_ITEM *) newItem;
+  while (item->hmm != NULL)
+    {
+      if (copy_hmm(item->hmm, item->transhmm, item->trans, item->bg, errmsg, &(item->result)) != eslOK) p7_Fail("%s\n", errmsg);
+      if (item->transhmm != NULL) p7_hmm_Destroy(item->transhmm);
+      item->transhmm  = NULL;
+      item->processed = TRUE;
+
+      status = esl_workqueue_WorkerUpdate(info->queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue worker failed");
+
+      item = (WORK_ITEM *) newItem;
+    }
+
+  status = esl_workqueue_WorkerUpdate(info->queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+#endif   /* HMMER_THREADS */
+
+/**
+ * read_failure
+ *
+ * Report a non-OK, non-EOF status from p7_hmmfile_Read() and exit.
+ */
+static void
+read_failure(int status, char *hmmfile)
+{
+  if      (status == eslEOD)       esl_fatal("read failed, HMM file %s may be truncated?", hmmfile);
+  else if (status == eslEFORMAT)   esl_fatal("bad file format in HMM file %s",             hmmfile);
+  else if (status == eslEINCOMPAT) esl_fatal("HMM file %s contains different alphabets",   hmmfile);
+  else                             esl_fatal("Unexpected error in reading HMMs from %s",   hmmfile);
+}
+
+/**
+ * load_library
+ *
+ * For --byname: read every HMM in <transhfp>, keeping only its
+ * transition summary, indexed by name in <lib>.  The caller destroys
+ * <lib->kh> and frees <lib->trans>.
+ */
+static int
+load_library(P7_HMMFILE *transhfp, char *transhmmfile, ESL_ALPHABET **byp_abc, TRANSITIONS_LIBRARY *lib)
+{
+  P7_HMM *transhmm = NULL;
+  int     nalloc   = 0;
+  int     idx;
+  int     status;
+
+  lib->trans = NULL;
+  if ((lib->kh = esl_keyhash_Create()) == NULL) { status = eslEMEM; goto ERROR; }
+
+  while ((status = p7_hmmfile_Read(transhfp, byp_abc, &transhmm)) != eslEOF) 
+    {
+      if (status != eslOK) read_failure(status, transhmmfile);
+
+      status = esl_keyhash_Store(lib->kh, transhmm->name, -1, &idx);
+      if      (status == eslEDUP) esl_fatal("HMM name %s appears more than once in transitions HMM file %s", transhmm->name, transhmmfile);
+      else if (status != eslOK)   goto ERROR;
+
+      if (idx >= nalloc) {
+	nalloc = (nalloc == 0 ? 256 : nalloc * 2);
+	ESL_REALLOC_CPP( PROFILLIC_TRANSITIONS, lib->trans, sizeof(PROFILLIC_TRANSITIONS) * nalloc);
+      }
+      profillic_hmm_SummarizeTransitions(transhmm, &(lib->trans[idx]));
+
+      p7_hmm_Destroy(transhmm);
+      transhmm = NULL;
+    }
+  return eslOK;
+
+ ERROR:
+  if (transhmm   != NULL) p7_hmm_Destroy(transhmm);
+  if (lib->kh    != NULL) esl_keyhash_Destroy(lib->kh);
+  if (lib->trans != NULL) free(lib->trans);
+  lib->kh    = NULL;
+  lib->trans = NULL;
+  return status;
+}
+
+/**
+ * find_partner
+ *
+ * Find <hmm>'s transitions partner: the next HMM in <transhfp>
+ * (returned in <*ret_transhmm>, for the caller to destroy) or, with a
+ * <lib>, the summary of the one of the same name (in <*ret_trans>).
+ * Exits if there is none.
+ */
+static void
+find_partner(P7_HMM *hmm, P7_HMMFILE *transhfp, char *transhmmfile, TRANSITIONS_LIBRARY *lib, ESL_ALPHABET **byp_abc,
+	     P7_HMM **ret_transhmm, const PROFILLIC_TRANSITIONS **ret_trans)
+{
+  int idx;
+  int status;
+
+  *ret_transhmm = NULL;
+  *ret_trans    = NULL;
+  if (lib != NULL) {
+    if (esl_keyhash_Lookup(lib->kh, hmm->name, -1, &idx) != eslOK) esl_fatal("no HMM named %s in transitions HMM file %s", hmm->name, transhmmfile);
+    *ret_trans = &(lib->trans[idx]);
+  } else {
+    status = p7_hmmfile_Read(transhfp, byp_abc, ret_transhmm);
+    if      (status == eslEOF) esl_fatal("read failed, no HMM in file %s to pair with %s; may be truncated?", transhmmfile, hmm->name);
+    else if (status != eslOK)  read_failure(status, transhmmfile);
+  }
+}
+
+/**
+ * copy_hmm
+ *
+ * Give <hmm> the transitions of <transhmm> (or, if that is <NULL>, of
+ * summary <trans>), validate it, and fill in <result> with it formatted
+ * for the writer and its stats (against <bg>; none if <bg> is NULL);
+ * the caller frees <result->text>.
+ */
+static int
+copy_hmm(P7_HMM *hmm, P7_HMM *transhmm, const PROFILLIC_TRANSITIONS *trans, P7_BG *bg, char *errbuf, HYBRID_HMM *result)
+{
+  FILE *mfp = NULL;
+  int   status;
+
+  result->text = NULL;
+  result->n    = 0;
+
+  // Internal transitions get the partner's average; first and last are copied as they are.
+  if (transhmm != NULL) profillic_hmm_CopyTransitions(hmm, transhmm);
+  else                  profillic_hmm_ApplyTransitions(hmm, trans);
+
+  if ((status = p7_hmm_Validate(hmm, errbuf, 0.0001)) != eslOK) return status;
+
+  if ((mfp = open_memstream(&(result->text), &(result->n))) == NULL) ESL_FAIL(eslEMEM, errbuf, "Failed to open a memory stream for HMM %s", hmm->name);
+  status = p7_hmmfile_WriteASCII(mfp, -1, hmm);
+  if (fclose(mfp) != 0 && status == eslOK) status = eslEMEM;
+  if (status != eslOK) ESL_FAIL(status, errbuf, "HMM save failed for %s", hmm->name);
+
+  if ((status = profillic_hmm_Stats(hmm, bg, &(result->stats))) != eslOK) ESL_FAIL(status, errbuf, "Failed to compute the stats of HMM %s", hmm->name);
+  return eslOK;
+}
+
+/**
+ * output_result
+ *
+ * Write one hybrid <hmm> (number <nhmm>, formatted in <result>) to
+ * <outhmmfp>, and print its line of stats to stdout.
+ */
+static int
+output_result(FILE *outhmmfp, char *outhmmfile, char *errbuf, int nhmm, P7_HMM *hmm, HYBRID_HMM *result)
+{
+  if (fwrite(result->text, 1, result->n, outhmmfp) != result->n) ESL_FAIL(eslEWRITE, errbuf, "Failed to write HMM file %s", outhmmfile);
+
+  profillic_hmm_PrintStats(stdout, nhmm, hmm, &(result->stats));
+  return eslOK;
 }
@@ -14,8 +14,25 @@
 Usage: profillic-hmmtoprofile [-options] <input hmmfile> <output galosh profile>
 
 Options:
-  -h : show brief help on version and usage
+  -h        : show brief help on version and usage
+  --binary  : write the profiles in binary (memory-mappable) format, not text
+  --outdir  : <output> is a directory: write one profile file per HMM
+  --nostats : don't compute the stats columns of each model's line (print "-")
+  --cpu <n> : number of parallel CPU workers for multithreads
 </pre>
+
+Every HMM in <input hmmfile> is converted. By default they all go to
+the one <output galosh profile> file: as text, separated by lines
+containing only "//", or (with --binary) as one binary profile file.
+With --outdir, each goes to <output>/<name>.profile (or <name>.gpb
+with --binary), where <name> is the HMM's name with any '/' turned
+into '_'; an HMM whose <name> was already used in this run gets its
+number (1, 2, ... in <input hmmfile>) appended, as <name>.<n>.profile,
+rather than overwriting the earlier one's file.
+
+An <input hmmfile> or <output galosh profile> ending in ".gz" or
+".zst" is read or written gzip- or zstd-compressed, through a gzip or
+zstd process (see profillic-compress.hpp); binary profiles can't be.
  */
 extern "C" {
 #include "p7_config.h"
@@ -25,6 +42,9 @@ extern "C" {
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 extern "C" {
 #include "easel.h"
@@ -35,10 +55,26 @@ extern "C" {
 #undef new
 }
 
+#ifdef HMMER_THREADS
+#include <unistd.h>
+extern "C" {
+#include "esl_threads.h"
+#include "esl_workqueue.h"
+}
+#endif /*HMMER_THREADS*/
+
 /* ////////////// For profillic-hmmer ////////////////////////////////// */
 #include "profillic-hmmer.hpp"
+#include "profillic-galosh_convert.hpp"
+#include "profillic-profile_binary.hpp"
+#include "profillic-modelstats.hpp"
+#include "profillic-compress.hpp"
 
 #include <iostream>
+#include <sstream>
+#include <set>
+#include <string>
+#include <vector>
 
 // Updated notices:
 #define PROFILLIC_HMMER_VERSION "1.0a"
@@ -114,119 +150,76 @@ profillic_p7_banner(FILE *fp, char *progname, char *banner)
   return;
 }
 
-template <typename ProfileType>
-int
-convert_to_galosh_profile ( P7_HMM * hmm, ProfileType & profile )
-{
-  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
-
-  int status;
-
-  uint32_t pos_i; // Position in profile.  Corresponds to one less than match state pos in HMM.
-  uint32_t res_i;
-  ESL_DSQ hmmer_digitized_residue;
-
-  /* How many match states in the HMM? */
-  if( hmm->M == 0 ) { status = eslENORESULT; goto ERROR; }
-  profile.reinitialize( static_cast<uint32_t>( hmm->M ) );
-
-  profile.zero();
-
-  /// \note NOTE that HMMER3 has a slightly different model, starting in
-  /// Begin rather than in preAlign, and with 3 legal transitions out
-  /// of Begin (one of these is to PreAlign).  The galosh profile model
-  /// begins in preAlign and transitions to Begin, and from there to
-  /// either Match or Delete.  One implication is that galosh profiles
-  /// enforce t[ 0 ][ p7H_MI ] to be the same as t[ 0 ][ p7H_II ], but
-  /// HMMER3 does not.  Another way to say this is that H3 uses affine
-  /// pre-aligns, and prohibits pre-align -to- delete transitions,
-  /// whereas galosh / profillic uses non-affine pre-aligns and allows
-  /// pre-align->delete.
-
-  // fromPreAlign
-  profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toPreAlign ] =
-    hmm->t[ 0 ][ p7H_II ];
-  profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toBegin ] =
-    hmm->t[ 0 ][ p7H_IM ];
-  for( res_i = 0; res_i < seqan::ValueSize<ResidueType>::VALUE; res_i++ ) {
-    hmmer_digitized_residue =
-      esl_abc_DigitizeSymbol( hmm->abc, static_cast<char>( ResidueType( res_i ) ) );
-    // See below where it says "TODO/NOTE"..
-    profile[ galosh::Emission::PreAlignInsertion ][ res_i ] =
-      hmm->ins[ 0 ][ hmmer_digitized_residue ];
-  }
-
-  // fromBegin
-  profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ] =
-    ( hmm->t[ 0 ][ p7H_MM ] / ( 1.0 - hmm->t[ 0 ][ p7H_MI ] ) );
-  profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toDeletion ] =
-    ( 1.0 - profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ] );
-
-  for( pos_i = 0; pos_i < profile.length(); pos_i++ ) {
-//    if( be_verbose ) {
-//      cout << '.';
-//      cout.flush();
-//    }
-    // TODO: If this is too slow, memoize the ResidueType( res_i )s.
-    for( res_i = 0; res_i < seqan::ValueSize<ResidueType>::VALUE; res_i++ ) {
-      hmmer_digitized_residue =
-        esl_abc_DigitizeSymbol( hmm->abc, static_cast<char>( ResidueType( res_i ) ) );
-      profile[ pos_i ][ galosh::Emission::Match ][ res_i ] =
-        hmm->mat[ pos_i + 1 ][ hmmer_digitized_residue ];
-      if( pos_i == ( profile.length() - 1 ) ) {
-        // Use post-align insertions
-        profile[ galosh::Emission::PostAlignInsertion ][ res_i ] =
-          hmm->ins[ pos_i + 1 ][ hmmer_digitized_residue ];
-      } else { // if this is the last position (use post-align insertions) .. else ..
-        profile[ galosh::Emission::Insertion ][ res_i ] +=
-          hmm->ins[ pos_i + 1 ][ hmmer_digitized_residue ];
-      } // End if this is the last position (use post-align insertions) .. else ..
-    } // End foreach res_i
-    if( pos_i == ( profile.length() - 1 ) ) {
-      // Use post-align insertions
-      profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ] =
-        hmm->t[ pos_i + 1 ][ p7H_IM ];
-      profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toPostAlign ] =
-        ( 1.0 - profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ] );
-    } else {  // if this is the last position (use post-align insertions) .. else ..
-      profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toMatch ] +=
-        hmm->t[ pos_i + 1 ][ p7H_MM ];
-      profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toInsertion ] +=
-        hmm->t[ pos_i + 1 ][ p7H_MI ];
-      profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toDeletion ] +=
-        hmm->t[ pos_i + 1 ][ p7H_MD ];
-  
-      profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toMatch ] +=
-        hmm->t[ pos_i + 1 ][ p7H_IM ];
-      profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toInsertion ] +=
-        hmm->t[ pos_i + 1 ][ p7H_II ];
-      profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toMatch ] +=
-        hmm->t[ pos_i + 1 ][ p7H_DM ];
-      profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toDeletion ] +=
-        hmm->t[ pos_i + 1 ][ p7H_DD ];
-    } // End if this is the last position (use post-align insertions) .. else ..
-  } // End foreach pos_i
-
-  // Normalize with 0 as the minimum value we'll allow.  Note that in
-  // profillic and profuse, it's generally 1E-5, so when the profile
-  // is read in by those programs, it might be slightly altered.
-  profile.normalize( 0 );
-  return eslOK;
-
- ERROR:
-  return status;
-} // convert_to_galosh_profile (..)
-
 /* ////////////// End profillic-hmmer ////////////////////////////////// */
 
+/* One converted HMM, ready to be written: the profile as text, or
+ * encoded for the binary format (see profillic-profile_binary.hpp).
+ * Workers create these; the writer writes and deletes them.
+ */
+typedef struct {
+  std::string              text;
+  PROFILLIC_BINARY_RECORD  rec;
+  std::vector<float>       v;
+} CONVERTED_PROFILE;
+
+typedef struct {
+#ifdef HMMER_THREADS
+  ESL_WORK_QUEUE   *queue;
+#endif /*HMMER_THREADS*/
+  int               do_binary;
+} WORKER_INFO;
+
+/* Where the converted profiles go; used only by the (one) writer. */
+typedef struct {
+  char                    *outfile;    /* output file, or directory with --outdir */
+  int                      do_binary;
+  int                      do_outdir;
+  int                      do_stats;   /* FALSE with --nostats                    */
+  FILE                    *fp;         /* text output, unless --outdir            */
+  PROFILLIC_BINARY_WRITER *bw;         /* binary output, unless --outdir          */
+  std::set<std::string>    stems;      /* file names used so far, with --outdir   */
+} OUTPUT_INFO;
+
+#ifdef HMMER_THREADS
+typedef struct {
+  int                nhmm;
+  int                processed;
+  P7_HMM            *hmm;
+  CONVERTED_PROFILE *converted;
+} WORK_ITEM;
+
+typedef struct _pending_s {
+  int                nhmm;
+  P7_HMM            *hmm;
+  CONVERTED_PROFILE *converted;
+  struct _pending_s *next;
+} PENDING_ITEM;
+#endif /*HMMER_THREADS*/
+
 static ESL_OPTIONS options[] = {
   /* name           type      default  env  range     toggles   reqs   incomp  help   docgroup*/
   { "-h",        eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "show brief help on version and usage",            0 },
+  { "--binary",  eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "write binary (memory-mappable) galosh profiles",  0 },
+  { "--outdir",  eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "<output> is a directory: one profile file per HMM", 0 },
+  { "--nostats", eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "don't compute the stats columns of each model's line", 0 },
+#ifdef HMMER_THREADS 
+  { "--cpu",     eslARG_INT,    NULL,"HMMER_NCPU","n>=0",NULL,     NULL,  NULL,  "number of parallel CPU workers for multithreads",       0 },
+#endif
   {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
 static char usage[]  = "[-options] <input hmmfile> <output galosh profile>";
 static char banner[] = "convert HMM to galosh profile";
+
+static void serial_loop    (WORKER_INFO *info, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, OUTPUT_INFO *out);
+#ifdef HMMER_THREADS
+static void thread_loop    (ESL_THREADS *obj, ESL_WORK_QUEUE *queue, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, OUTPUT_INFO *out);
+static void pipeline_thread(void *arg);
+#endif /*HMMER_THREADS*/
+
+static void read_failure   (int status, char *hmmfile);
+static int  convert_hmm    (WORKER_INFO *info, P7_HMM *hmm, CONVERTED_PROFILE **ret_converted);
+static int  output_result  (OUTPUT_INFO *out, P7_BG *bg, char *errbuf, int nhmm, P7_HMM *hmm, CONVERTED_PROFILE *converted);
 /**
  * \fn int main(int argc,char **argv)
  * main driver
@@ -236,24 +229,33 @@ int
 main(int argc, char **argv)
 {
   ESL_GETOPTS     *go	   = NULL;      /**< command line processing                   */
-  ESL_ALPHABET    *abc     = NULL;
+  ESL_ALPHABET    *abc     = NULL;      /* one alphabet, shared by all HMMs read     */
   char            *hmmfile = NULL;
   char            *outhmmfile = NULL;
   P7_HMMFILE      *hfp     = NULL;
-  P7_HMM          *hmm     = NULL;
-  P7_BG           *bg      = NULL;
-  int              nhmm;	
-  double           x;
-  float            KL;
+  FILE            *hpipe   = NULL;      /* decompressor <hfp> reads from, or NULL    */
+  P7_BG           *bg      = NULL;      /* one bg, for the writer's stats lines      */
+  OUTPUT_INFO      out;
   int              status;
   char             errbuf[eslERRBUFSIZE];
 
   char        errmsg[eslERRBUFSIZE];
 
+  int              ncpus    = 0;
+  int              infocnt  = 0;
+  WORKER_INFO     *info     = NULL;
+#ifdef HMMER_THREADS
+  WORK_ITEM       *item     = NULL;
+  ESL_THREADS     *threadObj= NULL;
+  ESL_WORK_QUEUE  *queue    = NULL;
+#endif
+  int              i;
+
   /* Process the command line options.
    */
   go = esl_getopts_Create(options);
-  if (esl_opt_ProcessCmdline(go, argc, argv) != eslOK || 
+  if (esl_opt_ProcessEnvironment(go)         != eslOK ||
+      esl_opt_ProcessCmdline(go, argc, argv) != eslOK || 
       esl_opt_VerifyConfig(go)               != eslOK)
     {
       printf("Failed to parse command line: %s\n", go->errbuf);
@@ -294,80 +296,464 @@ main(int argc, char **argv)
     }
 
   profillic_p7_banner(stdout, argv[0], banner);
+  if (esl_opt_IsUsed(go, "--binary"))          printf("# output format:                    binary galosh profiles\n");
+  if (esl_opt_IsUsed(go, "--outdir"))          printf("# one profile file per HMM in:      %s\n", outhmmfile);
+  if (esl_opt_IsUsed(go, "--nostats"))         printf("# model stats:                      not computed\n");
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--cpu"))             printf("# number of worker threads:         %d\n", esl_opt_GetInteger(go, "--cpu"));
+#endif
   
   /* Initializations: open the input HMM file for reading
    */
-  status = p7_hmmfile_OpenE(hmmfile, NULL, &hfp, errbuf);
+  status = profillic_hmmfile_OpenE(hmmfile, &hfp, &hpipe, errbuf);
   if      (status == eslENOTFOUND) p7_Fail("File existence/permissions problem in trying to open HMM file %s.\n%s\n", hmmfile, errbuf);
   else if (status == eslEFORMAT)   p7_Fail("File format problem in trying to open HMM file %s.\n%s\n",                hmmfile, errbuf);
   else if (status != eslOK)        p7_Fail("Unexpected error %d in opening HMM file %s.\n%s\n",               status, hmmfile, errbuf);  
 
-  /** Main body: read HMMs one at a time, print one line of stats
+  /* Initializations: open the output (file or directory)
    */
-  printf("#\n");
-  printf("# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "idx",  "name",                 "accession",    "nseq",     "eff_nseq", "M",      "relent", "info",   "p relE", "compKL");
-  printf("# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "----", "--------------------", "------------", "--------", "--------", "------", "------", "------", "------", "------");
+  out.outfile   = outhmmfile;
+  out.do_binary = esl_opt_GetBoolean(go, "--binary");
+  out.do_outdir = esl_opt_GetBoolean(go, "--outdir");
+  out.do_stats  = ! esl_opt_GetBoolean(go, "--nostats");
+  out.fp        = NULL;
+  out.bw        = NULL;
+  if (out.do_outdir) {
+    if (mkdir(outhmmfile, 0777) != 0 && errno != EEXIST) p7_Fail("Failed to create output directory %s\n", outhmmfile);
+  } else if (out.do_binary) {
+    if (profillic_compress_Type(outhmmfile) != PROFILLIC_COMPRESS_NONE) p7_Fail("Binary profile files can't be compressed (%s)\n", outhmmfile);
+    if (profillic_binary_writer_Open(outhmmfile, &(out.bw), errmsg) != eslOK) p7_Fail("%s\n", errmsg);
+  } else {
+    if ((out.fp = profillic_ofile_Open(outhmmfile)) == NULL) p7_Fail("Failed to open galosh profile file %s for writing\n", outhmmfile);
+  }
 
-  nhmm = 0;
-  if ((status = p7_hmmfile_Read(hfp, &abc, &hmm)) != eslEOF) 
+#ifdef HMMER_THREADS
+  /* initialize thread data */
+  if (esl_opt_IsOn(go, "--cpu")) ncpus = esl_opt_GetInteger(go, "--cpu");
+  else                                   esl_threads_CPUCount(&ncpus);
+
+  if (ncpus > 0)
     {
-      if      (status == eslEOD)       esl_fatal("read failed, HMM file %s may be truncated?", hmmfile);
-      else if (status == eslEFORMAT)   esl_fatal("bad file format in HMM file %s",             hmmfile);
-      else if (status == eslEINCOMPAT) esl_fatal("HMM file %s contains different alphabets",   hmmfile);
-      else if (status != eslOK)        esl_fatal("Unexpected error in reading HMMs from %s",   hmmfile);
-      nhmm++;
+      threadObj = esl_threads_Create(&pipeline_thread);
+      queue = esl_workqueue_Create(ncpus * 2);
+    }
+#endif
 
-      if (bg == NULL) bg = p7_bg_Create(abc);
-
-      if( abc->type == eslDNA ) {
-        galosh::ProfileTreeRoot<seqan::Dna, floatrealspace> profile;
-        if( (status = convert_to_galosh_profile( hmm, profile )) != eslOK ) esl_fatal("Unexpected error in converting HMM from file %s to a dna galosh profile",   hmmfile);
-        std::ofstream fs ( outhmmfile );
-    
-        if( !fs.is_open() ) {
-          esl_fatal("Unexpected error in opening the file %s for writing", outhmmfile);
-        } else {
-          fs << profile;
-          fs.close();
-        }
-      } else if( abc->type == eslAMINO ) {
-        galosh::ProfileTreeRoot<seqan::AminoAcid20, floatrealspace> profile;
-        if( (status = convert_to_galosh_profile( hmm, profile )) != eslOK ) esl_fatal("Unexpected error in converting HMM from file %s to an amino galosh profile",   hmmfile);
-        std::ofstream fs ( outhmmfile );
-    
-        if( !fs.is_open() ) {
-          esl_fatal("Unexpected error in opening the file %s for writing", outhmmfile);
-        } else {
-          fs << profile;
-          fs.close();
-        }
-      } else {
-        ESL_EXCEPTION(eslEUNIMPLEMENTED, "Sorry, at present the profillic-hmmtoprofile software can only handle amino and dna.");
-      }
-  
-      p7_MeanPositionRelativeEntropy(hmm, bg, &x); 
-      p7_hmm_CompositionKLDist(hmm, bg, &KL, NULL);
-
-      printf("%-6d %-20s %-12s %8d %8.2f %6d %6.2f %6.2f %6.2f %6.2f\n",
-	     nhmm,
-	     hmm->name,
-	     hmm->acc == NULL ? "-" : hmm->acc,
-	     hmm->nseq,
-	     hmm->eff_nseq,
-	     hmm->M,
-	     p7_MeanMatchRelativeEntropy(hmm, bg),
-	     p7_MeanMatchInfo(hmm, bg),
-	     x,
-	     KL);
-
-	     /*	     p7_MeanForwardScore(hmm, bg)); */
+  infocnt = (ncpus == 0) ? 1 : ncpus;
+  ESL_ALLOC_CPP( WORKER_INFO, info, sizeof(*info) * infocnt);
 
-      p7_hmm_Destroy(hmm);
+  for (i = 0; i < infocnt; ++i)
+    {
+      info[i].do_binary = out.do_binary;
+#ifdef HMMER_THREADS
+      info[i].queue = queue;
+      if (ncpus > 0) esl_threads_AddThread(threadObj, &info[i]);
+#endif
     }
 
-  p7_bg_Destroy(bg);
+#ifdef HMMER_THREADS
+  for (i = 0; i < ncpus * 2; ++i)
+    {
+      ESL_ALLOC_CPP( WORK_ITEM, item, sizeof(*item));
+
+      item->nhmm      = 0;
+      item->processed = FALSE;
+      item->hmm       = NULL;
+      item->converted = NULL;
+
+      status = esl_workqueue_Init(queue, item);
+      if (status != eslOK) esl_fatal("Failed to add block to work queue");
+    }
+#endif
+
+  /* Main body: read HMMs one at a time, print one line of stats
+   */
+  printf("#\n");
+  profillic_hmm_PrintStatsHeader(stdout);
+
+#ifdef HMMER_THREADS
+  if (ncpus > 0)  thread_loop(threadObj, queue, hfp, hmmfile, &abc, &bg, &out);
+  else            serial_loop(info, hfp, hmmfile, &abc, &bg, &out);
+#else
+  serial_loop(info, hfp, hmmfile, &abc, &bg, &out);
+#endif
+
+#ifdef HMMER_THREADS
+  if (ncpus > 0)
+    {
+      esl_workqueue_Reset(queue);
+      while (esl_workqueue_Remove(queue, (void **) &item) == eslOK)
+	{
+	  free(item);
+	}
+      esl_workqueue_Destroy(queue);
+      esl_threads_Destroy(threadObj);
+    }
+#endif
+
+  if (out.bw != NULL && profillic_binary_writer_Close(out.bw) != eslOK) p7_Fail("Failed to finish binary profile file %s\n", outhmmfile);
+  if (out.fp != NULL && profillic_ofile_Close(out.fp, outhmmfile) != 0) p7_Fail("Failed to finish galosh profile file %s\n", outhmmfile);
+
+  free(info);
+  if (bg != NULL) p7_bg_Destroy(bg);
   esl_alphabet_Destroy(abc);
-  p7_hmmfile_Close(hfp);
+  if (profillic_hmmfile_Close(hfp, hpipe) != eslOK) p7_Fail("Failed to decompress HMM file %s\n", hmmfile);
   esl_getopts_Destroy(go);
   exit(0);
+
+ ERROR:
+  p7_Fail("profillic-hmmtoprofile failed: memory allocation problem");
+}
+
+/**
+ * serial_loop
+ *
+ * Read, convert and write each HMM in turn, with the one worker <info>.
+ */
+static void
+serial_loop(WORKER_INFO *info, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, OUTPUT_INFO *out)
+{
+  P7_HMM            *hmm         = NULL;
+  CONVERTED_PROFILE *converted   = NULL;
+  int                nhmm        = 0;
+  char               errmsg[eslERRBUFSIZE];
+  int                status;
+
+  while ((status = p7_hmmfile_Read(hfp, byp_abc, &hmm)) != eslEOF) 
+    {
+      if (status != eslOK) read_failure(status, hmmfile);
+      nhmm++;
+
+      if (out->do_stats && *byp_bg == NULL) *byp_bg = p7_bg_Create(*byp_abc);
+
+      if ((status = convert_hmm(info, hmm, &converted))                          != eslOK) esl_fatal("Unexpected error in converting HMM %s from file %s to a galosh profile", hmm->name, hmmfile);
+      if ((status = output_result(out, *byp_bg, errmsg, nhmm, hmm, converted))   != eslOK) p7_Fail("%s\n", errmsg);
+
+      delete converted;
+      p7_hmm_Destroy(hmm);
+    }
+}
+
+#ifdef HMMER_THREADS
+/**
+ * thread_loop
+ *
+ * The reader and ordered writer for the threaded version: read each HMM
+ * into a work item for the pipeline_thread()s, and write the converted
+ * profiles (and their stats lines) out in the order the HMMs were read.
+ */
+static void
+thread_loop(ESL_THREADS *obj, ESL_WORK_QUEUE *queue, P7_HMMFILE *hfp, char *hmmfile, ESL_ALPHABET **byp_abc, P7_BG **byp_bg, OUTPUT_INFO *out)
+{
+  int          status    = eslOK;
+  int          sstatus   = eslOK;
+  int          nhmm      = 0;
+  int          processed = 0;
+  WORK_ITEM   *item;
+  void        *newItem;
+
+  int           next     = 1;
+  PENDING_ITEM *top      = NULL;
+  PENDING_ITEM *empty    = NULL;
+  PENDING_ITEM *tmp      = NULL;
+
+  char        errmsg[eslERRBUFSIZE];
+
+  esl_workqueue_Reset(queue);
+  esl_threads_WaitForStart(obj);
+
+  status = esl_workqueue_ReaderUpdate(queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+      
+  /* Main loop: */
+  item = (WORK_ITEM *) newItem;
+  while (sstatus == eslOK) {
+    sstatus = p7_hmmfile_Read(hfp, byp_abc, &item->hmm);
+    if (sstatus == eslOK) {
+      item->nhmm = ++nhmm;
+      if (out->do_stats && *byp_bg == NULL) *byp_bg = p7_bg_Create(*byp_abc);
+    }
+    else if (sstatus == eslEOF) {
+      item->hmm = NULL;	/* an empty item tells the workers there's nothing left */
+      if (processed < nhmm) sstatus = eslOK;
+    }
+    else read_failure(sstatus, hmmfile);
+	  
+    if (sstatus == eslOK) {
+      status = esl_workqueue_ReaderUpdate(queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue reader failed");
+
+      /* process any results */
+      item = (WORK_ITEM *) newItem;
+      if (item->processed == TRUE) {
+	++processed;
+
+	/* keep the output order the same as the input order */
+	if (item->nhmm == next) {
+	  if (output_result(out, *byp_bg, errmsg, item->nhmm, item->hmm, item->converted) != eslOK) p7_Fail("%s\n", errmsg);
+	  delete item->converted;
+	  p7_hmm_Destroy(item->hmm);
+	  ++next;
+
+	  /* output any pending profiles as long as the order
+	   * remains the same as read in.
+	   */
+	  while (top != NULL && top->nhmm == next) {
+	    if (output_result(out, *byp_bg, errmsg, top->nhmm, top->hmm, top->converted) != eslOK) p7_Fail("%s\n", errmsg);
+	    delete top->converted;
+	    p7_hmm_Destroy(top->hmm);
+
+	    tmp = top;
+	    top = tmp->next;
+
+	    tmp->next = empty;
+	    empty     = tmp;
+	    
+	    ++next;
+	  }
+	} else {
+	  /* queue up the profile until its predecessors have been written */
+	  if (empty != NULL) {
+	    tmp   = empty;
+	    empty = tmp->next;
+	  } else {
+	    ESL_ALLOC_CPP( PENDING_ITEM, tmp, sizeof(PENDING_ITEM));
+	  }
+
+	  tmp->nhmm      = item->nhmm;
+	  tmp->hmm       = item->hmm;
+	  tmp->converted = item->converted;
+
+	  /* add the profile to the pending list */
+	  if (top == NULL || tmp->nhmm < top->nhmm) {
+	    tmp->next = top;
+	    top       = tmp;
+	  } else {
+	    PENDING_ITEM *ptr = top;
+	    while (ptr->next != NULL && tmp->nhmm > ptr->next->nhmm) {
+	      ptr = ptr->next;
+	    }
+	    tmp->next = ptr->next;
+	    ptr->next = tmp;
+	  }
+	}
+
+	item->nhmm      = 0;
+	item->processed = FALSE;
+	item->hmm       = NULL;
+	item->converted = NULL;
+      }
+    }
+  }
+
+  if (top != NULL) esl_fatal("Top is not empty\n");
+
+  while (empty != NULL) {
+    tmp   = empty;
+    empty = tmp->next;
+    free(tmp);
+  }
+
+  status = esl_workqueue_ReaderUpdate(queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue reader failed");
+
+  if (sstatus == eslEOF)
+    {
+      /* wait for all the threads to complete */
+      esl_threads_WaitForFinish(obj);
+      esl_workqueue_Complete(queue);  
+    }
+  return;
+
+ ERROR:
+  p7_Fail("thread_loop failed: memory allocation problem");
+}
+
+/**
+ * pipeline_thread
+ *
+ * A conversion worker: convert each work item's HMM to a galosh
+ * profile, and serialize (or encode) it for the writer.
+ */
+static void 
+pipeline_thread(void *arg)
+{
+  int           workeridx;
+  int           status;
+
+  WORK_ITEM    *item;
+  void         *newItem;
+
+  WORKER_INFO  *info;
+  ESL_THREADS  *obj;
+
+  obj = (ESL_THREADS *) arg;
+  esl_threads_Started(obj, &workeridx);
+
+  info = (WORKER_INFO *) esl_threads_GetData(obj, workeridx);
+
+  status = esl_workqueue_WorkerUpdate(info->queue, NULL, &newItem);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  /* loop until all blocks have been processed */
+  item = (WORK_ITEM *) newItem;
+  while (item->hmm != NULL)
+    {
+      if (convert_hmm(info, item->hmm, &(item->converted)) != eslOK) esl_fatal("Unexpected error in converting HMM %s to a galosh profile", item->hmm->name);
+      item->processed = TRUE;
+
+      status = esl_workqueue_WorkerUpdate(info->queue, item, &newItem);
+      if (status != eslOK) esl_fatal("Work queue worker failed");
+
+      item = (WORK_ITEM *) newItem;
+    }
+
+  status = esl_workqueue_WorkerUpdate(info->queue, item, NULL);
+  if (status != eslOK) esl_fatal("Work queue worker failed");
+
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+#endif   /* HMMER_THREADS */
+
+/**
+ * read_failure
+ *
+ * Report a non-OK, non-EOF status from p7_hmmfile_Read() and exit.
+ */
+static void
+read_failure(int status, char *hmmfile)
+{
+  if      (status == eslEOD)       esl_fatal("read failed, HMM file %s may be truncated?", hmmfile);
+  else if (status == eslEFORMAT)   esl_fatal("bad file format in HMM file %s",             hmmfile);
+  else if (status == eslEINCOMPAT) esl_fatal("HMM file %s contains different alphabets",   hmmfile);
+  else                             esl_fatal("Unexpected error in reading HMMs from %s",   hmmfile);
+}
+
+/**
+ * convert_profile
+ *
+ * Convert <hmm> to a galosh profile of residue type <ResidueType>, and
+ * serialize it into <converted> as the writer will want it.
+ */
+template <typename ResidueType>
+static int
+convert_profile(WORKER_INFO *info, P7_HMM *hmm, CONVERTED_PROFILE *converted)
+{
+  galosh::ProfileTreeRoot<ResidueType, floatrealspace> profile;
+  int status;
+
+  if ((status = profillic_hmm_to_profile( hmm, profile )) != eslOK) return status;
+  if (info->do_binary) {
+    profillic_binary_Encode( profile, &(converted->rec), converted->v );
+  } else {
+    std::ostringstream profile_stream;
+    profile_stream << profile;
+    converted->text = profile_stream.str();
+  }
+  return eslOK;
+}
+
+/**
+ * convert_hmm
+ *
+ * Convert one <hmm> for the writer; the caller deletes <*ret_converted>.
+ */
+static int
+convert_hmm(WORKER_INFO *info, P7_HMM *hmm, CONVERTED_PROFILE **ret_converted)
+{
+  CONVERTED_PROFILE *converted = new CONVERTED_PROFILE;
+  int                status;
+
+  if      (hmm->abc->type == eslDNA)   status = convert_profile<seqan::Dna>(info, hmm, converted);
+  else if (hmm->abc->type == eslAMINO) status = convert_profile<seqan::AminoAcid20>(info, hmm, converted);
+  else    ESL_XEXCEPTION(eslEUNIMPLEMENTED, "Sorry, at present the profillic-hmmtoprofile software can only handle amino and dna.");
+  if (status != eslOK) goto ERROR;
+
+  *ret_converted = converted;
+  return eslOK;
+
+ ERROR:
+  delete converted;
+  *ret_converted = NULL;
+  return status;
+}
+
+/**
+ * outdir_Stem
+ *
+ * Set <ret_stem> to the file name (less extension) for HMM number
+ * <nhmm>, named <name>, under <out>'s --outdir directory: <name> with
+ * any '/' made '_', plus ".<nhmm>" if that was already used.
+ */
+static void
+outdir_Stem(OUTPUT_INFO *out, int nhmm, const char *name, std::string *ret_stem)
+{
+  std::ostringstream suffix;
+  std::string        stem(name);
+  std::string::size_type i;
+
+  /* the name must not reach outside <out->outfile> */
+  for (i = 0; i < stem.length(); i++)
+    if (stem[i] == '/') stem[i] = '_';
+  if (stem.empty()) stem = "hmm";
+
+  /* nor overwrite an earlier HMM's file */
+  suffix << "." << nhmm;
+  while (out->stems.count(stem) > 0) stem += suffix.str();
+  out->stems.insert(stem);
+  *ret_stem = stem;
+}
+
+/**
+ * output_result
+ *
+ * Write one <converted> profile (number <nhmm>, from <hmm>) to <out>,
+ * and print its line of stats (against <bg>; none if <bg> is NULL) to
+ * stdout.
+ */
+static int
+output_result(OUTPUT_INFO *out, P7_BG *bg, char *errbuf, int nhmm, P7_HMM *hmm, CONVERTED_PROFILE *converted)
+{
+  PROFILLIC_BINARY_WRITER *bw   = NULL;
+  FILE                    *fp   = NULL;
+  char                    *path = NULL;
+  PROFILLIC_HMM_STATS      stats;
+  std::string              stem;
+  int                      status;
+
+  if (out->do_outdir) {
+    outdir_Stem(out, nhmm, hmm->name, &stem);
+    if ((status = esl_sprintf(&path, "%s/%s%s", out->outfile, stem.c_str(), (out->do_binary ? ".gpb" : ".profile"))) != eslOK) ESL_XFAIL(status, errbuf, "allocation failed");
+    if (out->do_binary) {
+      if ((status = profillic_binary_writer_Open(path, &bw, errbuf))                != eslOK) goto ERROR;
+      if ((status = profillic_binary_writer_WriteRecord(bw, &(converted->rec), converted->v)) != eslOK) ESL_XFAIL(status, errbuf, "Failed to write binary profile file %s", path);
+      status = profillic_binary_writer_Close(bw);
+      bw = NULL;
+      if (status != eslOK) ESL_XFAIL(status, errbuf, "Failed to finish binary profile file %s", path);
+    } else {
+      if ((fp = fopen(path, "w")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open galosh profile file %s for writing", path);
+      if (fwrite(converted->text.data(), 1, converted->text.length(), fp) != converted->text.length()) ESL_XFAIL(eslEWRITE, errbuf, "Failed to write galosh profile file %s", path);
+      status = fclose(fp);
+      fp = NULL;
+      if (status != 0) ESL_XFAIL(eslEWRITE, errbuf, "Failed to write galosh profile file %s", path);
+    }
+    free(path);
+    path = NULL;
+  } else if (out->do_binary) {
+    if ((status = profillic_binary_writer_WriteRecord(out->bw, &(converted->rec), converted->v)) != eslOK) ESL_FAIL(status, errbuf, "Failed to write binary profile file %s", out->outfile);
+  } else {
+    /* records after the first are separated by a "//" line, so a single profile is written exactly as before */
+    if (nhmm > 1 && fputs("//\n", out->fp) < 0) ESL_FAIL(eslEWRITE, errbuf, "Failed to write galosh profile file %s", out->outfile);
+    if (fwrite(converted->text.data(), 1, converted->text.length(), out->fp) != converted->text.length()) ESL_FAIL(eslEWRITE, errbuf, "Failed to write galosh profile file %s", out->outfile);
+  }
+  
+  if ((status = profillic_hmm_Stats(hmm, bg, &stats)) != eslOK) ESL_FAIL(status, errbuf, "Failed to compute the stats of HMM %s", hmm->name);
+  profillic_hmm_PrintStats(stdout, nhmm, hmm, &stats);
+  return eslOK;
+
+ ERROR:
+  if (fp   != NULL) fclose(fp);
+  if (path != NULL) free(path);
+  return status;
 }
@@ -0,0 +1,460 @@
+/**
+ * \file profillic-lib.cpp
+ * \brief
+ * libprofillic-hmmer: building HMMER3 models from galosh profiles in
+ * memory; see profillic-lib.hpp.
+ * \details
+ * <pre>
+ * Contents:
+ *    1. PROFILLIC_LIB: allocation, destruction.
+ *    2. Building one model.
+ *    3. Building a batch of models, threaded.
+ *    4. The public templates, and their instantiations.
+ *    5. Copyright and license information.
+ * </pre>
+ *
+ * The builder is profillic-hmmbuild's: one shared P7_BUILDER (prior,
+ * options), and per worker a clone of it, a null model and a pool, as
+ * in profillic-hmmbuild's thread workers.  A batch's profile <i> goes
+ * to worker <i mod nworkers>; each model is independent of the others,
+ * and of which worker built it (calibration reseeds the worker's RNG
+ * first), so threading the batch changes nothing but the time it takes.
+ *
+ * Each model's consensus MSA is made straight from the profile
+ * (profillic_esl_msa_CreateFromProfile()), so nothing is written out
+ * or parsed back, and the build itself is profillic_p7_Builder(), the
+ * tools' one engine.  The pools keep no spare models (maxspare 0):
+ * models here go to the caller, who frees them with p7_hmm_Destroy().
+ */
+extern "C" {
+#include "p7_config.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+  /// \note TAH 8/12 Workaround for C++ keyword "new" in esl_msa.h
+#define new _new
+#include "esl_msa.h"
+#undef new
+#include "esl_random.h"
+}
+
+#ifdef HMMER_THREADS
+extern "C" {
+#include "esl_threads.h"
+}
+#endif /*HMMER_THREADS*/
+
+extern "C" {
+#include "hmmer.h"
+}
+
+/* /////////////// For profillic-hmmer ////////////////////////////////// */
+#include "profillic-hmmer.hpp"
+#include "DynamicProgramming.hpp"
+#include "profillic-p7_builder.hpp"
+#include "profillic-esl_msafile.hpp"
+#include "profillic-compress.hpp"
+#include "profillic-lib.hpp"
+
+/*****************************************************************
+ * 1. PROFILLIC_LIB: allocation, destruction.
+ *****************************************************************/
+
+struct profillic_lib_worker_s;
+
+/* Builds worker <w>'s share of its batch; see lib_worker_Run(). */
+typedef int (*PROFILLIC_LIB_RUNFUNC)(struct profillic_lib_worker_s *w);
+
+/* One worker: its builder, null model and pool, and its share of the current batch. */
+typedef struct profillic_lib_worker_s {
+  P7_BUILDER           *bld;       /* clone of the shared builder                         */
+  P7_BG                *bg;        /* own null model (calibration resets its length)      */
+  PROFILLIC_BUILD_POOL *pool;      /* window-length scratch space                         */
+  const ESL_ALPHABET   *abc;
+  int                   use_priors;
+
+  /* the current batch */
+  PROFILLIC_LIB_RUNFUNC run;       /* lib_worker_Run<ProfileType>                         */
+  const void           *profiles;  /* ProfileType const * const *, all of them            */
+  const char * const   *names;     /* as given to the public call; may be NULL            */
+  int                   first;     /* batch is profiles[first..first+n-1] ...             */
+  int                   n;
+  P7_HMM              **hmms;      /* ... into hmms[0..n-1]                               */
+  int                   widx;      /* this worker builds batch entries widx, widx+nworkers, ... */
+  int                   nworkers;
+  int                   status;    /* eslOK, or the error on entry <failed>               */
+  int                   failed;    /* batch entry that failed, or -1                      */
+  char                  errbuf[eslERRBUFSIZE];
+} PROFILLIC_LIB_WORKER;
+
+struct profillic_lib_s {
+  ESL_ALPHABET         *abc;
+  P7_BUILDER           *bld;       /* shared: the workers' builders are its clones */
+  int                   nworkers;  /* >= 1; more than 1 only with HMMER_THREADS    */
+  PROFILLIC_LIB_WORKER *wrk;       /* [0..nworkers-1]                              */
+  char                  errbuf[eslERRBUFSIZE];
+};
+
+PROFILLIC_LIB *
+profillic_lib_Create(const ESL_GETOPTS *go, int abctype, int ncpus, char *errbuf)
+{
+  PROFILLIC_LIB *lib = NULL;
+  char           msg[eslERRBUFSIZE];
+  int            j;
+  int            status;
+
+  strcpy(msg, "memory allocation failed");
+  if (abctype != eslDNA && abctype != eslAMINO) ESL_XFAIL(eslEINVAL, msg, "galosh profiles are DNA or amino; alphabet type %d is neither", abctype);
+
+  ESL_ALLOC_CPP( PROFILLIC_LIB, lib, sizeof(PROFILLIC_LIB));
+  lib->abc       = NULL;
+  lib->bld       = NULL;
+  lib->wrk       = NULL;
+  lib->errbuf[0] = '\0';
+#ifdef HMMER_THREADS
+  lib->nworkers  = ESL_MAX(1, ncpus);
+#else
+  lib->nworkers  = 1;
+#endif
+
+  if ((lib->abc = esl_alphabet_Create(abctype))                == NULL) { status = eslEMEM; goto ERROR; }
+  if ((lib->bld = profillic_p7_builder_Create(go, lib->abc))   == NULL) ESL_XFAIL(eslEMEM, msg, "failed to create the model builder");
+
+  /* Without options, build as profillic-hmmbuild does by default:
+   * --seed 42, reseeded for each model, not the arbitrary seed
+   * (--seed 0) that p7_builder_Create() takes for no options.
+   */
+  if (go == NULL)
+    {
+      esl_randomness_Init(lib->bld->r, PROFILLIC_LIB_DEFAULT_SEED);
+      lib->bld->do_reseeding = TRUE;
+    }
+
+  /* special arguments for hmmbuild */
+  lib->bld->w_len      = (go != NULL && esl_opt_IsOn (go, "--w_length")) ?  esl_opt_GetInteger(go, "--w_length"): -1;
+  lib->bld->w_beta     = (go != NULL && esl_opt_IsOn (go, "--w_beta"))   ?  esl_opt_GetReal   (go, "--w_beta")    : p7_DEFAULT_WINDOW_BETA;
+  if ( lib->bld->w_beta < 0 || lib->bld->w_beta > 1  ) ESL_XFAIL(eslEINVAL, msg, "Invalid window-length beta value");
+
+  ESL_ALLOC_CPP( PROFILLIC_LIB_WORKER, lib->wrk, sizeof(PROFILLIC_LIB_WORKER) * lib->nworkers);
+  for (j = 0; j < lib->nworkers; j++) { lib->wrk[j].bld = NULL; lib->wrk[j].bg = NULL; lib->wrk[j].pool = NULL; }
+  for (j = 0; j < lib->nworkers; j++)
+    {
+      if ((lib->wrk[j].bld  = profillic_p7_builder_CreateClone(lib->bld))   == NULL) { status = eslEMEM; goto ERROR; }
+      if ((lib->wrk[j].bg   = p7_bg_Create(lib->abc))                       == NULL) { status = eslEMEM; goto ERROR; }
+      if ((lib->wrk[j].pool = profillic_build_pool_Create(lib->abc, 0))     == NULL) { status = eslEMEM; goto ERROR; }
+      lib->wrk[j].abc        = lib->abc;
+      lib->wrk[j].use_priors = (go == NULL || ! esl_opt_GetBoolean(go, "--noprior"));
+      lib->wrk[j].widx       = j;
+      lib->wrk[j].nworkers   = lib->nworkers;
+      lib->wrk[j].errbuf[0]  = '\0';
+    }
+  return lib;
+
+ ERROR:
+  if (errbuf != NULL) strcpy(errbuf, msg);
+  profillic_lib_Destroy(lib);
+  return NULL;
+}
+
+void
+profillic_lib_Destroy(PROFILLIC_LIB *lib)
+{
+  int j;
+
+  if (lib == NULL) return;
+  if (lib->wrk != NULL)
+    {
+      for (j = 0; j < lib->nworkers; j++)
+        {
+          profillic_p7_builder_DestroyClone(lib->wrk[j].bld);
+          if (lib->wrk[j].bg != NULL) p7_bg_Destroy(lib->wrk[j].bg);
+          profillic_build_pool_Destroy(lib->wrk[j].pool);
+        }
+      free(lib->wrk);
+    }
+  profillic_p7_builder_Destroy(lib->bld); /* after its clones */
+  if (lib->abc != NULL) esl_alphabet_Destroy(lib->abc);
+  free(lib);
+}
+
+const ESL_ALPHABET *
+profillic_lib_Alphabet(const PROFILLIC_LIB *lib)
+{
+  return lib->abc;
+}
+
+const char *
+profillic_lib_Error(const PROFILLIC_LIB *lib)
+{
+  return lib->errbuf;
+}
+
+/*------------------- end, PROFILLIC_LIB ---------------------------*/
+
+/*****************************************************************
+ * 2. Building one model.
+ *****************************************************************/
+
+/**
+ * static int lib_build_one()
+ *
+ * Build, with worker <w>, the model of <profile> into <*ret_hmm>,
+ * named <name>; or, if <name> is <NULL>, "profile<idx+1>", or (if
+ * <idx> is -1) as the consensus MSA is named. On failure, <*ret_hmm>
+ * is <NULL> and <w->errbuf> says why.
+ */
+template <typename ProfileType>
+static int
+lib_build_one(PROFILLIC_LIB_WORKER *w, ProfileType const & profile, const char *name, int idx, P7_HMM **ret_hmm)
+{
+  typedef ProfillicProfileKind<ProfileType> Kind;
+
+  ESL_MSA *msa = NULL;
+  P7_HMM  *hmm = NULL;
+  int      status;
+
+  w->errbuf[0] = '\0';
+  if ((int) seqan::ValueSize<typename Kind::ResidueType>::VALUE != w->abc->K)
+    ESL_XFAIL(eslEINVAL, w->errbuf, "profile has %d residues; the %s alphabet has %d", (int) seqan::ValueSize<typename Kind::ResidueType>::VALUE, esl_abc_DecodeType(w->abc->type), w->abc->K);
+  if (profile.length() <= (uint32_t) Kind::position_offset) ESL_XFAIL(eslEINVAL, w->errbuf, "profile is empty");
+
+  if ((status = profillic_esl_msa_CreateFromProfile(w->abc, profile, &msa, w->errbuf)) != eslOK) goto ERROR;
+  if      (name != NULL) { if ((status = esl_msa_SetName   (msa, name, -1))             != eslOK) goto ERROR; }
+  else if (idx  >= 0)    { if ((status = esl_msa_FormatName(msa, "profile%d", idx + 1)) != eslOK) goto ERROR; }
+
+  if ((status = profillic_p7_Builder(w->bld, msa, &profile, w->bg, &hmm, NULL, NULL, NULL, NULL, w->use_priors, 0, 0, NULL, NULL, w->pool)) != eslOK)
+    { strcpy(w->errbuf, w->bld->errbuf); goto ERROR; }
+
+  esl_msa_Destroy(msa);
+  *ret_hmm = hmm;
+  return eslOK;
+
+ ERROR:
+  if (w->errbuf[0] == '\0') strcpy(w->errbuf, "memory allocation failed");
+  if (msa != NULL) esl_msa_Destroy(msa);
+  if (hmm != NULL) p7_hmm_Destroy(hmm);
+  *ret_hmm = NULL;
+  return status;
+}
+
+/*------------------- end, building one model ---------------------------*/
+
+/*****************************************************************
+ * 3. Building a batch of models, threaded.
+ *****************************************************************/
+
+/**
+ * static int lib_worker_Run()
+ *
+ * Build worker <w>'s share of its batch, in order, stopping at the
+ * first that fails (in <w->failed>, with a message in <w->errbuf>).
+ * Since each worker goes in order, the lowest <failed> over the
+ * workers is the first profile of the batch that fails.
+ */
+template <typename ProfileType>
+static int
+lib_worker_Run(PROFILLIC_LIB_WORKER *w)
+{
+  ProfileType const * const *profiles = static_cast<ProfileType const * const *>(w->profiles);
+  const char                *name;
+  int                        b;
+
+  w->status = eslOK;
+  w->failed = -1;
+  for (b = w->widx; b < w->n; b += w->nworkers)
+    {
+      name = (w->names != NULL ? w->names[w->first + b] : NULL);
+      if ((w->status = lib_build_one(w, *profiles[w->first + b], name, w->first + b, &(w->hmms[b]))) != eslOK) { w->failed = b; break; }
+    }
+  return w->status;
+}
+
+#ifdef HMMER_THREADS
+/* Batch worker thread: run this worker's share of its batch. */
+static void
+lib_batch_thread(void *arg)
+{
+  ESL_THREADS          *obj = (ESL_THREADS *) arg;
+  PROFILLIC_LIB_WORKER *w;
+  int                   workeridx;
+
+  esl_threads_Started(obj, &workeridx);
+  w = (PROFILLIC_LIB_WORKER *) esl_threads_GetData(obj, workeridx);
+  (*w->run)(w);
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+#endif /*HMMER_THREADS*/
+
+/**
+ * static int lib_batch()
+ *
+ * Build <profiles[first..first+n-1]> into <hmms[0..n-1]> on <lib>'s
+ * workers: in this thread if there's one worker (or one profile),
+ * else on a thread per worker that has any of them. On failure all of
+ * <hmms> are <NULL>, and <lib->errbuf> names the first profile that
+ * failed, and why.
+ */
+static int
+lib_batch(PROFILLIC_LIB *lib, PROFILLIC_LIB_RUNFUNC run, const void *profiles, const char * const *names, int first, int n, P7_HMM **hmms)
+{
+#ifdef HMMER_THREADS
+  ESL_THREADS *threadObj = NULL;
+#endif
+  int          nw        = ESL_MIN(lib->nworkers, n);
+  int          wfail     = -1;
+  const char  *name;
+  int          b, j;
+  int          status;
+
+  lib->errbuf[0] = '\0';
+  for (b = 0; b < n; b++) hmms[b] = NULL;
+  if (n <= 0) return eslOK;
+
+  for (j = 0; j < nw; j++)
+    {
+      lib->wrk[j].run      = run;
+      lib->wrk[j].profiles = profiles;
+      lib->wrk[j].names    = names;
+      lib->wrk[j].first    = first;
+      lib->wrk[j].n        = n;
+      lib->wrk[j].hmms     = hmms;
+      lib->wrk[j].nworkers = nw;
+    }
+
+#ifdef HMMER_THREADS
+  if (nw > 1)
+    {
+      if ((threadObj = esl_threads_Create(&lib_batch_thread)) == NULL) ESL_XFAIL(eslEMEM, lib->errbuf, "failed to create the worker threads");
+      for (j = 0; j < nw; j++) esl_threads_AddThread(threadObj, &(lib->wrk[j]));
+      esl_threads_WaitForStart(threadObj);
+      esl_threads_WaitForFinish(threadObj);
+      esl_threads_Destroy(threadObj);
+    }
+  else
+#endif /*HMMER_THREADS*/
+    (*run)(&(lib->wrk[0]));
+
+  for (j = 0; j < nw; j++)
+    if (lib->wrk[j].failed >= 0 && (wfail < 0 || lib->wrk[j].failed < lib->wrk[wfail].failed)) wfail = j;
+  if (wfail >= 0)
+    {
+      b      = lib->wrk[wfail].failed;
+      name   = (names != NULL && names[first + b] != NULL ? names[first + b] : "-");
+      status = lib->wrk[wfail].status;
+      ESL_XFAIL(status, lib->errbuf, "profile %d (%s): %s", first + b + 1, name, lib->wrk[wfail].errbuf);
+    }
+  return eslOK;
+
+ ERROR:
+  for (b = 0; b < n; b++) { if (hmms[b] != NULL) p7_hmm_Destroy(hmms[b]); hmms[b] = NULL; }
+  return status;
+}
+
+/*------------------- end, building a batch ---------------------------*/
+
+/*****************************************************************
+ * 4. The public templates, and their instantiations.
+ *****************************************************************/
+
+template <typename ProfileType>
+int
+profillic_lib_Build(PROFILLIC_LIB *lib, ProfileType const & profile, const char *name, P7_HMM **ret_hmm)
+{
+  int status;
+
+  lib->errbuf[0] = '\0';
+  if ((status = lib_build_one(&(lib->wrk[0]), profile, name, -1, ret_hmm)) != eslOK) strcpy(lib->errbuf, lib->wrk[0].errbuf);
+  return status;
+}
+
+template <typename ProfileType>
+int
+profillic_lib_BuildBatch(PROFILLIC_LIB *lib, ProfileType const * const *profiles, const char * const *names, int n, P7_HMM **ret_hmms)
+{
+  return lib_batch(lib, &lib_worker_Run<ProfileType>, profiles, names, 0, n, ret_hmms);
+}
+
+template <typename ProfileType>
+int
+profillic_lib_WriteDatabase(PROFILLIC_LIB *lib, ProfileType const * const *profiles, const char * const *names, int n, const char *hmmfile)
+{
+  FILE    *ofp  = NULL;
+  P7_HMM **hmms = NULL;
+  int      nb;
+  int      first, b;
+  int      status;
+
+  lib->errbuf[0] = '\0';
+  ESL_ALLOC_CPP( P7_HMM *, hmms, sizeof(P7_HMM *) * ESL_MAX(1, ESL_MIN(n, PROFILLIC_LIB_NBATCH)));
+  for (b = 0; b < ESL_MIN(n, PROFILLIC_LIB_NBATCH); b++) hmms[b] = NULL;
+  if ((ofp = profillic_ofile_Open(hmmfile)) == NULL) ESL_XFAIL(eslFAIL, lib->errbuf, "Failed to open HMM file %s for writing", hmmfile);
+
+  for (first = 0; first < n; first += nb)
+    {
+      nb = ESL_MIN(n - first, PROFILLIC_LIB_NBATCH);
+      if ((status = lib_batch(lib, &lib_worker_Run<ProfileType>, profiles, names, first, nb, hmms)) != eslOK) goto ERROR;
+      for (b = 0; b < nb; b++)
+        {
+          if (p7_hmmfile_WriteASCII(ofp, -1, hmms[b]) != eslOK) ESL_XFAIL(eslEWRITE, lib->errbuf, "Failed to write model %d to HMM file %s", first + b + 1, hmmfile);
+          p7_hmm_Destroy(hmms[b]); hmms[b] = NULL;
+        }
+    }
+
+  free(hmms); hmms = NULL;
+  if (profillic_ofile_Close(ofp, hmmfile) != 0) { ofp = NULL; ESL_XFAIL(eslEWRITE, lib->errbuf, "Failed to finish writing HMM file %s", hmmfile); }
+  return eslOK;
+
+ ERROR:
+  if (lib->errbuf[0] == '\0') strcpy(lib->errbuf, "memory allocation failed");
+  if (hmms != NULL)
+    {
+      for (b = 0; b < ESL_MIN(n, PROFILLIC_LIB_NBATCH); b++) if (hmms[b] != NULL) p7_hmm_Destroy(hmms[b]);
+      free(hmms);
+    }
+  if (ofp != NULL) profillic_ofile_Close(ofp, hmmfile);
+  return status;
+}
+
+/* The profile types the library is built for; see profillic-lib.hpp. */
+#define PROFILLIC_LIB_INSTANTIATE(ProfileType)                                                                                              \
+  template int profillic_lib_Build<ProfileType >        (PROFILLIC_LIB *, ProfileType const &, const char *, P7_HMM **);                    \
+  template int profillic_lib_BuildBatch<ProfileType >   (PROFILLIC_LIB *, ProfileType const * const *, const char * const *, int, P7_HMM **); \
+  template int profillic_lib_WriteDatabase<ProfileType >(PROFILLIC_LIB *, ProfileType const * const *, const char * const *, int, const char *);
+
+typedef galosh::ProfileTreeRoot<seqan::Dna,         floatrealspace>  PROFILLIC_LIB_DNA_FLOAT;
+typedef galosh::ProfileTreeRoot<seqan::Dna,         doublerealspace> PROFILLIC_LIB_DNA_DOUBLE;
+typedef galosh::ProfileTreeRoot<seqan::Dna,         logspace>        PROFILLIC_LIB_DNA_LOGSPACE;
+typedef galosh::ProfileTreeRoot<seqan::Dna,         bfloat>          PROFILLIC_LIB_DNA_BFLOAT;
+typedef galosh::ProfileTreeRoot<seqan::AminoAcid20, floatrealspace>  PROFILLIC_LIB_AMINO_FLOAT;
+typedef galosh::ProfileTreeRoot<seqan::AminoAcid20, doublerealspace> PROFILLIC_LIB_AMINO_DOUBLE;
+typedef galosh::ProfileTreeRoot<seqan::AminoAcid20, logspace>        PROFILLIC_LIB_AMINO_LOGSPACE;
+typedef galosh::ProfileTreeRoot<seqan::AminoAcid20, bfloat>          PROFILLIC_LIB_AMINO_BFLOAT;
+typedef galosh::AlignmentProfileAccessor<seqan::Dna,         floatrealspace, floatrealspace, floatrealspace> PROFILLIC_LIB_DNA_ALIGNMENT;
+typedef galosh::AlignmentProfileAccessor<seqan::AminoAcid20, floatrealspace, floatrealspace, floatrealspace> PROFILLIC_LIB_AMINO_ALIGNMENT;
+
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_DNA_FLOAT)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_DNA_DOUBLE)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_DNA_LOGSPACE)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_DNA_BFLOAT)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_AMINO_FLOAT)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_AMINO_DOUBLE)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_AMINO_LOGSPACE)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_AMINO_BFLOAT)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_DNA_ALIGNMENT)
+PROFILLIC_LIB_INSTANTIATE(PROFILLIC_LIB_AMINO_ALIGNMENT)
+
+/*------------------- end, public templates ---------------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
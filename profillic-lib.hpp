@@ -0,0 +1,207 @@
+/**
+ * \file profillic-lib.hpp
+ * \brief
+ * In-process API for building HMMER3 models from galosh profiles
+ * already in memory (libprofillic-hmmer).
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. The PROFILLIC_LIB builder.
+ *     2. Building models from profiles.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * A trainer (profillic, profuse) that has its ProfileTreeRoots or
+ * AlignmentProfileAccessors in memory can hand them straight to
+ * profillic_p7_Builder(), through this API, rather than writing each
+ * one out as text for profillic-hmmbuild to parse back in.  A batch of
+ * profiles is shared out among the builder's worker threads, each with
+ * its own builder clone, null model and pool, as in profillic-hmmbuild
+ * --cpu; the models come back in input order, or are written in order
+ * to an HMM database.
+ *
+ * This is the library's only header; the engine headers it is built
+ * from (profillic-p7_builder.hpp and friends) define non-inline
+ * functions, so a client of the library shouldn't include them too.
+ * Link with -lprofillic-hmmer and HMMER's -lhmmer -leasel.
+ *
+ * The templates are instantiated in the library for the profile types
+ * the tools read:
+ *
+ * <pre>
+ *   galosh::ProfileTreeRoot<R, P>
+ *       R = seqan::Dna, seqan::AminoAcid20
+ *       P = floatrealspace, doublerealspace, logspace, bfloat
+ *   galosh::AlignmentProfileAccessor<R, floatrealspace, floatrealspace, floatrealspace>
+ *       R = seqan::Dna, seqan::AminoAcid20
+ * </pre>
+ *
+ * A minimal client:
+ *
+ * <pre>
+ *   char           errbuf[eslERRBUFSIZE];
+ *   PROFILLIC_LIB *lib = profillic_lib_Create(NULL, eslDNA, 4, errbuf);
+ *   P7_HMM       **hmms = ...;  // n of them
+ *
+ *   if (lib == NULL) esl_fatal(errbuf);
+ *   if (profillic_lib_BuildBatch(lib, profiles, names, n, hmms) != eslOK)
+ *     esl_fatal(profillic_lib_Error(lib));
+ *   ...
+ *   profillic_lib_Destroy(lib);
+ * </pre>
+ */
+#ifndef __GALOSH_PROFILLICLIB_HPP__
+#define __GALOSH_PROFILLICLIB_HPP__
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+#define new _new
+#include "hmmer.h"
+#undef new
+}
+
+#include "profillic-hmmer.hpp"
+
+/*****************************************************************
+ *# 1. The PROFILLIC_LIB builder.
+ *****************************************************************/
+
+/* A model builder and its workers; see profillic_lib_Create(). */
+typedef struct profillic_lib_s PROFILLIC_LIB;
+
+/* The RNG seed used without a <go>: profillic-hmmbuild's default --seed. */
+#define PROFILLIC_LIB_DEFAULT_SEED 42
+
+/* Profiles per batch that profillic_lib_WriteDatabase() holds models for at once. */
+#define PROFILLIC_LIB_NBATCH 256
+
+/**
+ * <pre>
+ * Function:  profillic_lib_Create()
+ *
+ * Purpose:   Create a builder for models in alphabet <abctype>
+ *            (<eslDNA> or <eslAMINO>), building batches on <ncpus>
+ *            worker threads (0 or 1 for none; always none without
+ *            HMMER_THREADS).
+ *
+ *            If <go> is <NULL>, the defaults of profillic-hmmbuild are
+ *            used (including --seed 42, so that models are
+ *            reproducible). Otherwise it must have the standard build
+ *            options that profillic_p7_builder_Create() takes, and
+ *            --noprior, --w_beta and --w_length, as profillic-hmmbuild's
+ *            does.
+ *
+ * Returns:   the new builder; or <NULL> on failure, with a message in
+ *            <errbuf> (if it isn't <NULL>).
+ * </pre>
+ */
+extern PROFILLIC_LIB      *profillic_lib_Create(const ESL_GETOPTS *go, int abctype, int ncpus, char *errbuf);
+
+/* Free <lib>. Models it made are the caller's, and outlive it. */
+extern void                profillic_lib_Destroy(PROFILLIC_LIB *lib);
+
+/* The alphabet <lib>'s models are made in. */
+extern const ESL_ALPHABET *profillic_lib_Alphabet(const PROFILLIC_LIB *lib);
+
+/* The message explaining <lib>'s last failure (or ""). */
+extern const char         *profillic_lib_Error(const PROFILLIC_LIB *lib);
+
+/*---------------------- end, PROFILLIC_LIB builder --------------------*/
+
+/*****************************************************************
+ *# 2. Building models from profiles.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_lib_Build()
+ *
+ * Purpose:   Build, in the calling thread, the model of <profile>, as
+ *            profillic-hmmbuild would from the profile read from a
+ *            file, and name it <name> (or, if <name> is <NULL>, as a
+ *            read profile is named).
+ *
+ *            The profile is used as given: profillic-alignment-hmmbuild
+ *            normalizes an alignment profile as it reads it (see
+ *            profillic-profile_kind.hpp), so a trainer's should be
+ *            normalized already.  One <lib> builds one model or batch
+ *            at a time; calls on it mustn't overlap.
+ *
+ * Returns:   <eslOK> on success, and <*ret_hmm> is the new model, for
+ *            the caller to free with <p7_hmm_Destroy()>.
+ *
+ *            <eslEINVAL> if <profile>'s residues aren't <lib>'s
+ *            alphabet; <eslEFORMAT> if its consensus isn't valid in it;
+ *            or another code if the build fails. <*ret_hmm> is then
+ *            <NULL>, and profillic_lib_Error() says why.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_lib_Build(PROFILLIC_LIB *lib, ProfileType const & profile, const char *name, P7_HMM **ret_hmm);
+
+/**
+ * <pre>
+ * Function:  profillic_lib_BuildBatch()
+ *
+ * Purpose:   Build the models of the <n> profiles <profiles[0..n-1]>
+ *            into <ret_hmms[0..n-1]> (an array the caller provides),
+ *            sharing them out among <lib>'s worker threads. Model <i>
+ *            is named <names[i]>; or, if <names> (or <names[i]>) is
+ *            <NULL>, "profile<i+1>".
+ *
+ *            Each model is calibrated with the RNG reseeded (unless
+ *            <go> gave --seed 0), so the models don't depend on the
+ *            number of threads.
+ *
+ * Returns:   <eslOK> on success; the caller frees each <ret_hmms[i]>
+ *            with <p7_hmm_Destroy()>.
+ *
+ *            As profillic_lib_Build(), for the first profile that
+ *            fails; then all of <ret_hmms> are <NULL>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_lib_BuildBatch(PROFILLIC_LIB *lib, ProfileType const * const *profiles, const char * const *names, int n, P7_HMM **ret_hmms);
+
+/**
+ * <pre>
+ * Function:  profillic_lib_WriteDatabase()
+ *
+ * Purpose:   As profillic_lib_BuildBatch(), but save the models, in
+ *            input order, to HMM file <hmmfile> (gzip- or
+ *            zstd-compressed, if it ends in ``.gz'' or ``.zst''; see
+ *            profillic-compress.hpp) instead of returning them. Only
+ *            PROFILLIC_LIB_NBATCH models are held at a time.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ *            <eslFAIL> if <hmmfile> can't be opened, or <eslEWRITE>
+ *            if it can't be written; or as profillic_lib_Build(), for
+ *            the first profile that fails. profillic_lib_Error() says
+ *            why; <hmmfile> is then incomplete.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_lib_WriteDatabase(PROFILLIC_LIB *lib, ProfileType const * const *profiles, const char * const *names, int n, const char *hmmfile);
+
+/*---------------------- end, building models --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICLIB_HPP__
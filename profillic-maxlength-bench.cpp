@@ -0,0 +1,242 @@
+/**
+ * \file profillic-maxlength-bench.cpp
+ * \brief
+ * Micro-benchmark of profillic_p7_Builder_MaxLength() against the old engine
+ * \details
+<pre>
+Usage: profillic-maxlength-bench [-options]
+
+Options:
+  -h          : show brief help on version and usage
+  -s <n>      : set random number seed to <n>  [42]
+  -N <n>      : number of sampled models per length  [20]
+  --Mmin <n>  : smallest model length  [100]
+  --Mmax <n>  : largest model length (lengths double from --Mmin)  [12800]
+  --beta <x>  : tail mass at which window length is determined  [1e-7]
+</pre>
+ *
+ * For each model length M it samples <N> random DNA HMMs and times the
+ * window-length computation on each, with both the rows-of-two-doubles
+ * table that profillic_p7_Builder_MaxLength() used to fill and the
+ * current engine (profillic-maxlength.hpp), and reports the CPU seconds
+ * per model, the speedup, and how many of the <N> <max_length>s agree
+ * (they all should).
+ */
+extern "C" {
+#include "p7_config.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern "C" {
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+#include "esl_random.h"
+#include "esl_stopwatch.h"
+#define new _new
+#include "hmmer.h"
+#undef new
+}
+
+#include "profillic-hmmer.hpp"
+#include "profillic-maxlength.hpp"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range     toggles   reqs   incomp  help   docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,      NULL,  NULL, NULL, "show brief help on version and usage",                     0 },
+  { "-s",        eslARG_INT,     "42", NULL, "n>=0",    NULL,  NULL, NULL, "set random number seed to <n>",                            0 },
+  { "-N",        eslARG_INT,     "20", NULL, "n>0",     NULL,  NULL, NULL, "number of sampled models per length",                      0 },
+  { "--Mmin",    eslARG_INT,    "100", NULL, "n>1",     NULL,  NULL, NULL, "smallest model length",                                    0 },
+  { "--Mmax",    eslARG_INT,  "12800", NULL, "n>1",     NULL,  NULL, NULL, "largest model length (lengths double from --Mmin)",        0 },
+  { "--beta",    eslARG_REAL,  "1e-7", NULL, "0<x<1",   NULL,  NULL, NULL, "tail mass at which window length is determined",           0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+static char usage[]  = "[-options]";
+static char banner[] = "benchmark the window-length (max_length) engine";
+
+/* The engine as it was: one two-double row per state in each of I, M, D. */
+static int
+reference_MaxLength (P7_HMM *hmm, double emit_thresh)
+{
+  int      col_ptr, prev_col_ptr; // which true column in above 2d-arrays is active
+  int      col;                   // which conceptual column in above 2d-arrays is active (up to table_len)
+  double   p_sum;                 // sum of probabilities for lengths <=L;  X from above
+  double   surv;                  // surviving probability mass at length L; Y from above
+  int      k;                     // active state in model
+  int      i;
+  int      length_bound = 200000; // default cap on # iterations (aka max model length)
+  double **I            = NULL;
+  double **M            = NULL;
+  double **D            = NULL;
+  int      model_len    = hmm->M; // model length                
+  int      status;
+  
+  if (model_len==1) {
+    hmm->max_length = 1;
+    return eslOK;
+  }
+
+
+  //    double I[model_len+1][2], M[model_len+1][2], D[model_len+1][2]; //2 columns for each way of ending a subpath
+  ESL_ALLOC_CPP(double*, I, (model_len+1) * sizeof(double*)); 
+  ESL_ALLOC_CPP(double*, M, (model_len+1) * sizeof(double*)); 
+  ESL_ALLOC_CPP(double*, D, (model_len+1) * sizeof(double*)); 
+  for (i = 0; i <= model_len; i++) {
+    I[i] = M[i] = D[i] = NULL; 
+  }
+  for (i=0; i <= model_len; i++) {
+    ESL_ALLOC_CPP(double, I[i], 2 * sizeof(double));
+    ESL_ALLOC_CPP(double, M[i], 2 * sizeof(double));
+    ESL_ALLOC_CPP(double, D[i], 2 * sizeof(double));
+  }
+
+  /*  Compute max length and max prefix lengths*/
+  // special case for filling in 1st column of DP table,  col=1;
+  M[1][0] = 1.0;// 1st match state must emit a character
+  I[1][0] = D[1][0] = M[2][0] = I[2][0] = 0;
+  D[2][0] = hmm->t[1][p7H_MD];  // The 2nd delete state is reached, having emitted only 1 character
+  for (k=3; k<=model_len; k++){
+    M[k][0] = I[k][0] = 0;
+    D[k][0] = hmm->t[k-1][p7H_DD] * D[k-1][0];  // only way to get to the 3rd or greater state with only 1 character
+  }
+
+  //special case for 2nd column
+  M[1][1] = D[1][1] = D[2][1] = I[2][1] = 0;  //No way any of these states can be responsible for the second emitted character.
+  I[1][1] = hmm->t[1][p7H_MI] * M[1][0];  //1st insert state can emit char #2.
+  M[2][1] = hmm->t[1][p7H_MM] * M[1][0] ; //2nd match state can emit char #2.
+  for (k=3; k<=model_len; k++){
+    M[k][1] = hmm->t[k-1][p7H_DM] * D[k-1][0] ; //kth match state would have to follow the k-1th delete state, having emitted only 1 char so far
+    I[k][1] = 0;
+    D[k][1] = hmm->t[k-1][p7H_MD] * M[k-1][1]  +  hmm->t[k-1][p7H_DD] * D[k-1][1]; //in general only by extending a delete.  For k=3, this could be a transition from M=2, with 2 chars.
+  }
+
+  p_sum = M[model_len][0] + M[model_len][1] + D[model_len][0] + D[model_len][1];
+
+  //general case for all remaining columns
+  col_ptr = 0;
+  for (col=3; col<=length_bound; col++) {
+    prev_col_ptr = 1-col_ptr;
+    surv = 0.0;
+    M[1][col_ptr] = D[1][col_ptr] = 0; //M[i][prev_col_ptr] is zero :  no way the first M state could have emitted >=2 chars
+    I[1][col_ptr] =  hmm->t[1][p7H_II] * I[1][prev_col_ptr];  // 1st insert state can emit chars indefinitely
+    surv += I[1][col_ptr];
+
+    for (k=2; k<=model_len; k++){
+      M[k][col_ptr] = hmm->t[k-1][p7H_MM] * M[k-1][prev_col_ptr]  +  hmm->t[k-1][p7H_DM] * D[k-1][prev_col_ptr]  +  hmm->t[k-1][p7H_IM] * I[k-1][prev_col_ptr];
+      I[k][col_ptr] = hmm->t[k][p7H_MI] * M[k][prev_col_ptr]    +  hmm->t[k][p7H_II] * I[k][prev_col_ptr];
+      D[k][col_ptr] = hmm->t[k-1][p7H_MD] * M[k-1][col_ptr]  +  hmm->t[k-1][p7H_DD] * D[k-1][col_ptr];
+
+      if (k<=model_len) {
+        surv +=  I[k][col_ptr] +
+     	           M[k][col_ptr] * ( 1 - hmm->t[k][p7H_MD] ) +  //this much of M[k]'s mass will bleed into D[k+1], and thus be added to surv then
+                 D[k][col_ptr] * ( 1 - hmm->t[k][p7H_DD] )  ; //this much of D[k]'s mass will bleed into D[k+1], and thus be added to surv then
+      }
+    }
+    surv +=    M[model_len][col_ptr] * ( hmm->t[model_len][p7H_MD] )   //the final state doesn't pass on to the next D state
+             + D[model_len][col_ptr] * ( hmm->t[model_len][p7H_DD] )  // the final state doesn't pass on to the next D state
+             - I[model_len][col_ptr] ;  // no I state for final position
+
+    p_sum += M[model_len][col_ptr] + D[model_len][col_ptr];
+    surv /= surv + p_sum;
+
+    if (surv < emit_thresh) {
+      hmm->max_length = col;
+      break;
+    }
+
+    col_ptr = 1-col_ptr; // alternating between 0 and 1
+  }
+
+  for (i=0; i<model_len+1; i++) {
+    free(I[i]);
+    free(M[i]);
+    free(D[i]);
+  }
+  free(I);
+  free(M);
+  free(D);
+
+  if (hmm->max_length >= length_bound) return eslERANGE;
+  return eslOK;
+  
+ ERROR:
+  if (I) { for (i = 0; i <= model_len; i++) { if (I[i]) free(I[i]); }  free(I);  }
+  if (D) { for (i = 0; i <= model_len; i++) { if (D[i]) free(D[i]); }  free(D);  }
+  if (M) { for (i = 0; i <= model_len; i++) { if (M[i]) free(M[i]); }  free(M);  }
+  return status;
+}
+
+/**
+ * \fn int main(int argc,char **argv)
+ * main driver
+ *
+ */
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS     *go   = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS  *r    = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET    *abc  = esl_alphabet_Create(eslDNA);
+  ESL_STOPWATCH   *w    = esl_stopwatch_Create();
+  P7_HMM         **hmm  = NULL;
+  int             *ref_len = NULL;
+  int              N    = esl_opt_GetInteger(go, "-N");
+  int              Mmin = esl_opt_GetInteger(go, "--Mmin");
+  int              Mmax = esl_opt_GetInteger(go, "--Mmax");
+  double           beta = esl_opt_GetReal   (go, "--beta");
+  double           t_ref, t_new;
+  int              nsame;
+  int              M, i;
+  int              status;
+
+  ESL_ALLOC_CPP(P7_HMM *, hmm,     sizeof(P7_HMM *) * N);
+  ESL_ALLOC_CPP(int,      ref_len, sizeof(int)      * N);
+
+  printf("# %8s %6s %12s %12s %8s %8s\n", "M",        "N",      "ref s/model",  "new s/model",  "speedup",  "same");
+  printf("# %8s %6s %12s %12s %8s %8s\n", "--------", "------", "------------", "------------", "--------", "--------");
+
+  for (M = Mmin; M <= Mmax; M *= 2)
+    {
+      for (i = 0; i < N; i++)
+        if (p7_hmm_Sample(r, M, abc, &(hmm[i])) != eslOK) esl_fatal("failed to sample an HMM of length %d", M);
+
+      esl_stopwatch_Start(w);
+      for (i = 0; i < N; i++) {
+        hmm[i]->max_length = -1;
+        reference_MaxLength(hmm[i], beta);
+        ref_len[i] = hmm[i]->max_length;
+      }
+      esl_stopwatch_Stop(w);
+      t_ref = w->user + w->sys;
+
+      esl_stopwatch_Start(w);
+      for (i = 0; i < N; i++) {
+        hmm[i]->max_length = -1;
+        profillic_p7_Builder_MaxLength(hmm[i], beta);
+      }
+      esl_stopwatch_Stop(w);
+      t_new = w->user + w->sys;
+
+      for (nsame = 0, i = 0; i < N; i++) {
+        if (hmm[i]->max_length == ref_len[i]) nsame++;
+        p7_hmm_Destroy(hmm[i]);
+      }
+
+      printf("  %8d %6d %12.6f %12.6f %8.2f %5d/%-3d\n", M, N, t_ref / N, t_new / N, (t_new > 0. ? t_ref / t_new : 0.), nsame, N);
+      fflush(stdout);
+    }
+
+  free(ref_len);
+  free(hmm);
+  esl_stopwatch_Destroy(w);
+  esl_alphabet_Destroy(abc);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return 0;
+
+ ERROR:
+  p7_Fail("profillic-maxlength-bench failed: memory allocation problem");
+}
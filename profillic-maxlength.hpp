@@ -0,0 +1,310 @@
+/**
+ * \file profillic-maxlength.hpp
+ * \brief
+ * Window length (max_length) of nucleotide models, shared by the builders.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Window length.
+ *     2. Copyright and license.
+ * </pre>
+ *
+ * profillic_p7_Builder() (profillic-p7_builder.hpp), for both
+ * profillic-hmmbuild and profillic-alignment-hmmbuild, sets
+ * <hmm->max_length> of DNA and RNA models through the one engine here.
+ */
+#ifndef __GALOSH_PROFILLICMAXLENGTH_HPP__
+#define __GALOSH_PROFILLICMAXLENGTH_HPP__
+
+#include <stdlib.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "base/p7_hmm.h"
+}
+
+#include "profillic-hmmer.hpp"
+
+/*****************************************************************
+ *# 1. Window length.
+ *****************************************************************/
+
+/* Number of doubles of scratch space the engine works in, for a model of length <M>. */
+#define PROFILLIC_MAXLENGTH_NSCRATCH(M)  (15 * ((M) + 1))
+
+int profillic_p7_Builder_MaxLengthScratch (P7_HMM *hmm, double emit_thresh, double *mem);
+
+/**
+ * <pre>
+ * Function:  profillic_p7_Builder_MaxLength()
+ *
+ * Purpose:  Compute the maximum likely length of an emitted sequence
+ *
+ * Synopsis:   Computes a fairly tight upper bound on domain length, by computing the
+ * probability of the model emitting sequences of all lengths up to some
+ * threshold, based on a dynamic-programming approach.  See TJW 01/14/2010 notes (p1)
+ *
+ * The idea is to find the length such that all but e.g. 1e-7 sequences emitted
+ * by the model are at most that long. The method conceptually fills in a table of
+ * length at most max_len (set to 100,000), though in practice, only two columns are
+ * used to store values;
+ *
+ * Letting i correspond to the ith state of the model,
+ *         j to a length j of emitted sequence, and
+ *    T[i][P7H_*M]  := transition prob from *_i to M_{i+1}
+ *    T[i][P7H_*I]  := transition prob from *_i to I_i
+ *    T[i][P7H_*D]  := transition prob from *_i to D_{i+1}
+ *
+ *
+ * in general,
+ * M(i,j) = T[i-1][P7H_MM] * M(i-1,j-1) + T[i-1][P7H_DM] * D(i-1,j-1) + T[i-1][P7H_IM] * I(i-1,j-1);
+ * I(i,j) = T[i][P7H_MI] * M(i,j-1) + T[i][P7H_II] * I(i,j-1);
+ * D(i,j) = T[i-1][P7H_MD] * M(i-1,j) + T[i-1][P7H_DD] * D(i-1,j);
+ *
+ * The process of filling in the dp table is done for only the full core model.
+ * We want to minimize memory consumption, so this is handled column-by-column,
+ * storing only 2 columns at a time.
+ *
+ * Initial values must be set.
+ * This is simple:
+ *   M(1,1) = 1;
+ *   I(1,1) = 0;
+ *   D(1,1) = 0;
+ *   D(2,1) = md;
+ * Fill in the remainder of rows
+ *   M(r,1) = I(r,1) = 0;
+ *   D(r,1) = dd * D(r-1,1)
+ *
+ *
+ * Then the next column:
+ *   M(1,2) = D(1,2) = 0;
+ *   I(1,2) = mi * M(1,1);
+ *   I(2,2) = D(2,2) = 0;
+ *   M(2,2) = mm * M(1,1);
+ *   D(3,2) = md * M(2,2);
+ * Fill in the remainder of rows r:
+ *   M(r,2) = dm * M(r-1,1);
+ *   D(r,2) = dd * D(r-1,2);
+ *   I(r,2) = 0;
+ *
+ *
+ *
+ * Then for each column c after that,
+ *   M(1,c) = D(1,c) = 0;
+ *   I(1,c) =  ii * I(1,c-1)
+ * Fill in the remainder of rows r based on the default formulas above
+ * Then:
+ *   M(i,j) = T[i-1][P7H_MM] * M(i-1,j-1) + T[i-1][P7H_DM] * D(i-1,j-1) + T[i-1][P7H_IM] * I(i-1,j-1);
+ *   D(i,j) = T[i-1][P7H_MD] * M(i-1,j) + T[i-1][P7H_DD] * D(i-1,j);
+ *   I(i,j) = T[i][P7H_MI] * M(i,j-1) + T[i][P7H_II] * I(i,j-1);
+ *
+ *
+ * We aim to find the length W s.t. nearly all (e.g. all but 1e-7) of the sequences
+ * emitted by the model are at most W long. Ideally, we could track the probability
+ * of emitting each length from 0 up, and accumulate those probabilities until the
+ * threshold is met. The probability of seeing a sequence of a given length emitted
+ * by the full model is simply the sum of the D[m] and M[m] values (for a model of
+ * length m). (I[m] is a false value - see below)
+ *
+ * I say "ideally", because numeric instability can lead the sum of all lengths - up
+ * to infinity - to be <0.99999 or >1.0 ... so instead we keep track of two things for
+ * each length L:
+ * (1) the sum of D[m] and M[m] prob masses for all lengths up to L  (call this X), and
+ * (2) the amount of the probability mass that belongs to all L-length-emitting states
+ * except the final M/D states.  That's the mass that will end up being spread across
+ * all lengths >L (call this Y).
+ *
+ * If not for numeric instability, X+Y=1, and we'd want to stop when Y <= 1e-7.  Because
+ * X+Y might not == 1, instead stop when Y/(X+Y) <= 1e-7.
+ *
+ * A note for computing X: the final position in the model does not actually include an
+ * I-state, so all of the final M state's probability mass should go to the E state.
+ * The value in I[m][] will suggest that some of that probability has gone to that state,
+ * but this will be ignored when tallying X = M[m]+D[m].
+ *
+ * A note on the calculation of Y: it's not quite as simple as adding up all pre-m
+ * states. For a given length j, the only way a D[i]-state can emit a sequence of length
+ * j is if an M[k] state emitted that sequence, with k<i.  If k<i-1, then other D states
+ * were also involved. The simplest way to account for this is to bleed the part of the
+ * M[i] or D[i] state that gets pushed forward into the next D state. That amount will
+ * end up being accounted for by either that later D state or (for the small part that
+ * bleeds all the way to the mth D state, it'll be added into X via D[m].  In other words:
+ * (1) each M[i] should contribute (1-t_md)M[i] to Y.
+ * (2) each D[i] should contribute (1-t_dd)D[i] to Y.
+ *
+ *
+ * The engine keeps the two columns as contiguous arrays (one per state
+ * type: structure-of-arrays), swapped rather than copied from column to
+ * column, and reads the transitions from per-state arrays hoisted out of
+ * <hmm->t> once, already offset so that every update of state <k> reads
+ * index <k>.  Each column is then two sweeps over <k>: the M and I
+ * updates depend only on the previous column, so that sweep has no
+ * loop-carried dependence and vectorizes; the D update (a chain down
+ * the current column) and the survival sum stay in a second,
+ * sequential sweep, which keeps every sum in the original order, so
+ * <max_length> is bit-for-bit what the old row-by-row table gave.
+ * The column loop stops as soon as the surviving mass falls below
+ * <emit_thresh>.
+ *
+ * Args:      hmm         - p7_HMM (required for the transition probabilities)
+ *            emit_thresh - stop when the surviving mass falls below this
+ *
+ * Returns:   <eslOK> on success. The max length is set in hmm->max_length.
+ *            <eslERANGE> if the bound on the number of columns was hit.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+int
+profillic_p7_Builder_MaxLength (P7_HMM *hmm, double emit_thresh)
+{
+  double  *mem = NULL;
+  int      status;
+
+  ESL_ALLOC_CPP(double, mem, sizeof(double) * PROFILLIC_MAXLENGTH_NSCRATCH(hmm->M));
+  status = profillic_p7_Builder_MaxLengthScratch(hmm, emit_thresh, mem);
+  free(mem);
+  return status;
+
+ ERROR:
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_p7_Builder_MaxLengthScratch()
+ *
+ * Purpose:   The same as <profillic_p7_Builder_MaxLength()>, but working
+ *            in the caller's <mem>, of at least
+ *            <PROFILLIC_MAXLENGTH_NSCRATCH(hmm->M)> doubles, instead of
+ *            allocating its own; a worker that builds many models keeps
+ *            one such buffer (see profillic-build_pool.hpp).
+ *
+ * Returns:   As <profillic_p7_Builder_MaxLength()>.
+ * </pre>
+ */
+int
+profillic_p7_Builder_MaxLengthScratch (P7_HMM *hmm, double emit_thresh, double *mem)
+{
+  int      col;                   // which conceptual column of the table is active (up to length_bound)
+  double   p_sum;                 // sum of probabilities for lengths <=L;  X from above
+  double   surv;                  // surviving probability mass at length L; Y from above
+  int      k;                     // active state in model
+  int      length_bound = 200000; // default cap on # iterations (aka max model length)
+  int      model_len    = hmm->M; // model length
+  int      n            = model_len + 1;
+  double  *Mp, *Ip, *Dp;          // previous column
+  double  *Mc, *Ic, *Dc;          // current column
+  double  *tmp;
+  double  *a_mm, *a_dm, *a_im;    // t[k-1][MM], t[k-1][DM], t[k-1][IM]: into M_k
+  double  *a_md, *a_dd;           // t[k-1][MD], t[k-1][DD]: into D_k
+  double  *t_mi, *t_ii;           // t[k][MI], t[k][II]: into I_k
+  double  *s_md, *s_dd;           // 1-t[k][MD], 1-t[k][DD]: what M_k, D_k keep from D_k+1
+
+  if (model_len==1) {
+    hmm->max_length = 1;
+    return eslOK;
+  }
+
+  Mp   = mem;          Ip   = mem +     n;  Dp   = mem + 2 * n;
+  Mc   = mem + 3 * n;  Ic   = mem + 4 * n;  Dc   = mem + 5 * n;
+  a_mm = mem + 6 * n;  a_dm = mem + 7 * n;  a_im = mem + 8 * n;
+  a_md = mem + 9 * n;  a_dd = mem + 10 * n;
+  t_mi = mem + 11 * n; t_ii = mem + 12 * n;
+  s_md = mem + 13 * n; s_dd = mem + 14 * n;
+
+  // The survival factors are computed in float, just as the expression
+  // ( 1 - hmm->t[k][p7H_MD] ) always was, so that the sums match exactly.
+  a_mm[0] = a_dm[0] = a_im[0] = a_md[0] = a_dd[0] = 0.;
+  t_mi[0] = t_ii[0] = s_md[0] = s_dd[0] = 0.;
+  for (k=1; k<=model_len; k++) {
+    if (k > 1) {
+      a_mm[k] = hmm->t[k-1][p7H_MM];
+      a_dm[k] = hmm->t[k-1][p7H_DM];
+      a_im[k] = hmm->t[k-1][p7H_IM];
+      a_md[k] = hmm->t[k-1][p7H_MD];
+      a_dd[k] = hmm->t[k-1][p7H_DD];
+    } else {
+      a_mm[k] = a_dm[k] = a_im[k] = a_md[k] = a_dd[k] = 0.;
+    }
+    t_mi[k] = hmm->t[k][p7H_MI];
+    t_ii[k] = hmm->t[k][p7H_II];
+    s_md[k] = ( 1 - hmm->t[k][p7H_MD] );
+    s_dd[k] = ( 1 - hmm->t[k][p7H_DD] );
+  }
+
+  /*  Compute max length and max prefix lengths*/
+  // special case for filling in 1st column of DP table,  col=1; (it goes in Mp/Ip/Dp)
+  Mp[0] = Ip[0] = Dp[0] = 0.;
+  Mp[1] = 1.0;// 1st match state must emit a character
+  Ip[1] = Dp[1] = Mp[2] = Ip[2] = 0;
+  Dp[2] = hmm->t[1][p7H_MD];  // The 2nd delete state is reached, having emitted only 1 character
+  for (k=3; k<=model_len; k++){
+    Mp[k] = Ip[k] = 0;
+    Dp[k] = a_dd[k] * Dp[k-1];  // only way to get to the 3rd or greater state with only 1 character
+  }
+
+  //special case for 2nd column (it goes in Mc/Ic/Dc)
+  Mc[0] = Ic[0] = Dc[0] = 0.;
+  Mc[1] = Dc[1] = Dc[2] = Ic[2] = 0;  //No way any of these states can be responsible for the second emitted character.
+  Ic[1] = t_mi[1] * Mp[1];  //1st insert state can emit char #2.
+  Mc[2] = a_mm[2] * Mp[1] ; //2nd match state can emit char #2.
+  for (k=3; k<=model_len; k++){
+    Mc[k] = a_dm[k] * Dp[k-1] ; //kth match state would have to follow the k-1th delete state, having emitted only 1 char so far
+    Ic[k] = 0;
+    Dc[k] = a_md[k] * Mc[k-1]  +  a_dd[k] * Dc[k-1]; //in general only by extending a delete.  For k=3, this could be a transition from M=2, with 2 chars.
+  }
+
+  p_sum = Mp[model_len] + Mc[model_len] + Dp[model_len] + Dc[model_len];
+
+  //general case for all remaining columns
+  for (col=3; col<=length_bound; col++) {
+    tmp = Mp; Mp = Mc; Mc = tmp;
+    tmp = Ip; Ip = Ic; Ic = tmp;
+    tmp = Dp; Dp = Dc; Dc = tmp;
+
+    Mc[1] = Dc[1] = 0; //no way the first M state could have emitted >=2 chars
+    Ic[1] = t_ii[1] * Ip[1];  // 1st insert state can emit chars indefinitely
+
+    // M and I come from the previous column only: no dependence between k's.
+    for (k=2; k<=model_len; k++) {
+      Mc[k] = a_mm[k] * Mp[k-1]  +  a_dm[k] * Dp[k-1]  +  a_im[k] * Ip[k-1];
+      Ic[k] = t_mi[k] * Mp[k]    +  t_ii[k] * Ip[k];
+    }
+
+    // D chains down this column; the survival sum is kept in the same k order as ever.
+    surv = 0.0;
+    surv += Ic[1];
+    for (k=2; k<=model_len; k++) {
+      Dc[k] = a_md[k] * Mc[k-1]  +  a_dd[k] * Dc[k-1];
+      surv +=  Ic[k] +
+               Mc[k] * s_md[k] +  //this much of M[k]'s mass will bleed into D[k+1], and thus be added to surv then
+               Dc[k] * s_dd[k]  ; //this much of D[k]'s mass will bleed into D[k+1], and thus be added to surv then
+    }
+    surv +=    Mc[model_len] * ( hmm->t[model_len][p7H_MD] )   //the final state doesn't pass on to the next D state
+             + Dc[model_len] * ( hmm->t[model_len][p7H_DD] )  // the final state doesn't pass on to the next D state
+             - Ic[model_len] ;  // no I state for final position
+
+    p_sum += Mc[model_len] + Dc[model_len];
+    surv /= surv + p_sum;
+
+    if (surv < emit_thresh) {
+      hmm->max_length = col;
+      break;
+    }
+  }
+
+  if (hmm->max_length >= length_bound) return eslERANGE;
+  return eslOK;
+}
+
+/*---------------------- end, window length --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICMAXLENGTH_HPP__
@@ -0,0 +1,233 @@
+/**
+ * \file profillic-modelstats.hpp
+ * \brief
+ * The per-model statistics the profillic tools report, in one pass.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Match emission statistics.
+ *     2. The stats line.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * profillic-hmmtoprofile, -hmmcalibrate, -hmmunifytransitions and
+ * -hmmcopytransitions each print a line of stats per model, and
+ * profillic-hmmbuild prints the mean match relative entropy.  Called
+ * one after another, p7_MeanMatchRelativeEntropy(), p7_MeanMatchInfo(),
+ * p7_MeanPositionRelativeEntropy() and p7_hmm_CompositionKLDist() walk
+ * the match emissions four times, taking logarithms on each walk;
+ * p7_MeanMatchInfo() recomputes the background's entropy at every
+ * position; and the last two each allocate and compute the match
+ * occupancy again.  profillic_hmm_StatsPass() gets all four numbers
+ * from one walk: one logarithm per emission, the background's logs and
+ * entropy computed once, and the occupancy carried along the walk (it
+ * depends only on the node before), so nothing is allocated.  (It
+ * accumulates in float per position, as the Easel vector routines do,
+ * so the numbers agree with HMMER's to the printed precision.)
+ *
+ * Tools' --nostats skips all of it.
+ */
+#ifndef __GALOSH_PROFILLICMODELSTATS_HPP__
+#define __GALOSH_PROFILLICMODELSTATS_HPP__
+
+#include <stdio.h>
+#include <math.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_vectorops.h"
+#define new _new
+#include "hmmer.h"
+#undef new
+}
+
+#include "profillic-hmmer.hpp"
+
+/* One model's stats line. */
+typedef struct {
+  int    is_set;   /* FALSE if not computed (--nostats)                 */
+  double relent;   /* mean match relative entropy, in bits              */
+  double info;     /* mean match information, in bits                   */
+  double prelent;  /* mean position relative entropy (p relE), in bits  */
+  float  KL;       /* composition KL distance (compKL)                  */
+} PROFILLIC_HMM_STATS;
+
+/*****************************************************************
+ *# 1. Match emission statistics.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_StatsPass()
+ *
+ * Purpose:   Compute, in one pass over <hmm>'s emissions against <bg>:
+ *            the mean match relative entropy (as
+ *            <p7_MeanMatchRelativeEntropy()>), returned; and, for each
+ *            of these that isn't <NULL>, the mean match information
+ *            (as <p7_MeanMatchInfo()>) into <*opt_info>, the mean
+ *            position relative entropy, weighted by match and insert
+ *            occupancy (as <p7_MeanPositionRelativeEntropy()>), into
+ *            <*opt_prelent>, and the KL distance of the model's
+ *            occupancy-weighted composition from <bg> (as
+ *            <p7_hmm_CompositionKLDist()>) into <*opt_KL>.  All are in
+ *            bits.
+ *
+ *            The occupancy (as <p7_hmm_CalculateOccupancy()>) is only
+ *            followed if <opt_prelent> or <opt_KL> is asked for.
+ *
+ * Returns:   the mean match relative entropy.
+ * </pre>
+ */
+static double
+profillic_hmm_StatsPass(const P7_HMM *hmm, const P7_BG *bg, double *opt_info, double *opt_prelent, float *opt_KL)
+{
+  double logf[p7_MAXABET];   /* log of each background frequency (-inf for a zero one) */
+  float  comp[p7_MAXABET];   /* occupancy-weighted composition */
+  int    K       = hmm->abc->K;
+  int    do_occ  = (opt_prelent != NULL || opt_KL != NULL);
+  double Hbg;
+  double relent  = 0.;
+  double info    = 0.;
+  double mre     = 0., ire     = 0.;
+  double mocctot = 0., iocctot = 0.;
+  double lp;
+  float  mocc    = 0.;       /* match occupancy of node k */
+  float  iocc;               /* expected insert count at node k */
+  float  re, h, ire_k, KL;
+  float  p;
+  int    k, x;
+
+  for (x = 0; x < K; x++) logf[x] = log(bg->f[x]);
+  Hbg = esl_vec_FEntropy(bg->f, K);
+  if (opt_KL != NULL) esl_vec_FSet(comp, K, 0.);
+
+  for (k = 1; k <= hmm->M; k++)
+    {
+      re = h = 0.;
+      for (x = 0; x < K; x++)
+        if ((p = hmm->mat[k][x]) > 0.)
+          {
+            lp  = log(p);
+            re += p * (lp - logf[x]);
+            h  += p * lp;
+          }
+      relent += re / eslCONST_LOG2;
+      info   += Hbg + h / eslCONST_LOG2;   /* Hbg - H(mat[k]) */
+
+      if (! do_occ) continue;
+
+      if (k == 1) mocc = hmm->t[0][p7H_MI] + hmm->t[0][p7H_MM];
+      else        mocc = mocc * (hmm->t[k-1][p7H_MM] + hmm->t[k-1][p7H_MI]) + (1.0 - mocc) * hmm->t[k-1][p7H_DM];
+      iocc = mocc * hmm->t[k][p7H_MI] / hmm->t[k][p7H_IM];
+
+      mre     += mocc * (re / eslCONST_LOG2);
+      mocctot += mocc;
+      if (opt_KL != NULL) esl_vec_FAddScaled(comp, hmm->mat[k], mocc, K);
+
+      if (k == hmm->M) continue;   /* node M has no insert state */
+      if (opt_prelent != NULL)
+        {
+          ire_k = 0.;
+          for (x = 0; x < K; x++)
+            if ((p = hmm->ins[k][x]) > 0.) ire_k += p * (log(p) - logf[x]);
+          ire     += iocc * (ire_k / eslCONST_LOG2);
+          iocctot += iocc;
+        }
+      if (opt_KL != NULL) esl_vec_FAddScaled(comp, hmm->ins[k], iocc, K);
+    }
+
+  if (opt_KL != NULL)
+    {
+      esl_vec_FNorm(comp, K);
+      KL = 0.;
+      for (x = 0; x < K; x++)
+        if (comp[x] > 0.) KL += comp[x] * (log(comp[x]) - logf[x]);
+      *opt_KL = KL / eslCONST_LOG2;
+    }
+  if (opt_prelent != NULL) *opt_prelent = (mre + ire) / (mocctot + iocctot);
+  if (opt_info    != NULL) *opt_info    = info / (double) hmm->M;
+  return relent / (double) hmm->M;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_MatchStats()
+ *
+ * Purpose:   Compute the mean match relative entropy of <hmm> to <bg>
+ *            (as <p7_MeanMatchRelativeEntropy()>), and, if <opt_info>
+ *            isn't <NULL>, the mean match information (as
+ *            <p7_MeanMatchInfo()>) into <*opt_info>, in bits, by
+ *            profillic_hmm_StatsPass() without the occupancy.
+ *
+ * Returns:   the mean match relative entropy.
+ * </pre>
+ */
+static double
+profillic_hmm_MatchStats(const P7_HMM *hmm, const P7_BG *bg, double *opt_info)
+{
+  return profillic_hmm_StatsPass(hmm, bg, opt_info, NULL, NULL);
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_Stats()
+ *
+ * Purpose:   Fill in <*ret_stats> with <hmm>'s stats line against
+ *            background <bg>, from one profillic_hmm_StatsPass(); or,
+ *            if <bg> is <NULL> (--nostats), just mark it as not
+ *            computed.
+ *
+ * Returns:   <eslOK>.
+ * </pre>
+ */
+static int
+profillic_hmm_Stats(P7_HMM *hmm, P7_BG *bg, PROFILLIC_HMM_STATS *ret_stats)
+{
+  ret_stats->is_set = FALSE;
+  if (bg == NULL) return eslOK;
+
+  ret_stats->relent = profillic_hmm_StatsPass(hmm, bg, &(ret_stats->info), &(ret_stats->prelent), &(ret_stats->KL));
+  ret_stats->is_set = TRUE;
+  return eslOK;
+}
+
+/*---------------------- end, match emission statistics --------------------*/
+
+/*****************************************************************
+ *# 2. The stats line.
+ *****************************************************************/
+
+/* Print the two header lines of the stats table to <fp>. */
+static void
+profillic_hmm_PrintStatsHeader(FILE *fp)
+{
+  fprintf(fp, "# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "idx",  "name",                 "accession",    "nseq",     "eff_nseq", "M",      "relent", "info",   "p relE", "compKL");
+  fprintf(fp, "# %-4s %-20s %-12s %8s %8s %6s %6s %6s %6s %6s\n", "----", "--------------------", "------------", "--------", "--------", "------", "------", "------", "------", "------");
+}
+
+/* Print the stats line of <hmm>, number <nhmm>, to <fp>; the stats columns are "-" if <stats> isn't set. */
+static void
+profillic_hmm_PrintStats(FILE *fp, int nhmm, const P7_HMM *hmm, const PROFILLIC_HMM_STATS *stats)
+{
+  fprintf(fp, "%-6d %-20s %-12s %8d %8.2f %6d ",
+          nhmm,
+          hmm->name,
+          hmm->acc == NULL ? "-" : hmm->acc,
+          hmm->nseq,
+          hmm->eff_nseq,
+          hmm->M);
+  if (stats->is_set) fprintf(fp, "%6.2f %6.2f %6.2f %6.2f\n", stats->relent, stats->info, stats->prelent, stats->KL);
+  else               fprintf(fp, "%6s %6s %6s %6s\n", "-", "-", "-", "-");
+}
+
+/*---------------------- end, stats line --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICMODELSTATS_HPP__
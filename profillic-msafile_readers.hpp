@@ -0,0 +1,443 @@
+/**
+ * \file profillic-msafile_readers.hpp
+ * \brief
+ * Parsing an alignment database with several threads, each reading
+ * its own records from their byte offsets (hmmbuild --readers).
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Finding record offsets.
+ *     2. The reader threads.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * On a big Stockholm database, one thread parsing every alignment can
+ * be slower than many threads building models from them.  Here each
+ * of <nthreads> threads opens the file for itself and parses whole
+ * records, starting from byte offsets found up front: from an SSI
+ * index <msafile>.ssi (as made by esl-afetch --index) if there is one,
+ * or else by one quick pass over the file for "//" record terminators.
+ *
+ * Records are claimed by the threads in file order, and parsed
+ * alignments wait in a reorder ring until profillic_readers_Read()
+ * returns them, again in file order; so to the caller this is just a
+ * faster eslx_msafile_Read().  A thread waits before claiming a record
+ * <nring> or more ahead of the next one to be returned, which bounds
+ * the memory held by parsed alignments; the thread with the next
+ * record never waits, so the readers always make progress.
+ *
+ * Only Stockholm (and Pfam) files can be read this way: their records
+ * are self-contained, so any one of them can be parsed without the
+ * ones before it; and the file must be seekable (not a pipe, nor
+ * gzipped).
+ */
+#ifndef __GALOSH_PROFILLICMSAFILEREADERS_HPP__
+#define __GALOSH_PROFILLICMSAFILEREADERS_HPP__
+
+#ifdef HMMER_THREADS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+extern "C" {
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_buffer.h"
+#include "esl_mem.h"
+#define new _new
+#include "esl_msa.h"
+#undef new
+#include "esl_msafile.h"
+#ifdef eslAUGMENT_SSI
+#include "esl_ssi.h"
+#endif
+}
+
+#include "profillic-hmmer.hpp"
+#include "profillic-esl_msafile.hpp"
+#include "profillic-compress.hpp"
+
+/*****************************************************************
+ *# 1. Finding record offsets.
+ *****************************************************************/
+
+static int
+profillic_readers_pos_compare(const void *a, const void *b)
+{
+  esl_pos_t x = *(const esl_pos_t *) a;
+  esl_pos_t y = *(const esl_pos_t *) b;
+
+  return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+#ifdef eslAUGMENT_SSI
+/* Offsets of the records indexed in SSI file <ssifile>, in file
+ * order.  Returns eslENOTFOUND if there is no such file; eslEFORMAT
+ * (with <errbuf>) if it isn't a usable index of one file.
+ */
+static int
+profillic_readers_SSIOffsets(const char *ssifile, char *errbuf, esl_pos_t **ret_off, int *ret_n)
+{
+  ESL_SSI   *ssi = NULL;
+  esl_pos_t *off = NULL;
+  uint16_t   fh;
+  off_t      roff;
+  int64_t    i;
+  int        status;
+
+  if ((status = esl_ssi_Open(ssifile, &ssi)) == eslENOTFOUND) return eslENOTFOUND;
+  else if (status != eslOK) ESL_XFAIL(eslEFORMAT, errbuf, "failed to open SSI index %s", ssifile);
+  if (ssi->nfiles != 1)     ESL_XFAIL(eslEFORMAT, errbuf, "SSI index %s covers %d files; --readers needs an index of the alignment file alone", ssifile, (int) ssi->nfiles);
+
+  ESL_ALLOC_CPP(esl_pos_t, off, sizeof(esl_pos_t) * ESL_MAX(1, ssi->nprimary));
+  for (i = 0; i < ssi->nprimary; i++)
+    {
+      if (esl_ssi_FindNumber(ssi, i, &fh, &roff, NULL, NULL, NULL) != eslOK) ESL_XFAIL(eslEFORMAT, errbuf, "failed to look up key %d in SSI index %s", (int) i, ssifile);
+      off[i] = (esl_pos_t) roff;
+    }
+  qsort(off, ssi->nprimary, sizeof(esl_pos_t), profillic_readers_pos_compare);
+
+  *ret_n   = (int) ssi->nprimary;
+  *ret_off = off;
+  esl_ssi_Close(ssi);
+  return eslOK;
+
+ ERROR:
+  if (ssi != NULL) esl_ssi_Close(ssi);
+  if (off != NULL) free(off);
+  return status;
+}
+#endif /*eslAUGMENT_SSI*/
+
+/* Offsets of the records in <msafile>, found by one pass over its
+ * lines: a record starts at the first nonblank line of the file, and
+ * at the first nonblank line after each "//".
+ */
+static int
+profillic_readers_ScanOffsets(const char *msafile, char *errbuf, esl_pos_t **ret_off, int *ret_n)
+{
+  ESL_BUFFER *bf       = NULL;
+  esl_pos_t  *off      = NULL;
+  int         n        = 0;
+  int         nalloc   = 0;
+  int         inrecord = FALSE;
+  esl_pos_t   lineoff;
+  char       *p;
+  esl_pos_t   len;
+  int         status;
+
+  if (esl_buffer_Open(msafile, NULL, &bf) != eslOK) ESL_XFAIL(eslENOTFOUND, errbuf, "failed to open %s to find its records", msafile);
+
+  lineoff = esl_buffer_GetOffset(bf);
+  while ((status = esl_buffer_GetLine(bf, &p, &len)) == eslOK)
+    {
+      if (! inrecord && esl_memspn(p, len, " \t\r") < len)
+        {
+          if (n == nalloc) { nalloc = (nalloc == 0 ? 1024 : nalloc * 2); ESL_REALLOC_CPP(esl_pos_t, off, sizeof(esl_pos_t) * nalloc); }
+          off[n++] = lineoff;
+          inrecord = TRUE;
+        }
+      if (len >= 2 && p[0] == '/' && p[1] == '/' && esl_memspn(p + 2, len - 2, " \t\r") == len - 2) inrecord = FALSE;
+      lineoff = esl_buffer_GetOffset(bf);
+    }
+  if (status != eslEOF) ESL_XFAIL(status, errbuf, "failed to read %s while finding its records", msafile);
+
+  esl_buffer_Close(bf);
+  *ret_n   = n;
+  *ret_off = off;
+  return eslOK;
+
+ ERROR:
+  if (bf  != NULL) esl_buffer_Close(bf);
+  if (off != NULL) free(off);
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_readers_Offsets()
+ *
+ * Purpose:   Find the byte offsets of the records in <msafile>, in
+ *            file order: from the SSI index <msafile>.ssi if there is
+ *            one, else by scanning the file.  The caller frees
+ *            <*ret_off>.
+ *
+ * Returns:   <eslOK> on success, with <*ret_n> offsets in <*ret_off>.
+ *            On failure, a non-<eslOK> status, with a message in
+ *            <errbuf>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+static int
+profillic_readers_Offsets(const char *msafile, char *errbuf, esl_pos_t **ret_off, int *ret_n)
+{
+  int   status = eslENOTFOUND;
+#ifdef eslAUGMENT_SSI
+  char *ssifile = NULL;
+
+  if ((status = esl_sprintf(&ssifile, "%s.ssi", msafile)) != eslOK) return status;
+  status = profillic_readers_SSIOffsets(ssifile, errbuf, ret_off, ret_n);
+  free(ssifile);
+#endif
+  if (status == eslENOTFOUND) status = profillic_readers_ScanOffsets(msafile, errbuf, ret_off, ret_n);
+  return status;
+}
+
+/*---------------------- end, record offsets --------------------*/
+
+/*****************************************************************
+ *# 2. The reader threads.
+ *****************************************************************/
+
+/* A parsed record waiting in the reorder ring */
+typedef struct {
+  int      nrec;      /* 1.. number of the record; 0 if the slot is empty */
+  ESL_MSA *msa;
+  int      status;    /* eslOK, or how parsing it failed                  */
+  char     errmsg[eslERRBUFSIZE];
+} PROFILLIC_READ_SLOT;
+
+struct profillic_readers_s;
+
+/* One reader thread, with its own open copy of the file */
+typedef struct {
+  struct profillic_readers_s *r;
+  ESLX_MSAFILE               *afp;
+  pthread_t                   thread;
+} PROFILLIC_READER;
+
+typedef struct profillic_readers_s {
+  esl_pos_t           *off;       /* record offsets, in file order        */
+  int                  noff;
+  int                  nclaimed;  /* records claimed by the threads so far */
+  int                  next;      /* 1.. number of the next record to return */
+  int                  stop;      /* TRUE to make the threads quit        */
+  PROFILLIC_READ_SLOT *ring;
+  int                  nring;
+  PROFILLIC_READER    *td;
+  int                  nthreads;  /* number of threads started            */
+  pthread_mutex_t      mutex;
+  pthread_cond_t       ready;     /* a slot was filled                    */
+  pthread_cond_t       space;     /* <next> moved on, or <stop> was set   */
+} PROFILLIC_READERS;
+
+/* Reader thread: claim records in turn, parse each, and put it in the ring */
+static void *
+profillic_readers_thread(void *arg)
+{
+  PROFILLIC_READER    *rd = (PROFILLIC_READER *) arg;
+  PROFILLIC_READERS   *r  = rd->r;
+  ESLX_MSAFILE        *afp = rd->afp;
+  PROFILLIC_READ_SLOT *slot;
+  ESL_MSA             *msa;
+  int                  i;
+  int                  status;
+
+  for (;;)
+    {
+      if (pthread_mutex_lock(&r->mutex) != 0) esl_fatal("mutex lock failed");
+      while (! r->stop && r->nclaimed < r->noff && r->nclaimed + 1 >= r->next + r->nring)
+        if (pthread_cond_wait(&r->space, &r->mutex) != 0) esl_fatal("cond wait failed");
+      if (r->stop || r->nclaimed == r->noff) { pthread_mutex_unlock(&r->mutex); break; }
+      i = r->nclaimed++;
+      if (pthread_mutex_unlock(&r->mutex) != 0) esl_fatal("mutex unlock failed");
+
+      msa            = NULL;
+      afp->errmsg[0] = '\0';
+      if ((status = esl_buffer_SetOffset(afp->bf, r->off[i])) == eslOK)
+        {
+          afp->line       = NULL;
+          afp->n          = 0;
+          afp->lineoffset = r->off[i];
+          afp->linenumber = 0;	/* line numbers in messages count from the start of the record */
+          status = profillic_eslx_msafile_Read(afp, &msa);
+          if (status == eslEOF) { status = eslEFORMAT; strcpy(afp->errmsg, "no alignment found"); }
+        }
+      else strcpy(afp->errmsg, "failed to seek to the record");
+
+      if (pthread_mutex_lock(&r->mutex) != 0) esl_fatal("mutex lock failed");
+      slot         = &(r->ring[(i + 1) % r->nring]);
+      slot->nrec   = i + 1;
+      slot->msa    = msa;
+      slot->status = status;
+      if (status != eslOK) snprintf(slot->errmsg, eslERRBUFSIZE, "record %d (at byte %lld): %s", i + 1, (long long) r->off[i], afp->errmsg);
+      if (pthread_cond_broadcast(&r->ready) != 0) esl_fatal("cond broadcast failed");
+      if (pthread_mutex_unlock(&r->mutex)   != 0) esl_fatal("mutex unlock failed");
+    }
+  return NULL;
+}
+
+static void profillic_readers_Close(PROFILLIC_READERS *r);
+
+/**
+ * <pre>
+ * Function:  profillic_readers_Open()
+ *
+ * Purpose:   Start <nthreads> threads parsing the Stockholm (or Pfam,
+ *            per <format>) alignment file <msafile>, into digital
+ *            alphabet <abc> (or text mode, if <abc> is <NULL>).
+ *            Parsed alignments are then returned in file order by
+ *            profillic_readers_Read().
+ *
+ * Returns:   <eslOK> on success, and <*ret_r> is the new reader set.
+ *            <eslEINVAL> if <format> isn't Stockholm or Pfam, or
+ *            <msafile> can't be seeked in; other failures finding the
+ *            records or opening the file are passed up.  On failure
+ *            <errbuf> has a message and <*ret_r> is <NULL>.
+ *
+ * Throws:    <eslEMEM> on allocation failure; <eslESYS> if a thread
+ *            can't be started.
+ * </pre>
+ */
+static int
+profillic_readers_Open(const char *msafile, int format, ESL_ALPHABET *abc, int nthreads, char *errbuf, PROFILLIC_READERS **ret_r)
+{
+  PROFILLIC_READERS *r = NULL;
+  ESL_ALPHABET      *byp_abc;
+  int                i;
+  int                status;
+
+  if (format != eslMSAFILE_STOCKHOLM && format != eslMSAFILE_PFAM)
+    ESL_XFAIL(eslEINVAL, errbuf, "--readers can only parse Stockholm or Pfam alignment files");
+  if (profillic_compress_Type(msafile) != PROFILLIC_COMPRESS_NONE)
+    ESL_XFAIL(eslEINVAL, errbuf, "--readers needs a plain alignment file it can seek in, not a pipe or a compressed file");
+
+  ESL_ALLOC_CPP(PROFILLIC_READERS, r, sizeof(PROFILLIC_READERS));
+  r->off      = NULL;
+  r->noff     = 0;
+  r->nclaimed = 0;
+  r->next     = 1;
+  r->stop     = FALSE;
+  r->ring     = NULL;
+  r->nring    = nthreads * 4;
+  r->td       = NULL;
+  r->nthreads = 0;
+  if (pthread_mutex_init(&r->mutex, NULL) != 0) ESL_XEXCEPTION(eslESYS, "mutex init failed");
+  if (pthread_cond_init (&r->ready, NULL) != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+  if (pthread_cond_init (&r->space, NULL) != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+
+  ESL_ALLOC_CPP(PROFILLIC_READ_SLOT, r->ring, sizeof(PROFILLIC_READ_SLOT) * r->nring);
+  for (i = 0; i < r->nring; i++) { r->ring[i].nrec = 0; r->ring[i].msa = NULL; }
+  ESL_ALLOC_CPP(PROFILLIC_READER, r->td, sizeof(PROFILLIC_READER) * nthreads);
+  for (i = 0; i < nthreads; i++) r->td[i].afp = NULL;
+
+  if ((status = profillic_readers_Offsets(msafile, errbuf, &(r->off), &(r->noff))) != eslOK) goto ERROR;
+
+  for (i = 0; i < nthreads; i++)
+    {
+      byp_abc = abc;
+      r->td[i].r = r;
+      if ((status = profillic_eslx_msafile_Open((abc != NULL ? &byp_abc : NULL), msafile, NULL, format, NULL, &(r->td[i].afp))) != eslOK)
+        ESL_XFAIL(status, errbuf, "--readers failed to open %s: %s", msafile, (r->td[i].afp != NULL ? r->td[i].afp->errmsg : ""));
+      if (r->td[i].afp->bf->mode_is == eslBUFFER_STDIN || r->td[i].afp->bf->mode_is == eslBUFFER_CMDPIPE)
+        ESL_XFAIL(eslEINVAL, errbuf, "--readers needs a plain alignment file it can seek in, not a pipe or a compressed file");
+    }
+  for (i = 0; i < nthreads; i++)
+    {
+      if (pthread_create(&(r->td[i].thread), NULL, profillic_readers_thread, &(r->td[i])) != 0) ESL_XEXCEPTION(eslESYS, "reader thread creation failed");
+      r->nthreads++;
+    }
+
+  *ret_r = r;
+  return eslOK;
+
+ ERROR:
+  if (r != NULL)
+    {
+      for (i = 0; r->td != NULL && i < nthreads; i++)
+        if (r->td[i].afp != NULL && i >= r->nthreads) { eslx_msafile_Close(r->td[i].afp); r->td[i].afp = NULL; }
+      profillic_readers_Close(r);
+    }
+  *ret_r = NULL;
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_readers_Read()
+ *
+ * Purpose:   Return the next alignment in file order in <*ret_msa>,
+ *            waiting for it to be parsed if need be.
+ *
+ * Returns:   <eslOK> on success; <eslEOF> when all have been returned.
+ *            On a parse failure, its status (normally <eslEFORMAT>),
+ *            with a message in <errbuf> (of at least <eslERRBUFSIZE>
+ *            bytes), and <*ret_msa> is <NULL>.
+ * </pre>
+ */
+static int
+profillic_readers_Read(PROFILLIC_READERS *r, ESL_MSA **ret_msa, char *errbuf)
+{
+  PROFILLIC_READ_SLOT *slot;
+  int                  status;
+
+  *ret_msa = NULL;
+  if (r->next > r->noff) return eslEOF;
+
+  if (pthread_mutex_lock(&r->mutex) != 0) esl_fatal("mutex lock failed");
+  slot = &(r->ring[r->next % r->nring]);
+  while (slot->nrec != r->next)
+    if (pthread_cond_wait(&r->ready, &r->mutex) != 0) esl_fatal("cond wait failed");
+
+  *ret_msa   = slot->msa;
+  status     = slot->status;
+  if (status != eslOK) strcpy(errbuf, slot->errmsg);
+  slot->nrec = 0;
+  slot->msa  = NULL;
+  r->next++;
+  if (pthread_cond_broadcast(&r->space) != 0) esl_fatal("cond broadcast failed");
+  if (pthread_mutex_unlock(&r->mutex)   != 0) esl_fatal("mutex unlock failed");
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_readers_Close()
+ *
+ * Purpose:   Stop the reader threads, and free <r> along with any
+ *            alignments parsed but not yet returned.
+ * </pre>
+ */
+static void
+profillic_readers_Close(PROFILLIC_READERS *r)
+{
+  int i;
+
+  if (r == NULL) return;
+
+  if (pthread_mutex_lock(&r->mutex) != 0) esl_fatal("mutex lock failed");
+  r->stop = TRUE;
+  if (pthread_cond_broadcast(&r->space) != 0) esl_fatal("cond broadcast failed");
+  if (pthread_mutex_unlock(&r->mutex)   != 0) esl_fatal("mutex unlock failed");
+
+  for (i = 0; i < r->nthreads; i++)
+    {
+      if (pthread_join(r->td[i].thread, NULL) != 0) esl_fatal("reader thread join failed");
+      eslx_msafile_Close(r->td[i].afp);
+    }
+  for (i = 0; r->ring != NULL && i < r->nring; i++)
+    if (r->ring[i].msa != NULL) esl_msa_Destroy(r->ring[i].msa);
+
+  pthread_cond_destroy (&r->space);
+  pthread_cond_destroy (&r->ready);
+  pthread_mutex_destroy(&r->mutex);
+  if (r->ring != NULL) free(r->ring);
+  if (r->td   != NULL) free(r->td);
+  if (r->off  != NULL) free(r->off);
+  free(r);
+}
+
+/*---------------------- end, reader threads --------------------*/
+
+#endif /*HMMER_THREADS*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICMSAFILEREADERS_HPP__
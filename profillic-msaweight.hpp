@@ -0,0 +1,456 @@
+/**
+ * \file profillic-msaweight.hpp
+ * \brief
+ * Multithreaded relative sequence weighting and single-linkage
+ * clustering, for very deep alignments (hmmbuild --Wcpu).
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Pairwise identity.
+ *     2. Single-linkage clustering (--eclust, --wblosum).
+ *     3. Position-based weights (--wpb).
+ *     4. Copyright and license.
+ * </pre>
+ *
+ * Threads across alignments don't help when there is one alignment
+ * of 100k sequences, and for those the weighting and clustering
+ * stages take longer than the rest of the build.  These replacements
+ * for esl_msacluster_SingleLinkage(), esl_msaweight_BLOSUM() and
+ * esl_msaweight_PB() split one alignment's work across threads, and
+ * give the same results as the serial Easel routines, bit for bit:
+ *
+ * Single linkage clusters are the connected components of the graph
+ * that links every pair of sequences at least <maxid> identical, so
+ * they don't depend on the order in which pairs are looked at.  Each
+ * thread takes every <n>th row of the (lower triangle of the) pair
+ * matrix, keeping its own union-find forest and skipping the pairs it
+ * already knows to be connected; the forests are merged at the end.
+ * The identity of a pair is computed as esl_dst_XPairId() does
+ * (identical canonical residues over the shorter of the two ungapped
+ * lengths), in a loop over the digital rows that the compiler can
+ * vectorize, with each sequence's length counted once instead of once
+ * per pair.
+ *
+ * Position-based weights go in two passes: first the columns are
+ * shared out, each getting the weight its residues contribute; then
+ * the sequences are, each summing its contributions over the columns
+ * in order, exactly as the serial loop does.
+ *
+ * Each function falls back to the Easel routine for text mode
+ * alignments, with fewer than two threads, or without HMMER_THREADS.
+ * (Tree weights, --wgsc, stay serial.)
+ */
+#ifndef __GALOSH_PROFILLICMSAWEIGHT_HPP__
+#define __GALOSH_PROFILLICMSAWEIGHT_HPP__
+
+#include <stdlib.h>
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+#define new _new
+#include "esl_msa.h"
+#undef new
+#include "esl_msacluster.h"
+#include "esl_msaweight.h"
+#include "esl_vectorops.h"
+
+#ifdef HMMER_THREADS
+#include "esl_threads.h"
+#endif /*HMMER_THREADS*/
+}
+
+#include "profillic-hmmer.hpp"
+
+#ifdef HMMER_THREADS
+
+/* One worker's share of a weighting or clustering job. */
+typedef struct {
+  const ESL_MSA *msa;
+  int            nworkers;
+  double         maxid;   /* clustering: identity at which two sequences are linked */
+  const int     *len;     /* clustering: each sequence's number of canonical residues */
+  int           *parent;  /* clustering: this worker's union-find forest, 0..nseq-1   */
+  double        *colwgt;  /* --wpb: what a residue x in column apos adds, [apos*K + x] */
+} PROFILLIC_MSAWEIGHT_INFO;
+
+/* Run <func> on <nworkers> threads, the <j>th with <info[j]>. */
+static int
+profillic_msaweight_Run(void (*func)(void *), PROFILLIC_MSAWEIGHT_INFO *info, int nworkers)
+{
+  ESL_THREADS *threadObj;
+  int          j;
+
+  if ((threadObj = esl_threads_Create(func)) == NULL) return eslEMEM;
+  for (j = 0; j < nworkers; j++) esl_threads_AddThread(threadObj, &info[j]);
+  esl_threads_WaitForStart(threadObj);
+  esl_threads_WaitForFinish(threadObj);
+  esl_threads_Destroy(threadObj);
+  return eslOK;
+}
+
+/*****************************************************************
+ *# 1. Pairwise identity.
+ *****************************************************************/
+
+/* The number of canonical residues in digital row <ax> of length <alen>. */
+static int
+profillic_msaweight_Length(const ESL_DSQ *ax, int64_t alen, int K)
+{
+  int64_t apos;
+  int     n = 0;
+
+  for (apos = 1; apos <= alen; apos++) n += (ax[apos] < K);
+  return n;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_msaweight_IsLinked()
+ *
+ * Purpose:   TRUE if the aligned digital rows <ax1> and <ax2>, with
+ *            <len1> and <len2> canonical residues, are at least
+ *            <maxid> identical, by esl_dst_XPairId()'s measure: the
+ *            number of columns where both have the same canonical
+ *            residue, over the smaller of <len1> and <len2> (and 0 if
+ *            that is 0).
+ * </pre>
+ */
+static int
+profillic_msaweight_IsLinked(const ESL_DSQ *ax1, const ESL_DSQ *ax2, int len1, int len2, int64_t alen, int K, double maxid)
+{
+  int64_t apos;
+  int     idents = 0;
+  int     len    = ESL_MIN(len1, len2);
+  double  pid;
+
+  /* canonical residues are the codes below K */
+  for (apos = 1; apos <= alen; apos++) idents += ((ax1[apos] == ax2[apos]) & (ax1[apos] < K));
+
+  pid = (len == 0 ? 0. : (double) idents / (double) len);
+  return (pid >= maxid ? TRUE : FALSE);
+}
+
+/*---------------------- end, pairwise identity --------------------*/
+
+/*****************************************************************
+ *# 2. Single-linkage clustering (--eclust, --wblosum).
+ *****************************************************************/
+
+/* The root of <v>'s tree in union-find forest <parent> (halving the path on the way). */
+static int
+profillic_msaweight_Find(int *parent, int v)
+{
+  while (parent[v] != v) { parent[v] = parent[parent[v]]; v = parent[v]; }
+  return v;
+}
+
+/* Link the trees of <a> and <b>; FALSE if they were already one. */
+static int
+profillic_msaweight_Union(int *parent, int a, int b)
+{
+  a = profillic_msaweight_Find(parent, a);
+  b = profillic_msaweight_Find(parent, b);
+  if (a == b) return FALSE;
+  if (a < b) parent[b] = a; else parent[a] = b;
+  return TRUE;
+}
+
+/* Clustering worker: rows workeridx, workeridx+n, ... of the pair matrix, into its own forest. */
+static void
+profillic_msaweight_linkage_thread(void *arg)
+{
+  ESL_THREADS              *obj = (ESL_THREADS *) arg;
+  PROFILLIC_MSAWEIGHT_INFO *info;
+  const ESL_MSA            *msa;
+  int                       workeridx;
+  int                       i, j;
+
+  esl_threads_Started(obj, &workeridx);
+  info = (PROFILLIC_MSAWEIGHT_INFO *) esl_threads_GetData(obj, workeridx);
+  msa  = info->msa;
+
+  for (i = 0; i < msa->nseq; i++) info->parent[i] = i;
+  for (i = 1 + workeridx; i < msa->nseq; i += info->nworkers)
+    for (j = 0; j < i; j++)
+      if (profillic_msaweight_Find(info->parent, i) != profillic_msaweight_Find(info->parent, j) &&
+          profillic_msaweight_IsLinked(msa->ax[i], msa->ax[j], info->len[i], info->len[j], msa->alen, msa->abc->K, info->maxid))
+        profillic_msaweight_Union(info->parent, i, j);
+
+  esl_threads_Finished(obj, workeridx);
+}
+
+/**
+ * <pre>
+ * Function:  profillic_msacluster_SingleLinkage()
+ *
+ * Purpose:   Single-linkage cluster the sequences of <msa> at
+ *            fractional identity <maxid>, on <ncpus> threads, as
+ *            <esl_msacluster_SingleLinkage()> does.  Return the
+ *            number of clusters in <*ret_nc> and, if <opt_c> isn't
+ *            <NULL>, in <*opt_c> a new array of each sequence's
+ *            cluster, 0..nc-1 (numbered in order of each cluster's
+ *            first sequence, which need not be Easel's numbering; the
+ *            clusters themselves are the same).
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+static int
+profillic_msacluster_SingleLinkage(const ESL_MSA *msa, double maxid, int ncpus, int **opt_c, int *ret_nc)
+{
+  PROFILLIC_MSAWEIGHT_INFO *info   = NULL;
+  int                      *len    = NULL;
+  int                      *parent = NULL;
+  int                      *c      = NULL;
+  int                       nc     = 0;
+  int                       i, j;
+  int                       status;
+
+  if (! (msa->flags & eslMSA_DIGITAL) || ncpus < 2 || msa->nseq < 2)
+    return esl_msacluster_SingleLinkage(msa, maxid, opt_c, NULL, ret_nc);
+  ncpus = ESL_MIN(ncpus, msa->nseq - 1);
+
+  ESL_ALLOC_CPP(int, len,    sizeof(int) * msa->nseq);
+  ESL_ALLOC_CPP(int, parent, sizeof(int) * msa->nseq * (ncpus + 1));
+  ESL_ALLOC_CPP(int, c,      sizeof(int) * msa->nseq);
+  ESL_ALLOC_CPP(PROFILLIC_MSAWEIGHT_INFO, info, sizeof(PROFILLIC_MSAWEIGHT_INFO) * ncpus);
+  for (i = 0; i < msa->nseq; i++) len[i] = profillic_msaweight_Length(msa->ax[i], msa->alen, msa->abc->K);
+
+  for (j = 0; j < ncpus; j++)
+    {
+      info[j].msa      = msa;
+      info[j].nworkers = ncpus;
+      info[j].maxid    = maxid;
+      info[j].len      = len;
+      info[j].parent   = parent + (j + 1) * msa->nseq;
+      info[j].colwgt   = NULL;
+    }
+  if ((status = profillic_msaweight_Run(&profillic_msaweight_linkage_thread, info, ncpus)) != eslOK) goto ERROR;
+
+  /* Merge the workers' forests into the first <nseq> of <parent> */
+  for (i = 0; i < msa->nseq; i++) parent[i] = i;
+  for (j = 0; j < ncpus; j++)
+    for (i = 0; i < msa->nseq; i++)
+      profillic_msaweight_Union(parent, i, profillic_msaweight_Find(info[j].parent, i));
+
+  /* Roots are the smallest members, so each cluster is numbered when its first sequence is seen */
+  for (i = 0; i < msa->nseq; i++)
+    c[i] = (profillic_msaweight_Find(parent, i) == i) ? nc++ : c[profillic_msaweight_Find(parent, i)];
+
+  *ret_nc = nc;
+  if (opt_c != NULL) *opt_c = c; else free(c);
+  free(info);
+  free(parent);
+  free(len);
+  return eslOK;
+
+ ERROR:
+  if (info   != NULL) free(info);
+  if (parent != NULL) free(parent);
+  if (len    != NULL) free(len);
+  if (c      != NULL) free(c);
+  if (opt_c  != NULL) *opt_c = NULL;
+  *ret_nc = 0;
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_msaweight_BLOSUM()
+ *
+ * Purpose:   <esl_msaweight_BLOSUM()> on <ncpus> threads: weight each
+ *            sequence of <msa> by one over the size of its single
+ *            linkage cluster at identity <maxid>, then normalize the
+ *            weights to sum to <nseq>.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+static int
+profillic_msaweight_BLOSUM(ESL_MSA *msa, double maxid, int ncpus)
+{
+  int *c    = NULL;
+  int *nmem = NULL;
+  int  nc;
+  int  i;
+  int  status;
+
+  if (! (msa->flags & eslMSA_DIGITAL) || ncpus < 2 || msa->nseq < 2)
+    return esl_msaweight_BLOSUM(msa, maxid);
+
+  if ((status = profillic_msacluster_SingleLinkage(msa, maxid, ncpus, &c, &nc)) != eslOK) goto ERROR;
+  ESL_ALLOC_CPP(int, nmem, sizeof(int) * nc);
+  esl_vec_ISet(nmem, nc, 0);
+  for (i = 0; i < msa->nseq; i++) nmem[c[i]]++;
+  for (i = 0; i < msa->nseq; i++) msa->wgt[i] = 1. / (double) nmem[c[i]];
+
+  esl_vec_DNorm(msa->wgt, msa->nseq);
+  esl_vec_DScale(msa->wgt, msa->nseq, (double) msa->nseq);
+  msa->flags |= eslMSA_HASWGTS;
+
+  free(nmem);
+  free(c);
+  return eslOK;
+
+ ERROR:
+  if (nmem != NULL) free(nmem);
+  if (c    != NULL) free(c);
+  return status;
+}
+
+/*---------------------- end, single linkage --------------------*/
+
+/*****************************************************************
+ *# 3. Position-based weights (--wpb).
+ *****************************************************************/
+
+/* --wpb pass 1: for columns workeridx+1, workeridx+1+n, ..., what each residue adds to its sequence's weight. */
+static void
+profillic_msaweight_pb_columns_thread(void *arg)
+{
+  ESL_THREADS              *obj = (ESL_THREADS *) arg;
+  PROFILLIC_MSAWEIGHT_INFO *info;
+  const ESL_MSA            *msa;
+  int                       K;
+  int                      *ct = NULL;
+  int                       rlen;
+  int                       workeridx;
+  int64_t                   apos;
+  int                       idx;
+  int                       x;
+  int                       status;
+
+  esl_threads_Started(obj, &workeridx);
+  info = (PROFILLIC_MSAWEIGHT_INFO *) esl_threads_GetData(obj, workeridx);
+  msa  = info->msa;
+  K    = msa->abc->K;
+
+  ESL_ALLOC_CPP(int, ct, sizeof(int) * K);
+  for (apos = 1 + workeridx; apos <= msa->alen; apos += info->nworkers)
+    {
+      esl_vec_ISet(ct, K, 0);
+      for (idx = 0; idx < msa->nseq; idx++)
+        if (esl_abc_XIsCanonical(msa->abc, msa->ax[idx][apos])) ct[msa->ax[idx][apos]]++;
+      for (rlen = 0, x = 0; x < K; x++) if (ct[x] > 0) rlen++;
+
+      for (x = 0; x < K; x++)
+        info->colwgt[apos * K + x] = (ct[x] > 0 ? 1. / (double) (rlen * ct[x]) : 0.);
+    }
+  free(ct);
+  esl_threads_Finished(obj, workeridx);
+  return;
+
+ ERROR:
+  esl_fatal("--wpb column worker: memory allocation failed");
+}
+
+/* --wpb pass 2: sequences workeridx, workeridx+n, ... sum their residues' contributions, in column order. */
+static void
+profillic_msaweight_pb_sequences_thread(void *arg)
+{
+  ESL_THREADS              *obj = (ESL_THREADS *) arg;
+  PROFILLIC_MSAWEIGHT_INFO *info;
+  ESL_MSA                  *msa;
+  int                       K;
+  int                       nres;
+  int                       workeridx;
+  int64_t                   apos;
+  int                       idx;
+
+  esl_threads_Started(obj, &workeridx);
+  info = (PROFILLIC_MSAWEIGHT_INFO *) esl_threads_GetData(obj, workeridx);
+  msa  = (ESL_MSA *) info->msa;
+  K    = msa->abc->K;
+
+  for (idx = workeridx; idx < msa->nseq; idx += info->nworkers)
+    {
+      msa->wgt[idx] = 0.;
+      nres          = 0;
+      for (apos = 1; apos <= msa->alen; apos++)
+        if (esl_abc_XIsCanonical(msa->abc, msa->ax[idx][apos]))
+          {
+            msa->wgt[idx] += info->colwgt[apos * K + msa->ax[idx][apos]];
+            nres++;
+          }
+      if (nres > 0) msa->wgt[idx] /= (double) nres;
+    }
+  esl_threads_Finished(obj, workeridx);
+}
+
+/**
+ * <pre>
+ * Function:  profillic_msaweight_PB()
+ *
+ * Purpose:   <esl_msaweight_PB()> on <ncpus> threads: Henikoff
+ *            position-based weights, each column giving each of its
+ *            canonical residues one over (the number of residue types
+ *            in the column times the number of that residue), summed
+ *            over the columns and divided by the sequence's number of
+ *            residues; then normalized to sum to <nseq>.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+static int
+profillic_msaweight_PB(ESL_MSA *msa, int ncpus)
+{
+  PROFILLIC_MSAWEIGHT_INFO *info = NULL;
+  int                       j;
+  int                       status;
+
+  if (! (msa->flags & eslMSA_DIGITAL) || ncpus < 2 || msa->nseq < 2)
+    return esl_msaweight_PB(msa);
+
+  ESL_ALLOC_CPP(PROFILLIC_MSAWEIGHT_INFO, info, sizeof(PROFILLIC_MSAWEIGHT_INFO) * ncpus);
+  info[0].colwgt = NULL;
+  ESL_ALLOC_CPP(double, info[0].colwgt, sizeof(double) * (msa->alen + 1) * msa->abc->K);
+  for (j = 0; j < ncpus; j++)
+    {
+      info[j].msa      = msa;
+      info[j].nworkers = ncpus;
+      info[j].maxid    = 0.;
+      info[j].len      = NULL;
+      info[j].parent   = NULL;
+      info[j].colwgt   = info[0].colwgt;
+    }
+  if ((status = profillic_msaweight_Run(&profillic_msaweight_pb_columns_thread,   info, ncpus)) != eslOK) goto ERROR;
+  if ((status = profillic_msaweight_Run(&profillic_msaweight_pb_sequences_thread, info, ncpus)) != eslOK) goto ERROR;
+
+  esl_vec_DNorm(msa->wgt, msa->nseq);
+  esl_vec_DScale(msa->wgt, msa->nseq, (double) msa->nseq);
+  msa->flags |= eslMSA_HASWGTS;
+
+  free(info[0].colwgt);
+  free(info);
+  return eslOK;
+
+ ERROR:
+  if (info != NULL) { if (info[0].colwgt != NULL) free(info[0].colwgt); free(info); }
+  return status;
+}
+
+/*---------------------- end, position-based weights --------------------*/
+
+#else /* ! HMMER_THREADS: just the serial Easel routines */
+
+static int profillic_msacluster_SingleLinkage(const ESL_MSA *msa, double maxid, int ncpus, int **opt_c, int *ret_nc) { return esl_msacluster_SingleLinkage(msa, maxid, opt_c, NULL, ret_nc); }
+static int profillic_msaweight_BLOSUM(ESL_MSA *msa, double maxid, int ncpus) { return esl_msaweight_BLOSUM(msa, maxid); }
+static int profillic_msaweight_PB    (ESL_MSA *msa, int ncpus)               { return esl_msaweight_PB(msa); }
+
+#endif /*HMMER_THREADS*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICMSAWEIGHT_HPP__
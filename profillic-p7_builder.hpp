@@ -6,10 +6,14 @@
  * <pre>
  * Contents:
  *    1. P7_BUILDER: allocation, initialization, destruction
- *    2. Standardized model construction API.
+ *    2. Standardized model construction API (and its per-stage timings).
  *    3. Internal functions.
  *    4. Copyright and license information
  * </pre>
+ *
+ * The one build engine for profillic-hmmbuild and
+ * profillic-alignment-hmmbuild: what differs between their kinds of
+ * galosh profile is in profillic-profile_kind.hpp.
  */   
 #ifndef __GALOSH_PROFILLICP7BUILDER_HPP__
 #define __GALOSH_PROFILLICP7BUILDER_HPP__
@@ -20,6 +24,9 @@ extern "C" {
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
 
 extern "C" {
 #include "easel.h"
@@ -32,7 +39,9 @@ extern "C" {
 #undef new
 #include "esl_msacluster.h"
 #include "esl_msaweight.h"
+#include "esl_gumbel.h"
 #include "esl_random.h"
+#include "esl_randomseq.h"
 #include "esl_vectorops.h"
 
 #include "base/p7_bg.h"
@@ -47,14 +56,27 @@ extern "C" {
 #include "build/seqmodel.h"
 
 #include "dp_vector/p7_oprofile.h"
+#include "dp_vector/p7_checkptmx.h"
+#include "dp_vector/fwdfilter.h"
 
 #include "misc/tracealign.h"
 
+#ifdef HMMER_THREADS
+#include "esl_threads.h"
+#endif /*HMMER_THREADS*/
+
 } // End extern "C"
 
 /* ////////////// For profillic-hmmer ////////////////////////////////// */
 /// Stuff we needed to modify in order to compile it in c++:
 #include "profillic-hmmer.hpp"
+#include "profillic-galosh_convert.hpp"
+#include "profillic-maxlength.hpp"
+#include "profillic-consensus_msa.hpp"
+#include "profillic-profile_kind.hpp"
+#include "profillic-build_cache.hpp"
+#include "profillic-build_pool.hpp"
+#include "profillic-msaweight.hpp"
 #include <seqan/basic.h>
 
 // Forward declarations
@@ -62,8 +84,6 @@ void
 profillic_p7_builder_Destroy(P7_BUILDER *bld);
 static int
 profillic_annotate_model(P7_HMM *hmm, ESL_MSA * msa);
-int
-profillic_p7_Builder_MaxLength (P7_HMM *hmm, double emit_thresh);
 //
 /* ////////////// End profillic-hmmer ////////////////////////////////// */
 
@@ -175,7 +195,7 @@ profillic_p7_builder_Create(const ESL_GETOPTS *go, const ESL_ALPHABET *abc)
   bld->do_reseeding = (seed == 0) ? FALSE : TRUE;
 
   // NOTE: this is now redundant with the new --pnone and --plaplace arguments.  Remove these, after verifying that they're the same.
-  if(esl_opt_GetBoolean(go, "--noprior") || esl_opt_GetBoolean(go, "--laplace")) {
+  if(go && (esl_opt_GetBoolean(go, "--noprior") || esl_opt_GetBoolean(go, "--laplace"))) {
     /// \note NOTE: we need the prior to be initialized for the rest of the
     /// code to work.  A laplace prior (eg a dirichlet with all "1"s)
     /// should have no effect in most cases.  See below in
@@ -409,6 +429,67 @@ profillic_p7_builder_Destroy(P7_BUILDER *bld)
   free(bld);
   return;
 }
+
+/**
+ * <pre>
+ * Function:  profillic_p7_builder_CreateClone()
+ * Synopsis:  Create a per-thread view of a shared <P7_BUILDER>.
+ *
+ * Purpose:   Create a builder that has all of <shared>'s settings and
+ *            shares its read-only construction data -- the prior, and
+ *            the single-sequence score system <S> and <Q> -- but has
+ *            its own RNG and <errbuf>, so that each worker thread can
+ *            build with it while <shared> is set up (and its prior
+ *            and score matrix held in memory) only once.
+ *
+ *            The clone's RNG starts from <shared>'s seed, as a builder
+ *            of its own made with that seed would; if <shared> doesn't
+ *            reseed (<--seed 0>), the clone gets an arbitrary seed of
+ *            its own.
+ *
+ *            Free the clone with <profillic_p7_builder_DestroyClone()>,
+ *            before <shared> is destroyed.
+ *
+ * Throws:    <NULL> on allocation failure.
+ * </pre>
+ */
+P7_BUILDER *
+profillic_p7_builder_CreateClone(const P7_BUILDER *shared)
+{
+  P7_BUILDER *bld = NULL;
+  int         status;
+
+  ESL_ALLOC_CPP( P7_BUILDER, bld, sizeof(P7_BUILDER));
+  *bld = *shared;
+  bld->r         = esl_randomness_CreateFast(shared->do_reseeding ? esl_randomness_GetSeed(shared->r) : 0);
+  bld->errbuf[0] = '\0';
+  if (bld->r == NULL) goto ERROR;
+  return bld;
+
+ ERROR:
+  if (bld != NULL) free(bld);
+  return NULL;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_p7_builder_DestroyClone()
+ * Synopsis:  Free a clone of a shared <P7_BUILDER>.
+ *
+ * Purpose:   Frees <bld>, made by <profillic_p7_builder_CreateClone()>,
+ *            and its RNG; the construction data it shares belong to the
+ *            builder it was cloned from.
+ * </pre>
+ */
+void
+profillic_p7_builder_DestroyClone(P7_BUILDER *bld)
+{
+  if (bld == NULL) return;
+
+  if (bld->r != NULL) esl_randomness_Destroy(bld->r);
+  free(bld);
+  return;
+}
 /*------------------- end, P7_BUILDER ---------------------------*/
 
 
@@ -419,14 +500,107 @@ profillic_p7_builder_Destroy(P7_BUILDER *bld)
  *****************************************************************/
 
 static int    validate_msa         (P7_BUILDER *bld, ESL_MSA *msa);
-static int    relative_weights     (P7_BUILDER *bld, ESL_MSA *msa);
+static int    relative_weights     (P7_BUILDER *bld, ESL_MSA *msa, int const weight_ncpu);
 template <class ProfileType>
 static int    profillic_build_model          (P7_BUILDER *bld, ESL_MSA *msa, ProfileType const & profile, P7_HMM **ret_hmm, P7_TRACE ***opt_tr);
-static int    effective_seqnumber  (P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm, const P7_BG *bg);
+static int    effective_seqnumber  (P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm, const P7_BG *bg, int const weight_ncpu);
 static int    profillic_parameterize         (P7_BUILDER *bld, P7_HMM *hmm, int const use_priors);
 static int    annotate             (P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm);
-static int    calibrate            (P7_BUILDER *bld, P7_HMM *hmm, P7_BG *bg, P7_PROFILE **opt_gm, P7_OPROFILE **opt_om);
+static int    annotate_labels      (P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm);
+static int    make_profiles        (const P7_HMM *hmm, P7_BG *bg, P7_PROFILE **opt_gm, P7_OPROFILE **opt_om);
+static int    calibrate            (P7_BUILDER *bld, P7_HMM *hmm, P7_BG *bg, P7_PROFILE **opt_gm, P7_OPROFILE **opt_om, int const calibrate_ncpu);
 static int    make_post_msa        (P7_BUILDER *bld, const ESL_MSA *premsa, const P7_HMM *hmm, P7_TRACE **tr, ESL_MSA **opt_postmsa);
+static int    sync_profiles        (const P7_HMM *hmm, P7_BG *bg, P7_PROFILE *gm, P7_OPROFILE *om);
+
+/* The stages of profillic_p7_Builder(), in the order they run; see
+ * PROFILLIC_BUILD_TIMINGS.
+ */
+enum profillic_build_stage_e {
+  PROFILLIC_STAGE_VALIDATE     = 0,  /* validate_msa()                      */
+  PROFILLIC_STAGE_CHECKSUM     = 1,  /* esl_msa_Checksum(), and --cache lookup */
+  PROFILLIC_STAGE_WEIGHTS      = 2,  /* relative_weights()                  */
+  PROFILLIC_STAGE_FRAGMENTS    = 3,  /* esl_msa_MarkFragments()             */
+  PROFILLIC_STAGE_MODEL        = 4,  /* profillic_build_model()             */
+  PROFILLIC_STAGE_POSTMSA      = 5,  /* make_post_msa()                     */
+  PROFILLIC_STAGE_EFFN         = 6,  /* effective_seqnumber()               */
+  PROFILLIC_STAGE_PARAMETERIZE = 7,  /* profillic_parameterize()            */
+  PROFILLIC_STAGE_ANNOTATE     = 8,  /* annotate()                          */
+  PROFILLIC_STAGE_CALIBRATE    = 9,  /* calibrate()                         */
+  PROFILLIC_STAGE_MAXLENGTH    = 10  /* profillic_p7_Builder_MaxLength()    */
+};
+#define PROFILLIC_NSTAGES 11
+
+static const char *profillic_build_stage_names[PROFILLIC_NSTAGES] = {
+  "validate", "checksum", "weights", "fragments", "model", "postmsa",
+  "effn", "parameterize", "annotate", "calibrate", "maxlength"
+};
+
+/* Wall and CPU seconds spent in each stage of profillic_p7_Builder().
+ * CPU time is the calling thread's own (where the system can tell us
+ * that), so in threaded builds each worker's numbers are its own; the
+ * threads of a --Ecpu calibration are not included.
+ */
+typedef struct {
+  double wall[PROFILLIC_NSTAGES];
+  double cpu[PROFILLIC_NSTAGES];
+  double wall0;                    /* clocks at the last mark */
+  double cpu0;
+} PROFILLIC_BUILD_TIMINGS;
+
+static void
+profillic_timings_Clocks(double *ret_wall, double *ret_cpu)
+{
+  struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+  *ret_wall = (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  *ret_cpu  = (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+#else
+  *ret_cpu  = (double) clock() / (double) CLOCKS_PER_SEC;
+#endif
+}
+
+/* Zero all stages of <t>, and start its clocks. */
+static void
+profillic_timings_Start(PROFILLIC_BUILD_TIMINGS *t)
+{
+  int k;
+
+  for (k = 0; k < PROFILLIC_NSTAGES; k++) t->wall[k] = t->cpu[k] = 0.;
+  profillic_timings_Clocks(&(t->wall0), &(t->cpu0));
+}
+
+/* Charge the time since the last mark (or start) to <stage>. */
+static void
+profillic_timings_Mark(PROFILLIC_BUILD_TIMINGS *t, int stage)
+{
+  double wall, cpu;
+
+  if (t == NULL) return;
+  profillic_timings_Clocks(&wall, &cpu);
+  t->wall[stage] += wall - t->wall0;
+  t->cpu[stage]  += cpu  - t->cpu0;
+  t->wall0        = wall;
+  t->cpu0         = cpu;
+}
+
+/* Add the stage times of <src> into <dest> (for per-worker totals). */
+static void
+profillic_timings_Add(PROFILLIC_BUILD_TIMINGS *dest, const PROFILLIC_BUILD_TIMINGS *src)
+{
+  int k;
+
+  for (k = 0; k < PROFILLIC_NSTAGES; k++) {
+    dest->wall[k] += src->wall[k];
+    dest->cpu[k]  += src->cpu[k];
+  }
+}
 
 /**
  * <pre>
@@ -441,13 +615,37 @@ static int    make_post_msa        (P7_BUILDER *bld, const ESL_MSA *premsa, cons
  *
  * Args:      bld         - build configuration
  *            msa         - multiple sequence alignment (or possibly just the profillic consensus).
- *            profile     - the galosh profile (from profillic) to use the build the model
+ *            profile     - the galosh profile (from profillic) to use the build the model:
+ *                          a ProfileTreeRoot, or (for profillic-alignment-hmmbuild)
+ *                          an AlignmentProfileAccessor; see ProfillicProfileKind<>.
+ *                          Alignment profiles aren't put in <opt_cache>.
  *            bg          - null model
  *            opt_hmm     - optRETURN: new HMM
  *            opt_trarr   - optRETURN: array of faux tracebacks, <0..nseq-1>
  *            opt_gm      - optRETURN: profile corresponding to <hmm>
  *            opt_om      - optRETURN: optimized profile corresponding to <gm>
  *            opt_postmsa - optRETURN: RF-annotated, possibly modified MSA 
+ *            use_priors  - FALSE to parameterize without the prior (--noprior)
+ *            calibrate_ncpu - number of threads to split this one model's E-value
+ *                          calibration across; 0 (or 1) for the ordinary serial
+ *                          p7_Calibrate().
+ *            weight_ncpu - number of threads to split this alignment's relative
+ *                          weighting (--wpb, --wblosum) and --eclust clustering
+ *                          across (profillic-msaweight.hpp); 0 (or 1) for the
+ *                          serial Easel routines.  The results are the same.
+ *            opt_timings - optRETURN: wall and CPU time of each stage of the
+ *                          build (--timings); <NULL> if not wanted.
+ *            opt_cache   - build cache to take the model from, if it was built
+ *                          before, and to store it in if not; <NULL> for none.
+ *                          Only used for <profile> input without tracebacks or
+ *                          <opt_postmsa>, and with a fixed RNG seed (otherwise
+ *                          calibrations aren't reproducible).  A cached model
+ *                          is named and annotated from <msa> afresh, and its
+ *                          time is charged to the checksum stage.
+ *            opt_pool    - the calling worker's pool (profillic-build_pool.hpp)
+ *                          to take a model built from <profile> and the
+ *                          window-length scratch space from; <NULL> for none.
+ *                          The returned model can then be given back to it.
  *
  * Returns:   <eslOK> on success. The new HMM is optionally returned in
  *            <*opt_hmm>, along with optional returns of an array of faux tracebacks
@@ -462,6 +660,9 @@ static int    make_post_msa        (P7_BUILDER *bld, const ESL_MSA *premsa, cons
  *            line in hand architecture construction. On any returned error,
  *            <bld->errbuf> contains an informative error message.
  *
+ *            Returns <eslFAIL> if <opt_cache> is given and the model can't
+ *            be stored in it, with a message in <bld->errbuf>.
+ *
  * Throws:    <eslEMEM> on allocation error.
  *            <eslEINVAL> if relative weights couldn't be calculated from <msa>.
  *
@@ -472,41 +673,79 @@ template <class ProfileType>
 int
 profillic_p7_Builder(P7_BUILDER *bld, ESL_MSA *msa, ProfileType const * const profile_ptr, P7_BG *bg,
 	   P7_HMM **opt_hmm, P7_TRACE ***opt_trarr, P7_PROFILE **opt_gm, P7_OPROFILE **opt_om,
-                     ESL_MSA **opt_postmsa, int const use_priors)
+                     ESL_MSA **opt_postmsa, int const use_priors, int const calibrate_ncpu, int const weight_ncpu,
+                     PROFILLIC_BUILD_TIMINGS * const opt_timings,
+                     const PROFILLIC_BUILD_CACHE * const opt_cache,
+                     PROFILLIC_BUILD_POOL * const opt_pool)
 {
   int i,j;
   uint32_t    checksum = 0;	/* checksum calculated for the input MSA. hmmalign --mapali verifies against this. */
   P7_HMM     *hmm      = NULL;
   P7_TRACE  **tr       = NULL;
   P7_TRACE ***tr_ptr   = (opt_trarr != NULL || opt_postmsa != NULL) ? &tr : NULL;
+  int         use_cache = (ProfillicProfileKind<ProfileType>::cacheable && opt_cache != NULL && profile_ptr != NULL && tr_ptr == NULL && bld->do_reseeding);
+  uint64_t    cache_key = 0;
   int         status;
 
+  if (opt_timings != NULL) profillic_timings_Start(opt_timings);
+  if (opt_postmsa != NULL) *opt_postmsa = NULL;
+
   // NOTE: This checks the alignment for "missing data chars" ('~'), which is not relevant to a profillic profile consensus, but should be fine to call.
   if ((status =  validate_msa         (bld, msa))                       != eslOK) goto ERROR;
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_VALIDATE);
 
   // The following creates hashcode from the msa (or the consensus sequence of the galosh profile):
-  // TODO [profillic]: Consider altering this to create a checksum from the full Profile HMM somehow.
+  // hmmalign --mapali checks it against the msa, so it stays the msa's; the
+  // full profile is hashed for the build cache key instead (profillic_build_cache_Key()).
   if ((status =  esl_msa_Checksum     (msa, &checksum))                 != eslOK) ESL_XFAIL(status, bld->errbuf, "Failed to calculate checksum"); 
+  if (use_cache)
+    {
+      cache_key = profillic_build_cache_Key(bld, bg, msa, checksum, *profile_ptr, use_priors, calibrate_ncpu);
+      status    = profillic_build_cache_Fetch(opt_cache, cache_key, bld->abc, &hmm, bld->errbuf);
+      if (status == eslOK)
+        {
+          hmm->flags &= ~(p7H_GA | p7H_TC | p7H_NC);
+          if ((status = annotate_labels(bld, msa, hmm))           != eslOK) goto ERROR;
+          if ((status = make_profiles(hmm, bg, opt_gm, opt_om))   != eslOK) goto ERROR;
+          profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_CHECKSUM);
+          goto DONE;
+        }
+      else if (status != eslENOTFOUND) goto ERROR;
+    }
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_CHECKSUM);
 
   /// \note For now, we don't use this with profillic.  In the future, when we read in both an msa (viterbi alignments, perhaps .. or random alignment draws) and a profile, then we can use this for the msa.
   if( msa->nseq > 1 ) {
-    if ((status =  relative_weights     (bld, msa))                       != eslOK) goto ERROR;
+    if ((status =  relative_weights     (bld, msa, weight_ncpu))          != eslOK) goto ERROR;
   }
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_WEIGHTS);
 
   /// \note this identifies "sequence fragments" as having length less than <fragthresh> times the profile length, and converts leading and trailing gaps into missing-data chars.
   if ((status =  esl_msa_MarkFragments(msa, bld->fragthresh))           != eslOK) goto ERROR;
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_FRAGMENTS);
 
-  if ((status =  profillic_build_model          (bld, msa, profile_ptr, &hmm, tr_ptr))         != eslOK) goto ERROR;
+  if ((status =  profillic_build_model          (bld, msa, profile_ptr, &hmm, tr_ptr, opt_pool)) != eslOK) goto ERROR;
 
   //Ensures that the weighted-average I->I count <=  bld->max_insert_len
   if (bld->max_insert_len>0)
     for (i=1; i<hmm->M; i++ )   hmm->t[i][p7H_II] = ESL_MIN(hmm->t[i][p7H_II], bld->max_insert_len*hmm->t[i][p7H_MI]);
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_MODEL);
 
-  if ((status =  effective_seqnumber  (bld, msa, hmm, bg))              != eslOK) goto ERROR;
+  /* The postmsa needs only <msa>, which the later stages don't change,
+   * and the traces; so make it now, and (unless they're wanted) free
+   * the traces before they sit through parameterization and calibration. */
+  if ((status =  make_post_msa        (bld, msa, hmm, tr, opt_postmsa)) != eslOK) goto ERROR;
+  if (opt_trarr == NULL) { p7_trace_DestroyArray(tr, msa->nseq); tr = NULL; }
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_POSTMSA);
+
+  if ((status =  effective_seqnumber  (bld, msa, hmm, bg, weight_ncpu)) != eslOK) goto ERROR;
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_EFFN);
   if ((status =  profillic_parameterize (bld, hmm, use_priors))          != eslOK) goto ERROR;
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_PARAMETERIZE);
   if ((status =  annotate             (bld, msa, hmm))                  != eslOK) goto ERROR;
-  if ((status =  calibrate            (bld, hmm, bg, opt_gm, opt_om))   != eslOK) goto ERROR;
-  if ((status =  make_post_msa        (bld, msa, hmm, tr, opt_postmsa)) != eslOK) goto ERROR;
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_ANNOTATE);
+  if ((status =  calibrate            (bld, hmm, bg, opt_gm, opt_om, calibrate_ncpu)) != eslOK) goto ERROR;
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_CALIBRATE);
 
   //force masked positions to background  (it'll be close already, so no relevant impact on weighting)
   if (hmm->mm != NULL)
@@ -518,21 +757,34 @@ profillic_p7_Builder(P7_BUILDER *bld, ESL_MSA *msa, ProfileType const * const pr
   if ( bld->abc->type == eslDNA ||  bld->abc->type == eslRNA ) {
 	  if (bld->w_len > 0)           hmm->max_length = bld->w_len;
 	  else if (bld->w_beta == 0.0)  hmm->max_length = hmm->M *4;
-	  else if ( (status =  profillic_p7_Builder_MaxLength(hmm, bld->w_beta)) != eslOK) goto ERROR;
+	  else if (opt_pool == NULL) {
+	    if ( (status =  profillic_p7_Builder_MaxLength(hmm, bld->w_beta)) != eslOK) goto ERROR;
+	  } else {
+	    double *mem = profillic_build_pool_Scratch(opt_pool, PROFILLIC_MAXLENGTH_NSCRATCH(hmm->M));
+	    if (mem == NULL) { status = eslEMEM; goto ERROR; }
+	    if ( (status =  profillic_p7_Builder_MaxLengthScratch(hmm, bld->w_beta, mem)) != eslOK) goto ERROR;
+	  }
   }
+  profillic_timings_Mark(opt_timings, PROFILLIC_STAGE_MAXLENGTH);
 
   hmm->checksum = checksum;
   hmm->flags   |= p7H_CHKSUM;
 
-  if (opt_hmm   != NULL) *opt_hmm   = hmm; else p7_hmm_Destroy(hmm);
+  if (use_cache && (status = profillic_build_cache_Store(opt_cache, cache_key, hmm, bld->errbuf)) != eslOK) goto ERROR;
+
+ DONE:
+  if ((status = sync_profiles(hmm, bg, (opt_gm != NULL ? *opt_gm : NULL), (opt_om != NULL ? *opt_om : NULL))) != eslOK) goto ERROR;
+
+  if (opt_hmm   != NULL) *opt_hmm   = hmm; else profillic_build_pool_DestroyHmm(opt_pool, hmm);
   if (opt_trarr != NULL) *opt_trarr = tr;  else p7_trace_DestroyArray(tr, msa->nseq);
   return eslOK;
 
  ERROR:
-  p7_hmm_Destroy(hmm);
+  profillic_build_pool_DestroyHmm(opt_pool, hmm);
   p7_trace_DestroyArray(tr, msa->nseq);
   if (opt_gm    != NULL) p7_profile_Destroy(*opt_gm);
   if (opt_om    != NULL) p7_oprofile_Destroy(*opt_om);
+  if (opt_postmsa != NULL && *opt_postmsa != NULL) { esl_msa_Destroy(*opt_postmsa); *opt_postmsa = NULL; }
   return status;
 }
 
@@ -577,7 +829,7 @@ profillic_p7_SingleBuilder(P7_BUILDER *bld, ESL_SQ *sq, P7_BG *bg, P7_HMM **opt_
   if ((status = p7_Seqmodel(bld->abc, sq->dsq, sq->n, sq->name, bld->Q, bg->f, bld->popen, bld->pextend, &hmm)) != eslOK) goto ERROR;
   if ((status = p7_hmm_SetComposition(hmm))                                                                     != eslOK) goto ERROR;
   if ((status = p7_hmm_SetConsensus(hmm, sq))                                                                   != eslOK) goto ERROR; 
-  if ((status = calibrate(bld, hmm, bg, opt_gm, opt_om))                                                        != eslOK) goto ERROR;
+  if ((status = calibrate(bld, hmm, bg, opt_gm, opt_om, 0))                                                     != eslOK) goto ERROR;
 
   /* build a faux glocal trace */
   if (opt_tr != NULL) 
@@ -610,221 +862,6 @@ profillic_p7_SingleBuilder(P7_BUILDER *bld, ESL_SQ *sq, P7_BG *bg, P7_HMM **opt_
 }
 
 
-/**
- * <pre>
- * Function:  profillic_p7_Builder_MaxLength()
- *
- * Purpose:  Compute the maximum likely length of an emitted sequence
- *
- * Synopsis:   Computes a fairly tight upper bound on domain length, by computing the
- * probability of the model emitting sequences of all lengths up to some
- * threshold, based on a dynamic-programming approach.  See TJW 01/14/2010 notes (p1)
- *
- * The idea is to find the length such that all but e.g. 1e-7 sequences emitted
- * by the model are at most that long. The method conceptually fills in a table of
- * length at most max_len (set to 100,000), though in practice, only two columns are
- * used to store values;
- *
- * Letting i correspond to the ith state of the model,
- *         j to a length j of emitted sequence, and
- *    T[i][P7H_*M]  := transition prob from *_i to M_{i+1}
- *    T[i][P7H_*I]  := transition prob from *_i to I_i
- *    T[i][P7H_*D]  := transition prob from *_i to D_{i+1}
- *
- *
- * in general,
- * M(i,j) = T[i-1][P7H_MM] * M(i-1,j-1) + T[i-1][P7H_DM] * D(i-1,j-1) + T[i-1][P7H_IM] * I(i-1,j-1);
- * I(i,j) = T[i][P7H_MI] * M(i,j-1) + T[i][P7H_II] * I(i,j-1);
- * D(i,j) = T[i-1][P7H_MD] * M(i-1,j) + T[i-1][P7H_DD] * D(i-1,j);
- *
- * The process of filling in the dp table is done for only the full core model.
- * We want to minimize memory consumption, so this is handled column-by-column,
- * storing only 2 columns at a time.
- *
- * Initial values must be set.
- * This is simple:
- *   M(1,1) = 1;
- *   I(1,1) = 0;
- *   D(1,1) = 0;
- *   D(2,1) = md;
- * Fill in the remainder of rows
- *   M(r,1) = I(r,1) = 0;
- *   D(r,1) = dd * D(r-1,1)
- *
- *
- * Then the next column:
- *   M(1,2) = D(1,2) = 0;
- *   I(1,2) = mi * M(1,1);
- *   I(2,2) = D(2,2) = 0;
- *   M(2,2) = mm * M(1,1);
- *   D(3,2) = md * M(2,2);
- * Fill in the remainder of rows r:
- *   M(r,2) = dm * M(r-1,1);
- *   D(r,2) = dd * D(r-1,2);
- *   I(r,2) = 0;
- *
- *
- *
- * Then for each column c after that,
- *   M(1,c) = D(1,c) = 0;
- *   I(1,c) =  ii * I(1,c-1)
- * Fill in the remainder of rows r based on the default formulas above
- * Then:
- *   M(i,j) = T[i-1][P7H_MM] * M(i-1,j-1) + T[i-1][P7H_DM] * D(i-1,j-1) + T[i-1][P7H_IM] * I(i-1,j-1);
- *   D(i,j) = T[i-1][P7H_MD] * M(i-1,j) + T[i-1][P7H_DD] * D(i-1,j);
- *   I(i,j) = T[i][P7H_MI] * M(i,j-1) + T[i][P7H_II] * I(i,j-1);
- *
- *
- * We aim to find the length W s.t. nearly all (e.g. all but 1e-7) of the sequences
- * emitted by the model are at most W long. Ideally, we could track the probability
- * of emitting each length from 0 up, and accumulate those probabilities until the
- * threshold is met. The probability of seeing a sequence of a given length emitted
- * by the full model is simply the sum of the D[m] and M[m] values (for a model of
- * length m). (I[m] is a false value - see below)
- *
- * I say "ideally", because numeric instability can lead the sum of all lengths - up
- * to infinity - to be <0.99999 or >1.0 ... so instead we keep track of two things for
- * each length L:
- * (1) the sum of D[m] and M[m] prob masses for all lengths up to L  (call this X), and
- * (2) the amount of the probability mass that belongs to all L-length-emitting states
- * except the final M/D states.  That's the mass that will end up being spread across
- * all lengths >L (call this Y).
- *
- * If not for numeric instability, X+Y=1, and we'd want to stop when Y <= 1e-7.  Because
- * X+Y might not == 1, instead stop when Y/(X+Y) <= 1e-7.
- *
- * A note for computing X: the final position in the model does not actually include an
- * I-state, so all of the final M state's probability mass should go to the E state.
- * The value in I[m][] will suggest that some of that probability has gone to that state,
- * but this will be ignored when tallying X = M[m]+D[m].
- *
- * A note on the calculation of Y: it's not quite as simple as adding up all pre-m
- * states. For a given length j, the only way a D[i]-state can emit a sequence of length
- * j is if an M[k] state emitted that sequence, with k<i.  If k<i-1, then other D states
- * were also involved. The simplest way to account for this is to bleed the part of the
- * M[i] or D[i] state that gets pushed forward into the next D state. That amount will
- * end up being accounted for by either that later D state or (for the small part that
- * bleeds all the way to the mth D state, it'll be added into X via D[m].  In other words:
- * (1) each M[i] should contribute (1-t_md)M[i] to Y.
- * (2) each D[i] should contribute (1-t_dd)D[i] to Y.
- *
- *
- * Args:      hmm         - p7_HMM (required for the transition probabilities)
- *
- * Returns:   <eslOK> on success. The max length is set in hmm->max_length.
- * </pre>
- */
-int
-profillic_p7_Builder_MaxLength (P7_HMM *hmm, double emit_thresh)
-{
-  int      col_ptr, prev_col_ptr; // which true column in above 2d-arrays is active
-  int      col;                   // which conceptual column in above 2d-arrays is active (up to table_len)
-  double   p_sum;                 // sum of probabilities for lengths <=L;  X from above
-  double   surv;                  // surviving probability mass at length L; Y from above
-  int      k;                     // active state in model
-  int      i;
-  int      length_bound = 200000; // default cap on # iterations (aka max model length)
-  double **I            = NULL;
-  double **M            = NULL;
-  double **D            = NULL;
-  int      model_len    = hmm->M; // model length                
-  int      status;
-  
-  if (model_len==1) {
-    hmm->max_length = 1;
-    return eslOK;
-  }
-
-
-  //    double I[model_len+1][2], M[model_len+1][2], D[model_len+1][2]; //2 columns for each way of ending a subpath
-  ESL_ALLOC_CPP(double*, I, (model_len+1) * sizeof(double*)); 
-  ESL_ALLOC_CPP(double*, M, (model_len+1) * sizeof(double*)); 
-  ESL_ALLOC_CPP(double*, D, (model_len+1) * sizeof(double*)); 
-  for (i = 0; i <= model_len; i++) {
-    I[i] = M[i] = D[i] = NULL; 
-  }
-  for (i=0; i <= model_len; i++) {
-    ESL_ALLOC_CPP(double, I[i], 2 * sizeof(double));
-    ESL_ALLOC_CPP(double, M[i], 2 * sizeof(double));
-    ESL_ALLOC_CPP(double, D[i], 2 * sizeof(double));
-  }
-
-  /*  Compute max length and max prefix lengths*/
-  // special case for filling in 1st column of DP table,  col=1;
-  M[1][0] = 1.0;// 1st match state must emit a character
-  I[1][0] = D[1][0] = M[2][0] = I[2][0] = 0;
-  D[2][0] = hmm->t[1][p7H_MD];  // The 2nd delete state is reached, having emitted only 1 character
-  for (k=3; k<=model_len; k++){
-    M[k][0] = I[k][0] = 0;
-    D[k][0] = hmm->t[k-1][p7H_DD] * D[k-1][0];  // only way to get to the 3rd or greater state with only 1 character
-  }
-
-  //special case for 2nd column
-  M[1][1] = D[1][1] = D[2][1] = I[2][1] = 0;  //No way any of these states can be responsible for the second emitted character.
-  I[1][1] = hmm->t[1][p7H_MI] * M[1][0];  //1st insert state can emit char #2.
-  M[2][1] = hmm->t[1][p7H_MM] * M[1][0] ; //2nd match state can emit char #2.
-  for (k=3; k<=model_len; k++){
-    M[k][1] = hmm->t[k-1][p7H_DM] * D[k-1][0] ; //kth match state would have to follow the k-1th delete state, having emitted only 1 char so far
-    I[k][1] = 0;
-    D[k][1] = hmm->t[k-1][p7H_MD] * M[k-1][1]  +  hmm->t[k-1][p7H_DD] * D[k-1][1]; //in general only by extending a delete.  For k=3, this could be a transition from M=2, with 2 chars.
-  }
-
-  p_sum = M[model_len][0] + M[model_len][1] + D[model_len][0] + D[model_len][1];
-
-  //general case for all remaining columns
-  col_ptr = 0;
-  for (col=3; col<=length_bound; col++) {
-    prev_col_ptr = 1-col_ptr;
-    surv = 0.0;
-    M[1][col_ptr] = D[1][col_ptr] = 0; //M[i][prev_col_ptr] is zero :  no way the first M state could have emitted >=2 chars
-    I[1][col_ptr] =  hmm->t[1][p7H_II] * I[1][prev_col_ptr];  // 1st insert state can emit chars indefinitely
-    surv += I[1][col_ptr];
-
-    for (k=2; k<=model_len; k++){
-      M[k][col_ptr] = hmm->t[k-1][p7H_MM] * M[k-1][prev_col_ptr]  +  hmm->t[k-1][p7H_DM] * D[k-1][prev_col_ptr]  +  hmm->t[k-1][p7H_IM] * I[k-1][prev_col_ptr];
-      I[k][col_ptr] = hmm->t[k][p7H_MI] * M[k][prev_col_ptr]    +  hmm->t[k][p7H_II] * I[k][prev_col_ptr];
-      D[k][col_ptr] = hmm->t[k-1][p7H_MD] * M[k-1][col_ptr]  +  hmm->t[k-1][p7H_DD] * D[k-1][col_ptr];
-
-      if (k<=model_len) {
-        surv +=  I[k][col_ptr] +
-     	           M[k][col_ptr] * ( 1 - hmm->t[k][p7H_MD] ) +  //this much of M[k]'s mass will bleed into D[k+1], and thus be added to surv then
-                 D[k][col_ptr] * ( 1 - hmm->t[k][p7H_DD] )  ; //this much of D[k]'s mass will bleed into D[k+1], and thus be added to surv then
-      }
-    }
-    surv +=    M[model_len][col_ptr] * ( hmm->t[model_len][p7H_MD] )   //the final state doesn't pass on to the next D state
-             + D[model_len][col_ptr] * ( hmm->t[model_len][p7H_DD] )  // the final state doesn't pass on to the next D state
-             - I[model_len][col_ptr] ;  // no I state for final position
-
-    p_sum += M[model_len][col_ptr] + D[model_len][col_ptr];
-    surv /= surv + p_sum;
-
-    if (surv < emit_thresh) {
-      hmm->max_length = col;
-      break;
-    }
-
-    col_ptr = 1-col_ptr; // alternating between 0 and 1
-  }
-
-  for (i=0; i<model_len+1; i++) {
-    free(I[i]);
-    free(M[i]);
-    free(D[i]);
-  }
-  free(I);
-  free(M);
-  free(D);
-
-  if (hmm->max_length >= length_bound) return eslERANGE;
-  return eslOK;
-  
- ERROR:
-  if (I) { for (i = 0; i <= model_len; i++) { if (I[i]) free(I[i]); }  free(I);  }
-  if (D) { for (i = 0; i <= model_len; i++) { if (D[i]) free(D[i]); }  free(D);  }
-  if (M) { for (i = 0; i <= model_len; i++) { if (M[i]) free(M[i]); }  free(M);  }
-  return status;
-}
-
 /*------------- end, model construction API ---------------------*/
 
 
@@ -870,19 +907,20 @@ validate_msa(P7_BUILDER *bld, ESL_MSA *msa)
 
 
 /** 
- * static int relative_weights(P7_BUILDER *bld, ESL_MSA *msa)
- * Set msa->wgt vector, using user's choice of relative weighting algorithm.
+ * static int relative_weights(P7_BUILDER *bld, ESL_MSA *msa, int const weight_ncpu)
+ * Set msa->wgt vector, using user's choice of relative weighting algorithm
+ * (--wpb and --wblosum on <weight_ncpu> threads).
  */
 static int
-relative_weights(P7_BUILDER *bld, ESL_MSA *msa)
+relative_weights(P7_BUILDER *bld, ESL_MSA *msa, int const weight_ncpu)
 {
   int status = eslOK;
 
   if      (bld->wgt_strategy == p7_WGT_NONE)                    { esl_vec_DSet(msa->wgt, msa->nseq, 1.); }
   else if (bld->wgt_strategy == p7_WGT_GIVEN)                   {}
-  else if (bld->wgt_strategy == p7_WGT_PB)                      status = esl_msaweight_PB(msa); 
+  else if (bld->wgt_strategy == p7_WGT_PB)                      status = profillic_msaweight_PB(msa, weight_ncpu); 
   else if (bld->wgt_strategy == p7_WGT_GSC)                     status = esl_msaweight_GSC(msa); 
-  else if (bld->wgt_strategy == p7_WGT_BLOSUM)                  status = esl_msaweight_BLOSUM(msa, bld->wid); 
+  else if (bld->wgt_strategy == p7_WGT_BLOSUM)                  status = profillic_msaweight_BLOSUM(msa, bld->wid, weight_ncpu); 
   else ESL_EXCEPTION(eslEINCONCEIVABLE, "no such weighting strategy");
 
   if (status != eslOK) ESL_FAIL(status, bld->errbuf, "failed to set relative weights in alignment");
@@ -894,171 +932,36 @@ relative_weights(P7_BUILDER *bld, ESL_MSA *msa)
  * profillic_p7_Profillicmodelmaker()
  *
  * Given <msa>, choose HMM architecture, collect counts;
- * upon return, <*ret_hmm> is newly allocated and contains
- * relative-weighted observed counts.
+ * upon return, <*ret_hmm> is newly allocated (or reused from
+ * <opt_pool>, if that isn't <NULL>) and contains relative-weighted
+ * observed counts.
+ *
+ * The conversion, and whether the model is scaled up to the number of
+ * sequences the (consensus-only) <msa> stands for, are
+ * ProfillicProfileKind<ProfileType>'s.
  */
 template <typename ProfileType>
 static int
-profillic_p7_Profillicmodelmaker(P7_BUILDER *bld, ESL_MSA * msa, ProfileType const & profile, P7_HMM **ret_hmm)
+profillic_p7_Profillicmodelmaker(P7_BUILDER *bld, ESL_MSA * msa, ProfileType const & profile, P7_HMM **ret_hmm, PROFILLIC_BUILD_POOL *opt_pool)
 {
-  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
-
   int        status;		/**< return status                       */
   P7_HMM    *hmm = NULL;        /**< RETURN: new hmm                     */
   int      M;                   /**< length of new model in match states */
   int      apos;                /**< counter for aligned columns         */
   char errbuf[eslERRBUFSIZE];
 
-  uint32_t pos_i; ///< Position in profile.  Corresponds to one less than match state pos in HMM.
-  uint32_t res_i;
-  ESL_DSQ hmmer_digitized_residue;
-
   /* How many match states in the HMM? */
   M = static_cast<int>( profile.length() );
   if (M == 0) { status = eslENORESULT; goto ERROR; }
 
-  /// \note Note that HMMER3 has a slightly different model, starting in
-  /// Begin rather than in preAlign, and with 3 legal transitions out
-  /// of Begin (one of these is to PreAlign).  The galosh profile model
-  /// begins in preAlign and transitions to Begin, and from there to
-  /// either Match or Delete.  One implication is that galosh profiles
-  /// enforce t[ 0 ][ p7H_MI ] to be the same as t[ 0 ][ p7H_II ], but
-  /// HMMER3 does not.  Another way to say this is that H3 uses affine
-  /// pre-aligns, and prohibits pre-align -to- delete transitions,
-  /// whereas galosh / profillic uses non-affine pre-aligns and allows
-  /// pre-align->delete.
-
   /* Build count model from profile */
-  if ((hmm    = p7_hmm_Create(M, msa->abc)) == NULL)  { status = eslEMEM; goto ERROR; }
-  if ((status = p7_hmm_Zero(hmm))           != eslOK) goto ERROR;
-
-  // ALWAYS TRUE, so need not be set:
-  //hmm->t[ 0 ][ p7H_DM ] = 1.0;
-  //hmm->t[ 0 ][ p7H_DD ] = 0.0;
-
-  // fromPreAlign
-  hmm->t[ 0 ][ p7H_MI ] =
-     toDouble(
-      profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toPreAlign ]
-    );
-  hmm->t[ 0 ][ p7H_II ] =  hmm->t[ 0 ][ p7H_MI ];
-  hmm->t[ 0 ][ p7H_IM ] = ( 1 - hmm->t[ 0 ][ p7H_MI ] );
-  for( res_i = 0; res_i < seqan::ValueSize<ResidueType>::VALUE; res_i++ ) {
-    hmmer_digitized_residue =
-      esl_abc_DigitizeSymbol( msa->abc, static_cast<char>( ResidueType( res_i ) ) );
-    hmm->ins[ 0 ][ hmmer_digitized_residue ] =
-       toDouble(
-        profile[ galosh::Emission::PreAlignInsertion ][ res_i ]
-       );
-  }
-
-  // fromBegin
-  hmm->t[ 0 ][ p7H_MM ] =
-    toDouble(
-      ( 1 - hmm->t[ 0 ][ p7H_MI ] ) *
-      profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ]
-    );
-  hmm->t[ 0 ][ p7H_MD ] =
-    toDouble(
-      ( 1 - hmm->t[ 0 ][ p7H_MI ] ) *
-      profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toDeletion ]
-    );
-
-  // ALWAYS TRUE, so need not be set:
-  // Convention sets first elem to 1, rest to 0.
-  hmm->mat[ 0 ][ 0 ] = 1.0;
-  for( res_i = 1; res_i < hmm->abc->K; res_i++ ) {
-    hmm->mat[ 0 ][ res_i ] = 0.0;
-  }
-
-  for( pos_i = 0; pos_i < profile.length(); pos_i++ ) {
-//    if( be_verbose ) {
-//      cout << '.';
-//      cout.flush();
-//    }
-    // TODO: If this is too slow, memoize the ResidueType( res_i )s.
-    for( res_i = 0; res_i < seqan::ValueSize<ResidueType>::VALUE; res_i++ ) {
-      hmmer_digitized_residue =
-        esl_abc_DigitizeSymbol( msa->abc, static_cast<char>( ResidueType( res_i ) ) );
-      hmm->mat[ pos_i + 1 ][ hmmer_digitized_residue ] =
-        toDouble(
-          profile[ pos_i ][ galosh::Emission::Match ][ res_i ]
-        );
-      if( pos_i == ( profile.length() - 1 ) ) {
-        // Use post-align insertions
-        hmm->ins[ pos_i + 1 ][ hmmer_digitized_residue ] =
-          toDouble(
-            profile[ galosh::Emission::PostAlignInsertion ][ res_i ]
-          );
-        assert( hmm->ins[ pos_i + 1 ][ hmmer_digitized_residue ] == hmm->ins[ 0 ][ hmmer_digitized_residue ] );
-      } else { // if this is the last position (use post-align insertions) .. else ..
-        hmm->ins[ pos_i + 1 ][ hmmer_digitized_residue ] =
-          toDouble(
-            profile[ galosh::Emission::Insertion ][ res_i ]
-          );
-      } // End if this is the last position (use post-align insertions) .. else ..
-    } // End foreach res_i
-    if( pos_i == ( profile.length() - 1 ) ) {
-      // Use post-align insertions
-      hmm->t[ pos_i + 1 ][ p7H_IM ] =
-         toDouble(
-           profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ]
-         );
-      hmm->t[ pos_i + 1 ][ p7H_II ] =
-         toDouble(
-           profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toPostAlign ]
-         );
-
-      hmm->t[ pos_i + 1 ][ p7H_MM ] = //hmm->t[ pos_i + 1 ][ p7H_IM ];
-        toDouble(
-          profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ]
-        );
-      hmm->t[ pos_i + 1 ][ p7H_MI ] = //1.0 - hmm->t[ pos_i + 1 ][ p7H_MM ];
-        toDouble(
-          profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toPostAlign ]
-        );
-
-      // ALWAYS TRUE, so need not be set:
-      //hmm->t[ pos_i + 1 ][ p7H_DM ] = 1;
-      //hmm->t[ pos_i + 1 ][ p7H_MD ] = 0;
-      //hmm->t[ pos_i + 1 ][ p7H_DD ] = 0;
-
-    } else {  // if this is the last position (use post-align insertions) .. else ..
-      hmm->t[ pos_i + 1 ][ p7H_MM ] =
-        toDouble(
-          profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toMatch ]
-        );
-      hmm->t[ pos_i + 1 ][ p7H_MI ] =
-        toDouble(
-          profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toInsertion ]
-        );
-      hmm->t[ pos_i + 1 ][ p7H_MD ] =
-        toDouble(
-          profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toDeletion ]
-        );
-  
-      hmm->t[ pos_i + 1 ][ p7H_IM ] =
-        toDouble(
-          profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toMatch ]  
-        );
-      hmm->t[ pos_i + 1 ][ p7H_II ] =
-        toDouble(
-          profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toInsertion ]
-        );
-      hmm->t[ pos_i + 1 ][ p7H_DM ] =
-        toDouble(
-          profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toMatch ]
-        );
-      hmm->t[ pos_i + 1 ][ p7H_DD ] =
-        toDouble(
-          profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toDeletion ]
-        );
-    } // End if this is the last position (use post-align insertions) .. else ..
-  } // End foreach pos_i
+  if ((hmm    = profillic_build_pool_CreateHmm(opt_pool, M, msa->abc)) == NULL)  { status = eslEMEM; goto ERROR; }
+  if ((status = p7_hmm_Zero(hmm))                    != eslOK) goto ERROR;
+  if ((status = ProfillicProfileKind<ProfileType>::ToHmm(profile, hmm)) != eslOK) goto ERROR;
 
   // TODO: Make nseq / eff_nseq somehow inputs!
-  hmm->nseq     = msa->nseq;
-  hmm->eff_nseq = msa->nseq;
+  hmm->nseq     = profillic_esl_msa_Nseq(msa);
+  hmm->eff_nseq = hmm->nseq;
 
   /* Transfer annotation from the MSA to the new model
    */
@@ -1074,11 +977,16 @@ profillic_p7_Profillicmodelmaker(P7_BUILDER *bld, ESL_MSA * msa, ProfileType con
     msa->rf[apos-1] = 'x';
   msa->rf[msa->alen] = '\0';
 
+  /* An alignment profile makes a "counts model": each position's
+   * distributions are scaled up to sum to nseq (without it, the
+   * effective sequence number calculation doesn't work). */
+  if (ProfillicProfileKind<ProfileType>::counts_scaled) p7_hmm_Scale(hmm, hmm->nseq);
+
   *ret_hmm = hmm;
   return eslOK;
 
  ERROR:
-  if (hmm    != NULL) p7_hmm_Destroy(hmm);
+  if (hmm    != NULL) profillic_build_pool_DestroyHmm(opt_pool, hmm);
   *ret_hmm = NULL;
   return status;
 }
@@ -1094,12 +1002,12 @@ profillic_p7_Profillicmodelmaker(P7_BUILDER *bld, ESL_MSA * msa, ProfileType con
  */
 template <typename ProfileType>
 static int
-profillic_build_model(P7_BUILDER *bld, ESL_MSA *msa, ProfileType const * const profile_ptr, P7_HMM **ret_hmm, P7_TRACE ***opt_tr)
+profillic_build_model(P7_BUILDER *bld, ESL_MSA *msa, ProfileType const * const profile_ptr, P7_HMM **ret_hmm, P7_TRACE ***opt_tr, PROFILLIC_BUILD_POOL *opt_pool)
 {
   int status;
 
   if( profile_ptr != NULL ) {
-    status = profillic_p7_Profillicmodelmaker(bld, msa, *profile_ptr, ret_hmm);
+    status = profillic_p7_Profillicmodelmaker(bld, msa, *profile_ptr, ret_hmm, opt_pool);
   } else
   if      (bld->arch_strategy == p7_ARCH_FAST)
     {
@@ -1200,19 +1108,21 @@ profillic_annotate_model(P7_HMM *hmm, ESL_MSA * msa)
  *
  * <prior> is needed because we may need to parameterize test models
  * looking for the right relative entropy. (for --eent, the default)
+ *
+ * --eclust clusters on <weight_ncpu> threads.
  */
 static int
-effective_seqnumber(P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm, const P7_BG *bg)
+effective_seqnumber(P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm, const P7_BG *bg, int const weight_ncpu)
 {
   int    status;
 
-  if      (bld->effn_strategy == p7_EFFN_NONE)    hmm->eff_nseq = msa->nseq;
+  if      (bld->effn_strategy == p7_EFFN_NONE)    hmm->eff_nseq = hmm->nseq;
   else if (bld->effn_strategy == p7_EFFN_SET)     hmm->eff_nseq = bld->eset;
   else if (bld->effn_strategy == p7_EFFN_CLUST)
     {
       int nclust;
 
-      status = esl_msacluster_SingleLinkage(msa, bld->eid, NULL, NULL, &nclust);
+      status = profillic_msacluster_SingleLinkage(msa, bld->eid, weight_ncpu, NULL, &nclust);
       if      (status == eslEMEM) ESL_XFAIL(status, bld->errbuf, "memory allocation failed");
       else if (status != eslOK)   ESL_XFAIL(status, bld->errbuf, "single linkage clustering algorithm (at %d%% id) failed", (int)(100 * bld->eid));
 
@@ -1320,6 +1230,25 @@ annotate(P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm)
 {
   int status;
 
+  if ((status = annotate_labels(bld, msa, hmm))                 != eslOK) goto ERROR;
+  if ((status = p7_hmm_SetComposition(hmm))                     != eslOK) ESL_XFAIL(status, bld->errbuf, "Failed to determine model composition");
+  if ((status = p7_hmm_SetConsensus(hmm, NULL))                 != eslOK) ESL_XFAIL(status, bld->errbuf, "Failed to set consensus line");
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* annotate_labels()
+ * The part of annotate() that doesn't depend on the model's
+ * parameters: name, accession, description, creation time and
+ * cutoffs.  A model taken from the build cache gets just these.
+ */
+static int
+annotate_labels(P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm)
+{
+  int status;
+
   /* Name. */
   if (msa->name) p7_hmm_SetName(hmm, msa->name);  
   else ESL_XFAIL(eslEINVAL, bld->errbuf, "Unable to name the HMM.");
@@ -1328,8 +1257,6 @@ annotate(P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm)
   if ((status = p7_hmm_SetDescription(hmm, msa->desc))          != eslOK) ESL_XFAIL(status, bld->errbuf, "Failed to record MSA description");
   //  if ((status = p7_hmm_AppendComlog(hmm, go->argc, go->argv))   != eslOK) ESL_XFAIL(status, errbuf, "Failed to record command log");
   if ((status = p7_hmm_SetCtime(hmm))                           != eslOK) ESL_XFAIL(status, bld->errbuf, "Failed to record timestamp");
-  if ((status = p7_hmm_SetComposition(hmm))                     != eslOK) ESL_XFAIL(status, bld->errbuf, "Failed to determine model composition");
-  if ((status = p7_hmm_SetConsensus(hmm, NULL))                 != eslOK) ESL_XFAIL(status, bld->errbuf, "Failed to set consensus line");
 
   if (msa->cutset[eslMSA_GA1] && msa->cutset[eslMSA_GA2]) { hmm->cutoff[p7_GA1] = msa->cutoff[eslMSA_GA1]; hmm->cutoff[p7_GA2] = msa->cutoff[eslMSA_GA2]; hmm->flags |= p7H_GA; }
   if (msa->cutset[eslMSA_TC1] && msa->cutset[eslMSA_TC2]) { hmm->cutoff[p7_TC1] = msa->cutoff[eslMSA_TC1]; hmm->cutoff[p7_TC2] = msa->cutoff[eslMSA_TC2]; hmm->flags |= p7H_TC; }
@@ -1341,21 +1268,304 @@ annotate(P7_BUILDER *bld, const ESL_MSA *msa, P7_HMM *hmm)
   return status;
 }
 
+#ifdef HMMER_THREADS
+/**
+ * One worker's share of a threaded calibrate(): its own bg (the
+ * simulations reset the bg's length), its own RNG, how many of each
+ * simulated sequence set it is to score, its mu fits, and its Forward
+ * scores (its slice of the caller's array of all of them).
+ */
+typedef struct {
+  const P7_HMM   *hmm;
+  P7_BG          *bg;
+  ESL_RANDOMNESS *r;
+  double          lambda;
+  int             EmL, EmN;	/* MSV:     length, number of seqs for this worker */
+  int             EvL, EvN;	/* Viterbi: length, number of seqs for this worker */
+  int             EfL, EfN;	/* Forward: length, number of seqs for this worker */
+  double          mmu;
+  double          vmu;
+  double         *fsc;		/* Forward: this worker's EfN scores, in bits */
+  int             status;
+} CALIBRATE_INFO;
+
+/**
+ * static int calibrate_forward_scores()
+ *
+ * The simulation half of p7_Tau(), without its fit: score <N> iid
+ * sequences of length <L> with Forward, in bits over the null model,
+ * into <xv[0..N-1]>, so that calibrate_threaded() can make one fit to
+ * all of its workers' scores.
+ */
+static int
+calibrate_forward_scores(ESL_RANDOMNESS *r, P7_OPROFILE *om, P7_BG *bg, int L, int N, double *xv)
+{
+  P7_CHECKPTMX *cx  = NULL;
+  ESL_DSQ      *dsq = NULL;
+  float         fsc, nullsc;
+  int           i;
+  int           status;
+
+  ESL_ALLOC_CPP( ESL_DSQ, dsq, sizeof(ESL_DSQ) * (L+2));
+  if ((cx = p7_checkptmx_Create(om->M, L, ESL_MBYTES(p7_RAMLIMIT))) == NULL) { status = eslEMEM; goto ERROR; }
+
+  p7_oprofile_ReconfigLength(om, L);
+  p7_bg_SetLength(bg, L);
+
+  for (i = 0; i < N; i++)
+    {
+      if ((status = esl_rsq_xfIID(r, bg->f, om->abc->K, L, dsq)) != eslOK) goto ERROR;
+      if ((status = p7_ForwardFilter(dsq, L, om, cx, &fsc))      != eslOK) goto ERROR;
+      if ((status = p7_bg_NullOne(bg, dsq, L, &nullsc))          != eslOK) goto ERROR;
+      xv[i] = (fsc - nullsc) / eslCONST_LOG2;
+      p7_checkptmx_Reuse(cx);
+    }
+
+  p7_checkptmx_Destroy(cx);
+  free(dsq);
+  return eslOK;
+
+ ERROR:
+  if (cx  != NULL) p7_checkptmx_Destroy(cx);
+  if (dsq != NULL) free(dsq);
+  return status;
+}
+
+/**
+ * static void calibrate_thread(void *arg)
+ *
+ * Calibration worker: configure a private profile for <info->hmm> and
+ * run this worker's share of the MSV, Viterbi and Forward simulations:
+ * mu fits for the first two, raw scores for the last.
+ */
+static void
+calibrate_thread(void *arg)
+{
+  ESL_THREADS    *obj  = (ESL_THREADS *) arg;
+  CALIBRATE_INFO *info;
+  P7_PROFILE     *gm   = NULL;
+  P7_OPROFILE    *om   = NULL;
+  int             workeridx;
+  int             status;
+
+  esl_threads_Started(obj, &workeridx);
+  info = (CALIBRATE_INFO *) esl_threads_GetData(obj, workeridx);
+
+  if ((gm = p7_profile_Create(info->hmm->M, info->hmm->abc))  == NULL)  { status = eslEMEM; goto ERROR; }
+  if ((om = p7_oprofile_Create(info->hmm->M, info->hmm->abc)) == NULL)  { status = eslEMEM; goto ERROR; }
+  if ((status = p7_profile_Config(gm, info->hmm, info->bg))   != eslOK) goto ERROR;
+  if ((status = p7_oprofile_Convert(gm, om))                  != eslOK) goto ERROR;
+
+  if (info->EmN > 0 && (status = p7_MSVMu    (info->r, om, info->bg, info->EmL, info->EmN, info->lambda,            &(info->mmu))) != eslOK) goto ERROR;
+  if (info->EvN > 0 && (status = p7_ViterbiMu(info->r, om, info->bg, info->EvL, info->EvN, info->lambda,            &(info->vmu))) != eslOK) goto ERROR;
+  if (info->EfN > 0 && (status = calibrate_forward_scores(info->r, om, info->bg, info->EfL, info->EfN, info->fsc))       != eslOK) goto ERROR;
+
+  info->status = eslOK;
+  p7_oprofile_Destroy(om);
+  p7_profile_Destroy(gm);
+  esl_threads_Finished(obj, workeridx);
+  return;
+
+ ERROR:
+  info->status = status;
+  if (om != NULL) p7_oprofile_Destroy(om);
+  if (gm != NULL) p7_profile_Destroy(gm);
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+
+/**
+ * static double merge_gumbel_mu(CALIBRATE_INFO *info, int nworkers, int which, double lambda)
+ *
+ * With lambda fixed, the ML Gumbel location for scores x_1..x_N is
+ * mu = -1/lambda log( 1/N \sum_i e^{-lambda x_i} ), so each worker's
+ * fit mu_j over its N_j scores stands in for its sum, and
+ * mu = -1/lambda log( \sum_j N_j e^{-lambda mu_j} / N ) is exactly the
+ * fit the serial code would make to the pooled scores. <which> is 0 to
+ * merge the MSV fits, 1 for the Viterbi fits.
+ */
+static double
+merge_gumbel_mu(CALIBRATE_INFO *info, int nworkers, int which, double lambda)
+{
+  double maxv = -eslINFINITY;
+  double sum  = 0.;
+  int    N    = 0;
+  int    Nj;
+  double v;
+  int    j;
+
+  for (j = 0; j < nworkers; j++) {
+    Nj = (which == 0) ? info[j].EmN : info[j].EvN;
+    if (Nj == 0) continue;
+    v  = -lambda * ((which == 0) ? info[j].mmu : info[j].vmu);
+    if (v > maxv) maxv = v;
+  }
+  for (j = 0; j < nworkers; j++) {
+    Nj = (which == 0) ? info[j].EmN : info[j].EvN;
+    if (Nj == 0) continue;
+    v  = -lambda * ((which == 0) ? info[j].mmu : info[j].vmu);
+    sum += Nj * exp(v - maxv);
+    N   += Nj;
+  }
+  return -(maxv + log(sum / (double) N)) / lambda;
+}
+
+/**
+ * static int calibrate_threaded()
+ *
+ * calibrate(), for one (long) model, with the three simulations split
+ * across <ncpus> threads.  Worker <j> scores its share of each sequence
+ * set with its own RNG, seeded from the <j>th draw off <bld->r> (which
+ * is first reseeded, as usual, unless --seed 0), so results are
+ * reproducible for a given seed and thread count.  The MSV and Viterbi
+ * mu fits merge exactly (see merge_gumbel_mu()). The Forward tau comes
+ * from a two-parameter Gumbel fit, which can't be pooled from the
+ * per-worker fits, so the workers return their raw Forward scores, and
+ * tau is fit once to all of them, as p7_Tau() would fit them serially.
+ */
+static int
+calibrate_threaded(P7_BUILDER *bld, P7_HMM *hmm, P7_BG *bg, int ncpus)
+{
+  ESL_THREADS    *threadObj = NULL;
+  CALIBRATE_INFO *info      = NULL;
+  double         *fsc       = NULL;	/* all bld->EfN Forward scores, each worker's a slice */
+  double          lambda;
+  double          gmu, glam;
+  int             Nmin;
+  int             nf;
+  int             j;
+  int             status;
+
+  /* don't bother with workers that would have nothing to do */
+  Nmin  = ESL_MIN(bld->EmN, ESL_MIN(bld->EvN, bld->EfN));
+  ncpus = ESL_MIN(ncpus, Nmin);
+
+  if (bld->do_reseeding) esl_randomness_Init(bld->r, esl_randomness_GetSeed(bld->r));
+  if ((status = p7_Lambda(hmm, bg, &lambda)) != eslOK) ESL_XFAIL(status, bld->errbuf, "failed to determine lambda");
+
+  ESL_ALLOC_CPP( double,         fsc,  sizeof(double) * bld->EfN);
+  ESL_ALLOC_CPP( CALIBRATE_INFO, info, sizeof(CALIBRATE_INFO) * ncpus);
+  for (j = 0; j < ncpus; j++) { info[j].bg = NULL; info[j].r = NULL; }
+
+  threadObj = esl_threads_Create(&calibrate_thread);
+  for (nf = 0, j = 0; j < ncpus; j++)
+    {
+      info[j].hmm    = hmm;
+      info[j].lambda = lambda;
+      info[j].EmL    = bld->EmL;  info[j].EmN = bld->EmN / ncpus + (j < bld->EmN % ncpus ? 1 : 0);
+      info[j].EvL    = bld->EvL;  info[j].EvN = bld->EvN / ncpus + (j < bld->EvN % ncpus ? 1 : 0);
+      info[j].EfL    = bld->EfL;  info[j].EfN = bld->EfN / ncpus + (j < bld->EfN % ncpus ? 1 : 0);
+      info[j].mmu    = info[j].vmu = 0.;
+      info[j].fsc    = fsc + nf;
+      info[j].status = eslOK;
+      nf += info[j].EfN;
+      if ((info[j].bg = p7_bg_Clone(bg))                                            == NULL) { status = eslEMEM; goto ERROR; }
+      if ((info[j].r  = esl_randomness_CreateFast(1 + esl_rnd_Roll(bld->r, INT_MAX-1))) == NULL) { status = eslEMEM; goto ERROR; }
+      esl_threads_AddThread(threadObj, &info[j]);
+    }
+
+  esl_threads_WaitForStart(threadObj);
+  esl_threads_WaitForFinish(threadObj);
+
+  for (j = 0; j < ncpus; j++)
+    if ((status = info[j].status) != eslOK) ESL_XFAIL(status, bld->errbuf, "E-value calibration failed");
+
+  /* One fit to all the Forward scores; tau is then, as in p7_Tau(), the x at
+   * which the Gumbel tail mass is Eft, backed up by log(Eft)/lambda.
+   */
+  if ((status = esl_gumbel_FitComplete(fsc, bld->EfN, &gmu, &glam)) != eslOK) ESL_XFAIL(status, bld->errbuf, "E-value calibration failed");
+
+  hmm->evparam[p7_MLAMBDA] = lambda;
+  hmm->evparam[p7_VLAMBDA] = lambda;
+  hmm->evparam[p7_FLAMBDA] = lambda;
+  hmm->evparam[p7_MMU]     = merge_gumbel_mu(info, ncpus, 0, lambda);
+  hmm->evparam[p7_VMU]     = merge_gumbel_mu(info, ncpus, 1, lambda);
+  hmm->evparam[p7_FTAU]    = esl_gumbel_invcdf(1.0 - bld->Eft, gmu, glam) + (log(bld->Eft) / lambda);
+  hmm->flags              |= p7H_STATS;
+
+  for (j = 0; j < ncpus; j++) { p7_bg_Destroy(info[j].bg); esl_randomness_Destroy(info[j].r); }
+  free(info);
+  free(fsc);
+  esl_threads_Destroy(threadObj);
+  return eslOK;
+
+ ERROR:
+  if (fsc != NULL) free(fsc);
+  if (info != NULL) {
+    for (j = 0; j < ncpus; j++) {
+      if (info[j].bg != NULL) p7_bg_Destroy(info[j].bg);
+      if (info[j].r  != NULL) esl_randomness_Destroy(info[j].r);
+    }
+    free(info);
+  }
+  if (threadObj != NULL) esl_threads_Destroy(threadObj);
+  return status;
+}
+#endif /*HMMER_THREADS*/
+
+/**
+ * make_profiles()
+ *
+ * Configure a profile, and convert it to an optimized profile, for
+ * <hmm> as it stands, returning whichever of the two the caller asks
+ * for (neither is made if both <opt_gm> and <opt_om> are <NULL>).
+ * For calibrations that don't make their own, and for models taken
+ * from the build cache.
+ */
+static int
+make_profiles(const P7_HMM *hmm, P7_BG *bg, P7_PROFILE **opt_gm, P7_OPROFILE **opt_om)
+{
+  P7_PROFILE  *gm = NULL;
+  P7_OPROFILE *om = NULL;
+  int          status;
+
+  if (opt_gm != NULL) *opt_gm = NULL;
+  if (opt_om != NULL) *opt_om = NULL;
+  if (opt_gm == NULL && opt_om == NULL) return eslOK;
+
+  if ((gm = p7_profile_Create(hmm->M, hmm->abc))  == NULL)  { status = eslEMEM; goto ERROR; }
+  if ((status = p7_profile_Config(gm, hmm, bg))   != eslOK) goto ERROR;
+  if (opt_om != NULL) {
+    if ((om = p7_oprofile_Create(hmm->M, hmm->abc)) == NULL)  { status = eslEMEM; goto ERROR; }
+    if ((status = p7_oprofile_Convert(gm, om))      != eslOK) goto ERROR;
+    *opt_om = om;
+  }
+  if (opt_gm != NULL) *opt_gm = gm; else p7_profile_Destroy(gm);
+  return eslOK;
+
+ ERROR:
+  if (gm != NULL) p7_profile_Destroy(gm);
+  if (om != NULL) p7_oprofile_Destroy(om);
+  return status;
+}
+
 /**
  * static int calibrate()
  * 
  * Sets the E value parameters of the model with two short simulations.
  * A profile and an oprofile are created here. If caller wants to keep either
  * of them, it can pass non-<NULL> <opt_gm>, <opt_om> pointers.
+ *
+ * With <calibrate_ncpu> > 1 (and HMMER_THREADS), the simulations are
+ * instead split across that many threads by calibrate_threaded(), and
+ * the profile and oprofile are only made if the caller asks for them.
  */
 static int
-calibrate(P7_BUILDER *bld, P7_HMM *hmm, P7_BG *bg, P7_PROFILE **opt_gm, P7_OPROFILE **opt_om)
+calibrate(P7_BUILDER *bld, P7_HMM *hmm, P7_BG *bg, P7_PROFILE **opt_gm, P7_OPROFILE **opt_om, int const calibrate_ncpu)
 {
   int status;
 
   if (opt_gm != NULL) *opt_gm = NULL;
   if (opt_om != NULL) *opt_om = NULL;
 
+#ifdef HMMER_THREADS
+  if (calibrate_ncpu > 1)
+    {
+      if ((status = calibrate_threaded(bld, hmm, bg, calibrate_ncpu)) != eslOK) goto ERROR;
+      return make_profiles(hmm, bg, opt_gm, opt_om);
+    }
+#endif /*HMMER_THREADS*/
+
   if ((status = p7_Calibrate(hmm, bld, &(bld->r), &bg, opt_gm, opt_om)) != eslOK) goto ERROR;
   return eslOK;
 
@@ -1364,6 +1574,49 @@ calibrate(P7_BUILDER *bld, P7_HMM *hmm, P7_BG *bg, P7_PROFILE **opt_gm, P7_OPROF
 }
 
 
+/**
+ * sync_profiles()
+ *
+ * The <gm> and <om> that calibrate() returns are configured before
+ * profillic_p7_Builder() forces masked positions to background and
+ * sets <max_length>. Bring either (or both; each may be <NULL>) up to
+ * date with the finished <hmm>, so that they are what hmmpress would
+ * make from it: reconfigure them if <hmm> has a mask, and copy the
+ * E-value parameters and <max_length> over.
+ */
+static int
+sync_profiles(const P7_HMM *hmm, P7_BG *bg, P7_PROFILE *gm, P7_OPROFILE *om)
+{
+  P7_PROFILE *tmp = NULL;
+  int         status;
+
+  if (hmm->mm != NULL)
+    {
+      if (gm == NULL && om != NULL) {
+        if ((tmp = p7_profile_Create(hmm->M, hmm->abc)) == NULL) { status = eslEMEM; goto ERROR; }
+        gm = tmp;
+      }
+      if (gm != NULL && (status = p7_profile_Config(gm, hmm, bg)) != eslOK) goto ERROR;
+      if (om != NULL && (status = p7_oprofile_Convert(gm, om))    != eslOK) goto ERROR;
+      if (tmp != NULL) { p7_profile_Destroy(tmp); gm = tmp = NULL; }
+    }
+
+  if (gm != NULL) {
+    esl_vec_FCopy(hmm->evparam, p7_NEVPARAM, gm->evparam);
+    gm->max_length = hmm->max_length;
+  }
+  if (om != NULL) {
+    esl_vec_FCopy(hmm->evparam, p7_NEVPARAM, om->evparam);
+    om->max_length = hmm->max_length;
+  }
+  return eslOK;
+
+ ERROR:
+  if (tmp != NULL) p7_profile_Destroy(tmp);
+  return status;
+}
+
+
 /**
  * make_post_msa()
  * 
@@ -1379,6 +1632,7 @@ make_post_msa(P7_BUILDER *bld, const ESL_MSA *premsa, const P7_HMM *hmm, P7_TRAC
   int       status;
 
   if (opt_postmsa == NULL) return eslOK;
+  if (tr == NULL)          return eslOK; /* a galosh profile's model has no traces to align */
 
   /* someday we might want to transfer more info from HMM to postmsa */
   if ((status = p7_tracealign_MSA(premsa, tr, hmm->M, optflags, &postmsa)) != eslOK) goto ERROR;
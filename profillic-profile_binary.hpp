@@ -0,0 +1,486 @@
+/**
+ * \file profillic-profile_binary.hpp
+ * \brief
+ * Binary galosh profile files (an alternative to the text format)
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. The binary profile format.
+ *     2. Writing binary profile files.
+ *     3. Reading binary profiles from an ESL_BUFFER.
+ *     4. Copyright and license.
+ * </pre>
+ *
+ * A binary profile file holds one or more galosh ProfileTreeRoots as
+ * native-endian 32-bit floats, so that readers can take them straight
+ * from a memory-mapped file instead of parsing text:
+ *
+ * <pre>
+ *   PROFILLIC_BINARY_HEADER                   32 bytes
+ *   per profile, at 8-byte aligned offsets:
+ *     PROFILLIC_BINARY_RECORD                 16 bytes
+ *     float transitions[PROFILLIC_BINARY_NTRANSITIONS]
+ *     float pre-align insertion emissions[K]
+ *     float insertion emissions[K]
+ *     float post-align insertion emissions[K]
+ *     float match emissions[M][K]             (position-major)
+ *     zero padding, to a multiple of 8 bytes
+ *   index: PROFILLIC_BINARY_INDEXTAG, uint32_t n, uint64_t offset[n]
+ * </pre>
+ *
+ * The header gives the number of profiles and the offset of the index,
+ * which holds the file offset of each record.  The readers here take
+ * the records in order, and stop at the index's tag.  Text remains the
+ * default format everywhere; profillic-hmmtoprofile writes this one
+ * with --binary, and profillic_esl_msafile_profile_Read() recognizes
+ * it by its leading tag.
+ */
+#ifndef __GALOSH_PROFILLICPROFILEBINARY_HPP__
+#define __GALOSH_PROFILLICPROFILEBINARY_HPP__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <vector>
+
+extern "C" {
+#include "easel.h"
+#include "esl_buffer.h"
+}
+
+#include "profillic-hmmer.hpp"
+#include "profillic-galosh_convert.hpp"
+
+/*****************************************************************
+ *# 1. The binary profile format.
+ *****************************************************************/
+
+#define PROFILLIC_BINARY_FILETAG    "\x89GPB"  /* starts the file                   */
+#define PROFILLIC_BINARY_RECORDTAG  "\x89GPR"  /* starts each profile               */
+#define PROFILLIC_BINARY_INDEXTAG   "\x89GPI"  /* starts the index, after the last  */
+#define PROFILLIC_BINARY_TAGLEN     4
+#define PROFILLIC_BINARY_BYTEORDER  0x01020304 /* as written by the writing host    */
+#define PROFILLIC_BINARY_VERSION    1
+#define PROFILLIC_BINARY_NTRANSITIONS 13
+#define PROFILLIC_BINARY_MAXM       1000000    /* longest profile a record may claim */
+
+typedef struct {
+  char     tag[PROFILLIC_BINARY_TAGLEN]; /* PROFILLIC_BINARY_FILETAG                          */
+  uint32_t byteorder;                    /* PROFILLIC_BINARY_BYTEORDER, in the writer's order  */
+  uint32_t version;                      /* PROFILLIC_BINARY_VERSION                           */
+  uint32_t K;                            /* residues per distribution: 4 (Dna), 20 (AminoAcid20) */
+  uint32_t nprofiles;
+  uint32_t reserved;
+  uint64_t index_offset;                 /* file offset of the index                           */
+} PROFILLIC_BINARY_HEADER;
+
+typedef struct {
+  char     tag[PROFILLIC_BINARY_TAGLEN]; /* PROFILLIC_BINARY_RECORDTAG                        */
+  uint32_t M;                            /* profile length                                     */
+  uint32_t K;
+  uint32_t nfloats;                      /* PROFILLIC_BINARY_NTRANSITIONS + 3K + MK            */
+} PROFILLIC_BINARY_RECORD;
+
+/* Bytes of float data (with padding) following a record header. */
+static size_t
+profillic_binary_PayloadSize(uint32_t nfloats)
+{
+  return ((sizeof(float) * nfloats + 7) / 8) * 8;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_binary_CheckRecord()
+ * Synopsis:  Check a record header before its floats are read.
+ *
+ * Purpose:   Check that record header <rec> is tagged, holds a profile
+ *            of <K> residues per distribution and of 1 to
+ *            PROFILLIC_BINARY_MAXM positions, and that its <nfloats>
+ *            agrees with those; so that a corrupt or truncated file
+ *            can't make a reader allocate or read more than a real
+ *            profile would need.
+ *
+ * Returns:   <eslOK> if so; else <eslEFORMAT>, and <errbuf>, if
+ *            non-<NULL>, says why.
+ * </pre>
+ */
+static int
+profillic_binary_CheckRecord(PROFILLIC_BINARY_RECORD const *rec, uint32_t K, char *errbuf)
+{
+  if (memcmp(rec->tag, PROFILLIC_BINARY_RECORDTAG, PROFILLIC_BINARY_TAGLEN) != 0) ESL_FAIL(eslEFORMAT, errbuf, "bad binary profile record tag");
+  if (rec->K != K)                                       ESL_FAIL(eslEFORMAT, errbuf, "binary profile has %u residues per distribution; expected %u", rec->K, K);
+  if (rec->M == 0 || rec->M > PROFILLIC_BINARY_MAXM)     ESL_FAIL(eslEFORMAT, errbuf, "binary profile record claims a profile of length %u (at most %u)", rec->M, (uint32_t) PROFILLIC_BINARY_MAXM);
+  if (rec->nfloats != PROFILLIC_BINARY_NTRANSITIONS + 3 * K + rec->M * K)
+                                                         ESL_FAIL(eslEFORMAT, errbuf, "inconsistent binary profile record (M=%u, K=%u, %u floats)", rec->M, rec->K, rec->nfloats);
+  return eslOK;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_binary_Encode()
+ * Synopsis:  Pack a galosh profile's parameters as floats.
+ *
+ * Purpose:   Fill <rec> and the float vector <v> with galosh profile
+ *            <profile>, in the order described at the top of this
+ *            file.
+ * </pre>
+ */
+template <typename ProfileType>
+void
+profillic_binary_Encode(ProfileType const & profile, PROFILLIC_BINARY_RECORD *rec, std::vector<float> & v)
+{
+  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
+
+  uint32_t const K = ProfillicResidueMap<ResidueType>::SIZE;
+  uint32_t const M = profile.length();
+  uint32_t pos_i;
+  uint32_t res_i;
+  float   *x;
+
+  memcpy(rec->tag, PROFILLIC_BINARY_RECORDTAG, PROFILLIC_BINARY_TAGLEN);
+  rec->M       = M;
+  rec->K       = K;
+  rec->nfloats = PROFILLIC_BINARY_NTRANSITIONS + 3 * K + M * K;
+  v.resize( rec->nfloats );
+  x = &( v[ 0 ] );
+
+  *x++ = toDouble( profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toPreAlign ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toBegin ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toDeletion ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toMatch ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toInsertion ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toDeletion ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toMatch ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toInsertion ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toMatch ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toDeletion ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ] );
+  *x++ = toDouble( profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toPostAlign ] );
+
+  for( res_i = 0; res_i < K; res_i++ ) *x++ = toDouble( profile[ galosh::Emission::PreAlignInsertion ][ res_i ] );
+  for( res_i = 0; res_i < K; res_i++ ) *x++ = toDouble( profile[ galosh::Emission::Insertion ][ res_i ] );
+  for( res_i = 0; res_i < K; res_i++ ) *x++ = toDouble( profile[ galosh::Emission::PostAlignInsertion ][ res_i ] );
+  for( pos_i = 0; pos_i < M; pos_i++ ) {
+    for( res_i = 0; res_i < K; res_i++ ) *x++ = toDouble( profile[ pos_i ][ galosh::Emission::Match ][ res_i ] );
+  }
+} // profillic_binary_Encode (..)
+
+/**
+ * <pre>
+ * Function:  profillic_binary_Decode()
+ * Synopsis:  Set a galosh profile from a binary record.
+ *
+ * Purpose:   Reinitialize <*profile_ptr> to the length given by record
+ *            header <rec> and set all of its parameters from the
+ *            <rec->nfloats> floats at <v> (which may point straight
+ *            into a memory-mapped file).
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEFORMAT> if the record doesn't hold a profile of
+ *            <ProfileType>'s alphabet size, or is inconsistent;
+ *            <errbuf>, if non-<NULL>, says why.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_binary_Decode(PROFILLIC_BINARY_RECORD const *rec, float const *v, ProfileType * profile_ptr, char *errbuf)
+{
+  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
+
+  uint32_t const K = ProfillicResidueMap<ResidueType>::SIZE;
+  uint32_t pos_i;
+  uint32_t res_i;
+  int      status;
+
+  if ((status = profillic_binary_CheckRecord(rec, K, errbuf)) != eslOK) return status;
+
+  ProfileType & profile = *profile_ptr;
+  profile.reinitialize( rec->M );
+
+  profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toPreAlign ]         = *v++;
+  profile[ galosh::Transition::fromPreAlign ][ galosh::TransitionFromPreAlign::toBegin ]            = *v++;
+  profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toMatch ]                  = *v++;
+  profile[ galosh::Transition::fromBegin ][ galosh::TransitionFromBegin::toDeletion ]               = *v++;
+  profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toMatch ]                  = *v++;
+  profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toInsertion ]              = *v++;
+  profile[ galosh::Transition::fromMatch ][ galosh::TransitionFromMatch::toDeletion ]               = *v++;
+  profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toMatch ]          = *v++;
+  profile[ galosh::Transition::fromInsertion ][ galosh::TransitionFromInsertion::toInsertion ]      = *v++;
+  profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toMatch ]            = *v++;
+  profile[ galosh::Transition::fromDeletion ][ galosh::TransitionFromDeletion::toDeletion ]         = *v++;
+  profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toTerminal ]       = *v++;
+  profile[ galosh::Transition::fromPostAlign ][ galosh::TransitionFromPostAlign::toPostAlign ]      = *v++;
+
+  for( res_i = 0; res_i < K; res_i++ ) profile[ galosh::Emission::PreAlignInsertion ][ res_i ]  = *v++;
+  for( res_i = 0; res_i < K; res_i++ ) profile[ galosh::Emission::Insertion ][ res_i ]          = *v++;
+  for( res_i = 0; res_i < K; res_i++ ) profile[ galosh::Emission::PostAlignInsertion ][ res_i ] = *v++;
+  for( pos_i = 0; pos_i < rec->M; pos_i++ ) {
+    for( res_i = 0; res_i < K; res_i++ ) profile[ pos_i ][ galosh::Emission::Match ][ res_i ] = *v++;
+  }
+  return eslOK;
+} // profillic_binary_Decode (..)
+
+/* Check a file header, as read from a file. */
+static int
+profillic_binary_CheckHeader(PROFILLIC_BINARY_HEADER const *hdr, char *errbuf)
+{
+  if (memcmp(hdr->tag, PROFILLIC_BINARY_FILETAG, PROFILLIC_BINARY_TAGLEN) != 0) ESL_FAIL(eslEFORMAT, errbuf, "not a binary galosh profile file");
+  if (hdr->byteorder != PROFILLIC_BINARY_BYTEORDER) ESL_FAIL(eslEFORMAT, errbuf, "binary galosh profile file was written on a host of different byte order");
+  if (hdr->version   != PROFILLIC_BINARY_VERSION)   ESL_FAIL(eslEFORMAT, errbuf, "binary galosh profile file is version %u; expected %u", hdr->version, (uint32_t) PROFILLIC_BINARY_VERSION);
+  return eslOK;
+}
+
+/*---------------------- end, the binary profile format ---------*/
+
+/*****************************************************************
+ *# 2. Writing binary profile files.
+ *****************************************************************/
+
+typedef struct {
+  FILE     *fp;
+  uint32_t  K;          /* residues per distribution; set by the first profile written */
+  uint64_t *offset;     /* file offsets of the records written so far: the index       */
+  uint32_t  n;
+  uint32_t  nalloc;
+} PROFILLIC_BINARY_WRITER;
+
+/**
+ * <pre>
+ * Function:  profillic_binary_writer_Open()
+ * Synopsis:  Open a binary galosh profile file for writing.
+ *
+ * Purpose:   Create (or truncate) file <path> and write a placeholder
+ *            header; the header is completed, and the index written,
+ *            by <profillic_binary_writer_Close()>.  <path> must be a
+ *            seekable file.
+ *
+ * Returns:   <eslOK> on success, and <*ret_bw> is the new writer.
+ *            <eslFAIL> if <path> can't be opened for writing; <errbuf>
+ *            says why.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+static int
+profillic_binary_writer_Open(const char *path, PROFILLIC_BINARY_WRITER **ret_bw, char *errbuf)
+{
+  PROFILLIC_BINARY_WRITER *bw = NULL;
+  PROFILLIC_BINARY_HEADER  hdr;
+  int                      status;
+
+  ESL_ALLOC_CPP( PROFILLIC_BINARY_WRITER, bw, sizeof(PROFILLIC_BINARY_WRITER));
+  bw->fp     = NULL;
+  bw->K      = 0;
+  bw->offset = NULL;
+  bw->n      = 0;
+  bw->nalloc = 0;
+
+  if ((bw->fp = fopen(path, "wb")) == NULL) ESL_XFAIL(eslFAIL, errbuf, "Failed to open binary profile file %s for writing", path);
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.tag, PROFILLIC_BINARY_FILETAG, PROFILLIC_BINARY_TAGLEN);
+  hdr.byteorder = PROFILLIC_BINARY_BYTEORDER;
+  hdr.version   = PROFILLIC_BINARY_VERSION;
+  if (fwrite(&hdr, sizeof(hdr), 1, bw->fp) != 1) ESL_XEXCEPTION_SYS(eslEWRITE, "binary profile header write failed");
+
+  *ret_bw = bw;
+  return eslOK;
+
+ ERROR:
+  if (bw != NULL) {
+    if (bw->fp != NULL) fclose(bw->fp);
+    free(bw);
+  }
+  *ret_bw = NULL;
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_binary_writer_WriteRecord()
+ * Synopsis:  Append an encoded profile to a binary profile file.
+ *
+ * Purpose:   Append the profile encoded (by <profillic_binary_Encode()>)
+ *            as record header <rec> and floats <v>.  This lets callers
+ *            encode profiles in worker threads and leave only the
+ *            write to the thread that owns <bw>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEINCOMPAT> if the profile isn't of the same alphabet
+ *            as the profiles already written.
+ *
+ * Throws:    <eslEMEM> on allocation failure; <eslEWRITE> on a write
+ *            error.
+ * </pre>
+ */
+static int
+profillic_binary_writer_WriteRecord(PROFILLIC_BINARY_WRITER *bw, PROFILLIC_BINARY_RECORD const *rec, std::vector<float> const & v)
+{
+  static const char       zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  size_t                  npad;
+  off_t                   offset;
+  int                     status;
+
+  if (bw->K == 0) bw->K = rec->K;
+  else if (bw->K != rec->K) ESL_EXCEPTION(eslEINCOMPAT, "binary profile file can't mix alphabets");
+
+  if (bw->n == bw->nalloc) {
+    bw->nalloc = (bw->nalloc == 0) ? 256 : 2 * bw->nalloc;
+    ESL_REALLOC_CPP(uint64_t, bw->offset, sizeof(uint64_t) * bw->nalloc);
+  }
+  if ((offset = ftello(bw->fp)) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "ftello() failed on binary profile file");
+  bw->offset[bw->n++] = (uint64_t) offset;
+
+  npad = profillic_binary_PayloadSize(rec->nfloats) - sizeof(float) * rec->nfloats;
+  if (fwrite(rec,         sizeof(*rec),  1,            bw->fp) != 1)            ESL_EXCEPTION_SYS(eslEWRITE, "binary profile write failed");
+  if (fwrite(&( v[ 0 ] ), sizeof(float), rec->nfloats, bw->fp) != rec->nfloats) ESL_EXCEPTION_SYS(eslEWRITE, "binary profile write failed");
+  if (npad > 0 && fwrite(zeros, 1, npad, bw->fp) != npad)                       ESL_EXCEPTION_SYS(eslEWRITE, "binary profile write failed");
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_binary_writer_Close()
+ * Synopsis:  Finish and close a binary profile file.
+ *
+ * Purpose:   Write the index of profile offsets, complete the file
+ *            header, close the file and free <bw>.
+ *
+ * Throws:    <eslEWRITE> on a write error. <bw> is freed in any case.
+ * </pre>
+ */
+static int
+profillic_binary_writer_Close(PROFILLIC_BINARY_WRITER *bw)
+{
+  PROFILLIC_BINARY_HEADER hdr;
+  off_t                   index_offset;
+  int                     status = eslOK;
+
+  if (bw == NULL) return eslOK;
+
+  if ((index_offset = ftello(bw->fp)) < 0) { status = eslEWRITE; goto DONE; }
+  if (fwrite(PROFILLIC_BINARY_INDEXTAG, 1, PROFILLIC_BINARY_TAGLEN, bw->fp) != PROFILLIC_BINARY_TAGLEN) { status = eslEWRITE; goto DONE; }
+  if (fwrite(&(bw->n), sizeof(uint32_t), 1, bw->fp)                         != 1)                       { status = eslEWRITE; goto DONE; }
+  if (bw->n > 0 && fwrite(bw->offset, sizeof(uint64_t), bw->n, bw->fp)      != bw->n)                   { status = eslEWRITE; goto DONE; }
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.tag, PROFILLIC_BINARY_FILETAG, PROFILLIC_BINARY_TAGLEN);
+  hdr.byteorder    = PROFILLIC_BINARY_BYTEORDER;
+  hdr.version      = PROFILLIC_BINARY_VERSION;
+  hdr.K            = bw->K;
+  hdr.nprofiles    = bw->n;
+  hdr.index_offset = (uint64_t) index_offset;
+  if (fseeko(bw->fp, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, bw->fp) != 1) { status = eslEWRITE; goto DONE; }
+
+ DONE:
+  if (fclose(bw->fp) != 0 && status == eslOK) status = eslEWRITE;
+  if (bw->offset != NULL) free(bw->offset);
+  free(bw);
+  if (status != eslOK) ESL_EXCEPTION_SYS(status, "failed to finish binary profile file");
+  return eslOK;
+}
+
+/*---------------------- end, writing binary profile files ------*/
+
+/*****************************************************************
+ *# 3. Reading binary profiles from an ESL_BUFFER.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_binary_IsNext()
+ * Synopsis:  Is <bf> positioned at binary profile data?
+ *
+ * Purpose:   Return <TRUE> if the next bytes in <bf> are one of this
+ *            format's tags (no text profile starts with one), else
+ *            <FALSE>. Nothing is consumed.
+ * </pre>
+ */
+static int
+profillic_binary_IsNext(ESL_BUFFER *bf)
+{
+  char      *p;
+  esl_pos_t  n;
+
+  if (esl_buffer_Get(bf, &p, &n) != eslOK || n < PROFILLIC_BINARY_TAGLEN) return FALSE;
+  return (p[0] == PROFILLIC_BINARY_FILETAG[0] && p[1] == PROFILLIC_BINARY_FILETAG[1] && p[2] == PROFILLIC_BINARY_FILETAG[2]) ? TRUE : FALSE;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_binary_Read()
+ * Synopsis:  Read the next binary profile from <bf>.
+ *
+ * Purpose:   Read the next profile of a binary profile file from
+ *            <bf> into <*profile_ptr>, consuming the file header first
+ *            if <bf> is at the start of the file.  Profiles are read
+ *            in order, without using the index, so <bf> may be a
+ *            stream.  When <bf> is memory-mapped (the usual case for
+ *            a file) the floats are decoded straight from the mapping.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEOF> when the index (or the end of the data) is
+ *            reached.
+ *            <eslEFORMAT> on bad or truncated data; <errbuf> says why.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ * </pre>
+ */
+template <typename ProfileType>
+int
+profillic_binary_Read(ESL_BUFFER *bf, ProfileType * profile_ptr, char *errbuf)
+{
+  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
+
+  PROFILLIC_BINARY_HEADER hdr;
+  PROFILLIC_BINARY_RECORD rec;
+  std::vector<float>      v;
+  char                   *p;
+  esl_pos_t               n;
+  size_t                  nbytes;
+  int                     status;
+
+  if ((status = esl_buffer_Get(bf, &p, &n)) != eslOK) return status;
+  if (n >= PROFILLIC_BINARY_TAGLEN && memcmp(p, PROFILLIC_BINARY_FILETAG, PROFILLIC_BINARY_TAGLEN) == 0)
+    {
+      if (esl_buffer_Read(bf, sizeof(hdr), &hdr)          != eslOK) ESL_FAIL(eslEFORMAT, errbuf, "truncated binary profile file header");
+      if ((status = profillic_binary_CheckHeader(&hdr, errbuf)) != eslOK) return status;
+      if ((status = esl_buffer_Get(bf, &p, &n))           != eslOK) return status;
+    }
+  if (n >= PROFILLIC_BINARY_TAGLEN && memcmp(p, PROFILLIC_BINARY_INDEXTAG, PROFILLIC_BINARY_TAGLEN) == 0) return eslEOF;
+
+  if (esl_buffer_Read(bf, sizeof(rec), &rec) != eslOK) ESL_FAIL(eslEFORMAT, errbuf, "truncated binary profile record");
+  /* (before <nfloats> sizes anything) */
+  if ((status = profillic_binary_CheckRecord(&rec, ProfillicResidueMap<ResidueType>::SIZE, errbuf)) != eslOK) return status;
+  nbytes = profillic_binary_PayloadSize(rec.nfloats);
+
+  if (esl_buffer_Get(bf, &p, &n) == eslOK && (size_t) n >= nbytes)
+    {
+      if ((status = profillic_binary_Decode(&rec, (float const *) p, profile_ptr, errbuf)) != eslOK) return status;
+      esl_buffer_Set(bf, p, nbytes);
+    }
+  else
+    {
+      v.resize( nbytes / sizeof(float) + 1 );
+      if (esl_buffer_Read(bf, nbytes, &( v[ 0 ] )) != eslOK) ESL_FAIL(eslEFORMAT, errbuf, "truncated binary profile record");
+      if ((status = profillic_binary_Decode(&rec, &( v[ 0 ] ), profile_ptr, errbuf)) != eslOK) return status;
+    }
+  return eslOK;
+}
+
+/*---------------------- end, reading from an ESL_BUFFER --------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICPROFILEBINARY_HPP__
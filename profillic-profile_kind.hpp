@@ -0,0 +1,285 @@
+/**
+ * \file profillic-profile_kind.hpp
+ * \brief
+ * Compile-time policies for the two kinds of galosh profile the
+ * builders take: ProfileTreeRoot and AlignmentProfileAccessor.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. ProfillicProfileKind<ProfileType>.
+ *     2. Profile families.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * profillic-hmmbuild and profillic-alignment-hmmbuild are one driver
+ * (profillic_hmmbuild_main(), in profillic-hmmbuild_driver.hpp), with
+ * one reader (profillic_esl_msafile_profile_Read(), in
+ * profillic-esl_msafile.hpp) and one builder (profillic_p7_Builder(),
+ * in profillic-p7_builder.hpp), templated on the profile type.  The few
+ * places where the two kinds really differ are the members of
+ * ProfillicProfileKind<ProfileType>:
+ *
+ * <pre>
+ *   member           ProfileTreeRoot          AlignmentProfileAccessor
+ *   ---------------  -----------------------  --------------------------
+ *   ResidueType      profile_traits<>         APAResidueType
+ *   position_offset  0                        1 (position 0 is Begin)
+ *   Create( nseq )   empty profile            empty profile of nseq
+ *                                             sequences (--nseq)
+ *   orig_nseq()      1                        profile.orig_nseq()
+ *   weighted         FALSE                    TRUE: the consensus row's
+ *                                             weight is orig_nseq
+ *   Read()           next record, text or     the whole file, by name
+ *                    binary; a pipe or a      (not a pipe, nor
+ *                    .gz/.zst is fine         compressed), then
+ *                                             normalize( 1E-5 ); so
+ *                                             one profile per file
+ *   ToHmm()          profillic_profile_       profillic_alignment_
+ *                    to_hmm()                 profile_to_hmm()
+ *   counts_scaled    FALSE                    TRUE: p7_hmm_Scale() to
+ *                                             orig_nseq
+ *   cacheable        TRUE                     FALSE (no binary form
+ *                                             to hash)
+ * </pre>
+ *
+ * Which profile types a program reads is its family (section 2):
+ * ProfillicTreeProfiles for profillic-hmmbuild, read as any
+ * --profile-precision and shipped to --mpi workers as text; or
+ * ProfillicAlignmentProfiles for profillic-alignment-hmmbuild, which
+ * are read as float only, and not sent to --mpi workers.  Otherwise
+ * the threads, writer, MPI, --server, pools, the cache, timings and
+ * calibration are the one implementation, so both programs get each
+ * change from one place.
+ */
+#ifndef __GALOSH_PROFILLICPROFILEKIND_HPP__
+#define __GALOSH_PROFILLICPROFILEKIND_HPP__
+
+#include <string.h>
+#include <string>
+
+extern "C" {
+#include "easel.h"
+#include "esl_buffer.h"
+#include "esl_mem.h"
+#include "esl_msafile.h"
+#include "base/p7_hmm.h"
+}
+
+#include "profillic-hmmer.hpp"
+#include "profillic-galosh_convert.hpp"
+#include "profillic-profile_binary.hpp"
+#include "profillic-compress.hpp"
+
+/*****************************************************************
+ *# 1. ProfillicProfileKind<ProfileType>.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Class:     ProfillicProfileKind<ProfileType>
+ * Synopsis:  What the reader and builder do differently for each kind
+ *            of galosh profile.
+ *
+ * Purpose:   The primary template is for a galosh ProfileTreeRoot:
+ *            positions 0..L-1 are the match states, its insertions and
+ *            transitions are shared, and profillic-hmmbuild reads one
+ *            record (text, ending in <//>, or binary) at a time.
+ *
+ *            Create() allocates an empty profile for Read(), for the
+ *            caller to delete; <nseq> is --nseq, which only alignment
+ *            profiles take.
+ *            Read() parses the next profile from <afp> into
+ *            <*profile_ptr>, returning <eslOK>; <eslEOF> if there is
+ *            none; or <eslEFORMAT>, with a message in <afp->errmsg>.
+ *            ToHmm() fills in the zeroed <hmm> of <M = profile.length()>.
+ * </pre>
+ */
+template <typename ProfileType>
+struct ProfillicProfileKind
+{
+  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
+
+  enum {
+    position_offset = 0,      /* profile positions before the first match state          */
+    weighted        = FALSE,  /* consensus row weighted by orig_nseq()?                  */
+    counts_scaled   = FALSE,  /* model scaled to orig_nseq() counts, as a counts model?  */
+    cacheable       = TRUE    /* may go in the build cache (profillic-build_cache.hpp)?  */
+  };
+
+  static ProfileType *
+  Create ( int nseq )
+  {
+    return new ProfileType();
+  }
+
+  static int
+  orig_nseq ( ProfileType const & profile )
+  {
+    return 1;
+  }
+
+  static int
+  Read ( ESLX_MSAFILE * afp, ProfileType * profile_ptr )
+  {
+    std::string profile_string;
+    char       *p;
+    esl_pos_t   n;
+    int         status;
+
+    if( profillic_binary_IsNext( afp->bf ) ) return profillic_binary_Read( afp->bf, profile_ptr, afp->errmsg );
+
+    // Collect the next record: every line up to a "//" terminator, or to EOF.
+    while ( (status = eslx_msafile_GetLine(afp, &p, &n)) == eslOK ) {
+      if( n >= 2 && p[ 0 ] == '/' && p[ 1 ] == '/' && esl_memspn( p + 2, n - 2, " \t\r" ) == ( n - 2 ) ) break;
+      if( profile_string.empty() && esl_memspn( p, n, " \t\r" ) == n ) continue; // skip blank lines between records
+      profile_string.append( p, n );
+      profile_string.push_back( '\n' );
+    }
+    if( ( status != eslOK ) && ( status != eslEOF ) ) return status;
+    if( profile_string.empty() ) return eslEOF;
+
+    // Read in the galosh profile (from profillic)
+    profile_ptr->fromString( profile_string );
+    if( profile_ptr->length() == 0 ) ESL_FAIL(eslEFORMAT, afp->errmsg, "no galosh profile found in record ending at line %d", (int) afp->linenumber);
+    return eslOK;
+  }
+
+  static int
+  ToHmm ( ProfileType const & profile, P7_HMM * hmm )
+  {
+    return profillic_profile_to_hmm( profile, hmm );
+  }
+}; // End struct ProfillicProfileKind<ProfileType>
+
+/**
+ * <pre>
+ * Class:     ProfillicProfileKind<AlignmentProfileAccessor<..> >
+ *
+ * Purpose:   A galosh alignment profile (from profuse): position 0 is
+ *            the Begin state, so its consensus and match states start
+ *            at position 1; every position has its own parameters; it
+ *            says how many sequences it was trained on (unless --nseq
+ *            says otherwise); and it is read whole, by file name (so
+ *            not from a pipe), and then normalized, so a file holds
+ *            just one.
+ * </pre>
+ */
+template <typename ResidueT, typename ProbabilityType, typename ScoreType, typename MatrixValueType>
+struct ProfillicProfileKind<galosh::AlignmentProfileAccessor<ResidueT, ProbabilityType, ScoreType, MatrixValueType> >
+{
+  typedef galosh::AlignmentProfileAccessor<ResidueT, ProbabilityType, ScoreType, MatrixValueType> ProfileType;
+  typedef typename ProfileType::APAResidueType ResidueType;
+
+  enum {
+    position_offset = 1,
+    weighted        = TRUE,
+    counts_scaled   = TRUE,
+    cacheable       = FALSE
+  };
+
+  static ProfileType *
+  Create ( int nseq )
+  {
+    return new ProfileType( nseq );
+  }
+
+  static int
+  orig_nseq ( ProfileType const & profile )
+  {
+    return profile.orig_nseq();
+  }
+
+  static int
+  Read ( ESLX_MSAFILE * afp, ProfileType * profile_ptr )
+  {
+    char      *p;
+    esl_pos_t  n;
+    int        status;
+
+    // fromFile() opens the file itself, so it can't be a pipe, or compressed.
+    if( afp->bf->filename == NULL || strcmp( afp->bf->filename, "-" ) == 0 )
+      ESL_FAIL(eslEFORMAT, afp->errmsg, "a galosh alignment profile can't be read from a pipe or the standard input");
+    if( profillic_compress_Type( afp->bf->filename ) != PROFILLIC_COMPRESS_NONE )
+      ESL_FAIL(eslEFORMAT, afp->errmsg, "galosh alignment profile %s can't be read compressed", afp->bf->filename);
+
+    // The file is one profile: once its lines have been used up, there are no more.
+    if( (status = eslx_msafile_GetLine(afp, &p, &n)) == eslEOF ) return eslEOF;
+    while ( status == eslOK ) status = eslx_msafile_GetLine(afp, &p, &n);
+    if( status != eslEOF ) return status;
+
+    // Read in the galosh alignment profile (from profuse)
+    profile_ptr->fromFile( afp->bf->filename, *profile_ptr );
+    if( profile_ptr->length() <= position_offset ) ESL_FAIL(eslEFORMAT, afp->errmsg, "no galosh alignment profile found in %s", afp->bf->filename);
+    profile_ptr->normalize( 1E-5 ); //TAH 7/12 experimental mod for Robert Hubley
+    return eslOK;
+  }
+
+  static int
+  ToHmm ( ProfileType const & profile, P7_HMM * hmm )
+  {
+    return profillic_alignment_profile_to_hmm<ProbabilityType>( profile, hmm );
+  }
+}; // End struct ProfillicProfileKind<AlignmentProfileAccessor<..> >
+
+/*---------------------- end, ProfillicProfileKind --------------------*/
+
+/*****************************************************************
+ *# 2. Profile families.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Class:     ProfillicTreeProfiles, ProfillicAlignmentProfiles
+ * Synopsis:  The galosh profile types a program reads.
+ *
+ * Purpose:   The template argument of profillic_hmmbuild_main() (in
+ *            profillic-hmmbuild_driver.hpp).  Of<R, P>::Type is the
+ *            profile type read for residues <R> (seqan::Dna or
+ *            seqan::AminoAcid20) and --profile-precision <P>.
+ *
+ *            alignment:     TRUE for alignment profiles (from
+ *                           profuse), which take --nseq.
+ *            any_precision: FALSE if only float is read.
+ *            shippable:     FALSE if the profiles can't go to --mpi
+ *                           workers (see profillic-esl_mpi.hpp).
+ * </pre>
+ */
+struct ProfillicTreeProfiles
+{
+  template <typename R, typename P>
+  struct Of
+  {
+    typedef galosh::ProfileTreeRoot<R, P> Type;
+  };
+
+  enum {
+    alignment     = FALSE,
+    any_precision = TRUE,
+    shippable     = TRUE
+  };
+}; // End struct ProfillicTreeProfiles
+
+struct ProfillicAlignmentProfiles
+{
+  template <typename R, typename P>
+  struct Of
+  {
+    typedef galosh::AlignmentProfileAccessor<R, floatrealspace, floatrealspace, floatrealspace> Type;
+  };
+
+  enum {
+    alignment     = TRUE,
+    any_precision = FALSE,
+    shippable     = FALSE
+  };
+}; // End struct ProfillicAlignmentProfiles
+
+/*---------------------- end, profile families --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICPROFILEKIND_HPP__
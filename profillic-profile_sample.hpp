@@ -0,0 +1,101 @@
+/**
+ * \file profillic-profile_sample.hpp
+ * \brief
+ * Random (but valid) galosh profiles of a chosen length, for benchmarks.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Sampling profiles.
+ *     2. Copyright and license.
+ * </pre>
+ *
+ * A profile is sampled by sampling a Plan7 HMM of the same length
+ * (p7_hmm_Sample()) and converting it with profillic_hmm_to_profile(),
+ * so that it is normalized and round-trips through the hmmbuild
+ * conversion like any profile the galosh tools would write.
+ */
+#ifndef __GALOSH_PROFILLICPROFILESAMPLE_HPP__
+#define __GALOSH_PROFILLICPROFILESAMPLE_HPP__
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_random.h"
+#include "base/p7_hmm.h"
+}
+
+#include "profillic-hmmer.hpp"
+#include "profillic-galosh_convert.hpp"
+
+#include <seqan/basic.h>
+
+/*****************************************************************
+ *# 1. Sampling profiles.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_profile_AlphabetType()
+ *
+ * Purpose:   Return the easel alphabet type (<eslDNA> or <eslAMINO>)
+ *            that profiles of residue type <ResidueType> are built
+ *            over.
+ * </pre>
+ */
+template <typename ResidueType>
+static int profillic_profile_AlphabetType( ResidueType const * ) { return eslNONSTANDARD; }
+static int profillic_profile_AlphabetType( seqan::Dna const * ) { return eslDNA; }
+static int profillic_profile_AlphabetType( seqan::AminoAcid20 const * ) { return eslAMINO; }
+
+/**
+ * <pre>
+ * Function:  profillic_profile_Sample()
+ *
+ * Purpose:   Sample a random <profile> of length <M> using random
+ *            number generator <r>.  If <opt_hmm> is non-<NULL>, the
+ *            HMM that <profile> was converted from is returned in
+ *            <*opt_hmm> (the caller destroys it); it has the
+ *            position-specific transitions that the profile averages.
+ *
+ *            <abc> must match the residue type of <profile>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEINVAL> if <M> < 1 or <abc> is the wrong alphabet.
+ *
+ * Throws:    <eslEMEM> on allocation error.
+ * </pre>
+ */
+template <typename ProfileType>
+static int
+profillic_profile_Sample(ESL_RANDOMNESS *r, int M, const ESL_ALPHABET *abc, ProfileType & profile, P7_HMM **opt_hmm)
+{
+  typedef typename galosh::profile_traits<ProfileType>::ResidueType ResidueType;
+
+  P7_HMM *hmm = NULL;
+  int     status;
+
+  if (opt_hmm != NULL) *opt_hmm = NULL;
+  if (M < 1)                                                          { status = eslEINVAL; goto ERROR; }
+  if (abc->type != profillic_profile_AlphabetType((ResidueType *)NULL)) { status = eslEINVAL; goto ERROR; }
+
+  if ((status = p7_hmm_Sample(r, M, abc, &hmm))          != eslOK) goto ERROR;
+  if ((status = profillic_hmm_to_profile(hmm, profile)) != eslOK) goto ERROR;
+
+  if (opt_hmm != NULL) *opt_hmm = hmm; else p7_hmm_Destroy(hmm);
+  return eslOK;
+
+ ERROR:
+  if (hmm != NULL) p7_hmm_Destroy(hmm);
+  return status;
+}
+
+/*---------------------- end, sampling profiles --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICPROFILESAMPLE_HPP__
@@ -0,0 +1,241 @@
+/**
+ * \file profillic-schedule.hpp
+ * \brief
+ * Costliest-first dispatch of buffered alignments to parallel workers
+ * (hmmbuild --sched).
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Estimating the cost of a build.
+ *     2. The scheduling window.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * Handing alignments to workers in file order lets one huge family
+ * near the end of a database keep a single worker busy long after the
+ * others have run dry.  The scheduler instead reads up to <size>
+ * inputs ahead into a window, and hands out the one with the largest
+ * estimated build cost first.
+ *
+ * So that a cheap input can't be passed over indefinitely (which
+ * would also hold up the in-order writing of everything after it),
+ * the oldest input in the window is handed out as soon as it is
+ * 2*<size>-1 inputs behind the newest one.  Every input is therefore
+ * dispatched before any input 2*<size> or more after it, and a writer
+ * that keeps results in input order never has to hold more than
+ * 2*<size> (plus the number in progress) of them.
+ *
+ * The window knows nothing of profile types: each input carries an
+ * opaque handle to its own galosh profile (or <NULL>), and the window
+ * keeps a stack of spare handles for its owner to read the next
+ * profile into.
+ */
+#ifndef __GALOSH_PROFILLICSCHEDULE_HPP__
+#define __GALOSH_PROFILLICSCHEDULE_HPP__
+
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "easel.h"
+#include "esl_alphabet.h"
+#define new _new
+#include "esl_msa.h"
+#undef new
+}
+
+#include "profillic-hmmer.hpp"
+
+/*****************************************************************
+ *# 1. Estimating the cost of a build.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_sched_ExpectedM()
+ *
+ * Purpose:   Return the number of match states that --fast
+ *            construction with <symfrac> would likely assign to
+ *            <msa>: the columns in which at least <symfrac> of the
+ *            (unweighted) sequences have a residue.  For a galosh
+ *            profile's consensus (<is_profile>), or a text-mode MSA,
+ *            that is just <alen>.
+ * </pre>
+ */
+static int
+profillic_sched_ExpectedM(const ESL_MSA *msa, int is_profile, double symfrac)
+{
+  int64_t apos;
+  int     idx;
+  int     nres;
+  int     M = 0;
+
+  if (is_profile || ! (msa->flags & eslMSA_DIGITAL)) return (int) msa->alen;
+#ifdef eslAUGMENT_ALPHABET
+  for (apos = 1; apos <= msa->alen; apos++)
+    {
+      for (nres = 0, idx = 0; idx < msa->nseq; idx++)
+        if (esl_abc_XIsResidue(msa->abc, msa->ax[idx][apos])) nres++;
+      if ((double) nres >= symfrac * (double) msa->nseq) M++;
+    }
+  return M;
+#else
+  return (int) msa->alen;
+#endif
+}
+
+/**
+ * <pre>
+ * Function:  profillic_sched_Cost()
+ *
+ * Purpose:   Return a relative estimate of the time it takes to build
+ *            and calibrate a model from <msa>: weighting and counting
+ *            take time in proportion to <nseq> * <alen>, and
+ *            calibration in proportion to the expected <M> times
+ *            <calib_residues>, the total length of the simulated
+ *            sequences (EmL*EmN + EvL*EvN + EfL*EfN).
+ * </pre>
+ */
+static double
+profillic_sched_Cost(const ESL_MSA *msa, int is_profile, double symfrac, double calib_residues)
+{
+  return (double) msa->nseq * (double) msa->alen
+    +    (double) profillic_sched_ExpectedM(msa, is_profile, symfrac) * calib_residues;
+}
+
+/*---------------------- end, build cost --------------------*/
+
+/*****************************************************************
+ *# 2. The scheduling window.
+ *****************************************************************/
+
+/* One buffered input. */
+typedef struct {
+  ESL_MSA *msa;
+  void    *profile;   /* its own galosh profile, for --profillic-* input; else NULL */
+  int      nali;      /* its number in the input, 1.. */
+  double   cost;      /* profillic_sched_Cost() */
+} PROFILLIC_SCHED_ENTRY;
+
+typedef struct {
+  PROFILLIC_SCHED_ENTRY *e;      /* buffered inputs, oldest first                    */
+  int                    n;      /* number buffered                                  */
+  int                    size;   /* most buffered at once                            */
+  int                    newest; /* nali of the newest input added; 0 before any     */
+  void                 **spare;  /* spare profile handles, for reading into          */
+  int                    nspare;
+} PROFILLIC_SCHED;
+
+/**
+ * <pre>
+ * Function:  profillic_sched_Create()
+ *
+ * Purpose:   Create a scheduling window of <size> inputs (<size> >= 1).
+ *
+ * Throws:    <NULL> on allocation failure.
+ * </pre>
+ */
+static PROFILLIC_SCHED *
+profillic_sched_Create(int size)
+{
+  PROFILLIC_SCHED *s = NULL;
+  int              status;
+
+  ESL_ALLOC_CPP(PROFILLIC_SCHED, s, sizeof(PROFILLIC_SCHED));
+  s->e      = NULL;
+  s->spare  = NULL;
+  s->n      = 0;
+  s->size   = size;
+  s->newest = 0;
+  s->nspare = 0;
+  ESL_ALLOC_CPP(PROFILLIC_SCHED_ENTRY, s->e,     sizeof(PROFILLIC_SCHED_ENTRY) * size);
+  ESL_ALLOC_CPP(void *,                s->spare, sizeof(void *) * (size + 1));
+  return s;
+
+ ERROR:
+  if (s != NULL) { if (s->e != NULL) free(s->e); if (s->spare != NULL) free(s->spare); free(s); }
+  return NULL;
+}
+
+/* TRUE if no more inputs can be added until one is taken. */
+static int
+profillic_sched_IsFull(const PROFILLIC_SCHED *s)
+{
+  return (s->n == s->size);
+}
+
+/* Add input <msa>, with profile handle <profile>, number <nali> and cost <cost>; the window must not be full. */
+static void
+profillic_sched_Add(PROFILLIC_SCHED *s, ESL_MSA *msa, void *profile, int nali, double cost)
+{
+  PROFILLIC_SCHED_ENTRY *e = &(s->e[s->n++]);
+
+  e->msa     = msa;
+  e->profile = profile;
+  e->nali    = nali;
+  e->cost    = cost;
+  s->newest  = nali;
+}
+
+/**
+ * <pre>
+ * Function:  profillic_sched_Take()
+ *
+ * Purpose:   Remove the input to dispatch next into <*ret_e>: the
+ *            costliest buffered one (the oldest of those that tie),
+ *            unless the oldest is 2*<size>-1 or more inputs behind
+ *            the newest, in which case it goes first.
+ *
+ * Returns:   <eslOK> on success; <eslEOD> if the window is empty.
+ * </pre>
+ */
+static int
+profillic_sched_Take(PROFILLIC_SCHED *s, PROFILLIC_SCHED_ENTRY *ret_e)
+{
+  int best = 0;
+  int i;
+
+  if (s->n == 0) return eslEOD;
+  if (s->newest - s->e[0].nali < 2 * s->size - 1)
+    for (i = 1; i < s->n; i++)
+      if (s->e[i].cost > s->e[best].cost) best = i;
+
+  *ret_e = s->e[best];
+  memmove(s->e + best, s->e + best + 1, sizeof(PROFILLIC_SCHED_ENTRY) * (s->n - best - 1));
+  s->n--;
+  return eslOK;
+}
+
+/* Keep profile handle <profile> for reuse (a <NULL> one is ignored). */
+static void
+profillic_sched_PushSpare(PROFILLIC_SCHED *s, void *profile)
+{
+  if (profile != NULL) s->spare[s->nspare++] = profile;
+}
+
+/* A spare profile handle, or <NULL> if there are none (the owner then makes one). */
+static void *
+profillic_sched_PopSpare(PROFILLIC_SCHED *s)
+{
+  return (s->nspare > 0 ? s->spare[--(s->nspare)] : NULL);
+}
+
+/* Free <s>, once its owner has taken (and freed) all its inputs and spares. */
+static void
+profillic_sched_Destroy(PROFILLIC_SCHED *s)
+{
+  if (s == NULL) return;
+  free(s->e);
+  free(s->spare);
+  free(s);
+}
+
+/*---------------------- end, scheduling window --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICSCHEDULE_HPP__
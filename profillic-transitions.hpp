@@ -0,0 +1,202 @@
+/**
+ * \file profillic-transitions.hpp
+ * \brief
+ * Position-independent ("unified") transitions of an HMM.
+ * \details
+ * <pre>
+ * Table of contents:
+ *     1. Averaging and setting internal transitions.
+ *     2. Transition summaries.
+ *     3. Copyright and license.
+ * </pre>
+ *
+ * profillic-hmmunifytransitions and profillic-hmmcopytransitions both
+ * replace the internal (1..M-1) transitions of an HMM by their average,
+ * which is what a galosh profile has; they share the code here.
+ *
+ * These rely on p7_hmm_CreateBody() allocating <t[0..M]> as one block,
+ * so that <t[1..M-1]> is a single run of (M-1)*p7H_NTRANSITIONS floats:
+ * the average is taken over that run four rows (28 floats, seven SSE
+ * vectors) at a time, and the broadcast fills it by doubling memcpy()s.
+ */
+#ifndef __GALOSH_PROFILLICTRANSITIONS_HPP__
+#define __GALOSH_PROFILLICTRANSITIONS_HPP__
+
+extern "C" {
+#include "p7_config.h"
+#include "easel.h"
+#include "esl_vectorops.h"
+#include "base/p7_hmm.h"
+}
+
+#include <string.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/*****************************************************************
+ *# 1. Averaging and setting internal transitions.
+ *****************************************************************/
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_AverageTransitions()
+ *
+ * Purpose:   Set <avg> (of length <p7H_NTRANSITIONS>) to the mean of
+ *            <hmm>'s internal transitions <t[1..M-1]>, renormalized
+ *            as the three distributions (out of match, insert, delete)
+ *            that it is.
+ * </pre>
+ */
+static void
+profillic_hmm_AverageTransitions(const P7_HMM *hmm, float *avg)
+{
+  const float *p     = (hmm->M > 1 ? hmm->t[1] : NULL);
+  int          nrows = hmm->M - 1;
+  int          r     = 0;
+  int          j;
+
+  esl_vec_FSet(avg, p7H_NTRANSITIONS, 0.);
+#if defined(__SSE__)
+  {
+    __m128 acc[p7H_NTRANSITIONS];
+    float  lanes[4 * p7H_NTRANSITIONS];
+
+    for( j = 0; j < p7H_NTRANSITIONS; j++ ) acc[j] = _mm_setzero_ps();
+    for( ; r + 4 <= nrows; r += 4, p += 4 * p7H_NTRANSITIONS ) {
+      for( j = 0; j < p7H_NTRANSITIONS; j++ ) acc[j] = _mm_add_ps(acc[j], _mm_loadu_ps(p + 4 * j));
+    }
+    // Lane i of the 28 holds transition i % 7.
+    for( j = 0; j < p7H_NTRANSITIONS; j++ ) _mm_storeu_ps(lanes + 4 * j, acc[j]);
+    for( j = 0; j < 4 * p7H_NTRANSITIONS; j++ ) avg[j % p7H_NTRANSITIONS] += lanes[j];
+  }
+#endif
+  for( ; r < nrows; r++, p += p7H_NTRANSITIONS ) {
+    esl_vec_FAdd(avg, p, p7H_NTRANSITIONS);
+  }
+  // Match transitions
+  esl_vec_FNorm(avg, 3);
+  // Insert transitions
+  esl_vec_FNorm(avg + 3, 2);
+  // Delete transitions
+  esl_vec_FNorm(avg + 5, 2);
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_SetInternalTransitions()
+ *
+ * Purpose:   Set each of <hmm>'s internal transitions <t[1..M-1]> to
+ *            <trans> (of length <p7H_NTRANSITIONS>).
+ * </pre>
+ */
+static void
+profillic_hmm_SetInternalTransitions(P7_HMM *hmm, const float *trans)
+{
+  int nrows = hmm->M - 1;
+  int done  = 1;
+  int n;
+
+  if( nrows < 1 ) return;
+  esl_vec_FCopy( trans, p7H_NTRANSITIONS, hmm->t[1] );
+  while( done < nrows ) {
+    n = ESL_MIN(done, nrows - done);
+    memcpy( hmm->t[1] + done * p7H_NTRANSITIONS, hmm->t[1], sizeof(float) * n * p7H_NTRANSITIONS );
+    done += n;
+  }
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_UnifyTransitions()
+ *
+ * Purpose:   Reset <hmm>'s internal transitions to their average.
+ * </pre>
+ */
+static void
+profillic_hmm_UnifyTransitions(P7_HMM *hmm)
+{
+  float average_internal_transitions[ p7H_NTRANSITIONS ];
+
+  profillic_hmm_AverageTransitions(hmm, average_internal_transitions);
+  profillic_hmm_SetInternalTransitions(hmm, average_internal_transitions);
+}
+
+/*---------------------- end, internal transitions --------------------*/
+
+/*****************************************************************
+ *# 2. Transition summaries.
+ *****************************************************************/
+
+/**
+ * All that profillic_hmm_CopyTransitions() needs of the model it copies
+ * from: its averaged internal transitions, and its first and last
+ * transitions.  A whole library of these is small enough to keep in
+ * memory when pairing models by name.
+ */
+typedef struct {
+  float avg  [ p7H_NTRANSITIONS ];
+  float first[ p7H_NTRANSITIONS ];
+  float last [ p7H_NTRANSITIONS ];
+} PROFILLIC_TRANSITIONS;
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_SummarizeTransitions()
+ *
+ * Purpose:   Fill <trans> from <hmm>: its averaged internal
+ *            transitions, and its <t[0]> and <t[M]>.
+ * </pre>
+ */
+static void
+profillic_hmm_SummarizeTransitions(const P7_HMM *hmm, PROFILLIC_TRANSITIONS *trans)
+{
+  profillic_hmm_AverageTransitions(hmm, trans->avg);
+  esl_vec_FCopy( hmm->t[0], p7H_NTRANSITIONS, trans->first );
+  esl_vec_FCopy( hmm->t[ hmm->M ], p7H_NTRANSITIONS, trans->last );
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_ApplyTransitions()
+ *
+ * Purpose:   Set <hmm>'s internal transitions to <trans>'s average,
+ *            and its first and last transitions to <trans>'s.
+ * </pre>
+ */
+static void
+profillic_hmm_ApplyTransitions(P7_HMM *hmm, const PROFILLIC_TRANSITIONS *trans)
+{
+  profillic_hmm_SetInternalTransitions(hmm, trans->avg);
+  esl_vec_FCopy( trans->first, p7H_NTRANSITIONS, hmm->t[0] );
+  esl_vec_FCopy( trans->last, p7H_NTRANSITIONS, hmm->t[ hmm->M ] );
+}
+
+/**
+ * <pre>
+ * Function:  profillic_hmm_CopyTransitions()
+ *
+ * Purpose:   Set <hmm>'s internal transitions to the average of
+ *            <transhmm>'s, and copy over <transhmm>'s first and last
+ *            (non-internal, so never averaged) transitions too.  The
+ *            two models need not be the same length.
+ * </pre>
+ */
+static void
+profillic_hmm_CopyTransitions(P7_HMM *hmm, const P7_HMM *transhmm)
+{
+  PROFILLIC_TRANSITIONS trans;
+
+  profillic_hmm_SummarizeTransitions(transhmm, &trans);
+  profillic_hmm_ApplyTransitions(hmm, &trans);
+}
+
+/*---------------------- end, transition summaries --------------------*/
+
+/**
+ * \par Licence:
+ *****************************************************************
+ * @LICENSE@
+ *****************************************************************/
+
+#endif // __GALOSH_PROFILLICTRANSITIONS_HPP__